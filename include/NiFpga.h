@@ -633,6 +633,197 @@ NiFpga_Status NiFpga_Reset(NiFpga_Session session);
  */
 NiFpga_Status NiFpga_Download(NiFpga_Session session);
 
+/**
+ * Decodes the bitstream and generates the device tree overlay of a bitfile
+ * into the firmware cache without downloading it, so that a later
+ * NiFpga_Open or NiFpga_Download of the same bitfile only has to verify
+ * they're intact. Does nothing but verify them if they're already cached.
+ *
+ * The cache is kept in $NIFPGA_FIRMWARE_DIR, or /lib/firmware by default. If
+ * $NIFPGA_FIRMWARE_CACHE_SIZE is set, in bytes with an optional K, M, or G
+ * suffix, the least recently used bitfiles beyond that size are removed from
+ * it whenever another is added.
+ *
+ * @param bitfile path to the bitfile
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WarmFirmwareCache(const char *bitfile);
+
+/**
+ * A bitfile being prepared in the background by NiFpgaEx_PrepareBitfile.
+ */
+typedef uint32_t NiFpgaEx_PreparedBitfile;
+
+/**
+ * Starts parsing a bitfile and preparing its firmware, as
+ * NiFpgaEx_WarmFirmwareCache does, on a background thread, and returns
+ * without waiting for it. Whatever is running on the FPGA keeps running in the
+ * meantime, and a later NiFpgaEx_OpenPrepared or NiFpgaEx_DownloadPrepared
+ * with the result only has to load it.
+ *
+ * Errors in preparing the bitfile are returned by whichever of those, or
+ * NiFpgaEx_ReleasePrepared, it's passed to, each of which releases it.
+ *
+ * @param bitfile path to the bitfile
+ * @param prepared outputs the prepared bitfile, which must be passed to
+ *                 NiFpgaEx_OpenPrepared, NiFpgaEx_DownloadPrepared, or
+ *                 NiFpgaEx_ReleasePrepared when no longer needed
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_PrepareBitfile(const char *bitfile,
+                                      NiFpgaEx_PreparedBitfile *prepared);
+
+/**
+ * Opens a session as NiFpga_Open does, but with a bitfile prepared by
+ * NiFpgaEx_PrepareBitfile, waiting for it to finish being prepared if it
+ * hasn't already. The prepared bitfile is released, whether or not this
+ * succeeds.
+ *
+ * @param prepared bitfile prepared by NiFpgaEx_PrepareBitfile
+ * @param signature signature of the bitfile, or NULL to not verify signature
+ * @param resource RIO resource string to open ("RIO0")
+ * @param attribute bitwise OR of any NiFpga_OpenAttributes, or 0
+ * @param session outputs the session handle, which must be closed when no
+ *                longer needed
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_OpenPrepared(NiFpgaEx_PreparedBitfile prepared,
+                                    const char *signature,
+                                    const char *resource, uint32_t attribute,
+                                    NiFpga_Session *session);
+
+/**
+ * Re-downloads the FPGA bitstream to the target as NiFpga_Download does, but
+ * from a prepared copy of the session's own bitfile, waiting for it to finish
+ * being prepared if it hasn't already. The prepared bitfile is released,
+ * whether or not this succeeds, unless the session is invalid or it isn't the
+ * session's bitfile, in which case it's left prepared to be used elsewhere.
+ *
+ * @param session handle to a currently open session
+ * @param prepared the session's bitfile, prepared by NiFpgaEx_PrepareBitfile
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_DownloadPrepared(NiFpga_Session session,
+                                        NiFpgaEx_PreparedBitfile prepared);
+
+/**
+ * Releases a bitfile prepared by NiFpgaEx_PrepareBitfile without using it,
+ * waiting for it to finish being prepared if it hasn't already. What was
+ * prepared stays in the firmware cache.
+ *
+ * @param prepared bitfile prepared by NiFpgaEx_PrepareBitfile
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReleasePrepared(NiFpgaEx_PreparedBitfile prepared);
+
+/**
+ * Stages of opening a session or downloading a bitfile that
+ * NiFpgaEx_GetStageTimings reports on.
+ */
+typedef enum {
+  /** Parsing the bitfile, or loading it from the bitfile cache. */
+  NiFpgaEx_TimingStage_Parse = 0,
+  /** Decoding the bitstream. */
+  NiFpgaEx_TimingStage_Decode = 1,
+  /** Writing the decoded bitstream to the firmware cache. */
+  NiFpgaEx_TimingStage_Write = 2,
+  /** Hashing a cached bitstream to check that it's intact. */
+  NiFpgaEx_TimingStage_Verify = 3,
+  /** Generating the device tree overlay. */
+  NiFpgaEx_TimingStage_Overlay = 4,
+  /** Loading the firmware onto the FPGA and applying its overlay. */
+  NiFpgaEx_TimingStage_Load = 5,
+  /** Waiting for device nodes and attributes to appear. */
+  NiFpgaEx_TimingStage_DeviceNode = 6,
+  /** Reading sysfs attributes. */
+  NiFpgaEx_TimingStage_SysfsRead = 7,
+  /** Mapping the FPGA's registers into memory. */
+  NiFpgaEx_TimingStage_MapMemory = 8,
+  /** Creating the session's FIFOs. */
+  NiFpgaEx_TimingStage_Fifos = 9,
+  /** Number of stages, which may grow in later versions. */
+  NiFpgaEx_TimingStage_Count = 10
+} NiFpgaEx_TimingStage;
+
+/**
+ * How long one stage took in total, however many times it happened.
+ */
+typedef struct {
+  /** Total time spent in the stage, in nanoseconds. */
+  uint64_t nanoseconds;
+  /** Number of times the stage happened. */
+  uint32_t count;
+} NiFpgaEx_StageTiming;
+
+/**
+ * Gets how long each stage of the last NiFpga_Open, NiFpga_Download,
+ * NiFpgaEx_OpenPrepared, NiFpgaEx_DownloadPrepared, or
+ * NiFpgaEx_WarmFirmwareCache made on the calling thread took, whether or not
+ * it succeeded. Stages of a prepared bitfile count toward the call that used
+ * it, though they happened beforehand. Time spent in a stage nested within
+ * another, such as waiting for an attribute to appear while reading it, only
+ * counts toward the innermost one, so stages never overlap.
+ *
+ * If $NIFPGA_TIMING_LOG is set, each of those calls also logs the same as one
+ * line of JSON, appended to the file it names if it's an absolute path or
+ * written to stderr otherwise.
+ *
+ * @param timings outputs the timings, indexed by NiFpgaEx_TimingStage
+ * @param count number of elements in timings, of which at most
+ *              NiFpgaEx_TimingStage_Count are written
+ * @param total outputs how long the whole call took in nanoseconds, or NULL
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_GetStageTimings(NiFpgaEx_StageTiming *timings,
+                                       size_t count, uint64_t *total);
+
+/**
+ * Writes the calls most recently made on every thread to a file descriptor,
+ * one line of JSON per call, oldest first on each thread. The library keeps the
+ * last 256 calls made on each thread that reached a session, with the entry
+ * point, session, resource, number of elements, status, and how long each
+ * took, at a cost of a few nanoseconds per call.
+ *
+ * If $NIFPGA_FLIGHT_RECORDER_LOG is set, the same is also dumped each time a
+ * session is closed and whenever the process receives SIGUSR2, unless the
+ * process already handles SIGUSR2 itself: appended to the file it names if
+ * it's an absolute path, or written to stderr otherwise.
+ *
+ * This is safe to call from a signal handler.
+ *
+ * @param descriptor file descriptor to write to
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_DumpFlightRecorder(int descriptor);
+
+/**
+ * Run states of the FPGA VI that NiFpgaEx_WaitOnViState can wait on.
+ */
+typedef enum {
+  /** The VI has been started and has not yet finished. */
+  NiFpgaEx_ViState_Running = 1,
+  /** The VI ran to completion on its own. */
+  NiFpgaEx_ViState_Finished = 1 << 1,
+  /** The VI is not running because it was aborted, reset, or never run. */
+  NiFpgaEx_ViState_Aborted = 1 << 2
+} NiFpgaEx_ViState;
+
+/**
+ * Blocks the calling thread until the FPGA VI is in any of the given run
+ * states, or until the function call times out. This does not busy-wait, so it
+ * is suitable for waiting on long-running VIs.
+ *
+ * @param session handle to a currently open session
+ * @param states bitwise OR of NiFpgaEx_ViStates to wait on
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param state if non-NULL, outputs the last state observed
+ * @param timedOut if non-NULL, outputs whether the timeout expired
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WaitOnViState(NiFpga_Session session, uint32_t states,
+                                     uint32_t timeout, NiFpgaEx_ViState *state,
+                                     NiFpga_Bool *timedOut);
+
 /** Any indicator, control, or FIFO resource. */
 typedef uint32_t NiFpgaEx_Resource;
 
@@ -649,6 +840,8 @@ typedef NiFpgaEx_Register NiFpgaEx_RegisterI64;
 typedef NiFpgaEx_Register NiFpgaEx_RegisterU64;
 typedef NiFpgaEx_Register NiFpgaEx_RegisterSgl;
 typedef NiFpgaEx_Register NiFpgaEx_RegisterDbl;
+typedef NiFpgaEx_Register NiFpgaEx_RegisterFxp;
+typedef NiFpgaEx_Register NiFpgaEx_RegisterCluster;
 
 /** Any array indicator or control resource. */
 typedef NiFpgaEx_Register NiFpgaEx_RegisterArray;
@@ -663,6 +856,7 @@ typedef NiFpgaEx_RegisterArray NiFpgaEx_RegisterArrayI64;
 typedef NiFpgaEx_RegisterArray NiFpgaEx_RegisterArrayU64;
 typedef NiFpgaEx_RegisterArray NiFpgaEx_RegisterArraySgl;
 typedef NiFpgaEx_RegisterArray NiFpgaEx_RegisterArrayDbl;
+typedef NiFpgaEx_RegisterArray NiFpgaEx_RegisterArrayFxp;
 
 /** Any target-to-host or host-to-target DMA FIFO resource. */
 typedef NiFpgaEx_Resource NiFpgaEx_DmaFifo;
@@ -680,6 +874,8 @@ typedef NiFpgaEx_TargetToHostFifo NiFpgaEx_TargetToHostFifoI64;
 typedef NiFpgaEx_TargetToHostFifo NiFpgaEx_TargetToHostFifoU64;
 typedef NiFpgaEx_TargetToHostFifo NiFpgaEx_TargetToHostFifoSgl;
 typedef NiFpgaEx_TargetToHostFifo NiFpgaEx_TargetToHostFifoDbl;
+typedef NiFpgaEx_TargetToHostFifo NiFpgaEx_TargetToHostFifoFxp;
+typedef NiFpgaEx_TargetToHostFifo NiFpgaEx_TargetToHostFifoCluster;
 
 /** Any host-to-target DMA FIFO resource. */
 typedef NiFpgaEx_DmaFifo NiFpgaEx_HostToTargetFifo;
@@ -694,6 +890,8 @@ typedef NiFpgaEx_HostToTargetFifo NiFpgaEx_HostToTargetFifoI64;
 typedef NiFpgaEx_HostToTargetFifo NiFpgaEx_HostToTargetFifoU64;
 typedef NiFpgaEx_HostToTargetFifo NiFpgaEx_HostToTargetFifoSgl;
 typedef NiFpgaEx_HostToTargetFifo NiFpgaEx_HostToTargetFifoDbl;
+typedef NiFpgaEx_HostToTargetFifo NiFpgaEx_HostToTargetFifoFxp;
+typedef NiFpgaEx_HostToTargetFifo NiFpgaEx_HostToTargetFifoCluster;
 
 /** Any peer-to-peer FIFO resource. */
 typedef NiFpgaEx_Resource NiFpgaEx_PeerToPeerFifo;
@@ -769,6 +967,16 @@ typedef enum {
   NiFpgaEx_ResourceType_ControlArrayDbl = 63,
   NiFpgaEx_ResourceType_TargetToHostFifoDbl = 64,
   NiFpgaEx_ResourceType_HostToTargetFifoDbl = 65,
+  NiFpgaEx_ResourceType_IndicatorFxp = 66,
+  NiFpgaEx_ResourceType_ControlFxp = 67,
+  NiFpgaEx_ResourceType_IndicatorArrayFxp = 68,
+  NiFpgaEx_ResourceType_ControlArrayFxp = 69,
+  NiFpgaEx_ResourceType_IndicatorCluster = 70,
+  NiFpgaEx_ResourceType_ControlCluster = 71,
+  NiFpgaEx_ResourceType_TargetToHostFifoFxp = 72,
+  NiFpgaEx_ResourceType_HostToTargetFifoFxp = 73,
+  NiFpgaEx_ResourceType_TargetToHostFifoCluster = 74,
+  NiFpgaEx_ResourceType_HostToTargetFifoCluster = 75,
   NiFpgaEx_ResourceType_Any = 0xFFFFFFFF
 } NiFpgaEx_ResourceType;
 
@@ -787,6 +995,27 @@ NiFpga_Status NiFpgaEx_FindResource(NiFpga_Session session, const char *name,
                                     NiFpgaEx_ResourceType type,
                                     NiFpgaEx_Resource *resource);
 
+/**
+ * Finds many resources at once, as if by calling NiFpgaEx_FindResource for
+ * each, for resolving everything an application needs when it starts. Every
+ * resource is looked up even if others aren't found.
+ *
+ * @param session handle to a currently open session
+ * @param names name of each resource
+ * @param types type of each resource
+ * @param count number of resources
+ * @param resources outputs each resource if it was found, or 0 if not
+ * @param statuses outputs the result of finding each resource, or NULL if not
+ *                 needed
+ * @return result of the call, merged from the result for each resource
+ */
+NiFpga_Status NiFpgaEx_FindResources(NiFpga_Session session,
+                                     const char *const *names,
+                                     const NiFpgaEx_ResourceType *types,
+                                     size_t count,
+                                     NiFpgaEx_Resource *resources,
+                                     NiFpga_Status *statuses);
+
 /**
  * Reads a boolean value from a given indicator or control.
  *
@@ -1403,6 +1632,218 @@ NiFpga_Status NiFpga_WriteArrayDbl(NiFpga_Session session,
                                    NiFpgaEx_RegisterArrayDbl reg,
                                    const double *array, size_t size);
 
+/**
+ * Gets the session's direct mapping of FPGA address space, so that generated
+ * code can access 32-bit and smaller controls and indicators with plain loads
+ * and stores instead of calling NiFpga_Read* and NiFpga_Write*.
+ *
+ * A register's byte offset into the mapping is its offset in the bitfile,
+ * which is the value returned by NiFpgaEx_FindResource minus the bitfile's
+ * base address on device, with the bottom two bits cleared. Every access must
+ * be a single aligned 32-bit load or store. Registers whose access may time
+ * out must not be accessed this way, as no error would be reported.
+ *
+ * @warning The mapping is only valid until the session is closed or
+ *          NiFpga_Download is called.
+ *
+ * @param session handle to a currently open session
+ * @param registers outputs the start of the mapping
+ * @param size outputs the size of the mapping in bytes
+ * @return result of the call, which is NiFpga_Status_FeatureNotSupported if
+ *         the device doesn't support mapping its registers
+ */
+NiFpga_Status NiFpgaEx_GetMappedRegisters(NiFpga_Session session,
+                                          volatile void **registers,
+                                          size_t *size);
+
+/**
+ * Format of a fixed-point control or indicator, as described by the bitfile.
+ * The value is the word interpreted as an integer (two's complement if
+ * signed), multiplied by 2^(integerWordLength - wordLength).
+ */
+typedef struct {
+  /** Whether the word is signed. */
+  NiFpga_Bool isSigned;
+  /** Number of bits in the word, from 1 to 64. */
+  uint32_t wordLength;
+  /** Number of integer bits, which may be negative or exceed wordLength. */
+  int16_t integerWordLength;
+  /** Whether an overflow status bit accompanies the word. */
+  NiFpga_Bool includeOverflowStatus;
+} NiFpgaEx_FxpTypeInfo;
+
+/**
+ * Gets the format of a fixed-point control or indicator.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point control or indicator, scalar or array
+ * @param typeInfo outputs the format
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_GetFxpTypeInfo(NiFpga_Session session,
+                                      NiFpgaEx_Register reg,
+                                      NiFpgaEx_FxpTypeInfo *typeInfo);
+
+/**
+ * Reads a fixed-point value from a given indicator or control, converted to
+ * a 64-bit double.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point indicator or control from which to read
+ * @param value outputs the value that was read
+ * @param overflow outputs the overflow status, or NULL if not needed. Always
+ *                 false for types without overflow status.
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadFxpDbl(NiFpga_Session session,
+                                  NiFpgaEx_RegisterFxp reg, double *value,
+                                  NiFpga_Bool *overflow);
+
+/**
+ * Reads a fixed-point value from a given indicator or control, converted to
+ * a 32-bit float.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point indicator or control from which to read
+ * @param value outputs the value that was read
+ * @param overflow outputs the overflow status, or NULL if not needed. Always
+ *                 false for types without overflow status.
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadFxpSgl(NiFpga_Session session,
+                                  NiFpgaEx_RegisterFxp reg, float *value,
+                                  NiFpga_Bool *overflow);
+
+/**
+ * Writes a 64-bit double value to a given fixed-point control or indicator.
+ * The value is rounded to the nearest representable value, with ties to
+ * even, and saturated to the range of the type. If the type includes
+ * overflow status, it is set when the value had to be saturated.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point control or indicator to which to write
+ * @param value value to write
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteFxpDbl(NiFpga_Session session,
+                                   NiFpgaEx_RegisterFxp reg, double value);
+
+/**
+ * Writes a 32-bit float value to a given fixed-point control or indicator,
+ * converted as in NiFpgaEx_WriteFxpDbl.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point control or indicator to which to write
+ * @param value value to write
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteFxpSgl(NiFpga_Session session,
+                                   NiFpgaEx_RegisterFxp reg, float value);
+
+/**
+ * Reads an entire array of fixed-point values from a given array indicator
+ * or control, converted to 64-bit doubles.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point array indicator or control from which to read
+ * @param array outputs the entire array that was read
+ * @param size exact number of elements in the indicator or control
+ * @param overflows outputs the overflow status of each element, or NULL if
+ *                  not needed
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadArrayFxpDbl(NiFpga_Session session,
+                                       NiFpgaEx_RegisterArrayFxp reg,
+                                       double *array, size_t size,
+                                       NiFpga_Bool *overflows);
+
+/**
+ * Reads an entire array of fixed-point values from a given array indicator
+ * or control, converted to 32-bit floats.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point array indicator or control from which to read
+ * @param array outputs the entire array that was read
+ * @param size exact number of elements in the indicator or control
+ * @param overflows outputs the overflow status of each element, or NULL if
+ *                  not needed
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadArrayFxpSgl(NiFpga_Session session,
+                                       NiFpgaEx_RegisterArrayFxp reg,
+                                       float *array, size_t size,
+                                       NiFpga_Bool *overflows);
+
+/**
+ * Writes an entire array of 64-bit double values to a given fixed-point
+ * array control or indicator, converted as in NiFpgaEx_WriteFxpDbl.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point array control or indicator to which to write
+ * @param array entire array to write
+ * @param size exact number of elements in the control or indicator
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteArrayFxpDbl(NiFpga_Session session,
+                                        NiFpgaEx_RegisterArrayFxp reg,
+                                        const double *array, size_t size);
+
+/**
+ * Writes an entire array of 32-bit float values to a given fixed-point
+ * array control or indicator, converted as in NiFpgaEx_WriteFxpDbl.
+ *
+ * @param session handle to a currently open session
+ * @param reg fixed-point array control or indicator to which to write
+ * @param array entire array to write
+ * @param size exact number of elements in the control or indicator
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteArrayFxpSgl(NiFpga_Session session,
+                                        NiFpgaEx_RegisterArrayFxp reg,
+                                        const float *array, size_t size);
+
+/**
+ * Reads an entire cluster from a given cluster indicator or control in a
+ * single transaction, so that all of its fields are consistent.
+ *
+ * The cluster is unpacked into a struct described by the caller. Nested
+ * clusters are flattened into their fields, in order, and fieldOffsets gives
+ * the offset (as from offsetof) of each of these fields within the struct.
+ * Each field is stored as its usual C type, such as NiFpga_Bool or uint16_t,
+ * except that fixed-point fields are stored as doubles. Array fields occupy
+ * consecutive elements starting at their offset.
+ *
+ * @param session handle to a currently open session
+ * @param reg cluster indicator or control from which to read
+ * @param cluster outputs the fields of the cluster that was read
+ * @param fieldOffsets offset of each field within the struct
+ * @param fieldCount exact number of fields in the flattened cluster
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadCluster(NiFpga_Session session,
+                                   NiFpgaEx_RegisterCluster reg,
+                                   void *cluster,
+                                   const size_t *fieldOffsets,
+                                   size_t fieldCount);
+
+/**
+ * Writes an entire cluster to a given cluster control or indicator in a
+ * single transaction, from a struct described as in NiFpgaEx_ReadCluster.
+ * Fixed-point fields are converted as in NiFpgaEx_WriteFxpDbl.
+ *
+ * @param session handle to a currently open session
+ * @param reg cluster control or indicator to which to write
+ * @param cluster fields of the cluster to write
+ * @param fieldOffsets offset of each field within the struct
+ * @param fieldCount exact number of fields in the flattened cluster
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteCluster(NiFpga_Session session,
+                                    NiFpgaEx_RegisterCluster reg,
+                                    const void *cluster,
+                                    const size_t *fieldOffsets,
+                                    size_t fieldCount);
+
 /**
  * Enumeration of all 32 possible IRQs. Multiple IRQs can be bitwise ORed
  * together like this:
@@ -1956,6 +2397,145 @@ NiFpga_Status NiFpga_WriteFifoDbl(NiFpga_Session session,
                                   uint32_t timeout,
                                   size_t *emptyElementsRemaining);
 
+/**
+ * Reads from a target-to-host FIFO of fixed-point values, converted to 64-bit
+ * doubles as they're copied out of the host memory buffer.
+ *
+ * @param session handle to a currently open session
+ * @param fifo fixed-point target-to-host FIFO from which to read
+ * @param data outputs the data that was read
+ * @param numberOfElements number of elements to read
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param overflows outputs the overflow status of each element, or NULL if
+ *                  not needed
+ * @param elementsRemaining if non-NULL, outputs the number of elements
+ *                          remaining in the host memory part of the DMA FIFO
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadFifoFxpDbl(NiFpga_Session session,
+                                      NiFpgaEx_TargetToHostFifoFxp fifo,
+                                      double *data, size_t numberOfElements,
+                                      uint32_t timeout, NiFpga_Bool *overflows,
+                                      size_t *elementsRemaining);
+
+/**
+ * Reads from a target-to-host FIFO of fixed-point values, converted to 32-bit
+ * floats as they're copied out of the host memory buffer.
+ *
+ * @param session handle to a currently open session
+ * @param fifo fixed-point target-to-host FIFO from which to read
+ * @param data outputs the data that was read
+ * @param numberOfElements number of elements to read
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param overflows outputs the overflow status of each element, or NULL if
+ *                  not needed
+ * @param elementsRemaining if non-NULL, outputs the number of elements
+ *                          remaining in the host memory part of the DMA FIFO
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadFifoFxpSgl(NiFpga_Session session,
+                                      NiFpgaEx_TargetToHostFifoFxp fifo,
+                                      float *data, size_t numberOfElements,
+                                      uint32_t timeout, NiFpga_Bool *overflows,
+                                      size_t *elementsRemaining);
+
+/**
+ * Writes 64-bit doubles to a host-to-target FIFO of fixed-point values,
+ * converted as in NiFpgaEx_WriteFxpDbl as they're copied into the host memory
+ * buffer.
+ *
+ * @param session handle to a currently open session
+ * @param fifo fixed-point host-to-target FIFO to which to write
+ * @param data data to write
+ * @param numberOfElements number of elements to write
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param emptyElementsRemaining if non-NULL, outputs the number of empty
+ *                               elements remaining in the host memory part of
+ *                               the DMA FIFO
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteFifoFxpDbl(NiFpga_Session session,
+                                       NiFpgaEx_HostToTargetFifoFxp fifo,
+                                       const double *data,
+                                       size_t numberOfElements,
+                                       uint32_t timeout,
+                                       size_t *emptyElementsRemaining);
+
+/**
+ * Writes 32-bit floats to a host-to-target FIFO of fixed-point values,
+ * converted as in NiFpgaEx_WriteFxpDbl as they're copied into the host memory
+ * buffer.
+ *
+ * @param session handle to a currently open session
+ * @param fifo fixed-point host-to-target FIFO to which to write
+ * @param data data to write
+ * @param numberOfElements number of elements to write
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param emptyElementsRemaining if non-NULL, outputs the number of empty
+ *                               elements remaining in the host memory part of
+ *                               the DMA FIFO
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteFifoFxpSgl(NiFpga_Session session,
+                                       NiFpgaEx_HostToTargetFifoFxp fifo,
+                                       const float *data,
+                                       size_t numberOfElements,
+                                       uint32_t timeout,
+                                       size_t *emptyElementsRemaining);
+
+/**
+ * Reads from a target-to-host FIFO of clusters, unpacking each element into
+ * an array of structs described as in NiFpgaEx_ReadCluster as it's copied out
+ * of the host memory buffer.
+ *
+ * @param session handle to a currently open session
+ * @param fifo cluster target-to-host FIFO from which to read
+ * @param data outputs the structs that were read
+ * @param stride size in bytes of each struct, such as from sizeof
+ * @param fieldOffsets offset of each field within a struct
+ * @param fieldCount exact number of fields in the flattened cluster
+ * @param numberOfElements number of elements to read
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param elementsRemaining if non-NULL, outputs the number of elements
+ *                          remaining in the host memory part of the DMA FIFO
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_ReadFifoCluster(NiFpga_Session session,
+                                       NiFpgaEx_TargetToHostFifoCluster fifo,
+                                       void *data, size_t stride,
+                                       const size_t *fieldOffsets,
+                                       size_t fieldCount,
+                                       size_t numberOfElements,
+                                       uint32_t timeout,
+                                       size_t *elementsRemaining);
+
+/**
+ * Writes to a host-to-target FIFO of clusters, packing each element from an
+ * array of structs described as in NiFpgaEx_ReadCluster as it's copied into
+ * the host memory buffer.
+ *
+ * @param session handle to a currently open session
+ * @param fifo cluster host-to-target FIFO to which to write
+ * @param data structs to write
+ * @param stride size in bytes of each struct, such as from sizeof
+ * @param fieldOffsets offset of each field within a struct
+ * @param fieldCount exact number of fields in the flattened cluster
+ * @param numberOfElements number of elements to write
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param emptyElementsRemaining if non-NULL, outputs the number of empty
+ *                               elements remaining in the host memory part of
+ *                               the DMA FIFO
+ * @return result of the call
+ */
+NiFpga_Status NiFpgaEx_WriteFifoCluster(NiFpga_Session session,
+                                        NiFpgaEx_HostToTargetFifoCluster fifo,
+                                        const void *data, size_t stride,
+                                        const size_t *fieldOffsets,
+                                        size_t fieldCount,
+                                        size_t numberOfElements,
+                                        uint32_t timeout,
+                                        size_t *emptyElementsRemaining);
+
 /**
  * Acquires elements for reading from a target-to-host FIFO of booleans.
  *
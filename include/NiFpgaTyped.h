@@ -0,0 +1,368 @@
+/*
+ * Typed C++ access to the controls, indicators, and DMA FIFOs of a specific
+ * bitfile, for use with the headers that lvbitx2h generates.
+ *
+ * A generated header describes each resource as a type carrying its offset,
+ * element type, and whether its access may time out, so that reading or
+ * writing a 32-bit or smaller control or indicator compiles down to a single
+ * load or store to the session's mapped registers, and anything else calls
+ * straight into the matching NiFpga_* or NiFpgaEx_* function without a
+ * lookup by name.
+ *
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "NiFpga.h"
+
+#if !defined(NiFpga_Cpp11)
+#error NiFpgaTyped.h requires C++11 or later.
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+namespace nifpga {
+
+/*
+ * Element types. Each names the C type callers use, the type of a single
+ * mapped access if the element fits in one (or void if not), and the C API
+ * functions to call otherwise.
+ */
+#define NiFpgaTyped_DefineType(T, C, Mapped)                                   \
+  struct T {                                                                   \
+    typedef C CType;                                                           \
+    typedef Mapped MappedType;                                                 \
+    static NiFpga_Status read(NiFpga_Session session, uint32_t reg,            \
+                              C *value) {                                      \
+      return NiFpga_Read##T(session, reg, value);                              \
+    }                                                                          \
+    static NiFpga_Status write(NiFpga_Session session, uint32_t reg,           \
+                               C value) {                                      \
+      return NiFpga_Write##T(session, reg, value);                             \
+    }                                                                          \
+    static NiFpga_Status readArray(NiFpga_Session session, uint32_t reg,       \
+                                   C *array, size_t size) {                    \
+      return NiFpga_ReadArray##T(session, reg, array, size);                   \
+    }                                                                          \
+    static NiFpga_Status writeArray(NiFpga_Session session, uint32_t reg,      \
+                                    const C *array, size_t size) {             \
+      return NiFpga_WriteArray##T(session, reg, array, size);                  \
+    }                                                                          \
+    static NiFpga_Status readFifo(NiFpga_Session session, uint32_t fifo,       \
+                                  C *data, size_t numberOfElements,            \
+                                  uint32_t timeout, size_t *remaining) {       \
+      return NiFpga_ReadFifo##T(session, fifo, data, numberOfElements,         \
+                                timeout, remaining);                           \
+    }                                                                          \
+    static NiFpga_Status writeFifo(NiFpga_Session session, uint32_t fifo,      \
+                                   const C *data, size_t numberOfElements,     \
+                                   uint32_t timeout, size_t *remaining) {      \
+      return NiFpga_WriteFifo##T(session, fifo, data, numberOfElements,        \
+                                 timeout, remaining);                          \
+    }                                                                          \
+  };
+
+/* Integers are always accessed as 32 bits, and Sgl as a float. */
+NiFpgaTyped_DefineType(Bool, NiFpga_Bool, uint32_t)
+NiFpgaTyped_DefineType(I8, int8_t, uint32_t)
+NiFpgaTyped_DefineType(U8, uint8_t, uint32_t)
+NiFpgaTyped_DefineType(I16, int16_t, uint32_t)
+NiFpgaTyped_DefineType(U16, uint16_t, uint32_t)
+NiFpgaTyped_DefineType(I32, int32_t, uint32_t)
+NiFpgaTyped_DefineType(U32, uint32_t, uint32_t)
+NiFpgaTyped_DefineType(I64, int64_t, void)
+NiFpgaTyped_DefineType(U64, uint64_t, void)
+NiFpgaTyped_DefineType(Sgl, float, float)
+NiFpgaTyped_DefineType(Dbl, double, void)
+
+#undef NiFpgaTyped_DefineType
+
+/*
+ * Fixed-point element type, converted to and from doubles by the library.
+ * The format is recorded so that code can check it at compile time.
+ */
+template <bool Signed, uint32_t WordLength, int16_t IntegerWordLength,
+          bool OverflowStatus>
+struct Fxp {
+  typedef double CType;
+  typedef void MappedType;
+  static constexpr bool isSigned = Signed;
+  static constexpr uint32_t wordLength = WordLength;
+  static constexpr int16_t integerWordLength = IntegerWordLength;
+  static constexpr bool includeOverflowStatus = OverflowStatus;
+  static NiFpga_Status read(NiFpga_Session session, uint32_t reg,
+                            double *value) {
+    return NiFpgaEx_ReadFxpDbl(session, reg, value, NULL);
+  }
+  static NiFpga_Status write(NiFpga_Session session, uint32_t reg,
+                             double value) {
+    return NiFpgaEx_WriteFxpDbl(session, reg, value);
+  }
+  static NiFpga_Status readArray(NiFpga_Session session, uint32_t reg,
+                                 double *array, size_t size) {
+    return NiFpgaEx_ReadArrayFxpDbl(session, reg, array, size, NULL);
+  }
+  static NiFpga_Status writeArray(NiFpga_Session session, uint32_t reg,
+                                  const double *array, size_t size) {
+    return NiFpgaEx_WriteArrayFxpDbl(session, reg, array, size);
+  }
+  static NiFpga_Status readFifo(NiFpga_Session session, uint32_t fifo,
+                                double *data, size_t numberOfElements,
+                                uint32_t timeout, size_t *remaining) {
+    return NiFpgaEx_ReadFifoFxpDbl(session, fifo, data, numberOfElements,
+                                   timeout, NULL, remaining);
+  }
+  static NiFpga_Status writeFifo(NiFpga_Session session, uint32_t fifo,
+                                 const double *data, size_t numberOfElements,
+                                 uint32_t timeout, size_t *remaining) {
+    return NiFpgaEx_WriteFifoFxpDbl(session, fifo, data, numberOfElements,
+                                    timeout, remaining);
+  }
+};
+
+/*
+ * Bit that NiFpgaEx_FindResource sets in controls and indicators whose access
+ * may time out because they're in an external clock domain.
+ */
+static constexpr uint32_t accessMayTimeoutBit = 1U << 31;
+
+/**
+ * A scalar control or indicator.
+ *
+ * @tparam Bitfile generated description of the bitfile it belongs to
+ * @tparam T element type
+ * @tparam Offset offset in the bitfile, as in its XML
+ * @tparam Indicator whether it's an indicator rather than a control
+ * @tparam AccessMayTimeout whether its access may time out
+ */
+template <typename Bitfile, typename T, uint32_t Offset, bool Indicator,
+          bool AccessMayTimeout>
+struct Register {
+  typedef Bitfile BitfileType;
+  typedef T Type;
+  static constexpr uint32_t offset = Offset;
+  static constexpr bool isIndicator = Indicator;
+  static constexpr bool isAccessMayTimeout = AccessMayTimeout;
+  /** Value NiFpgaEx_FindResource would return. */
+  static constexpr uint32_t resource =
+      (Bitfile::baseAddressOnDevice + Offset) |
+      (AccessMayTimeout ? accessMayTimeoutBit : 0);
+  /**
+   * Whether it can be accessed through the mapping. Accesses that may time
+   * out must go through the library so it can check for the timeout.
+   */
+  static constexpr bool isMappable =
+      !std::is_void<typename T::MappedType>::value && !AccessMayTimeout;
+};
+
+/**
+ * An array control or indicator.
+ *
+ * @tparam Size number of elements
+ */
+template <typename Bitfile, typename T, uint32_t Offset, size_t Size,
+          bool Indicator, bool AccessMayTimeout>
+struct ArrayRegister {
+  typedef Bitfile BitfileType;
+  typedef T Type;
+  static constexpr uint32_t offset = Offset;
+  static constexpr size_t size = Size;
+  static constexpr bool isIndicator = Indicator;
+  static constexpr bool isAccessMayTimeout = AccessMayTimeout;
+  /** Value NiFpgaEx_FindResource would return. */
+  static constexpr uint32_t resource =
+      (Bitfile::baseAddressOnDevice + Offset) |
+      (AccessMayTimeout ? accessMayTimeoutBit : 0);
+};
+
+/**
+ * A DMA FIFO.
+ *
+ * @tparam Number FIFO number
+ * @tparam HostToTarget whether it's host-to-target rather than
+ *                      target-to-host
+ */
+template <typename Bitfile, typename T, uint32_t Number, bool HostToTarget>
+struct Fifo {
+  typedef Bitfile BitfileType;
+  typedef T Type;
+  static constexpr uint32_t number = Number;
+  static constexpr bool isHostToTarget = HostToTarget;
+};
+
+/**
+ * A session opened on the bitfile a generated header describes.
+ *
+ * Opening passes the generated signature to NiFpga_Open, which fails with
+ * NiFpga_Status_SignatureMismatch if the bitfile on disk or the one already
+ * on the FPGA was recompiled since the header was generated. Resources from
+ * any other generated header fail to compile.
+ *
+ * If the device's registers can't be mapped, every access falls back to the
+ * C API, which behaves the same but costs a call into the library.
+ *
+ * @tparam Bitfile generated description of the bitfile
+ */
+template <typename Bitfile> class Session {
+public:
+  /**
+   * Opens a session as NiFpga_Open does. Check getStatus afterwards.
+   *
+   * @param path path to the bitfile
+   * @param resource RIO resource string, such as "RIO0"
+   * @param attribute bitwise OR of any NiFpga_OpenAttributes, or 0
+   */
+  Session(const char *path, const char *resource, uint32_t attribute = 0)
+      : session(0), registers(NULL) {
+    status =
+        NiFpga_Open(path, Bitfile::signature, resource, attribute, &session);
+    if (NiFpga_IsNotError(status))
+      mapRegisters();
+  }
+
+  ~Session() {
+    if (session)
+      NiFpga_Close(session, 0);
+  }
+
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  /** Gets the result of opening the session. */
+  NiFpga_Status getStatus() const { return status; }
+
+  /** Gets the handle for use with the C API. */
+  NiFpga_Session get() const { return session; }
+
+  /**
+   * Redownloads the bitfile as NiFpga_Download does, which invalidates and
+   * then replaces the mapping.
+   */
+  NiFpga_Status download() {
+    registers = NULL;
+    const NiFpga_Status result = NiFpga_Download(session);
+    if (NiFpga_IsNotError(result))
+      mapRegisters();
+    return result;
+  }
+
+  template <typename R>
+  NiFpga_Status read(typename R::Type::CType &value) const {
+    checkBitfile<R>();
+    return readRegister<R>(value,
+                           std::integral_constant<bool, R::isMappable>());
+  }
+
+  template <typename R>
+  NiFpga_Status write(typename R::Type::CType value) const {
+    checkBitfile<R>();
+    return writeRegister<R>(value,
+                            std::integral_constant<bool, R::isMappable>());
+  }
+
+  template <typename R>
+  NiFpga_Status readArray(typename R::Type::CType (&array)[R::size]) const {
+    checkBitfile<R>();
+    return R::Type::readArray(session, R::resource, array, R::size);
+  }
+
+  template <typename R>
+  NiFpga_Status
+  writeArray(const typename R::Type::CType (&array)[R::size]) const {
+    checkBitfile<R>();
+    return R::Type::writeArray(session, R::resource, array, R::size);
+  }
+
+  template <typename F>
+  NiFpga_Status readFifo(typename F::Type::CType *data,
+                         size_t numberOfElements, uint32_t timeout,
+                         size_t *elementsRemaining = NULL) const {
+    checkBitfile<F>();
+    static_assert(!F::isHostToTarget, "can't read a host-to-target FIFO");
+    return F::Type::readFifo(session, F::number, data, numberOfElements,
+                             timeout, elementsRemaining);
+  }
+
+  template <typename F>
+  NiFpga_Status writeFifo(const typename F::Type::CType *data,
+                          size_t numberOfElements, uint32_t timeout,
+                          size_t *emptyElementsRemaining = NULL) const {
+    checkBitfile<F>();
+    static_assert(F::isHostToTarget, "can't write a target-to-host FIFO");
+    return F::Type::writeFifo(session, F::number, data, numberOfElements,
+                              timeout, emptyElementsRemaining);
+  }
+
+private:
+  template <typename R> static void checkBitfile() {
+    static_assert(std::is_same<typename R::BitfileType, Bitfile>::value,
+                  "resource belongs to a different bitfile");
+  }
+
+  void mapRegisters() {
+    volatile void *mapped = NULL;
+    size_t size = 0;
+    if (NiFpga_IsNotError(NiFpgaEx_GetMappedRegisters(session, &mapped, &size)))
+      registers = static_cast<volatile uint8_t *>(mapped);
+  }
+
+  /*
+   * Offset into the mapping. Sub-32-bit registers sit 2 past the aligned
+   * word they're accessed through.
+   */
+  template <typename R, typename Mapped>
+  volatile Mapped *getMapped() const {
+    return reinterpret_cast<volatile Mapped *>(registers + (R::offset & ~3U));
+  }
+
+  template <typename R>
+  NiFpga_Status readRegister(typename R::Type::CType &value,
+                             std::true_type) const {
+    typedef typename R::Type::MappedType Mapped;
+    if (!registers)
+      return R::Type::read(session, R::resource, &value);
+    value = static_cast<typename R::Type::CType>(*getMapped<R, Mapped>());
+    return NiFpga_Status_Success;
+  }
+
+  template <typename R>
+  NiFpga_Status readRegister(typename R::Type::CType &value,
+                             std::false_type) const {
+    return R::Type::read(session, R::resource, &value);
+  }
+
+  template <typename R>
+  NiFpga_Status writeRegister(typename R::Type::CType value,
+                              std::true_type) const {
+    typedef typename R::Type::MappedType Mapped;
+    if (!registers)
+      return R::Type::write(session, R::resource, value);
+    *getMapped<R, Mapped>() = static_cast<Mapped>(value);
+    return NiFpga_Status_Success;
+  }
+
+  template <typename R>
+  NiFpga_Status writeRegister(typename R::Type::CType value,
+                              std::false_type) const {
+    return R::Type::write(session, R::resource, value);
+  }
+
+  NiFpga_Session session;
+  NiFpga_Status status;
+  volatile uint8_t *registers;
+};
+
+} // namespace nifpga
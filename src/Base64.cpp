@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "Base64.h"
+#include <cstring> // memcpy
+
+#if defined(NIRIO_BASE64_SCALAR)
+#elif defined(__AVX2__)
+#    include <immintrin.h>
+#    define NIRIO_BASE64_AVX2
+#elif defined(__SSSE3__)
+#    include <tmmintrin.h>
+#    define NIRIO_BASE64_SSSE3
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define NIRIO_BASE64_NEON
+#endif
+
+namespace nirio {
+
+namespace {
+
+/// Sextet for each character, or -1 for those outside the alphabet.
+const int8_t sextetTable[256] = {
+    // clang-format off
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    // clang-format on
+};
+
+// NOTE: the vector versions classify each character by its high and low
+//       nibbles: a character is in the alphabet if the bits looked up for its
+//       nibbles don't overlap, and its sextet is the character plus an offset
+//       looked up by its high nibble (less one for '/', the only character
+//       whose offset differs from the rest of its nibble)
+#if defined(NIRIO_BASE64_AVX2) || defined(NIRIO_BASE64_SSSE3) \
+    || defined(NIRIO_BASE64_NEON)
+alignas(16) const uint8_t lowNibbleClasses[16] = {0x15, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a};
+alignas(16) const uint8_t highNibbleClasses[16] = {0x10, 0x10, 0x01, 0x02, 0x04,
+    0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10};
+alignas(16) const int8_t highNibbleOffsets[16] = {
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0};
+#endif
+
+#if defined(NIRIO_BASE64_AVX2)
+
+/**
+ * Decodes whole 32-character blocks until one has a character outside the
+ * alphabet.
+ *
+ * @return number of characters decoded, with 3 bytes output for every 4
+ */
+size_t decodeVectors(uint8_t* const out, const uint8_t* const in, const size_t size)
+{
+    const auto lowClasses = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(lowNibbleClasses)));
+    const auto highClasses = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(highNibbleClasses)));
+    const auto offsets = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(highNibbleOffsets)));
+    const auto nibble = _mm256_set1_epi8(0x0f);
+    const auto slash  = _mm256_set1_epi8('/');
+    // merges each quantum's four sextets into 24 big-endian bits
+    const auto mergePairs  = _mm256_set1_epi32(0x01400140);
+    const auto mergeHalves = _mm256_set1_epi32(0x00011000);
+    const auto order       = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+        -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const auto lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    size_t done      = 0;
+    for (; done + 32 <= size; done += 32) {
+        const auto text = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done));
+        const auto high = _mm256_and_si256(_mm256_srli_epi32(text, 4), nibble);
+        const auto low  = _mm256_and_si256(text, nibble);
+        const auto invalid = _mm256_and_si256(_mm256_shuffle_epi8(lowClasses, low),
+            _mm256_shuffle_epi8(highClasses, high));
+        if (!_mm256_testz_si256(invalid, invalid))
+            break;
+        const auto offset = _mm256_shuffle_epi8(
+            offsets, _mm256_add_epi8(high, _mm256_cmpeq_epi8(text, slash)));
+        auto bytes = _mm256_maddubs_epi16(_mm256_add_epi8(text, offset), mergePairs);
+        bytes      = _mm256_madd_epi16(bytes, mergeHalves);
+        bytes      = _mm256_shuffle_epi8(bytes, order);
+        bytes      = _mm256_permutevar8x32_epi32(bytes, lanes);
+        // NOTE: only 24 of the 32 bytes are output, so store them by way of a
+        //       buffer rather than writing past what the caller has room for
+        alignas(32) uint8_t buffer[32];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(buffer), bytes);
+        memcpy(out + done / 4 * 3, buffer, 24);
+    }
+    return done;
+}
+
+#elif defined(NIRIO_BASE64_SSSE3)
+
+/**
+ * Decodes whole 16-character blocks until one has a character outside the
+ * alphabet.
+ *
+ * @return number of characters decoded, with 3 bytes output for every 4
+ */
+size_t decodeVectors(uint8_t* const out, const uint8_t* const in, const size_t size)
+{
+    const auto lowClasses =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(lowNibbleClasses));
+    const auto highClasses =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(highNibbleClasses));
+    const auto offsets =
+        _mm_load_si128(reinterpret_cast<const __m128i*>(highNibbleOffsets));
+    const auto nibble = _mm_set1_epi8(0x0f);
+    const auto slash  = _mm_set1_epi8('/');
+    const auto zero   = _mm_setzero_si128();
+    // merges each quantum's four sextets into 24 big-endian bits
+    const auto mergePairs  = _mm_set1_epi32(0x01400140);
+    const auto mergeHalves = _mm_set1_epi32(0x00011000);
+    const auto order =
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t done = 0;
+    for (; done + 16 <= size; done += 16) {
+        const auto text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        const auto high = _mm_and_si128(_mm_srli_epi32(text, 4), nibble);
+        const auto low  = _mm_and_si128(text, nibble);
+        const auto invalid = _mm_and_si128(
+            _mm_shuffle_epi8(lowClasses, low), _mm_shuffle_epi8(highClasses, high));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, zero)) != 0xffff)
+            break;
+        const auto offset =
+            _mm_shuffle_epi8(offsets, _mm_add_epi8(high, _mm_cmpeq_epi8(text, slash)));
+        auto bytes = _mm_maddubs_epi16(_mm_add_epi8(text, offset), mergePairs);
+        bytes      = _mm_madd_epi16(bytes, mergeHalves);
+        bytes      = _mm_shuffle_epi8(bytes, order);
+        // NOTE: only 12 of the 16 bytes are output, so store them by way of a
+        //       buffer rather than writing past what the caller has room for
+        alignas(16) uint8_t buffer[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(buffer), bytes);
+        memcpy(out + done / 4 * 3, buffer, 12);
+    }
+    return done;
+}
+
+#elif defined(NIRIO_BASE64_NEON)
+
+/**
+ * Decodes whole 64-character blocks until one has a character outside the
+ * alphabet.
+ *
+ * @return number of characters decoded, with 3 bytes output for every 4
+ */
+size_t decodeVectors(uint8_t* const out, const uint8_t* const in, const size_t size)
+{
+    const auto lowClasses  = vld1q_u8(lowNibbleClasses);
+    const auto highClasses = vld1q_u8(highNibbleClasses);
+    const auto offsets =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(highNibbleOffsets));
+    const auto nibble      = vdupq_n_u8(0x0f);
+    const auto slash       = vdupq_n_u8('/');
+    size_t done            = 0;
+    for (; done + 64 <= size; done += 64) {
+        // deinterleaving puts the first sextet of every quantum in val[0], the
+        // second in val[1], and so on
+        auto text          = vld4q_u8(in + done);
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (auto& characters : text.val) {
+            const auto high = vshrq_n_u8(characters, 4);
+            const auto low  = vandq_u8(characters, nibble);
+            invalid         = vorrq_u8(invalid,
+                vandq_u8(vqtbl1q_u8(lowClasses, low), vqtbl1q_u8(highClasses, high)));
+            const auto offset =
+                vqtbl1q_u8(offsets, vaddq_u8(high, vceqq_u8(characters, slash)));
+            characters = vaddq_u8(characters, offset);
+        }
+        if (vmaxvq_u8(invalid))
+            break;
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(text.val[0], 2), vshrq_n_u8(text.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(text.val[1], 4), vshrq_n_u8(text.val[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(text.val[2], 6), text.val[3]);
+        vst3q_u8(out + done / 4 * 3, bytes);
+    }
+    return done;
+}
+
+#else
+
+size_t decodeVectors(uint8_t*, const uint8_t*, size_t)
+{
+    return 0;
+}
+
+#endif
+
+} // unnamed namespace
+
+Base64Decoder::Base64Decoder() : bits(0), sextets(0) {}
+
+size_t Base64Decoder::decode(void* const out_, const char* const in_, const size_t size)
+{
+    auto* const start     = static_cast<uint8_t*>(out_);
+    auto* out             = start;
+    const auto* in        = reinterpret_cast<const uint8_t*>(in_);
+    const auto* const end = in + size;
+    while (in < end) {
+        // decode whole quanta as fast as possible until finding a character
+        // outside the alphabet, such as a line break
+        if (!sextets) {
+            const auto done = decodeVectors(out, in, static_cast<size_t>(end - in));
+            in += done;
+            out += done / 4 * 3;
+            for (; end - in >= 4; in += 4, out += 3) {
+                const int32_t a = sextetTable[in[0]];
+                const int32_t b = sextetTable[in[1]];
+                const int32_t c = sextetTable[in[2]];
+                const int32_t d = sextetTable[in[3]];
+                if ((a | b | c | d) < 0)
+                    break;
+                const uint32_t quantum = a << 18 | b << 12 | c << 6 | d;
+                out[0]                 = static_cast<uint8_t>(quantum >> 16);
+                out[1]                 = static_cast<uint8_t>(quantum >> 8);
+                out[2]                 = static_cast<uint8_t>(quantum);
+            }
+            if (in == end)
+                break;
+        }
+        // then skip or decode the next character on its own, outputting a byte
+        // as soon as all of its bits are decoded just like libb64
+        const auto sextet = sextetTable[*in++];
+        if (sextet < 0)
+            continue;
+        const auto value = static_cast<uint32_t>(sextet);
+        switch (sextets++) {
+            case 0:
+                bits = value;
+                break;
+            case 1:
+                *out++ = static_cast<uint8_t>(bits << 2 | value >> 4);
+                bits   = value & 0x0f;
+                break;
+            case 2:
+                *out++ = static_cast<uint8_t>(bits << 4 | value >> 2);
+                bits   = value & 0x03;
+                break;
+            default:
+                *out++  = static_cast<uint8_t>(bits << 6 | value);
+                sextets = 0;
+                break;
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+} // namespace nirio
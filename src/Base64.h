@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uint32_t
+
+namespace nirio {
+
+/**
+ * Decodes Base64 text a block at a time, such as the bitstream of a bitfile.
+ *
+ * Output is identical to that of libb64, which bitfiles have always been
+ * decoded with: any character outside the Base64 alphabet, including
+ * whitespace and '=' padding, is skipped, and each byte is output as soon as
+ * all of its bits have been decoded.
+ *
+ * Runs of valid characters are decoded with the widest vector instructions the
+ * target was compiled for (AVX2 or SSSE3 on x86, NEON on 64-bit ARM), and
+ * everything else with scalar code. Define NIRIO_BASE64_SCALAR to force the
+ * scalar version, such as for comparing against it.
+ */
+class Base64Decoder
+{
+public:
+    Base64Decoder();
+
+    /**
+     * Decodes the next block of text, continuing from where the previous block
+     * left off, so blocks may split the text anywhere.
+     *
+     * @param out where to write decoded bytes, which must have room for
+     *            getMaxDecodedSize(size) bytes
+     * @param in text to decode
+     * @param size size of the text in bytes
+     * @return number of bytes decoded
+     */
+    size_t decode(void* out, const char* in, size_t size);
+
+    /**
+     * Gets the most bytes a block of text can decode to.
+     *
+     * @param size size of the text in bytes
+     * @return room needed to decode the text
+     */
+    static constexpr size_t getMaxDecodedSize(const size_t size)
+    {
+        return size / 4 * 3 + 3;
+    }
+
+private:
+    uint32_t bits; ///< Bits left over from the last sextet decoded.
+    uint32_t sextets; ///< Number of sextets decoded into the current quantum.
+};
+
+} // namespace nirio
@@ -13,14 +13,24 @@
  */
 
 #include "Bitfile.h"
+#include "Base64.h"
+#include "BitfileCache.h"
+#include "ClusterPlan.h"
+#include "ErrnoMap.h"
 #include "Exception.h"
+#include "MappedFile.h"
 #include "NiFpga.h"
+#include "Timing.h"
 #include "Type.h"
-#include "libb64/cdecode.h"
-#include "rapidxml/rapidxml_utils.hpp"
+#include "rapidxml/rapidxml.hpp"
+#include <unistd.h> // write
+#include <algorithm> // std::min
+#include <cerrno> // errno
 #include <cstring>
 #include <iostream>
 #include <limits> // std::numeric_limits
+#include <memory> // std::make_shared
+#include <string_view> // std::string_view
 
 namespace nirio {
 
@@ -57,9 +67,9 @@ Type parseType(const std::string& text)
     else if (!strcasecmp(text.c_str(), "Dbl"))
         return Dbl();
     else {
-        // FXPs and Clusters are supported by LabVIEW FPGA but not the C API,
-        // so we mark them as unsupported and ignore them for now. Anything
-        // else we didn't expect is an error.
+        // FXPs and Clusters need more than a name to describe, so they're
+        // handled elsewhere when possible and are unsupported otherwise.
+        // Anything else we didn't expect is an error.
         if (text != "FXP" && text != "Cluster")
             NIRIO_THROW(CorruptBitfileException());
         return UnsupportedType();
@@ -76,6 +86,14 @@ unsigned int parseUnsignedInteger(rapidxml::xml_node<>& element)
     return value;
 }
 
+int parseInteger(rapidxml::xml_node<>& element)
+{
+    int value = 0;
+    if (sscanf(element.value(), "%d", &value) != 1)
+        NIRIO_THROW(CorruptBitfileException());
+    return value;
+}
+
 bool parseBoolean(rapidxml::xml_node<>& element)
 {
     auto value = false;
@@ -118,6 +136,223 @@ rapidxml::xml_node<>& operator/(rapidxml::xml_node<>& parent, const char* const
     return findFirstChild(parent, name);
 }
 
+/**
+ * The XML document of a bitfile, parsed from everything but the text of its
+ * <Bitstream> element.
+ *
+ * The bitstream is nearly all of a bitfile, but the metadata around it is all
+ * that's needed to open a session, so the file is mapped instead of read and
+ * only the metadata is copied out to be parsed in place. The bitstream is left
+ * as a range of the mapping that isn't touched until it's decoded.
+ */
+class BitfileXml
+{
+public:
+    /**
+     * @param path bitfile to open
+     * @param parseMetadata whether to parse the metadata, which needn't be if
+     *                      only the bitstream is wanted and it can be found
+     *                      without parsing
+     */
+    explicit BitfileXml(const std::string& path, const bool parseMetadata = true)
+        : file(path)
+    {
+        if (!file.isMapped())
+            NIRIO_THROW(BitfileReadErrorException());
+        const std::string_view contents(
+            reinterpret_cast<const char*>(file.getData()), file.getSize());
+        if (const auto found = Bitfile::findBitstream(contents)) {
+            bitstream = *found;
+            if (!parseMetadata)
+                return;
+            metadata.reserve(contents.size() - bitstream.size() + 1);
+            metadata.assign(contents.data(), bitstream.data());
+            metadata.insert(metadata.end(), bitstream.end(), contents.end());
+        }
+        // otherwise there's no bitstream worth leaving out, or it's formatted
+        // in some way we didn't expect, so just parse all of it
+        else
+            metadata.assign(contents.begin(), contents.end());
+        metadata.push_back('\0');
+        document.parse<0>(metadata.data());
+    }
+
+    rapidxml::xml_node<>& getBitfileElement()
+    {
+        return document / "Bitfile";
+    }
+
+    /**
+     * Gets the still-encoded text of the <Bitstream> element.
+     *
+     * @return Base64 bitstream, referring to either the mapping or document
+     */
+    std::string_view getBitstream()
+    {
+        if (bitstream.data())
+            return bitstream;
+        auto& xmlBitstream = getBitfileElement() / "Bitstream";
+        return std::string_view(xmlBitstream.value(), xmlBitstream.value_size());
+    }
+
+    /**
+     * Decodes the bitstream a chunk at a time, dropping each encoded chunk
+     * from memory once it's been handed off.
+     *
+     * @param sink called with each decoded chunk
+     */
+    template <typename Sink>
+    void decodeBitstream(Sink&& sink)
+    {
+        const auto encoded       = getBitstream();
+        const auto* const mapped = reinterpret_cast<const char*>(file.getData());
+        const bool isMapped      = bitstream.data() != NULL;
+        // NOTE: the decoder carries its state between blocks, so chunks can
+        //       split Base64 quanta anywhere
+        const size_t chunkSize = 256 * 1024;
+        // NOTE: kept for the thread's next bitstream, so that preparing many
+        //       bitfiles in turn doesn't allocate a buffer for each
+        thread_local std::vector<char> decoded(
+            Base64Decoder::getMaxDecodedSize(chunkSize));
+        Base64Decoder decoder;
+        for (size_t offset = 0; offset < encoded.size(); offset += chunkSize) {
+            const auto size         = std::min(chunkSize, encoded.size() - offset);
+            const auto* const chunk = encoded.data() + offset;
+            const auto decodedSize  = decoder.decode(decoded.data(), chunk, size);
+            sink(decoded.data(), decodedSize);
+            if (isMapped)
+                file.release(static_cast<size_t>(chunk - mapped), size);
+        }
+    }
+
+private:
+    const MappedFile file;
+    std::string_view bitstream; ///< Left out of the metadata, if found.
+    std::vector<char> metadata; ///< Parsed in place, so must outlive document.
+    rapidxml::xml_document<> document;
+
+    BitfileXml(const BitfileXml&) = delete;
+    BitfileXml& operator=(const BitfileXml&) = delete;
+};
+
+/**
+ * Ensures the bitstream is encoded in a way we know how to decode.
+ */
+void checkBitstreamEncoding(rapidxml::xml_node<>& xmlBitfile)
+{
+    try {
+        // if it was specified, ensure it's Base64
+        if (strcasecmp((xmlBitfile / "BitstreamEncoding").value(), "base64")) {
+            // this is considered corrupt instead of incompatible because we
+            // already validated it was not a future BitfileVersion
+            NIRIO_THROW(CorruptBitfileException());
+        }
+    } catch (const rapidxml::parse_error&) {
+        // no bitstream encoding specified means it's de facto Base64
+    }
+}
+
+/**
+ * Parses the format of a fixed-point type from its <FXP> element.
+ */
+Type parseFxpType(rapidxml::xml_node<>& element)
+{
+    const auto isSigned          = parseBoolean(element / "Signed");
+    const auto wordLength        = parseUnsignedInteger(element / "WordLength");
+    const auto integerWordLength = parseInteger(element / "IntegerWordLength");
+    bool overflowStatus          = false;
+    try {
+        overflowStatus = parseBoolean(element / "IncludeOverflowStatus");
+    } catch (const rapidxml::parse_error&) {
+        // older bitfiles don't say, because they didn't support it
+    }
+    if (wordLength == 0 || wordLength > 64)
+        NIRIO_THROW(CorruptBitfileException());
+    // we only handle raw values that fit in 64 bits, so the rare 64-bit word
+    // with overflow status remains unsupported
+    if (wordLength + overflowStatus > 64)
+        return UnsupportedType();
+    return FxpType(isSigned, wordLength, integerWordLength, overflowStatus);
+}
+
+/**
+ * Parses a type from its element, such as <U32> or <FXP>.
+ */
+Type parseType(rapidxml::xml_node<>& element)
+{
+    if (!strcmp(element.name(), "FXP"))
+        return parseFxpType(element);
+    else
+        return parseType(element.name());
+}
+
+/**
+ * Appends the fields of a cluster, flattening any nested clusters, to a plan.
+ *
+ * @return false if any field is of an unsupported type
+ */
+bool parseClusterFields(rapidxml::xml_node<>& element, ClusterPlan& plan)
+{
+    for (auto* xmlField = (element / "TypeList").first_node(); xmlField;
+         xmlField       = xmlField->next_sibling()) {
+        auto* xmlType = xmlField;
+        size_t count  = 1;
+        if (!strcmp(xmlType->name(), "Array")) {
+            count   = parseUnsignedInteger(*xmlType / "Size");
+            xmlType = &findFirstChild(*xmlType / "Type");
+        }
+        if (!strcmp(xmlType->name(), "Cluster")) {
+            // arrays of clusters are just their fields over and over
+            for (size_t i = 0; i < count; i++)
+                if (!parseClusterFields(*xmlType, plan))
+                    return false;
+            continue;
+        }
+        const auto type = parseType(*xmlType);
+        if (type.getLogicalBits() == 0)
+            return false;
+        plan.addField(type, count);
+    }
+    return true;
+}
+
+/**
+ * Compiles the layout of a cluster from its <Cluster> element.
+ *
+ * @return layout of the cluster, or NULL if it can't be supported
+ */
+std::shared_ptr<const ClusterPlan> parseClusterPlan(rapidxml::xml_node<>& element)
+{
+    auto plan = std::make_shared<ClusterPlan>();
+    if (!parseClusterFields(element, *plan) || plan->getBits() == 0)
+        return nullptr;
+    return plan;
+}
+
+/**
+ * Parses the element type of a DMA FIFO from its <DataType> element, whose
+ * <SubType> names the type. Fixed-point and cluster types are described in
+ * full by a child element like a register's, though fixed-point formats may
+ * instead appear alongside <SubType>.
+ *
+ * @param clusterPlan outputs the layout of cluster elements
+ */
+Type parseFifoType(
+    rapidxml::xml_node<>& element, std::shared_ptr<const ClusterPlan>& clusterPlan)
+{
+    const std::string subType((element / "SubType").value());
+    if (subType == "FXP") {
+        auto* const xmlFxp = element.first_node("FXP");
+        return parseFxpType(xmlFxp ? *xmlFxp : element);
+    } else if (subType == "Cluster") {
+        if (auto* const xmlCluster = element.first_node("Cluster"))
+            if ((clusterPlan = parseClusterPlan(*xmlCluster)))
+                return ClusterType(clusterPlan->getBits());
+        return UnsupportedType();
+    } else
+        return parseType(subType);
+}
+
 } // unnamed namespace
 
 Bitfile::Bitfile(const std::string& path)
@@ -126,21 +361,42 @@ Bitfile::Bitfile(const std::string& path)
     , signatureRegister(invalid)
     , controlRegister(invalid)
     , resetRegister(invalid)
+    , irqEnable(invalid)
+    , irqMask(invalid)
+    , irqStatus(invalid)
     , fifosSupportClear(false)
     , fifosSupportBridgeFlush(false)
     , resetAutoClears(false)
     , autoRunWhenDownloaded(false)
     , bitstreamVersion(invalid)
+{
+    const TimingScope timing(NiFpgaEx_TimingStage_Parse);
+    // reuse what was parsed last time unless the bitfile has since changed
+    BitfileCache cache(path);
+    if (!cache.load(*this)) {
+        parse();
+        cache.store(*this);
+    }
+    // index everything by name now that it won't move
+    byName.reserve(registers.size() + fifos.size());
+    for (const auto& reg : registers) {
+        auto& named     = byName[reg.getName()];
+        named.ambiguous = !named.registers.empty();
+        named.registers.push_back(&reg);
+    }
+    for (const auto& fifo : fifos)
+        byName[fifo.getName()].fifos.push_back(&fifo);
+}
+
+void Bitfile::parse()
 {
     try {
-        // open the bitfile
-        rapidxml::file<> bitfile(path.c_str());
-        rapidxml::xml_document<> document;
-        document.parse<0>(bitfile.data());
+        // open the bitfile, leaving the bitstream for later
+        BitfileXml bitfile(path);
         // validate bitfile versions aren't too new
         // TODO: validate NiFpga's Version, if present, isn't greater than latest?
         // TODO: validate NiRio's Version, if present, isn't greater than latest?
-        auto& xmlBitfile = document / "Bitfile";
+        auto& xmlBitfile = bitfile.getBitfileElement();
         uint32_t major, minor;
         parseVersionString(xmlBitfile / "BitfileVersion", major, minor);
         if (major > maxBitfileVersionMajor)
@@ -180,32 +436,43 @@ Bitfile::Bitfile(const std::string& path)
                 const auto indicator = parseBoolean(*xmlRegister / "Indicator");
                 const auto accessMayTimeout =
                     parseBoolean(*xmlRegister / "AccessMayTimeout");
-                auto& xmlDatatypeChild = findFirstChild(*xmlRegister / "Datatype");
-                const std::string datatypeChild(xmlDatatypeChild.name());
-                std::string typeString;
-                bool array = false;
+                auto* xmlType = &findFirstChild(*xmlRegister / "Datatype");
+                const std::string datatypeChild(xmlType->name());
+                bool array  = false;
+                size_t size = 1;
                 // skip unsupported types
-                if (datatypeChild == "Cluster" || datatypeChild == "String") {
+                if (datatypeChild == "String") {
                     // though FPGA VIs shouldn't contain strings anyway
-                    assert(datatypeChild != "String");
+                    assert(false);
+                    continue;
+                }
+                // compile the layout of clusters once, up front, so accessing
+                // them is just a matter of following the plan
+                else if (datatypeChild == "Cluster") {
+                    if (auto plan = parseClusterPlan(*xmlType))
+                        registers.emplace_back(name,
+                            ClusterType(plan->getBits()),
+                            offset,
+                            indicator,
+                            false,
+                            1,
+                            accessMayTimeout,
+                            std::move(plan));
                     continue;
                 }
                 // have to dig deeper to determine array types
                 else if (datatypeChild == "Array") {
-                    array      = true;
-                    typeString = findFirstChild(xmlDatatypeChild / "Type").name();
+                    array   = true;
+                    size    = parseUnsignedInteger(*xmlType / "Size");
+                    xmlType = &findFirstChild(*xmlType / "Type");
                 }
-                // use simple types as-is
-                else {
-                    typeString = datatypeChild;
-                }
-                assert(!typeString.empty());
                 // remember the register for later
                 registers.emplace_back(name,
-                    parseType(typeString),
+                    parseType(*xmlType),
                     offset,
                     indicator,
                     array,
+                    size,
                     accessMayTimeout);
             }
         }
@@ -240,8 +507,10 @@ Bitfile::Bitfile(const std::string& path)
         // find the base address
         auto& xmlNiFpga     = compilationResults / "NiFpga";
         baseAddressOnDevice = parseUnsignedInteger(xmlNiFpga / "BaseAddressOnDevice");
-        // get the bitstream version
+        // get the bitstream version, and check its encoding now so that
+        // decoding it later needn't parse all of this again
         bitstreamVersion = parseUnsignedInteger(xmlBitfile / "BitstreamVersion");
+        checkBitstreamEncoding(xmlBitfile);
         // different behaviors depend upon bitstream version
         fifosSupportClear       = bitstreamVersion >= 1;
         fifosSupportBridgeFlush = bitstreamVersion >= 2;
@@ -266,7 +535,8 @@ Bitfile::Bitfile(const std::string& path)
             else
                 continue; // skip non-DMA FIFOs
             // determine type
-            const auto type = parseType((*xmlChannel / "DataType" / "SubType").value());
+            std::shared_ptr<const ClusterPlan> clusterPlan;
+            const auto type = parseFifoType(*xmlChannel / "DataType", clusterPlan);
             // NOTE: we expect FIFOs to be numbered [0,n-1] and in the bitfile
             //       in EXACTLY that order!
             if (number != i)
@@ -278,7 +548,8 @@ Bitfile::Bitfile(const std::string& path)
                     number,
                     controlSet,
                     write,
-                    (*xmlChannel / "BaseAddressTag").value());
+                    (*xmlChannel / "BaseAddressTag").value(),
+                    std::move(clusterPlan));
         }
         // if the map is filled sparsely, something's wrong
         i = 0; // reused
@@ -322,9 +593,6 @@ Bitfile::Bitfile(const std::string& path)
         for (auto it = fifos.cbegin(), end = fifos.cend(); it != end; ++it)
             if (!it->isOffsetSet())
                 NIRIO_THROW(CorruptBitfileException());
-    } catch (const std::runtime_error&) {
-        // rapidxml::file will throw this if it fails to open the file
-        NIRIO_THROW(BitfileReadErrorException());
     } catch (const rapidxml::parse_error&) {
         // something went wrong parsing the contents
         NIRIO_THROW(CorruptBitfileException());
@@ -353,38 +621,43 @@ const std::string& Bitfile::getOverlay() const
 
 std::vector<char> Bitfile::getBitstream() const
 {
-    rapidxml::file<> bitfile(path.c_str());
-    rapidxml::xml_document<> document;
-    document.parse<0>(bitfile.data());
-
-    auto& xmlBitfile = document / "Bitfile";
-
-    // check bitstream encoding
+    std::vector<char> bitstream;
     try {
-        // if it was specified, ensure it's Base64
-        if (strcasecmp((xmlBitfile / "BitstreamEncoding").value(), "base64")) {
-            // this is considered corrupt instead of incompatible because we
-            // already validated it was not a future BitfileVersion
-            NIRIO_THROW(CorruptBitfileException());
-        }
+        BitfileXml bitfile(path, false);
+        bitstream.reserve(bitfile.getBitstream().size() / 4 * 3);
+        bitfile.decodeBitstream([&](const char* const data, const size_t size) {
+            bitstream.insert(bitstream.end(), data, data + size);
+        });
     } catch (const rapidxml::parse_error&) {
-        // no bitstream encoding specified means it's de facto Base64
+        NIRIO_THROW(CorruptBitfileException());
     }
-    // find the bitstream
-    auto& xmlBitstream = xmlBitfile / "Bitstream";
-
-    std::vector<char> bitstream;
-    bitstream.resize(xmlBitstream.value_size());
-
-    base64_decodestate state;
-    base64_init_decodestate(&state);
-    auto decodedSize = base64_decode_block(
-        xmlBitstream.value(), xmlBitstream.value_size(), &(bitstream[0]), &state);
-    bitstream.resize(decodedSize);
-
     return bitstream;
 }
 
+void Bitfile::writeBitstream(const int descriptor) const
+{
+    const TimingScope timing(NiFpgaEx_TimingStage_Decode);
+    try {
+        BitfileXml bitfile(path, false);
+        bitfile.decodeBitstream([descriptor](const char* data, size_t size) {
+            const TimingScope timing(NiFpgaEx_TimingStage_Write);
+            while (size) {
+                const auto written = ::write(descriptor, data, size);
+                if (written < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    // such as ENOSPC or EIO from the firmware directory
+                    ErrnoMap::instance.throwErrno(errno);
+                }
+                data += written;
+                size -= static_cast<size_t>(written);
+            }
+        });
+    } catch (const rapidxml::parse_error&) {
+        NIRIO_THROW(CorruptBitfileException());
+    }
+}
+
 NiFpgaEx_Register Bitfile::getBaseAddressOnDevice() const
 {
     return baseAddressOnDevice;
@@ -455,4 +728,24 @@ uint32_t Bitfile::getBitstreamVersion() const
     return bitstreamVersion;
 }
 
+std::optional<std::string_view> Bitfile::findBitstream(const std::string_view contents)
+{
+    // NOTE: searching forward for the start tag and back for the end tag
+    //       doesn't touch anything in between
+    static const std::string_view startTag = "<Bitstream>";
+    static const std::string_view endTag   = "</Bitstream>";
+    const auto start                       = contents.find(startTag);
+    const auto end                         = contents.rfind(endTag);
+    if (start == std::string_view::npos || end == std::string_view::npos
+        || start + startTag.size() > end)
+        return std::nullopt;
+    return contents.substr(start + startTag.size(), end - start - startTag.size());
+}
+
+const Bitfile::NamedResources* Bitfile::findByName(const std::string_view name) const
+{
+    const auto found = byName.find(name);
+    return found == byName.end() ? nullptr : &found->second;
+}
+
 } // namespace nirio
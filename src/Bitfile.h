@@ -18,6 +18,9 @@
 #include "RegisterInfo.h"
 #include "Status.h"
 #include <memory> // std::unique_ptr
+#include <optional> // std::optional
+#include <string_view> // std::string_view
+#include <unordered_map> // std::unordered_map
 
 namespace nirio {
 
@@ -39,6 +42,24 @@ public:
 
     std::vector<char> getBitstream() const;
 
+    /**
+     * Decodes the bitstream straight to a file a chunk at a time, so that
+     * neither the bitstream nor its encoding is ever in memory all at once.
+     *
+     * @param descriptor file to write to
+     */
+    void writeBitstream(int descriptor) const;
+
+    /**
+     * Finds the still-encoded text of the <Bitstream> element in a bitfile.
+     * The bitstream comes after the metadata and right before the end of the
+     * file, so if the contents are mapped, none of its pages are faulted in.
+     *
+     * @param contents everything in the bitfile
+     * @return the bitstream, or nothing if it isn't where it's expected
+     */
+    static std::optional<std::string_view> findBitstream(std::string_view contents);
+
     NiFpgaEx_Register getBaseAddressOnDevice() const;
 
     NiFpgaEx_Register getSignatureRegister() const;
@@ -67,7 +88,36 @@ public:
 
     uint32_t getBitstreamVersion() const;
 
+    /**
+     * Controls, indicators, and DMA FIFOs that share a name.
+     */
+    struct NamedResources
+    {
+        std::vector<const RegisterInfo*> registers;
+        std::vector<const FifoInfo*> fifos;
+        /// Whether more than one register has the name, so that finding one
+        /// by it may be ambiguous.
+        bool ambiguous = false;
+    };
+
+    /**
+     * Looks up every control, indicator, and DMA FIFO with a given name, so
+     * that finding a resource only has to compare against those few instead
+     * of every resource in the bitfile.
+     *
+     * @param name name of the resources
+     * @return resources with that name, or NULL if there are none
+     */
+    const NamedResources* findByName(std::string_view name) const;
+
 private:
+    friend class BitfileCache;
+
+    /**
+     * Parses everything but the bitstream from the XML.
+     */
+    void parse();
+
     const std::string path;
     std::string signature;
     std::string targetClass;
@@ -86,6 +136,8 @@ private:
     RegisterInfoVector registers;
     FifoInfoVector fifos;
     uint32_t bitstreamVersion;
+    /// Indexes registers and fifos, whose names must outlive it.
+    std::unordered_map<std::string_view, NamedResources> byName;
 
     Bitfile(const Bitfile&) = delete;
     Bitfile& operator=(const Bitfile&) = delete;
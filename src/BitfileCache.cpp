@@ -0,0 +1,503 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "BitfileCache.h"
+#include "Bitfile.h"
+#include "ClusterPlan.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <sys/stat.h> // mkdir, fchmod
+#include <unistd.h> // write, close
+#include <cerrno> // errno
+#include <climits> // PATH_MAX
+#include <cstdio> // rename, remove, snprintf
+#include <cstdlib> // getenv, realpath, mkstemp
+#include <cstring> // memcpy, memcmp
+#include <memory> // std::make_shared
+#include <string_view> // std::string_view
+
+namespace nirio {
+
+namespace {
+
+/**
+ * Bump whenever the layout below or anything it describes changes, so that
+ * entries written by other versions are ignored.
+ */
+const uint32_t formatVersion = 2;
+
+const char magic[8] = {'N', 'I', 'F', 'P', 'G', 'A', 'B', 'C'};
+
+/**
+ * Start of every entry, followed by bodyBytes of fields written by Writer.
+ */
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t modifiedSeconds;
+    int64_t modifiedNanoseconds;
+    uint64_t contentHash;
+    uint64_t bodyBytes;
+    uint64_t bodyHash; ///< Catches entries that were truncated or corrupted.
+};
+
+/**
+ * Scalar types by index, as they're stored.
+ */
+const Type scalarTypes[] = {UnsupportedType(),
+    Bool(),
+    I8(),
+    U8(),
+    I16(),
+    U16(),
+    I32(),
+    U32(),
+    I64(),
+    U64(),
+    Sgl(),
+    Dbl()};
+
+enum TypeKind : uint8_t { ScalarKind, FixedPointKind, ClusterKind };
+
+/**
+ * Thrown by Writer for anything it can't describe, such that no entry is
+ * written.
+ */
+struct UnsupportedError
+{
+};
+
+/**
+ * Appends fields in native byte order, since the cache never leaves the
+ * machine.
+ */
+class Writer
+{
+public:
+    template <typename T>
+    void put(const T value)
+    {
+        body.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void putString(const std::string& value)
+    {
+        put<uint32_t>(value.size());
+        body.append(value);
+    }
+
+    void putType(const Type& type)
+    {
+        if (type.isFixedPoint()) {
+            put<uint8_t>(FixedPointKind);
+            put<uint8_t>(type.isSigned());
+            put<uint32_t>(type.getWordLength());
+            put<int32_t>(type.getIntegerWordLength());
+            put<uint8_t>(type.hasOverflowStatus());
+            return;
+        }
+        if (type.isCluster()) {
+            put<uint8_t>(ClusterKind);
+            put<uint32_t>(type.getLogicalBits());
+            return;
+        }
+        for (uint8_t i = 0; i < sizeof(scalarTypes) / sizeof(scalarTypes[0]); i++)
+            if (scalarTypes[i] == type) {
+                put<uint8_t>(ScalarKind);
+                put<uint8_t>(i);
+                return;
+            }
+        throw UnsupportedError();
+    }
+
+    void putClusterPlan(const ClusterPlan* const plan)
+    {
+        put<uint8_t>(plan != NULL);
+        if (!plan)
+            return;
+        put<uint32_t>(plan->getFieldCount());
+        for (size_t i = 0; i < plan->getFieldCount(); i++) {
+            putType(plan->getFieldType(i));
+            put<uint64_t>(plan->getFieldElementCount(i));
+        }
+    }
+
+    const std::string& getBody() const
+    {
+        return body;
+    }
+
+private:
+    std::string body;
+};
+
+/**
+ * Reads back what Writer wrote, noting rather than throwing when it runs
+ * out, so that callers can check once at the end.
+ */
+class Reader
+{
+public:
+    Reader(const uint8_t* const begin, const uint8_t* const end)
+        : position(begin), end(end), failed(false)
+    {
+    }
+
+    template <typename T>
+    T get()
+    {
+        T value = T();
+        if (check(sizeof(value))) {
+            std::memcpy(&value, position, sizeof(value));
+            position += sizeof(value);
+        }
+        return value;
+    }
+
+    std::string getString()
+    {
+        const auto size = get<uint32_t>();
+        if (!check(size))
+            return std::string();
+        std::string value(reinterpret_cast<const char*>(position), size);
+        position += size;
+        return value;
+    }
+
+    Type getType()
+    {
+        switch (get<uint8_t>()) {
+            case ScalarKind: {
+                const auto index = get<uint8_t>();
+                if (index < sizeof(scalarTypes) / sizeof(scalarTypes[0]))
+                    return scalarTypes[index];
+                break;
+            }
+            case FixedPointKind: {
+                const bool isSigned          = get<uint8_t>();
+                const auto wordLength        = get<uint32_t>();
+                const auto integerWordLength = get<int32_t>();
+                const bool overflowStatus    = get<uint8_t>();
+                if (wordLength > 0 && wordLength + overflowStatus <= 64)
+                    return FxpType(
+                        isSigned, wordLength, integerWordLength, overflowStatus);
+                break;
+            }
+            case ClusterKind: return ClusterType(get<uint32_t>());
+        }
+        failed = true;
+        return UnsupportedType();
+    }
+
+    std::shared_ptr<const ClusterPlan> getClusterPlan()
+    {
+        if (!get<uint8_t>())
+            return nullptr;
+        auto plan        = std::make_shared<ClusterPlan>();
+        const auto count = get<uint32_t>();
+        for (uint32_t i = 0; i < count && !failed; i++) {
+            const auto type     = getType();
+            const auto elements = get<uint64_t>();
+            if (!failed && type.getLogicalBits() > 0 && type.getLogicalBits() <= 64)
+                plan->addField(type, elements);
+            else
+                failed = true;
+        }
+        return plan;
+    }
+
+    bool isFailed() const
+    {
+        return failed;
+    }
+
+    bool isDone() const
+    {
+        return position == end;
+    }
+
+private:
+    bool check(const size_t size)
+    {
+        if (failed || static_cast<size_t>(end - position) < size)
+            failed = true;
+        return !failed;
+    }
+
+    const uint8_t* position;
+    const uint8_t* const end;
+    bool failed;
+};
+
+/**
+ * Creates a directory and any missing parents.
+ */
+bool makeDirectories(const std::string& directory)
+{
+    for (auto slash = directory.find('/', 1);; slash = directory.find('/', slash + 1)) {
+        const auto parent = directory.substr(0, slash);
+        if (mkdir(parent.c_str(), 0755) && errno != EEXIST)
+            return false;
+        if (slash == std::string::npos)
+            return true;
+    }
+}
+
+} // unnamed namespace
+
+BitfileCache::BitfileCache(const std::string& bitfilePath, const std::string& directory)
+    : key()
+{
+    if (directory.empty())
+        return;
+    // the same bitfile can be named many ways, so key on the one true path
+    char resolved[PATH_MAX];
+    path = realpath(bitfilePath.c_str(), resolved) ? resolved : bitfilePath;
+    // anything that can't be identified can't be cached
+    const MappedFile bitfile(path);
+    if (!bitfile.isMapped())
+        return;
+    const auto& status      = bitfile.getStat();
+    key.device              = status.st_dev;
+    key.inode               = status.st_ino;
+    key.size                = status.st_size;
+    key.modifiedSeconds     = status.st_mtim.tv_sec;
+    key.modifiedNanoseconds = status.st_mtim.tv_nsec;
+    // NOTE: the rest can be wrong if the bitfile was replaced by a tool that
+    //       preserves modification times, so check the contents themselves.
+    //       Only what's around the bitstream is cached, so only that is
+    //       hashed, and the bitstream's pages are never read.
+    const std::string_view contents(
+        reinterpret_cast<const char*>(bitfile.getData()), bitfile.getSize());
+    if (const auto bitstream = Bitfile::findBitstream(contents)) {
+        const auto before = contents.substr(0, bitstream->data() - contents.data());
+        const auto after  = contents.substr(before.size() + bitstream->size());
+        key.contentHash   = hash64(before.data(), before.size());
+        key.contentHash   = hash64(after.data(), after.size(), key.contentHash);
+    } else
+        key.contentHash = hash64(contents.data(), contents.size());
+    char name[sizeof("0123456789abcdef.bin")];
+    snprintf(name,
+        sizeof(name),
+        "%016llx.bin",
+        static_cast<unsigned long long>(hash64(path.data(), path.size())));
+    entryPath = directory + "/" + name;
+}
+
+std::string BitfileCache::getDirectory()
+{
+    if (const char* const directory = getenv("NIFPGA_BITFILE_CACHE"))
+        return directory;
+    if (const char* const cache = getenv("XDG_CACHE_HOME"))
+        if (*cache)
+            return std::string(cache) + "/libnifpga";
+    if (const char* const home = getenv("HOME"))
+        if (*home)
+            return std::string(home) + "/.cache/libnifpga";
+    return std::string();
+}
+
+bool BitfileCache::load(Bitfile& bitfile) const
+{
+    if (entryPath.empty())
+        return false;
+    const MappedFile entry(entryPath);
+    if (!entry.isMapped() || entry.getSize() < sizeof(Header))
+        return false;
+    // check that this entry is for exactly this bitfile, and is intact
+    Header header;
+    std::memcpy(&header, entry.getData(), sizeof(header));
+    const auto* const body = entry.getData() + sizeof(header);
+    if (std::memcmp(header.magic, magic, sizeof(magic)) || header.version != formatVersion
+        || header.device != key.device || header.inode != key.inode
+        || header.size != key.size || header.modifiedSeconds != key.modifiedSeconds
+        || header.modifiedNanoseconds != key.modifiedNanoseconds
+        || header.contentHash != key.contentHash
+        || header.bodyBytes != entry.getSize() - sizeof(header)
+        || header.bodyHash != hash64(body, header.bodyBytes))
+        return false;
+
+    // read everything before touching the bitfile, so a miss leaves it alone
+    Reader reader(body, body + header.bodyBytes);
+    if (reader.getString() != path)
+        return false;
+    auto signature                     = reader.getString();
+    auto targetClass                   = reader.getString();
+    auto dtOverlay                     = reader.getString();
+    const auto baseAddress             = reader.get<uint32_t>();
+    const auto signatureRegister       = reader.get<uint32_t>();
+    const auto controlRegister         = reader.get<uint32_t>();
+    const auto resetRegister           = reader.get<uint32_t>();
+    const auto irqEnable               = reader.get<uint32_t>();
+    const auto irqMask                 = reader.get<uint32_t>();
+    const auto irqStatus               = reader.get<uint32_t>();
+    const auto bitstreamVersion        = reader.get<uint32_t>();
+    const bool fifosSupportClear       = reader.get<uint8_t>();
+    const bool fifosSupportBridgeFlush = reader.get<uint8_t>();
+    const bool resetAutoClears         = reader.get<uint8_t>();
+    const bool autoRunWhenDownloaded   = reader.get<uint8_t>();
+    // NOTE: counts are only trusted as far as the body hash goes, so let the
+    //       vectors grow rather than reserving whatever they claim
+    RegisterInfoVector registers;
+    const auto registerCount = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < registerCount && !reader.isFailed(); i++) {
+        auto name                   = reader.getString();
+        const auto type             = reader.getType();
+        const auto offset           = reader.get<uint32_t>();
+        const bool indicator        = reader.get<uint8_t>();
+        const bool array            = reader.get<uint8_t>();
+        const auto size             = reader.get<uint64_t>();
+        const bool accessMayTimeout = reader.get<uint8_t>();
+        auto plan                   = reader.getClusterPlan();
+        registers.emplace_back(name,
+            type,
+            offset,
+            indicator,
+            array,
+            size,
+            accessMayTimeout,
+            std::move(plan));
+    }
+    FifoInfoVector fifos;
+    const auto fifoCount = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < fifoCount && !reader.isFailed(); i++) {
+        auto name               = reader.getString();
+        const auto type         = reader.getType();
+        const auto number       = reader.get<uint32_t>();
+        const auto controlSet   = reader.get<uint32_t>();
+        const bool hostToTarget = reader.get<uint8_t>();
+        auto baseAddressTag     = reader.getString();
+        const auto offset       = reader.get<uint32_t>();
+        auto plan               = reader.getClusterPlan();
+        fifos.emplace_back(name,
+            type,
+            number,
+            controlSet,
+            hostToTarget,
+            baseAddressTag,
+            std::move(plan));
+        fifos.back().setOffset(offset);
+    }
+    if (reader.isFailed() || !reader.isDone())
+        return false;
+
+    bitfile.signature               = std::move(signature);
+    bitfile.targetClass             = std::move(targetClass);
+    bitfile.dtOverlay               = std::move(dtOverlay);
+    bitfile.baseAddressOnDevice     = baseAddress;
+    bitfile.signatureRegister       = signatureRegister;
+    bitfile.controlRegister         = controlRegister;
+    bitfile.resetRegister           = resetRegister;
+    bitfile.irqEnable               = irqEnable;
+    bitfile.irqMask                 = irqMask;
+    bitfile.irqStatus               = irqStatus;
+    bitfile.bitstreamVersion        = bitstreamVersion;
+    bitfile.fifosSupportClear       = fifosSupportClear;
+    bitfile.fifosSupportBridgeFlush = fifosSupportBridgeFlush;
+    bitfile.resetAutoClears         = resetAutoClears;
+    bitfile.autoRunWhenDownloaded   = autoRunWhenDownloaded;
+    bitfile.registers               = std::move(registers);
+    bitfile.fifos                   = std::move(fifos);
+    return true;
+}
+
+void BitfileCache::store(const Bitfile& bitfile) const
+{
+    if (entryPath.empty())
+        return;
+    Writer writer;
+    try {
+        writer.putString(path);
+        writer.putString(bitfile.signature);
+        writer.putString(bitfile.targetClass);
+        writer.putString(bitfile.dtOverlay);
+        writer.put<uint32_t>(bitfile.baseAddressOnDevice);
+        writer.put<uint32_t>(bitfile.signatureRegister);
+        writer.put<uint32_t>(bitfile.controlRegister);
+        writer.put<uint32_t>(bitfile.resetRegister);
+        writer.put<uint32_t>(bitfile.irqEnable);
+        writer.put<uint32_t>(bitfile.irqMask);
+        writer.put<uint32_t>(bitfile.irqStatus);
+        writer.put<uint32_t>(bitfile.bitstreamVersion);
+        writer.put<uint8_t>(bitfile.fifosSupportClear);
+        writer.put<uint8_t>(bitfile.fifosSupportBridgeFlush);
+        writer.put<uint8_t>(bitfile.resetAutoClears);
+        writer.put<uint8_t>(bitfile.autoRunWhenDownloaded);
+        writer.put<uint32_t>(bitfile.registers.size());
+        for (const auto& reg : bitfile.registers) {
+            writer.putString(reg.getName());
+            writer.putType(reg.getType());
+            writer.put<uint32_t>(reg.getOffset());
+            writer.put<uint8_t>(reg.isIndicator());
+            writer.put<uint8_t>(reg.isArray());
+            writer.put<uint64_t>(reg.getSize());
+            writer.put<uint8_t>(reg.isAccessMayTimeout());
+            writer.putClusterPlan(reg.getClusterPlan());
+        }
+        writer.put<uint32_t>(bitfile.fifos.size());
+        for (const auto& fifo : bitfile.fifos) {
+            writer.putString(fifo.getName());
+            writer.putType(fifo.getType());
+            writer.put<uint32_t>(fifo.getNumber());
+            writer.put<uint32_t>(fifo.getControlSet());
+            writer.put<uint8_t>(fifo.isHostToTarget());
+            writer.putString(fifo.getBaseAddressTag());
+            writer.put<uint32_t>(fifo.getOffset());
+            writer.putClusterPlan(fifo.getClusterPlan());
+        }
+    } catch (const UnsupportedError&) {
+        return;
+    }
+
+    const auto& body = writer.getBody();
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version             = formatVersion;
+    header.reserved            = 0;
+    header.device              = key.device;
+    header.inode               = key.inode;
+    header.size                = key.size;
+    header.modifiedSeconds     = key.modifiedSeconds;
+    header.modifiedNanoseconds = key.modifiedNanoseconds;
+    header.contentHash         = key.contentHash;
+    header.bodyBytes           = body.size();
+    header.bodyHash            = hash64(body.data(), body.size());
+
+    // write a private copy and rename it into place, so that other threads or
+    // processes opening the same bitfile never see a partial entry, nor store
+    // theirs into the same copy
+    const auto directory = entryPath.substr(0, entryPath.rfind('/'));
+    if (!makeDirectories(directory))
+        return;
+    const auto slash = entryPath.rfind('/') + 1;
+    auto temporaryPath =
+        entryPath.substr(0, slash) + "." + entryPath.substr(slash) + ".XXXXXX";
+    const auto descriptor = mkstemp(&temporaryPath[0]);
+    if (descriptor < 0)
+        return;
+    fchmod(descriptor, 0644);
+    bool written =
+        ::write(descriptor, &header, sizeof(header)) == ssize_t(sizeof(header))
+        && ::write(descriptor, body.data(), body.size()) == ssize_t(body.size());
+    written &= !::close(descriptor);
+    if (!written || std::rename(temporaryPath.c_str(), entryPath.c_str()))
+        std::remove(temporaryPath.c_str());
+}
+
+} // namespace nirio
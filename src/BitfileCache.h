@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <cstdint> // uint64_t
+#include <string> // std::string
+
+namespace nirio {
+
+class Bitfile;
+
+/**
+ * Cached copy of everything parsed from a bitfile but its bitstream, in a
+ * compact binary form that's mapped and copied out instead of parsing the
+ * whole XML document every time a process opens a session.
+ *
+ * An entry is named for the bitfile's path and only used while the
+ * bitfile's device, inode, size, modification time, and the hash of its
+ * contents all still match what was parsed. The bitstream isn't part of the
+ * entry, so it's left out of the hash rather than read. Trouble reading or
+ * writing the cache is never an error; it just means parsing the XML again.
+ *
+ * The cache lives in $NIFPGA_BITFILE_CACHE if set, where an empty value
+ * disables it, or else in libnifpga under $XDG_CACHE_HOME or ~/.cache.
+ */
+class BitfileCache
+{
+public:
+    /**
+     * Identifies the bitfile so it can be checked against an entry.
+     *
+     * @param bitfilePath path to the bitfile
+     * @param directory cache directory, or empty to disable caching
+     */
+    explicit BitfileCache(
+        const std::string& bitfilePath, const std::string& directory = getDirectory());
+
+    /**
+     * Fills in a bitfile from its entry.
+     *
+     * @param bitfile bitfile to fill in, which is left unchanged on a miss
+     * @return whether there was an up-to-date entry
+     */
+    bool load(Bitfile& bitfile) const;
+
+    /**
+     * Replaces the entry for a freshly parsed bitfile.
+     *
+     * @param bitfile parsed bitfile
+     */
+    void store(const Bitfile& bitfile) const;
+
+    /**
+     * Gets the cache directory from the environment.
+     *
+     * @return cache directory, or empty if caching is disabled
+     */
+    static std::string getDirectory();
+
+private:
+    /**
+     * What an entry must match to be used.
+     */
+    struct Key
+    {
+        uint64_t device;
+        uint64_t inode;
+        uint64_t size;
+        int64_t modifiedSeconds;
+        int64_t modifiedNanoseconds;
+        uint64_t contentHash;
+    };
+
+    std::string path; ///< Canonical path to the bitfile.
+    std::string entryPath; ///< Empty if caching is disabled.
+    Key key;
+};
+
+} // namespace nirio
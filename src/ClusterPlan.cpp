@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ClusterPlan.h"
+#include <cassert> // assert
+#include <cstring> // memcpy, memset
+
+namespace nirio {
+
+namespace {
+
+/**
+ * Reads bits from a big-endian bit stream. A field of up to 64 bits spans at
+ * most 9 bytes.
+ */
+uint64_t readBits(const uint8_t* const packed, const size_t offset, const size_t bits)
+{
+    const auto end           = offset + bits;
+    unsigned __int128 window = 0;
+    for (auto byte = offset / 8; byte * 8 < end; byte++)
+        window = window << 8 | packed[byte];
+    window >>= (8 - end % 8) % 8;
+    return static_cast<uint64_t>(window)
+           & (bits < 64 ? (uint64_t(1) << bits) - 1 : ~uint64_t(0));
+}
+
+/**
+ * ORs bits into a big-endian bit stream, which must start out zeroed.
+ */
+void writeBits(
+    uint8_t* const packed, const size_t offset, const size_t bits, const uint64_t value)
+{
+    const auto end = offset + bits;
+    auto window    = static_cast<unsigned __int128>(value) << (8 - end % 8) % 8;
+    for (auto byte = (end - 1) / 8; byte * 8 + 8 > offset; byte--, window >>= 8) {
+        packed[byte] |= static_cast<uint8_t>(window);
+        if (byte == 0)
+            break;
+    }
+}
+
+template <typename T>
+uint64_t load(const uint8_t* const from)
+{
+    T value;
+    std::memcpy(&value, from, sizeof(value));
+    return value;
+}
+
+template <typename T>
+void store(uint8_t* const to, const uint64_t value)
+{
+    const auto narrowed = static_cast<T>(value);
+    std::memcpy(to, &narrowed, sizeof(narrowed));
+}
+
+} // unnamed namespace
+
+ClusterPlan::ClusterPlan() : bits(0) {}
+
+void ClusterPlan::addField(const Type& type, const size_t count)
+{
+    assert(type.getLogicalBits() > 0 && type.getLogicalBits() <= 64);
+    Field field;
+    field.bitOffset = bits;
+    field.bits      = type.getLogicalBits();
+    field.count     = count;
+    field.type      = type;
+    if (type.isFixedPoint()) {
+        field.hostBytes = sizeof(double);
+        field.fixedPoint.emplace(type);
+    } else
+        field.hostBytes = type.getElementBytes();
+    fields.push_back(field);
+    bits += field.bits * count;
+}
+
+size_t ClusterPlan::getFieldCount() const
+{
+    return fields.size();
+}
+
+const Type& ClusterPlan::getFieldType(const size_t field) const
+{
+    return fields[field].type;
+}
+
+size_t ClusterPlan::getFieldElementCount(const size_t field) const
+{
+    return fields[field].count;
+}
+
+size_t ClusterPlan::getBits() const
+{
+    return bits;
+}
+
+size_t ClusterPlan::getPackedBytes() const
+{
+    return (bits + 7) / 8;
+}
+
+void ClusterPlan::unpack(const uint8_t* const packed,
+    void* const cluster,
+    const size_t* const fieldOffsets,
+    const size_t firstBit) const
+{
+    auto* const base = static_cast<uint8_t*>(cluster);
+    for (size_t f = 0; f < fields.size(); f++) {
+        const auto& field = fields[f];
+        auto* to          = base + fieldOffsets[f];
+        for (size_t i = 0; i < field.count; i++, to += field.hostBytes) {
+            const auto bit = firstBit + field.bitOffset + i * field.bits;
+            const auto raw = readBits(packed, bit, field.bits);
+            if (field.fixedPoint) {
+                double value;
+                field.fixedPoint->toFloat(&raw, &value, nullptr, 1);
+                std::memcpy(to, &value, sizeof(value));
+                continue;
+            }
+            // every other type's bits are exactly its C representation,
+            // including Sgl and Dbl, so narrowing copies them as-is
+            switch (field.hostBytes) {
+                case 1: store<uint8_t>(to, raw); break;
+                case 2: store<uint16_t>(to, raw); break;
+                case 4: store<uint32_t>(to, raw); break;
+                default: store<uint64_t>(to, raw); break;
+            }
+        }
+    }
+}
+
+void ClusterPlan::pack(const void* const cluster,
+    const size_t* const fieldOffsets,
+    uint8_t* const packed,
+    const size_t firstBit) const
+{
+    std::memset(packed, 0, (firstBit + bits + 7) / 8);
+    const auto* const base = static_cast<const uint8_t*>(cluster);
+    for (size_t f = 0; f < fields.size(); f++) {
+        const auto& field = fields[f];
+        const auto* from  = base + fieldOffsets[f];
+        const auto mask =
+            field.bits < 64 ? (uint64_t(1) << field.bits) - 1 : ~uint64_t(0);
+        for (size_t i = 0; i < field.count; i++, from += field.hostBytes) {
+            uint64_t raw;
+            if (field.fixedPoint) {
+                double value;
+                std::memcpy(&value, from, sizeof(value));
+                field.fixedPoint->fromFloat(&value, &raw, 1);
+            } else {
+                switch (field.hostBytes) {
+                    case 1: raw = load<uint8_t>(from); break;
+                    case 2: raw = load<uint16_t>(from); break;
+                    case 4: raw = load<uint32_t>(from); break;
+                    default: raw = load<uint64_t>(from); break;
+                }
+            }
+            // like elsewhere, only the least significant bit of a Bool counts
+            const auto bit = firstBit + field.bitOffset + i * field.bits;
+            writeBits(packed, bit, field.bits, raw & mask);
+        }
+    }
+}
+
+} // namespace nirio
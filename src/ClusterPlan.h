@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "FixedPoint.h"
+#include "Type.h"
+#include <cstdint> // uint8_t
+#include <optional> // std::optional
+#include <vector> // std::vector
+
+namespace nirio {
+
+/**
+ * Precompiled layout of a cluster control or indicator, for converting
+ * between the packed form transferred to and from the FPGA and a C struct
+ * described by the caller.
+ *
+ * On the FPGA, a cluster is a single wide register holding each field's bits
+ * one after another, starting from the most significant bit, padded to a
+ * whole number of bytes and transferred like an array of U8s. Nested
+ * clusters are flattened into their fields, so the caller describes a
+ * struct by the offset of each leaf field in order. Array fields occupy
+ * consecutive elements starting at their offset.
+ *
+ * Fields are stored in the struct as their usual C types, except that
+ * fixed-point fields are stored as doubles.
+ */
+class ClusterPlan
+{
+public:
+    ClusterPlan();
+
+    /**
+     * Appends a field to the end of the cluster.
+     *
+     * @param type type of the field, or of each element if an array
+     * @param count number of elements, which is 1 for non-arrays
+     */
+    void addField(const Type& type, size_t count);
+
+    /**
+     * Gets the number of leaf fields the caller must describe.
+     *
+     * @return number of fields
+     */
+    size_t getFieldCount() const;
+
+    /**
+     * Gets the type of a field, as passed to addField.
+     *
+     * @param field index of the field
+     * @return type of the field, or of each element if an array
+     */
+    const Type& getFieldType(size_t field) const;
+
+    /**
+     * Gets the number of elements in a field, as passed to addField.
+     *
+     * @param field index of the field
+     * @return number of elements, which is 1 for non-arrays
+     */
+    size_t getFieldElementCount(size_t field) const;
+
+    /**
+     * Gets the total number of bits in all fields.
+     *
+     * @return number of bits
+     */
+    size_t getBits() const;
+
+    /**
+     * Gets the number of bytes in the packed form.
+     *
+     * @return number of packed bytes
+     */
+    size_t getPackedBytes() const;
+
+    /**
+     * Unpacks a cluster into a caller's struct.
+     *
+     * @param packed packed form, as read from the FPGA
+     * @param cluster struct to fill in
+     * @param fieldOffsets offset of each field within the struct
+     * @param firstBit bit of packed at which the first field starts, for
+     *                 clusters padded at the front
+     */
+    void unpack(const uint8_t* packed,
+        void* cluster,
+        const size_t* fieldOffsets,
+        size_t firstBit = 0) const;
+
+    /**
+     * Packs a caller's struct into a cluster.
+     *
+     * @param cluster struct to pack
+     * @param fieldOffsets offset of each field within the struct
+     * @param packed outputs the packed form, to be written to the FPGA
+     * @param firstBit bit of packed at which the first field starts, with
+     *                 any bits before it zeroed
+     */
+    void pack(const void* cluster,
+        const size_t* fieldOffsets,
+        uint8_t* packed,
+        size_t firstBit = 0) const;
+
+private:
+    struct Field
+    {
+        size_t bitOffset; ///< From the most significant bit of the first byte.
+        size_t bits; ///< Per element.
+        size_t count;
+        size_t hostBytes; ///< Size of each element in the caller's struct.
+        std::optional<FixedPoint> fixedPoint;
+        Type type = UnsupportedType();
+    };
+
+    std::vector<Field> fields;
+    size_t bits;
+};
+
+} // namespace nirio
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "DeviceBackend.h"
+#include "Exception.h"
+#include "Loader.h"
+#include "SimulatedBackend.h"
+#include "TraceBackend.h"
+#include <fcntl.h> // open
+#include <sys/ioctl.h> // ioctl
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h> // close, read, write, pread, pwrite, lseek
+#include <cstdlib> // getenv
+#include <cstring> // strcmp
+#include <iostream> // std::cerr, std::endl
+
+namespace nirio {
+
+namespace {
+
+std::string getRoot(const char* const variable, const char* const fallback)
+{
+    const char* const root = getenv(variable);
+    return root && *root ? root : fallback;
+}
+
+DeviceBackend* createUntraced()
+{
+    const auto sysfsRoot   = getRoot("NIFPGA_SYSFS_ROOT", "/sys/class/nirio");
+    const auto devRoot     = getRoot("NIFPGA_DEV_ROOT", "/dev");
+    const auto dmaHeapRoot = getRoot("NIFPGA_DMA_HEAP_ROOT", "/dev/dma_heap");
+    const char* const name = getenv("NIFPGA_BACKEND");
+    if (!name || !*name || !strcmp(name, "system"))
+        return new SystemBackend(sysfsRoot, devRoot, dmaHeapRoot);
+    else if (!strcmp(name, "simulated"))
+        return new SimulatedBackend(sysfsRoot, devRoot, dmaHeapRoot);
+    else if (!strcmp(name, "replay")) {
+        const char* const trace = getenv("NIFPGA_REPLAY");
+        if (!trace || !*trace) {
+            std::cerr << "NIFPGA_BACKEND=replay needs NIFPGA_REPLAY" << std::endl;
+            NIRIO_THROW(InvalidParameterException());
+        }
+        const char* const timing = getenv("NIFPGA_REPLAY_TIMING");
+        return new ReplayBackend(trace, !timing || strcmp(timing, "none"));
+    }
+    std::cerr << "unknown NIFPGA_BACKEND: " << name << std::endl;
+    NIRIO_THROW(InvalidParameterException());
+}
+
+DeviceBackend* create()
+{
+    std::unique_ptr<DeviceBackend> backend(createUntraced());
+    const char* const trace = getenv("NIFPGA_TRACE");
+    if (!trace || !*trace)
+        return backend.release();
+    return new TracingBackend(std::move(backend), trace);
+}
+
+} // unnamed namespace
+
+DeviceBackend::DeviceBackend(const std::string& sysfsRoot,
+    const std::string& devRoot,
+    const std::string& dmaHeapRoot)
+    : sysfsRoot(sysfsRoot), devRoot(devRoot), dmaHeapRoot(dmaHeapRoot)
+{
+}
+
+const std::string& DeviceBackend::getSysfsRoot() const
+{
+    return sysfsRoot;
+}
+
+const std::string& DeviceBackend::getDevRoot() const
+{
+    return devRoot;
+}
+
+const std::string& DeviceBackend::getDmaHeapRoot() const
+{
+    return dmaHeapRoot;
+}
+
+DeviceBackend& DeviceBackend::get()
+{
+    // NOTE: never destroyed, since sessions may still be closing while the
+    //       library's other globals are destroyed
+    static DeviceBackend* const backend = create();
+    return *backend;
+}
+
+SystemBackend::SystemBackend(const std::string& sysfsRoot,
+    const std::string& devRoot,
+    const std::string& dmaHeapRoot)
+    : DeviceBackend(sysfsRoot, devRoot, dmaHeapRoot)
+{
+}
+
+int SystemBackend::open(const std::string& path, const int flags)
+{
+    return ::open(path.c_str(), flags);
+}
+
+int SystemBackend::close(const int descriptor)
+{
+    return ::close(descriptor);
+}
+
+ssize_t SystemBackend::read(const int descriptor, void* const buffer, const size_t size)
+{
+    return ::read(descriptor, buffer, size);
+}
+
+ssize_t SystemBackend::write(
+    const int descriptor, const void* const buffer, const size_t size)
+{
+    return ::write(descriptor, buffer, size);
+}
+
+ssize_t SystemBackend::pread(
+    const int descriptor, void* const buffer, const size_t size, const off_t offset)
+{
+    return ::pread(descriptor, buffer, size, offset);
+}
+
+ssize_t SystemBackend::pwrite(const int descriptor,
+    const void* const buffer,
+    const size_t size,
+    const off_t offset)
+{
+    return ::pwrite(descriptor, buffer, size, offset);
+}
+
+off_t SystemBackend::lseek(const int descriptor, const off_t offset, const int whence)
+{
+    return ::lseek(descriptor, offset, whence);
+}
+
+int SystemBackend::ioctl(
+    const int descriptor, const unsigned long int request, void* const argument)
+{
+    return ::ioctl(descriptor, request, argument);
+}
+
+int SystemBackend::stat(const std::string& path, struct stat* const status)
+{
+    return ::stat(path.c_str(), status);
+}
+
+void* SystemBackend::mmap(void* const address,
+    const size_t size,
+    const int protection,
+    const int flags,
+    const int descriptor,
+    const off_t offset)
+{
+    return ::mmap(address, size, protection, flags, descriptor, offset);
+}
+
+int SystemBackend::munmap(void* const address, const size_t size)
+{
+    return ::munmap(address, size);
+}
+
+std::unique_ptr<Loader> SystemBackend::createLoader()
+{
+    return Loader::create();
+}
+
+} // namespace nirio
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <sys/stat.h> // struct stat
+#include <sys/types.h> // off_t, ssize_t
+#include <memory> // std::unique_ptr
+#include <string> // std::string
+
+namespace nirio {
+
+class Loader;
+
+/**
+ * What DeviceFile, SysfsFile, and DmaBuf talk to: the NI-RIO driver's sysfs
+ * attributes and character devices, and the DMA heap.
+ *
+ * Each call stands in for the system call of the same name, returning the
+ * same thing and setting errno the same way on failure, so that errors are
+ * mapped just as they always have been. Descriptors handed out are always
+ * real ones, so they can be polled and mapped directly, but must be closed
+ * through the backend that opened them.
+ *
+ * Which backend is used is chosen once per process by $NIFPGA_BACKEND:
+ * "system" (the default) for the real driver, "simulated" for
+ * SimulatedBackend, or "replay" for ReplayBackend. The first two can be pointed
+ * somewhere other than /sys/class/nirio, /dev, and /dev/dma_heap with
+ * $NIFPGA_SYSFS_ROOT, $NIFPGA_DEV_ROOT, and $NIFPGA_DMA_HEAP_ROOT, and any of
+ * them can be recorded by TracingBackend by setting $NIFPGA_TRACE.
+ */
+class DeviceBackend
+{
+public:
+    virtual ~DeviceBackend() = default;
+
+    virtual int open(const std::string& path, int flags) = 0;
+
+    virtual int close(int descriptor) = 0;
+
+    virtual ssize_t read(int descriptor, void* buffer, size_t size) = 0;
+
+    virtual ssize_t write(int descriptor, const void* buffer, size_t size) = 0;
+
+    virtual ssize_t pread(int descriptor, void* buffer, size_t size, off_t offset) = 0;
+
+    virtual ssize_t pwrite(
+        int descriptor, const void* buffer, size_t size, off_t offset) = 0;
+
+    virtual off_t lseek(int descriptor, off_t offset, int whence) = 0;
+
+    virtual int ioctl(int descriptor, unsigned long int request, void* argument) = 0;
+
+    virtual int stat(const std::string& path, struct stat* status) = 0;
+
+    virtual void* mmap(void* address,
+        size_t size,
+        int protection,
+        int flags,
+        int descriptor,
+        off_t offset) = 0;
+
+    virtual int munmap(void* address, size_t size) = 0;
+
+    /**
+     * Creates a loader that puts firmware onto the devices of this backend.
+     */
+    virtual std::unique_ptr<Loader> createLoader() = 0;
+
+    /**
+     * Gets the directory of NI-RIO devices' sysfs attributes, such as
+     * /sys/class/nirio.
+     */
+    const std::string& getSysfsRoot() const;
+
+    /**
+     * Gets the directory of NI-RIO devices' character devices, such as /dev.
+     */
+    const std::string& getDevRoot() const;
+
+    /**
+     * Gets the directory of DMA heaps, such as /dev/dma_heap.
+     */
+    const std::string& getDmaHeapRoot() const;
+
+    /**
+     * Gets the backend for this process, creating it on first use.
+     *
+     * @return backend chosen by $NIFPGA_BACKEND
+     */
+    static DeviceBackend& get();
+
+protected:
+    DeviceBackend(const std::string& sysfsRoot,
+        const std::string& devRoot,
+        const std::string& dmaHeapRoot);
+
+private:
+    const std::string sysfsRoot;
+    const std::string devRoot;
+    const std::string dmaHeapRoot;
+
+    DeviceBackend(const DeviceBackend&) = delete;
+    DeviceBackend& operator=(const DeviceBackend&) = delete;
+};
+
+/**
+ * The real driver, through the system calls themselves.
+ */
+class SystemBackend : public DeviceBackend
+{
+public:
+    explicit SystemBackend(const std::string& sysfsRoot = "/sys/class/nirio",
+        const std::string& devRoot                      = "/dev",
+        const std::string& dmaHeapRoot                  = "/dev/dma_heap");
+
+    int open(const std::string& path, int flags) override;
+
+    int close(int descriptor) override;
+
+    ssize_t read(int descriptor, void* buffer, size_t size) override;
+
+    ssize_t write(int descriptor, const void* buffer, size_t size) override;
+
+    ssize_t pread(int descriptor, void* buffer, size_t size, off_t offset) override;
+
+    ssize_t pwrite(
+        int descriptor, const void* buffer, size_t size, off_t offset) override;
+
+    off_t lseek(int descriptor, off_t offset, int whence) override;
+
+    int ioctl(int descriptor, unsigned long int request, void* argument) override;
+
+    int stat(const std::string& path, struct stat* status) override;
+
+    void* mmap(void* address,
+        size_t size,
+        int protection,
+        int flags,
+        int descriptor,
+        off_t offset) override;
+
+    int munmap(void* address, size_t size) override;
+
+    std::unique_ptr<Loader> createLoader() override;
+};
+
+} // namespace nirio
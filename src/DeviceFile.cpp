@@ -14,12 +14,10 @@
 
 #include "DeviceFile.h"
 #include "Exception.h"
-#include "Timer.h"
-#include <fcntl.h> // open, close, read, write
-#include <sched.h> // sched_yield
-#include <sys/ioctl.h> // ioctl
-#include <sys/mman.h> // mmap, munmap
-#include <unistd.h>
+#include "PathWaiter.h"
+#include "Timing.h"
+#include <fcntl.h> // O_RDONLY, O_WRONLY, O_RDWR, O_CLOEXEC
+#include <sys/mman.h> // MAP_SHARED, PROT_*
 #include <cassert> // assert
 #include <sstream> // std::ostringstream
 
@@ -66,28 +64,34 @@ DeviceFile::DeviceFile(
     , mapped(NULL)
     , mappedSize(0)
     , errnoMap(errnoMap)
+    , backend(DeviceBackend::get())
 {
     // keep trying to open as long as file not found and we haven't timed out,
-    // as some virtual files can take a couple seconds before popping up
-    const Timer timer(2000);
-    do {
+    // as some virtual files can take a couple seconds before popping up (or
+    // until udev gets around to fixing their permissions)
+    int error = 0;
+    const TimingScope timing(NiFpgaEx_TimingStage_DeviceNode);
+    waitOnPath(path, 2000, [&] {
         // open the file with O_CLOEXEC to ensure child processes don't inherit
         // open handles
-        descriptor = ::open(path.c_str(), accessToOpenFlag(access) | O_CLOEXEC);
-    } while (descriptor == invalidDescriptor
-             && (errno == ENOENT || // "No such file or directory"
-                 errno == EACCES) // "Permission denied"
-             && !timer.isTimedOut()
-             // NOTE: "In the Linux implementation, sched_yield() always succeeds":
-             //    http://man7.org/linux/man-pages/man2/sched_yield.2.html
-             && sched_yield() == 0);
+        descriptor = backend.open(path, accessToOpenFlag(access) | O_CLOEXEC);
+        error      = errno;
+        return descriptor != invalidDescriptor
+               || (error != ENOENT && // "No such file or directory"
+                   error != EACCES); // "Permission denied"
+    });
     // finally, err if we never successfully opened
     if (descriptor == invalidDescriptor)
-        errnoMap.throwErrno(errno);
+        errnoMap.throwErrno(error);
 }
 
 DeviceFile::DeviceFile(int fd, const Access access, const ErrnoMap& errnoMap)
-    : access(access), descriptor(fd), mapped(NULL), mappedSize(0), errnoMap(errnoMap)
+    : access(access)
+    , descriptor(fd)
+    , mapped(NULL)
+    , mappedSize(0)
+    , errnoMap(errnoMap)
+    , backend(DeviceBackend::get())
 {
 }
 
@@ -102,7 +106,7 @@ DeviceFile::~DeviceFile()
         }
     }
 
-    ::close(descriptor);
+    backend.close(descriptor);
 }
 
 int DeviceFile::getDescriptor() const
@@ -110,13 +114,18 @@ int DeviceFile::getDescriptor() const
     return descriptor;
 }
 
+DeviceFile::Access DeviceFile::getAccess() const
+{
+    return access;
+}
+
 size_t DeviceFile::read(void* const buffer, const size_t size) const
 {
     // file must be open and readable
     if (access == WriteOnly)
         NIRIO_THROW(SoftwareFaultException());
 
-    const auto result = ::read(descriptor, buffer, size);
+    const auto result = backend.read(descriptor, buffer, size);
     if (result == -1)
         errnoMap.throwErrno(errno);
     return static_cast<size_t>(result);
@@ -128,7 +137,32 @@ size_t DeviceFile::write(const void* const buffer, const size_t size) const
     if (access == ReadOnly)
         NIRIO_THROW(SoftwareFaultException());
 
-    const auto result = ::write(descriptor, buffer, size);
+    const auto result = backend.write(descriptor, buffer, size);
+    if (result == -1)
+        errnoMap.throwErrno(errno);
+    return static_cast<size_t>(result);
+}
+
+size_t DeviceFile::pread(void* const buffer, const size_t size, const off_t offset) const
+{
+    // file must be open and readable
+    if (access == WriteOnly)
+        NIRIO_THROW(SoftwareFaultException());
+
+    const auto result = backend.pread(descriptor, buffer, size, offset);
+    if (result == -1)
+        errnoMap.throwErrno(errno);
+    return static_cast<size_t>(result);
+}
+
+size_t DeviceFile::pwrite(
+    const void* const buffer, const size_t size, const off_t offset) const
+{
+    // file must be open and writeable
+    if (access == ReadOnly)
+        NIRIO_THROW(SoftwareFaultException());
+
+    const auto result = backend.pwrite(descriptor, buffer, size, offset);
     if (result == -1)
         errnoMap.throwErrno(errno);
     return static_cast<size_t>(result);
@@ -136,7 +170,7 @@ size_t DeviceFile::write(const void* const buffer, const size_t size) const
 
 off_t DeviceFile::seek(off_t offset, int whence) const
 {
-    const auto result = ::lseek(descriptor, offset, whence);
+    const auto result = backend.lseek(descriptor, offset, whence);
 
     if (result == -1)
         errnoMap.throwErrno(errno);
@@ -146,19 +180,20 @@ off_t DeviceFile::seek(off_t offset, int whence) const
 
 void DeviceFile::ioctl(const unsigned long int request, void* const buffer) const
 {
-    if (::ioctl(descriptor, request, buffer) == -1)
+    if (backend.ioctl(descriptor, request, buffer) == -1)
         errnoMap.throwErrno(errno);
 }
 
 volatile void* DeviceFile::mapMemory(const size_t size)
 {
+    const TimingScope timing(NiFpgaEx_TimingStage_MapMemory);
     // file must be open and not mapped
     if (mapped)
         NIRIO_THROW(SoftwareFaultException());
 
     // try the mapping
-    mapped = static_cast<volatile uint8_t*>(
-        mmap(NULL, size, accessToMmapProtection(access), MAP_SHARED, descriptor, 0));
+    mapped = static_cast<volatile uint8_t*>(backend.mmap(
+        NULL, size, accessToMmapProtection(access), MAP_SHARED, descriptor, 0));
     // NOTE: we don't use MAP_FAILED to prevent "use of old-style cast" warning
     if (mapped != reinterpret_cast<void*>(-1))
         mappedSize = size;
@@ -174,7 +209,7 @@ void DeviceFile::unmapMemory()
     if (!mapped)
         NIRIO_THROW(SoftwareFaultException());
 
-    if (munmap(const_cast<uint8_t*>(mapped), mappedSize) == 0) {
+    if (backend.munmap(const_cast<uint8_t*>(mapped), mappedSize) == 0) {
         mapped     = NULL;
         mappedSize = 0;
     } else
@@ -186,9 +221,19 @@ bool DeviceFile::isMapped() const
     return mapped;
 }
 
+volatile void* DeviceFile::getMapped() const
+{
+    return mapped;
+}
+
+size_t DeviceFile::getMappedSize() const
+{
+    return mappedSize;
+}
+
 std::string DeviceFile::getCdevPath(const std::string& device)
 {
-    return joinPath("/dev", device);
+    return joinPath(DeviceBackend::get().getDevRoot(), device);
 }
 
 std::string DeviceFile::getFifoCdevPath(
@@ -196,7 +241,7 @@ std::string DeviceFile::getFifoCdevPath(
 {
     std::ostringstream temp;
     temp << device << "fifo" << fifo;
-    return joinPath("/dev", temp.str());
+    return joinPath(DeviceBackend::get().getDevRoot(), temp.str());
 }
 
 } // namespace nirio
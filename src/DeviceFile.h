@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include "DeviceBackend.h"
 #include "ErrnoMap.h"
 #include "Status.h"
 #include <sys/ioctl.h>
@@ -22,7 +23,8 @@
 namespace nirio {
 
 /**
- * A device file, usually in /dev or /sys.
+ * A device file, usually in /dev or /sys, opened through the process's
+ * DeviceBackend.
  *
  * Open file descriptors will use the O_CLOEXEC flag, so that copies will not be
  * held by child processes after a call to fork() and exec().
@@ -43,10 +45,16 @@ public:
 
     int getDescriptor() const;
 
+    Access getAccess() const;
+
     size_t read(void* buffer, size_t size) const;
 
     size_t write(const void* buffer, size_t size) const;
 
+    size_t pread(void* buffer, size_t size, off_t offset) const;
+
+    size_t pwrite(const void* buffer, size_t size, off_t offset) const;
+
     off_t seek(off_t offset, int whence) const;
 
     void ioctl(unsigned long int request, void* buffer = NULL) const;
@@ -57,6 +65,10 @@ public:
 
     bool isMapped() const;
 
+    volatile void* getMapped() const;
+
+    size_t getMappedSize() const;
+
     template <typename T>
     T mappedRead(size_t offset) const
     {
@@ -106,6 +118,7 @@ private:
     volatile uint8_t* mapped;
     size_t mappedSize;
     const ErrnoMap& errnoMap;
+    DeviceBackend& backend;
 
     DeviceFile(const DeviceFile&) = delete;
     DeviceFile& operator=(const DeviceFile&) = delete;
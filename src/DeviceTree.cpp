@@ -124,8 +124,7 @@ static auto gen_rio_node(const nirio::Bitfile& bitfile)
     return rio;
 }
 
-// TODO: Remove eventually, once most bitfiles are built using new style overlays
-std::string generateOldOverlay(const nirio::Bitfile& bitfile)
+static auto gen_old_fragment(const nirio::Bitfile& bitfile)
 {
     using dtgen::dt_node;
 
@@ -138,8 +137,19 @@ std::string generateOldOverlay(const nirio::Bitfile& bitfile)
     fragment->add_property_phandle("target", "amba");
     fragment->add_node(std::move(overlay));
 
+    return fragment;
+}
+
+static bool is_old_overlay(const std::string& overlay)
+{
+    return overlay.find("__overlay__") != std::string::npos;
+}
+
+// TODO: Remove eventually, once most bitfiles are built using new style overlays
+std::string generateOldOverlay(const nirio::Bitfile& bitfile)
+{
     auto dtso = bitfile.getOverlay();
-    dtso.insert(dtso.rfind("};"), fragment->render(0));
+    dtso.insert(dtso.rfind("};"), gen_old_fragment(bitfile)->render(0));
 
     return dtso;
 }
@@ -159,12 +169,37 @@ std::string generateOverlay(const nirio::Bitfile& bitfile)
 
 std::string generateDeviceTree(const nirio::Bitfile& bitfile)
 {
-    auto overlay = bitfile.getOverlay();
-
-    if (overlay.find("__overlay__") != -1)
+    if (is_old_overlay(bitfile.getOverlay()))
         return generateOldOverlay(bitfile);
     else
         return generateOverlay(bitfile);
 }
 
+std::optional<std::vector<uint8_t>> generateCompiledDeviceTree(
+    const nirio::Bitfile& bitfile)
+{
+    using dtgen::dt_node;
+    using dtgen::dt_tree;
+
+    const auto& source = bitfile.getOverlay();
+    try {
+        auto tree = dt_tree::parse(source);
+
+        // same additions as generateDeviceTree, made to the tree instead
+        if (is_old_overlay(source)) {
+            tree.root->add_node(gen_old_fragment(bitfile));
+        } else {
+            auto overlay = std::make_unique<dt_node>("");
+            overlay->add_node(gen_rio_node(bitfile));
+            tree.add_orphan("fpga_full", std::move(overlay));
+        }
+
+        return tree.flatten();
+    } catch (const dtgen::dt_error&) {
+        // leave it to dtc, which is expected for overlays that don't parse
+        // here, such as a bitfile without one
+        return std::nullopt;
+    }
+}
+
 } // namespace nirio
@@ -15,10 +15,23 @@
 #pragma once
 
 #include "Bitfile.h"
+#include <cstdint> // uint8_t
+#include <optional> // std::optional
+#include <vector> // std::vector
 
 namespace nirio {
 
 std::string generateDeviceTree(const Bitfile& bitfile);
 
+/**
+ * Generates the same overlay as generateDeviceTree, already compiled to a
+ * device tree blob as "dtc -@" would, so that loading it doesn't need dtc.
+ *
+ * @param bitfile bitfile to generate the overlay for
+ * @return the compiled overlay, or nothing if the overlay embedded in the
+ *         bitfile uses source that can only be compiled by dtc
+ */
+std::optional<std::vector<uint8_t>> generateCompiledDeviceTree(const Bitfile& bitfile);
+
 
 }
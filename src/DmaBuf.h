@@ -15,6 +15,7 @@
 #pragma once
 
 #include "Common.h"
+#include "DeviceBackend.h"
 #include "DeviceFile.h"
 #include "linux/dma-heap.h"
 #include <fcntl.h>
@@ -29,7 +30,8 @@ class DmaBuf
 public:
     static DmaBuf* allocate(size_t size, const char* heap = "system")
     {
-        DeviceFile heapFile(joinPath("/dev/dma_heap", heap), DeviceFile::ReadWrite);
+        DeviceFile heapFile(
+            joinPath(DeviceBackend::get().getDmaHeapRoot(), heap), DeviceFile::ReadWrite);
         struct dma_heap_allocation_data arg;
 
         arg.len        = size;
@@ -46,6 +46,7 @@ public:
             case EIO:
                 throw HardwareFaultException();
             case ENOMEM:
+            case ENOSPC:
                 throw MemoryFullException();
                 // TODO: FpgaBusy to be more generic?
             case EBUSY:
@@ -15,6 +15,7 @@
 #include "Fifo.h"
 #include "ErrnoMap.h"
 #include "Exception.h"
+#include "Probes.h"
 #include <unistd.h> // sysconf
 #include <cassert> // assert
 #include <cstdlib> // valloc
@@ -67,6 +68,20 @@ public:
     }
 } errnoMap;
 
+/**
+ * Converts between a cluster element as it sits in the buffer and the packed
+ * byte stream ClusterPlan works with. The element is read as little-endian
+ * 64-bit words, most significant first (or a single smaller word), so this
+ * just reverses the bytes of each word, which makes it its own inverse.
+ */
+void swapElementWords(const uint8_t* const in, uint8_t* const out, const size_t bytes)
+{
+    const size_t wordBytes = std::min<size_t>(bytes, sizeof(uint64_t));
+    for (size_t word = 0; word < bytes; word += wordBytes)
+        for (size_t i = 0; i < wordBytes; i++)
+            out[word + i] = in[word + wordBytes - 1 - i];
+}
+
 } // unnamed namespace
 
 Fifo::Fifo(const FifoInfo& fifo, const std::string& device)
@@ -75,6 +90,9 @@ Fifo::Fifo(const FifoInfo& fifo, const std::string& device)
     , started(false)
     , hardwareElementBytes(
           FifoSysfsFile(device, number, "element_bytes", errnoMap).readU32())
+    // clusters are padded to the hardware's element size, while everything
+    // else is transferred as its C type
+    , elementStride(type.isCluster() ? hardwareElementBytes : type.getElementBytes())
     ,
     // depth assigned below
     // size assigned below
@@ -259,6 +277,93 @@ void Fifo::setStopped()
     }
 }
 
+// precondition: lock is locked
+// precondition: FIFO is configured and started
+void* Fifo::doContiguousAcquireBookkeeping(const size_t elementsAcquired)
+{
+    acquired += elementsAcquired;
+    auto* const elements = static_cast<uint8_t*>(buffer) + next * elementStride;
+    next += elementsAcquired;
+    if (next == depth)
+        next = 0;
+
+    if (hostToTarget)
+        VALGRIND_MAKE_MEM_UNDEFINED(elements, elementsAcquired * elementStride);
+    else
+        VALGRIND_MAKE_MEM_DEFINED(elements, elementsAcquired * elementStride);
+    return elements;
+}
+
+void Fifo::checkFixedPoint(const bool isWrite) const
+{
+    if (!type.isFixedPoint() || isWrite != hostToTarget)
+        NIRIO_THROW(InvalidParameterException());
+}
+
+const ClusterPlan& Fifo::checkCluster(const bool isWrite, const size_t fieldCount) const
+{
+    if (!clusterPlan || isWrite != hostToTarget
+        || clusterPlan->getFieldCount() != fieldCount)
+        NIRIO_THROW(InvalidParameterException());
+    // we don't know how to handle a cluster that doesn't fit its elements
+    if (elementStride > maximumClusterElementBytes
+        || (elementStride > sizeof(uint64_t) && elementStride % sizeof(uint64_t))
+        || clusterPlan->getBits() > elementStride * 8)
+        NIRIO_THROW(FeatureNotSupportedException());
+    return *clusterPlan;
+}
+
+void Fifo::readCluster(void* const data,
+    const size_t stride,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount,
+    const size_t elementsRequested,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    const auto& plan = checkCluster(false, fieldCount);
+    // clusters are right-justified within their elements
+    const auto firstBit = elementStride * 8 - plan.getBits();
+    // unpack each element straight out of the buffer
+    transfer<false>(elementsRequested,
+        timeout,
+        elementsRemaining,
+        [&](const void* const elements, const size_t done, const size_t count) {
+            const auto* from = static_cast<const uint8_t*>(elements);
+            auto* to         = static_cast<uint8_t*>(data) + done * stride;
+            uint8_t packed[maximumClusterElementBytes];
+            for (size_t i = 0; i < count; i++, from += elementStride, to += stride) {
+                swapElementWords(from, packed, elementStride);
+                plan.unpack(packed, to, fieldOffsets, firstBit);
+            }
+        });
+}
+
+void Fifo::writeCluster(const void* const data,
+    const size_t stride,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount,
+    const size_t elementsRequested,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    const auto& plan    = checkCluster(true, fieldCount);
+    const auto firstBit = elementStride * 8 - plan.getBits();
+    // pack each element straight into the buffer
+    transfer<true>(elementsRequested,
+        timeout,
+        elementsRemaining,
+        [&](void* const elements, const size_t done, const size_t count) {
+            const auto* from = static_cast<const uint8_t*>(data) + done * stride;
+            auto* to         = static_cast<uint8_t*>(elements);
+            uint8_t packed[maximumClusterElementBytes];
+            for (size_t i = 0; i < count; i++, from += stride, to += elementStride) {
+                plan.pack(from, fieldOffsets, packed, firstBit);
+                swapElementWords(packed, to, elementStride);
+            }
+        });
+}
+
 void Fifo::release(const size_t elements)
 {
     // release of 0 elements should always succeed
@@ -269,6 +374,7 @@ void Fifo::release(const size_t elements)
     // they shouldn't release more than they have
     if (elements > acquired)
         NIRIO_THROW(BadReadWriteCountException());
+    NIRIO_HOT_PATH;
 
     // just pass it on, assuming kernel will error if wrong
     try {
@@ -278,12 +384,13 @@ void Fifo::release(const size_t elements)
         // if someone reset or otherwise stopped the FIFO behind our back, take note
         setStopped();
     }
+    NIRIO_PROBE(fifo_release, number, elements);
 
     const char* buf               = static_cast<const char*>(buffer);
-    const size_t bufSize          = depth * type.getElementBytes();
-    const size_t acquiredInBytes  = acquired * type.getElementBytes();
-    const size_t releasingInBytes = elements * type.getElementBytes();
-    const size_t nextInBytes      = next * type.getElementBytes();
+    const size_t bufSize          = depth * elementStride;
+    const size_t acquiredInBytes  = acquired * elementStride;
+    const size_t releasingInBytes = elements * elementStride;
+    const size_t nextInBytes      = next * elementStride;
 
     if (nextInBytes >= acquiredInBytes) {
         VALGRIND_MAKE_MEM_NOACCESS(
@@ -311,15 +418,24 @@ void Fifo::acquireWithWait(const size_t elementsRequested,
 
     fifo_acq.elements   = elementsRequested;
     fifo_acq.timeout_ms = timeoutMs;
+    NIRIO_PROBE(fifo_acquire_entry, number, elementsRequested, timeoutMs);
+    const ProbeTimer waited(NIRIO_PROBE_ENABLED(fifo_acquire_return));
     try {
         file->ioctl(NIRIO_IOC_FIFO_ACQUIRE, &fifo_acq);
     } catch (const TransferAbortedException&) {
         // FIFO was stopped out from under us
         // clean up our members, restart, and try one more time to acquire
+        NIRIO_PROBE(fifo_restart, number);
         setStopped();
         start();
         file->ioctl(NIRIO_IOC_FIFO_ACQUIRE, &fifo_acq);
     }
+    NIRIO_PROBE(fifo_acquire_return,
+        number,
+        elementsRequested,
+        fifo_acq.timed_out ? 0 : elementsRequested,
+        fifo_acq.available,
+        waited.getElapsed());
 
     if (elementsRemaining)
         *elementsRemaining = fifo_acq.available;
@@ -336,6 +452,7 @@ void Fifo::getElementsAvailable(size_t& elementsAvailable)
     } catch (const TransferAbortedException&) {
         // FIFO was stopped out from under us
         // clean up members, restart, and try one more time
+        NIRIO_PROBE(fifo_restart, number);
         setStopped();
         start();
         file->ioctl(NIRIO_IOC_FIFO_GET_AVAIL, &available);
@@ -19,6 +19,8 @@
 #include "DmaBuf.h"
 #include "Exception.h"
 #include "FifoInfo.h"
+#include "FixedPoint.h"
+#include "HotPath.h"
 #include "SysfsFile.h"
 #include "Timer.h"
 #include "valgrind.h"
@@ -70,13 +72,58 @@ public:
         uint32_t timeout,
         size_t* elementsRemaining);
 
+    template <typename Float>
+    void readFxp(Float* data,
+        size_t elementsRequested,
+        uint32_t timeout,
+        NiFpga_Bool* overflows,
+        size_t* elementsRemaining);
+
+    template <typename Float>
+    void writeFxp(const Float* data,
+        size_t elementsRequested,
+        uint32_t timeout,
+        size_t* elementsRemaining);
+
+    void readCluster(void* data,
+        size_t stride,
+        const size_t* fieldOffsets,
+        size_t fieldCount,
+        size_t elementsRequested,
+        uint32_t timeout,
+        size_t* elementsRemaining);
+
+    void writeCluster(const void* data,
+        size_t stride,
+        const size_t* fieldOffsets,
+        size_t fieldCount,
+        size_t elementsRequested,
+        uint32_t timeout,
+        size_t* elementsRemaining);
+
 private:
+    /// Largest cluster element we'll convert, in bytes.
+    static const size_t maximumClusterElementBytes = 256;
+
     template <typename T, bool IsWrite>
     void readOrWrite(typename T::CType* data,
         size_t elementsRequested,
         uint32_t timeout,
         size_t* elementsRemaining);
 
+    /// Acquires, copies, and releases elements, calling copy(elements, done,
+    /// count) for each contiguous region of the buffer so that any conversion
+    /// happens as the data is copied.
+    template <bool IsWrite, typename Copy>
+    void transfer(size_t elementsRequested,
+        uint32_t timeout,
+        size_t* elementsRemaining,
+        const Copy& copy);
+
+    void checkFixedPoint(bool isWrite) const;
+
+    const ClusterPlan& checkCluster(bool isWrite, size_t fieldCount) const;
+
     /// Do bookkeeping and set elements pointer after acquiring elements.
     /// Only handles contiguous acquires, i.e. does not handle wraparound
     /// case.
@@ -84,6 +131,9 @@ private:
     void doContiguousAcquireBookkeeping(
         typename T::CType*& elements, size_t elementsAcquired);
 
+    /// Untyped version of the above, returning the elements pointer.
+    void* doContiguousAcquireBookkeeping(size_t elementsAcquired);
+
     void calculateDimensions(
         size_t requestedDepth, size_t& actualDepth, size_t& actualSize) const;
 
@@ -112,6 +162,8 @@ private:
     bool started; ///< Whether currently started.
     /// Number of bytes per element transferred between hardware and driver.
     const size_t hardwareElementBytes;
+    /// Number of bytes per element in the buffer.
+    const size_t elementStride;
     size_t depth; ///< Total depth in elements.
     size_t size; ///< Total size in bytes.
     void* buffer; ///< Host memory buffer.
@@ -130,16 +182,8 @@ template <typename T>
 void Fifo::doContiguousAcquireBookkeeping(
     typename T::CType*& elements, const size_t elementsAcquired)
 {
-    acquired += elementsAcquired;
-    elements = &static_cast<typename T::CType*>(buffer)[next];
-    next += elementsAcquired;
-    if (next == depth)
-        next = 0;
-
-    if (hostToTarget)
-        VALGRIND_MAKE_MEM_UNDEFINED(elements, elementsAcquired * type.getElementBytes());
-    else
-        VALGRIND_MAKE_MEM_DEFINED(elements, elementsAcquired * type.getElementBytes());
+    elements =
+        static_cast<typename T::CType*>(doContiguousAcquireBookkeeping(elementsAcquired));
 }
 
 template <typename T, bool IsWrite>
@@ -164,6 +208,8 @@ void Fifo::acquire(typename T::CType*& elements,
         NIRIO_THROW(ElementsNotPermissibleToBeAcquiredException());
     // configure and start are optional calls, so do them if necessary
     ensureConfiguredAndStarted();
+    // once configured, the rest must not allocate
+    NIRIO_HOT_PATH;
     // Not trying to acquire anything at all, just get elements remaining
     if (elementsRequested == 0) {
         if (elementsRemaining)
@@ -177,14 +223,34 @@ void Fifo::acquire(typename T::CType*& elements,
 }
 
 template <typename T, bool IsWrite>
-void Fifo::readOrWrite(typename T::CType* data,
-    size_t elementsRequested,
+void Fifo::readOrWrite(typename T::CType* const data,
+    const size_t elementsRequested,
     const uint32_t timeout,
     size_t* const elementsRemaining)
 {
     // ensure the type and direction are right
     if (T() != type || IsWrite != hostToTarget)
         NIRIO_THROW(InvalidParameterException());
+    // copy between the acquired region and the user's buffer
+    transfer<IsWrite>(elementsRequested,
+        timeout,
+        elementsRemaining,
+        [data](void* const elements, const size_t done, const size_t count) {
+            const auto bytes = count * T::elementBytes;
+            if (IsWrite)
+                memcpy(elements, data + done, bytes);
+            else
+                memcpy(data + done, elements, bytes);
+        });
+}
+
+// precondition: type and direction were checked
+template <bool IsWrite, typename Copy>
+void Fifo::transfer(size_t elementsRequested,
+    const uint32_t timeout,
+    size_t* const elementsRemaining,
+    const Copy& copy)
+{
     // grab the lock
     const std::lock_guard<std::recursive_mutex> guard(lock);
     // cannot do this while elements are acquired
@@ -195,6 +261,8 @@ void Fifo::readOrWrite(typename T::CType* data,
         NIRIO_THROW(BadReadWriteCountException());
     // configure and start are optional calls, so do them if necessary
     ensureConfiguredAndStarted();
+    // once configured, the rest must not allocate
+    NIRIO_HOT_PATH;
     // Not trying to read/write anything at all, just get elements remaining
     if (elementsRequested == 0) {
         if (elementsRemaining)
@@ -206,17 +274,12 @@ void Fifo::readOrWrite(typename T::CType* data,
 
     // loop until we've copied the entire amount we just acquired
     size_t iterations = 0;
+    size_t done       = 0;
     do {
         // bookkeep the acquire (possibly a subset of total amount)
-        typename T::CType* elements;
         const size_t elementsAcquired = std::min(elementsRequested, depth - next);
-        doContiguousAcquireBookkeeping<T>(elements, elementsAcquired);
-        // copy between the acquired region and the user's buffer
-        const auto bytes = elementsAcquired * T::elementBytes;
-        if (IsWrite)
-            memcpy(elements, data, bytes);
-        else
-            memcpy(data, elements, bytes);
+        auto* const elements          = doContiguousAcquireBookkeeping(elementsAcquired);
+        copy(elements, done, elementsAcquired);
         // release the region
         //
         // NOTE: If release somehow failed, we'll be left in a weird state
@@ -225,7 +288,7 @@ void Fifo::readOrWrite(typename T::CType* data,
         //       there's not much else we can do other than err out.
         release(elementsAcquired);
         // account for how many we got
-        data += elementsAcquired;
+        done += elementsAcquired;
         elementsRequested -= elementsAcquired;
         iterations++;
     } while (elementsRequested);
@@ -255,4 +318,52 @@ void Fifo::write(const typename T::CType* const data,
         elementsRemaining);
 }
 
+template <typename Float>
+void Fifo::readFxp(Float* const data,
+    const size_t elementsRequested,
+    const uint32_t timeout,
+    NiFpga_Bool* const overflows,
+    size_t* const elementsRemaining)
+{
+    checkFixedPoint(false);
+    const FixedPoint fixedPoint(type);
+    const bool wide = type.getElementBytes() > sizeof(uint32_t);
+    // convert straight out of the buffer, which holds raw words
+    transfer<false>(elementsRequested,
+        timeout,
+        elementsRemaining,
+        [&](const void* const elements, const size_t done, const size_t count) {
+            auto* const flags = overflows ? overflows + done : nullptr;
+            if (wide)
+                fixedPoint.toFloat(
+                    static_cast<const uint64_t*>(elements), data + done, flags, count);
+            else
+                fixedPoint.toFloat(
+                    static_cast<const uint32_t*>(elements), data + done, flags, count);
+        });
+}
+
+template <typename Float>
+void Fifo::writeFxp(const Float* const data,
+    const size_t elementsRequested,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    checkFixedPoint(true);
+    const FixedPoint fixedPoint(type);
+    const bool wide = type.getElementBytes() > sizeof(uint32_t);
+    // convert straight into the buffer
+    transfer<true>(elementsRequested,
+        timeout,
+        elementsRemaining,
+        [&](void* const elements, const size_t done, const size_t count) {
+            if (wide)
+                fixedPoint.fromFloat(
+                    data + done, static_cast<uint64_t*>(elements), count);
+            else
+                fixedPoint.fromFloat(
+                    data + done, static_cast<uint32_t*>(elements), count);
+        });
+}
+
 } // namespace nirio
@@ -14,6 +14,7 @@
 
 #include "FifoInfo.h"
 #include <cassert> // assert
+#include <utility> // std::move
 
 namespace nirio {
 
@@ -22,7 +23,8 @@ FifoInfo::FifoInfo(const std::string& name,
     const NiFpgaEx_DmaFifo number,
     const uint32_t controlSet,
     const bool hostToTarget,
-    const std::string& baseAddressTag)
+    const std::string& baseAddressTag,
+    std::shared_ptr<const ClusterPlan> clusterPlan)
     : ResourceInfo(name, type)
     , number(number)
     , controlSet(controlSet)
@@ -30,7 +32,7 @@ FifoInfo::FifoInfo(const std::string& name,
     , baseAddressTag(baseAddressTag)
     , offset(0)
     , offsetIsSet(false)
-
+    , clusterPlan(std::move(clusterPlan))
 {
 }
 
@@ -75,6 +77,11 @@ bool FifoInfo::isOffsetSet() const
     return offsetIsSet;
 }
 
+const ClusterPlan* FifoInfo::getClusterPlan() const
+{
+    return clusterPlan.get();
+}
+
 bool FifoInfo::matches(const std::string& name, const NiFpgaEx_ResourceType type) const
 {
     if (type == NiFpgaEx_ResourceType_Any)
@@ -14,7 +14,9 @@
 
 #pragma once
 
+#include "ClusterPlan.h"
 #include "ResourceInfo.h"
+#include <memory> // std::shared_ptr
 #include <vector> // std::vector
 
 namespace nirio {
@@ -30,7 +32,8 @@ public:
         NiFpgaEx_DmaFifo number,
         uint32_t controlSet,
         bool hostToTarget,
-        const std::string& baseAddressTag);
+        const std::string& baseAddressTag,
+        std::shared_ptr<const ClusterPlan> clusterPlan = nullptr);
 
     /**
      * Gets the FIFO number. This is sometimes referred to as the channel
@@ -91,6 +94,13 @@ public:
      */
     bool isOffsetSet() const;
 
+    /**
+     * Gets the layout of the elements of a cluster FIFO.
+     *
+     * @return layout of each element, or NULL if not a cluster FIFO
+     */
+    const ClusterPlan* getClusterPlan() const;
+
     virtual bool matches(const std::string& name, NiFpgaEx_ResourceType type) const;
 
 protected:
@@ -101,6 +111,7 @@ protected:
     std::string baseAddressTag;
     uint32_t offset;
     bool offsetIsSet;
+    std::shared_ptr<const ClusterPlan> clusterPlan;
 };
 
 typedef std::vector<FifoInfo> FifoInfoVector;
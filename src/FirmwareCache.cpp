@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "FirmwareCache.h"
+#include "Bitfile.h"
+#include "DeviceTree.h"
+#include "Exception.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Timing.h"
+#include <dirent.h> // opendir, readdir, closedir
+#include <fcntl.h> // AT_FDCWD
+#include <sys/stat.h> // stat, fchmod, utimensat
+#include <unistd.h> // write, close, unlink
+#include <algorithm> // std::min, std::sort
+#include <cerrno> // errno
+#include <cstdio> // fopen, fscanf, rename, snprintf
+#include <cstdlib> // getenv, mkstemp, strtoull
+#include <cstring> // memcmp
+#include <iostream> // std::cerr, std::endl
+#include <vector> // std::vector
+
+namespace nirio {
+
+namespace {
+
+/**
+ * Hashes a file a megabyte at a time, each seeded by the hash of the last, so
+ * that checking a large bitstream doesn't keep all of it resident.
+ */
+bool hashFile(const std::string& path, uint64_t& hash, uint64_t& size)
+{
+    const MappedFile file(path);
+    if (!file.isMapped())
+        return false;
+    const size_t chunkSize = 1024 * 1024;
+    hash                   = 0;
+    size                   = file.getSize();
+    for (size_t offset = 0; offset < file.getSize(); offset += chunkSize) {
+        const auto length = std::min(chunkSize, file.getSize() - offset);
+        hash              = hash64(file.getData() + offset, length, hash);
+        file.release(offset, length);
+    }
+    return true;
+}
+
+bool writeAll(const int descriptor, const char* data, size_t size)
+{
+    while (size) {
+        const auto written = ::write(descriptor, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+/**
+ * Writes a file by way of a temporary file in the same directory, so that it
+ * appears all at once or not at all.
+ *
+ * @param write writes the contents to the temporary file's descriptor
+ */
+template <typename Write>
+void replaceFile(const std::string& path, Write&& write)
+{
+    const auto slash = path.rfind('/') + 1;
+    auto temporaryPath =
+        path.substr(0, slash) + "." + path.substr(slash) + ".XXXXXX";
+    const auto descriptor = mkstemp(&temporaryPath[0]);
+    if (descriptor < 0) {
+        std::cerr << "failed to create " << path << ": " << errno << std::endl;
+        NIRIO_THROW(SoftwareFaultException());
+    }
+    bool closed = false;
+    try {
+        // NOTE: mkstemp only lets us read it, but firmware is for everyone
+        fchmod(descriptor, 0644);
+        write(descriptor);
+        closed = true;
+        if (::close(descriptor))
+            NIRIO_THROW(SoftwareFaultException());
+        if (std::rename(temporaryPath.c_str(), path.c_str())) {
+            std::cerr << "failed to replace " << path << ": " << errno << std::endl;
+            NIRIO_THROW(SoftwareFaultException());
+        }
+    } catch (...) {
+        if (!closed)
+            ::close(descriptor);
+        ::unlink(temporaryPath.c_str());
+        throw;
+    }
+}
+
+/**
+ * Writes a file only if it doesn't already hold exactly what would be written,
+ * so that its modification time says when it last changed.
+ */
+void replaceFileIfChanged(const std::string& path, const char* data, const size_t size)
+{
+    const MappedFile existing(path);
+    if (existing.isMapped() && existing.getSize() == size
+        && !memcmp(existing.getData(), data, size))
+        return;
+    replaceFile(path, [&](const int descriptor) {
+        if (!writeAll(descriptor, data, size))
+            NIRIO_THROW(SoftwareFaultException());
+    });
+}
+
+uint64_t getFileSize(const std::string& path)
+{
+    struct stat status;
+    return stat(path.c_str(), &status) ? 0 : static_cast<uint64_t>(status.st_size);
+}
+
+} // unnamed namespace
+
+FirmwareCache::FirmwareCache(const std::string& directory, const uint64_t budget)
+    : directory(directory), budget(budget)
+{
+}
+
+Firmware FirmwareCache::prepare(const Bitfile& bitfile) const
+{
+    const auto& signature = bitfile.getSignature();
+    const auto binPath    = directory + "/" + signature + ".bin";
+    const auto hashPath   = directory + "/" + signature + ".hash";
+    const auto dtsPath    = directory + "/" + signature + ".dts";
+    const auto dtboPath   = directory + "/" + signature + ".dtbo";
+    const bool added      = !isIntact(binPath, hashPath);
+    if (added)
+        writeBitstream(bitfile, binPath, hashPath);
+    const bool compiled = writeOverlay(bitfile, dtsPath, dtboPath);
+    // the .hash's modification time is when the entry was last used
+    utimensat(AT_FDCWD, hashPath.c_str(), NULL, 0);
+    if (added)
+        evict(signature);
+    return {binPath, dtsPath, compiled ? dtboPath : ""};
+}
+
+std::string FirmwareCache::getDirectory()
+{
+    const char* const directory = getenv("NIFPGA_FIRMWARE_DIR");
+    return directory && *directory ? directory : "/lib/firmware";
+}
+
+uint64_t FirmwareCache::getBudget()
+{
+    const char* const text = getenv("NIFPGA_FIRMWARE_CACHE_SIZE");
+    if (!text)
+        return 0;
+    char* suffix  = NULL;
+    uint64_t size = strtoull(text, &suffix, 10);
+    switch (*suffix) {
+        case 'G':
+        case 'g':
+            size *= 1024;
+            // fall through
+        case 'M':
+        case 'm':
+            size *= 1024;
+            // fall through
+        case 'K':
+        case 'k':
+            size *= 1024;
+            break;
+        default:
+            break;
+    }
+    return size;
+}
+
+bool FirmwareCache::isIntact(
+    const std::string& binPath, const std::string& hashPath) const
+{
+    const TimingScope timing(NiFpgaEx_TimingStage_Verify);
+    FILE* const file = fopen(hashPath.c_str(), "re");
+    if (!file)
+        return false;
+    unsigned long long expectedHash = 0, expectedSize = 0;
+    const bool read = fscanf(file, "%llx %llu", &expectedHash, &expectedSize) == 2;
+    fclose(file);
+    // NOTE: check the size before hashing, since it's free and is all that
+    //       differs when an earlier write was cut short
+    uint64_t hash, size;
+    return read && getFileSize(binPath) == expectedSize && hashFile(binPath, hash, size)
+           && hash == expectedHash && size == expectedSize;
+}
+
+void FirmwareCache::writeBitstream(
+    const Bitfile& bitfile, const std::string& binPath, const std::string& hashPath) const
+{
+    // write the bitstream before recording its hash, so that a crash between
+    // leaves a bitstream that won't be trusted instead of a hash with nothing
+    replaceFile(
+        binPath, [&](const int descriptor) { bitfile.writeBitstream(descriptor); });
+    uint64_t hash, size;
+    {
+        const TimingScope timing(NiFpgaEx_TimingStage_Verify);
+        if (!hashFile(binPath, hash, size))
+            NIRIO_THROW(SoftwareFaultException());
+    }
+    char line[64];
+    const auto length = snprintf(line,
+        sizeof(line),
+        "%016llx %llu\n",
+        static_cast<unsigned long long>(hash),
+        static_cast<unsigned long long>(size));
+    replaceFile(hashPath, [&](const int descriptor) {
+        if (!writeAll(descriptor, line, static_cast<size_t>(length)))
+            NIRIO_THROW(SoftwareFaultException());
+    });
+}
+
+bool FirmwareCache::writeOverlay(const Bitfile& bitfile,
+    const std::string& dtsPath,
+    const std::string& dtboPath) const
+{
+    const TimingScope timing(NiFpgaEx_TimingStage_Overlay);
+    // NOTE: the source is still written, for anyone looking at what's loaded
+    const auto dts = generateDeviceTree(bitfile);
+    replaceFileIfChanged(dtsPath, dts.data(), dts.size());
+    const auto dtbo = generateCompiledDeviceTree(bitfile);
+    if (!dtbo)
+        return false;
+    replaceFileIfChanged(
+        dtboPath, reinterpret_cast<const char*>(dtbo->data()), dtbo->size());
+    return true;
+}
+
+void FirmwareCache::evict(const std::string& signature) const
+{
+    if (!budget)
+        return;
+    struct Entry
+    {
+        std::string signature;
+        struct timespec used;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    // only entries with a .hash are ours to evict
+    if (DIR* const listing = opendir(directory.c_str())) {
+        static const std::string extension = ".hash";
+        while (const auto* const entry = readdir(listing)) {
+            const std::string name = entry->d_name;
+            if (name.size() <= extension.size() || name[0] == '.'
+                || name.compare(
+                       name.size() - extension.size(), extension.size(), extension))
+                continue;
+            const auto cached = name.substr(0, name.size() - extension.size());
+            const auto base   = directory + "/" + cached;
+            struct stat status;
+            if (stat((base + extension).c_str(), &status))
+                continue;
+            const auto size = getFileSize(base + ".bin") + getFileSize(base + ".dts")
+                              + getFileSize(base + ".dtbo");
+            entries.push_back({cached, status.st_mtim, size});
+            total += size;
+        }
+        closedir(listing);
+    }
+    // remove the least recently used first, but never what was just added
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec
+                                              : a.used.tv_nsec < b.used.tv_nsec;
+    });
+    for (const auto& entry : entries) {
+        if (total <= budget)
+            break;
+        if (entry.signature == signature)
+            continue;
+        // NOTE: the .hash goes first so that nobody trusts what's left if
+        //       we're interrupted
+        const auto base = directory + "/" + entry.signature;
+        ::unlink((base + ".hash").c_str());
+        ::unlink((base + ".bin").c_str());
+        ::unlink((base + ".dts").c_str());
+        ::unlink((base + ".dtbo").c_str());
+        total -= entry.size;
+    }
+}
+
+} // namespace nirio
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <cstdint> // uint64_t
+#include <string> // std::string
+
+namespace nirio {
+
+class Bitfile;
+
+/**
+ * Where the files needed to load a bitfile were prepared.
+ */
+struct Firmware
+{
+    std::string bitstreamPath; ///< Decoded bitstream, <signature>.bin.
+    std::string overlayPath; ///< Device tree overlay source, <signature>.dts.
+    /// Compiled overlay, <signature>.dtbo, or empty if only dtc can compile it.
+    std::string compiledOverlayPath;
+};
+
+/**
+ * Decoded bitstreams and generated device tree overlays, kept in the firmware
+ * directory under the bitfile's signature so that downloading the same
+ * bitfile again is only a matter of checking they're still intact.
+ *
+ * Each <signature>.bin is accompanied by a <signature>.hash recording its size
+ * and hash, which must still match for it to be reused; otherwise, such as
+ * after a crash partway through writing it, it's decoded again. Every file is
+ * written to a temporary file first and renamed into place, so other
+ * processes never see one half written. Overlays, both the source and, unless
+ * it needs dtc, the compiled <signature>.dtbo, are only rewritten when what
+ * would be generated differs from what's there.
+ *
+ * If a size budget is set, the least recently used entries beyond it are
+ * removed whenever an entry is added, along with their compiled overlays. Only
+ * files with a .hash are considered part of the cache, so firmware put there
+ * by anything else is left alone.
+ */
+class FirmwareCache
+{
+public:
+    /**
+     * @param directory directory to keep firmware in
+     * @param budget total size of entries to keep, or 0 for no limit
+     */
+    explicit FirmwareCache(
+        const std::string& directory = getDirectory(), uint64_t budget = getBudget());
+
+    /**
+     * Ensures the bitstream and overlay of a bitfile are in the cache, writing
+     * whatever is missing, damaged, or out of date, and marks them as most
+     * recently used.
+     *
+     * @param bitfile bitfile to prepare
+     * @return paths to the prepared files
+     */
+    Firmware prepare(const Bitfile& bitfile) const;
+
+    /**
+     * Gets the firmware directory from $NIFPGA_FIRMWARE_DIR, or /lib/firmware.
+     *
+     * @return firmware directory
+     */
+    static std::string getDirectory();
+
+    /**
+     * Gets the size budget from $NIFPGA_FIRMWARE_CACHE_SIZE, in bytes with an
+     * optional K, M, or G suffix.
+     *
+     * @return size budget in bytes, or 0 for no limit
+     */
+    static uint64_t getBudget();
+
+private:
+    bool isIntact(const std::string& binPath, const std::string& hashPath) const;
+
+    void writeBitstream(const Bitfile& bitfile,
+        const std::string& binPath,
+        const std::string& hashPath) const;
+
+    bool writeOverlay(const Bitfile& bitfile,
+        const std::string& dtsPath,
+        const std::string& dtboPath) const;
+
+    void evict(const std::string& signature) const;
+
+    const std::string directory;
+    const uint64_t budget;
+};
+
+} // namespace nirio
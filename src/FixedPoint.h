@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "NiFpga.h"
+#include "Type.h"
+#include <cassert> // assert
+#include <cmath> // std::ldexp, std::nearbyint
+#include <cstdint> // uint64_t, int64_t
+
+namespace nirio {
+
+/**
+ * Conversions between raw fixed-point words, right-justified in 32 or 64 bits
+ * as unpacked from the FPGA or found in a DMA FIFO, and floating point.
+ *
+ * NOTE: these are scalar loops; neither SSE2 nor NEON can convert between
+ *       64-bit integers and doubles in vector registers, and std::nearbyint
+ *       is a libm call without SSE4.1, so the compiler doesn't vectorize them
+ */
+class FixedPoint
+{
+public:
+    explicit FixedPoint(const Type& type)
+        : isSigned(type.isSigned())
+        , wordLength(type.getWordLength())
+        , overflowStatus(type.hasOverflowStatus())
+        , unusedBits(64 - wordLength)
+        , wordMask(wordLength < 64 ? (uint64_t(1) << wordLength) - 1 : ~uint64_t(0))
+        , delta(std::ldexp(1.0, type.getIntegerWordLength() - int(wordLength)))
+        , scale(std::ldexp(1.0, int(wordLength) - type.getIntegerWordLength()))
+        , minimum(isSigned ? -std::ldexp(1.0, int(wordLength) - 1) : 0.0)
+        , maximum(std::ldexp(1.0, int(wordLength) - isSigned))
+        , minimumWord(isSigned ? (~uint64_t(0) << (wordLength - 1)) & wordMask : 0)
+        , maximumWord(isSigned ? wordMask >> 1 : wordMask)
+    {
+        assert(type.isFixedPoint());
+        assert(type.getLogicalBits() <= 64);
+    }
+
+    /**
+     * Converts raw words to floating point.
+     *
+     * @param raw raw words, with any overflow status just above the word
+     * @param values outputs the converted values
+     * @param overflows outputs the overflow status of each, or NULL
+     * @param count number of values
+     */
+    template <typename Raw, typename Float>
+    void toFloat(const Raw* const raw,
+        Float* const values,
+        NiFpga_Bool* const overflows,
+        const size_t count) const
+    {
+        // sign extend by shifting the word to the top and back down
+        if (isSigned)
+            for (size_t i = 0; i < count; i++) {
+                const auto top = static_cast<int64_t>(uint64_t(raw[i]) << unusedBits);
+                values[i] =
+                    static_cast<Float>(static_cast<double>(top >> unusedBits) * delta);
+            }
+        else
+            for (size_t i = 0; i < count; i++)
+                values[i] = static_cast<Float>(
+                    static_cast<double>((uint64_t(raw[i]) << unusedBits) >> unusedBits)
+                    * delta);
+        if (overflows)
+            for (size_t i = 0; i < count; i++)
+                overflows[i] = overflowStatus && (uint64_t(raw[i]) >> wordLength) & 1;
+    }
+
+    /**
+     * Converts floating point to raw words, rounding to the nearest
+     * representable value with ties to even and saturating to the range of
+     * the type. NaNs become zero. If the type includes overflow status, it's
+     * set for any value that didn't fit.
+     *
+     * @param values values to convert
+     * @param raw outputs the raw words
+     * @param count number of values
+     */
+    template <typename Float, typename Raw>
+    void fromFloat(const Float* const values, Raw* const raw, const size_t count) const
+    {
+        const auto overflowBit = overflowStatus ? uint64_t(1) << wordLength : 0;
+        for (size_t i = 0; i < count; i++) {
+            const auto scaled = std::nearbyint(static_cast<double>(values[i]) * scale);
+            const bool low    = scaled < minimum;
+            const bool high   = scaled >= maximum;
+            const bool nan    = scaled != scaled;
+            // only convert what's in range, since anything else is undefined
+            const auto inRange = low || high || nan ? 0.0 : scaled;
+            const auto word = isSigned ? static_cast<uint64_t>(int64_t(inRange))
+                                       : static_cast<uint64_t>(inRange);
+            raw[i] = static_cast<Raw>(
+                (low ? minimumWord : high ? maximumWord : word & wordMask)
+                | (low || high || nan ? overflowBit : 0));
+        }
+    }
+
+private:
+    const bool isSigned;
+    const size_t wordLength;
+    const bool overflowStatus;
+    const size_t unusedBits;
+    const uint64_t wordMask;
+    const double delta; ///< Value of the least significant bit.
+    const double scale; ///< Inverse of delta.
+    const double minimum; ///< Smallest scaled value that fits.
+    const double maximum; ///< Smallest scaled value that's too large.
+    const uint64_t minimumWord;
+    const uint64_t maximumWord;
+};
+
+} // namespace nirio
@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "FlightRecorder.h"
+#include <fcntl.h> // open
+#include <signal.h> // sigaction, SIGUSR2
+#include <sys/syscall.h> // SYS_gettid
+#include <time.h> // clock_gettime
+#include <unistd.h> // write, close, syscall
+#include <atomic> // std::atomic
+#include <cerrno> // errno
+#include <climits> // PATH_MAX
+#include <cstdlib> // getenv
+#include <cstring> // strlen, memcpy
+#include <new> // std::nothrow
+
+namespace nirio {
+
+namespace {
+
+/**
+ * One recorded call. Fields are atomic only so that a dump racing the thread
+ * recording is well defined; they're stored and loaded relaxed, which costs
+ * nothing over plain ones.
+ */
+struct alignas(64) Slot
+{
+    /// Index of the record in its ring plus 1, or 0 while it's being written.
+    std::atomic<uint64_t> sequence;
+    std::atomic<const char*> call;
+    std::atomic<NiFpga_Session> session;
+    std::atomic<uint32_t> resource;
+    std::atomic<int32_t> status;
+    std::atomic<int32_t> thread;
+    std::atomic<uint64_t> size;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> duration;
+};
+
+struct Ring
+{
+    Ring* next; ///< Set before the ring is published, and never changed.
+    std::atomic<bool> claimed;
+    std::atomic<uint64_t> count; ///< Number of records ever written.
+    Slot slots[FlightRecorder::capacity];
+};
+
+static_assert((FlightRecorder::capacity & (FlightRecorder::capacity - 1)) == 0,
+    "capacity must be a power of two");
+
+/// Every ring ever made, newest first.
+std::atomic<Ring*> rings(NULL);
+
+/**
+ * This thread's ring, given back for reuse when the thread exits.
+ */
+struct Claim
+{
+    Ring* ring     = NULL;
+    int32_t thread = 0;
+
+    ~Claim()
+    {
+        if (ring)
+            ring->claimed.store(false, std::memory_order_release);
+    }
+};
+
+thread_local Claim claim;
+
+Ring* claimRing()
+{
+    for (Ring* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        bool claimed = false;
+        if (!ring->claimed.load(std::memory_order_relaxed)
+            && ring->claimed.compare_exchange_strong(
+                claimed, true, std::memory_order_acquire))
+            return ring;
+    }
+    // NOTE: value-initialized, so every slot starts out empty
+    Ring* const ring = new (std::nothrow) Ring();
+    if (!ring)
+        return NULL;
+    ring->claimed.store(true, std::memory_order_relaxed);
+    ring->next = rings.load(std::memory_order_relaxed);
+    while (!rings.compare_exchange_weak(ring->next,
+        ring,
+        std::memory_order_release,
+        std::memory_order_relaxed))
+        ;
+    return ring;
+}
+
+uint64_t getNanoseconds(const clockid_t clock)
+{
+    struct timespec time;
+    clock_gettime(clock, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+
+/**
+ * A reading of the cycle counter and the monotonic clock at the same moment.
+ */
+struct Calibration
+{
+    uint64_t ticks;
+    uint64_t nanoseconds;
+};
+
+Calibration calibrate()
+{
+    return {FlightRecorder::now(), getNanoseconds(CLOCK_MONOTONIC)};
+}
+
+// taken as the library is loaded, to measure the cycle counter's rate against
+const Calibration loaded = calibrate();
+
+double getTicksPerNanosecond(const Calibration& current)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    // NOTE: the TSC runs at a constant rate on anything recent, so its rate
+    //       since the library was loaded is its rate
+    const auto elapsed = current.nanoseconds - loaded.nanoseconds;
+    return elapsed ? static_cast<double>(current.ticks - loaded.ticks) / elapsed : 1;
+#elif defined(__aarch64__)
+    UNUSED(current);
+    uint64_t frequency;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return frequency / 1e9;
+#else
+    UNUSED(current);
+    return 1;
+#endif
+}
+
+/**
+ * Formats a line without allocating, since it may be in a signal handler, and
+ * writes it in one go.
+ */
+class LineWriter
+{
+public:
+    explicit LineWriter(const int descriptor)
+        : descriptor(descriptor)
+        , length(0)
+        , error(0)
+    {
+    }
+
+    LineWriter& text(const char* const text)
+    {
+        for (auto* c = text; *c && length < sizeof(line) - 1; c++)
+            line[length++] = *c;
+        return *this;
+    }
+
+    LineWriter& number(uint64_t value)
+    {
+        char digits[20];
+        size_t count = 0;
+        do
+            digits[count++] = static_cast<char>('0' + value % 10);
+        while (value /= 10);
+        while (count && length < sizeof(line) - 1)
+            line[length++] = digits[--count];
+        return *this;
+    }
+
+    LineWriter& number(const int64_t value)
+    {
+        if (value < 0)
+            return text("-").number(-static_cast<uint64_t>(value));
+        return number(static_cast<uint64_t>(value));
+    }
+
+    /**
+     * Writes nanoseconds as seconds with microsecond precision.
+     */
+    LineWriter& seconds(const uint64_t nanoseconds)
+    {
+        number(nanoseconds / 1000000000).text(".");
+        const auto microseconds = nanoseconds / 1000 % 1000000;
+        for (uint64_t place = 100000; place > 1 && microseconds < place; place /= 10)
+            text("0");
+        return number(microseconds);
+    }
+
+    /**
+     * Ends the line and writes it, unless writing has already failed.
+     */
+    void end()
+    {
+        line[length++] = '\n';
+        if (!error && ::write(descriptor, line, length) < 0)
+            error = errno;
+        length = 0;
+    }
+
+    /**
+     * @return 0, or errno if writing failed
+     */
+    int getError() const
+    {
+        return error;
+    }
+
+private:
+    const int descriptor;
+    char line[256];
+    size_t length;
+    int error;
+};
+
+void dumpRing(const Ring& ring,
+    LineWriter& writer,
+    const Calibration& current,
+    const uint64_t realtime,
+    const double ticksPerNanosecond)
+{
+    const auto count = ring.count.load(std::memory_order_acquire);
+    const auto first =
+        count > FlightRecorder::capacity ? count - FlightRecorder::capacity : 0;
+    for (auto i = first; i < count; i++) {
+        const Slot& slot = ring.slots[i & (FlightRecorder::capacity - 1)];
+        // a seqlock: the record's only whole if its sequence didn't change
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != i + 1)
+            continue;
+        const auto call     = slot.call.load(std::memory_order_relaxed);
+        const auto session  = slot.session.load(std::memory_order_relaxed);
+        const auto resource = slot.resource.load(std::memory_order_relaxed);
+        const auto status   = slot.status.load(std::memory_order_relaxed);
+        const auto thread   = slot.thread.load(std::memory_order_relaxed);
+        const auto size     = slot.size.load(std::memory_order_relaxed);
+        const auto start    = slot.start.load(std::memory_order_relaxed);
+        const auto duration = slot.duration.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+        // NOTE: wall-clock time is worked out backwards from now, so that
+        //       recording never has to read it
+        const auto ago =
+            static_cast<uint64_t>((current.ticks - start) / ticksPerNanosecond);
+        writer.text("{\"thread\":")
+            .number(static_cast<int64_t>(thread))
+            .text(",\"time\":")
+            .seconds(realtime - ago)
+            .text(",\"call\":\"")
+            .text(call)
+            .text("\",\"session\":")
+            .number(static_cast<uint64_t>(session))
+            .text(",\"resource\":")
+            .number(static_cast<uint64_t>(resource))
+            .text(",\"size\":")
+            .number(size)
+            .text(",\"status\":")
+            .number(static_cast<int64_t>(status))
+            .text(",\"ns\":")
+            .number(static_cast<uint64_t>(duration / ticksPerNanosecond))
+            .text("}")
+            .end();
+    }
+}
+
+void dumpTo(const char* const destination)
+{
+    if (destination[0] == '/') {
+        const auto descriptor =
+            ::open(destination, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (descriptor >= 0) {
+            FlightRecorder::dump(descriptor);
+            ::close(descriptor);
+        }
+    } else
+        FlightRecorder::dump(STDERR_FILENO);
+}
+
+// copied when the signal handler is installed, since the environment may
+// change by the time a signal arrives
+char signalDestination[PATH_MAX];
+
+void handleSignal(int)
+{
+    const auto error = errno;
+    dumpTo(signalDestination);
+    errno = error;
+}
+
+// installed as the library is loaded, so that a process can be dumped however
+// it got stuck
+[[maybe_unused]] const bool signalHandlerInstalled =
+    FlightRecorder::installSignalHandler();
+
+} // unnamed namespace
+
+void FlightRecorder::record(const char* const call,
+    const NiFpga_Session session,
+    const uint32_t resource,
+    const size_t size,
+    const NiFpga_Status status,
+    const uint64_t start) noexcept
+{
+    const auto end = now();
+    if (!claim.ring) {
+        claim.ring = claimRing();
+        if (!claim.ring)
+            return;
+        claim.thread = static_cast<int32_t>(syscall(SYS_gettid));
+    }
+    Ring& ring     = *claim.ring;
+    const auto index = ring.count.load(std::memory_order_relaxed);
+    Slot& slot       = ring.slots[index & (capacity - 1)];
+    // NOTE: only this thread writes to its ring, so a fence keeping readers
+    //       from seeing a half-written record is all it takes
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.call.store(call, std::memory_order_relaxed);
+    slot.session.store(session, std::memory_order_relaxed);
+    slot.resource.store(resource, std::memory_order_relaxed);
+    slot.status.store(status, std::memory_order_relaxed);
+    slot.thread.store(claim.thread, std::memory_order_relaxed);
+    slot.size.store(size, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(end - start, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+    ring.count.store(index + 1, std::memory_order_release);
+}
+
+int FlightRecorder::dump(const int descriptor) noexcept
+{
+    const auto current            = calibrate();
+    const auto realtime           = getNanoseconds(CLOCK_REALTIME);
+    const auto ticksPerNanosecond = getTicksPerNanosecond(current);
+    LineWriter writer(descriptor);
+    for (Ring* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next)
+        dumpRing(*ring, writer, current, realtime, ticksPerNanosecond);
+    return writer.getError();
+}
+
+void FlightRecorder::dumpToLog() noexcept
+{
+    const char* const destination = getenv("NIFPGA_FLIGHT_RECORDER_LOG");
+    if (destination && *destination)
+        dumpTo(destination);
+}
+
+bool FlightRecorder::installSignalHandler() noexcept
+{
+    const char* const destination = getenv("NIFPGA_FLIGHT_RECORDER_LOG");
+    if (!destination || !*destination || strlen(destination) >= sizeof(signalDestination))
+        return false;
+    struct sigaction action;
+    if (sigaction(SIGUSR2, NULL, &action))
+        return false;
+    if (!(action.sa_flags & SA_SIGINFO) && action.sa_handler == handleSignal)
+        return true;
+    // leave it to whatever else handles it
+    if ((action.sa_flags & SA_SIGINFO) || action.sa_handler != SIG_DFL)
+        return false;
+    memcpy(signalDestination, destination, strlen(destination) + 1);
+    action            = {};
+    action.sa_handler = handleSignal;
+    action.sa_flags   = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    return !sigaction(SIGUSR2, &action, NULL);
+}
+
+} // namespace nirio
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "NiFpga.h"
+#include "Status.h"
+#include <cstddef> // size_t
+#include <cstdint> // uint32_t, uint64_t
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc
+#elif !defined(__aarch64__)
+#include <chrono> // std::chrono::steady_clock
+#endif
+
+namespace nirio {
+
+/**
+ * Keeps the last calls made through the C API on each thread, so that what led
+ * up to a failure can be seen after the fact.
+ *
+ * Always on. Each thread writes to its own ring of records with no locks and no
+ * system calls, timed with the CPU's cycle counter, so recording costs a few
+ * nanoseconds even on the register and FIFO paths. Rings are never freed; one
+ * left by a thread that exited is reused by the next thread to start making
+ * calls, keeping the exited thread's records until they're overwritten.
+ *
+ * If $NIFPGA_FLIGHT_RECORDER_LOG is set, everything recorded is dumped each
+ * time a session is closed and whenever the process receives SIGUSR2, unless
+ * something else already handles it: appended to the file it names if it's an
+ * absolute path, or written to stderr otherwise.
+ */
+class FlightRecorder
+{
+public:
+    /// Calls kept per thread, which must be a power of two.
+    static constexpr size_t capacity = 256;
+
+    /**
+     * Reads the cycle counter.
+     */
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t ticks;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+        return ticks;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    /**
+     * Records a call that just returned on this thread.
+     *
+     * @param call name of the entry point, which must outlive the process
+     * @param session session it was made on, or 0 if none
+     * @param resource register, FIFO, or IRQs it was on, or 0 if none
+     * @param size number of elements it asked for, or 0 if none
+     * @param status what it returned
+     * @param start value of now() when it was made
+     */
+    static void record(const char* call,
+        NiFpga_Session session,
+        uint32_t resource,
+        size_t size,
+        NiFpga_Status status,
+        uint64_t start) noexcept;
+
+    /**
+     * Writes every thread's records to a file descriptor, one line of JSON
+     * per call and one write per line, oldest first on each thread. Safe to
+     * call from a signal handler, and while other threads are recording; a
+     * record being written at that moment is skipped.
+     *
+     * @param descriptor descriptor to write to
+     * @return 0, or errno if writing failed
+     */
+    static int dump(int descriptor) noexcept;
+
+    /**
+     * Dumps to wherever $NIFPGA_FLIGHT_RECORDER_LOG names, if it's set.
+     */
+    static void dumpToLog() noexcept;
+
+    /**
+     * Dumps to wherever $NIFPGA_FLIGHT_RECORDER_LOG names whenever SIGUSR2 is
+     * received, if it's set and nothing else handles SIGUSR2. Done as the
+     * library is loaded; calling it again has no effect once installed.
+     *
+     * @return whether the handler is installed
+     */
+    static bool installSignalHandler() noexcept;
+};
+
+/**
+ * Records a call to the flight recorder as it goes out of scope, with whatever
+ * status it's returning by then.
+ */
+class FlightScope
+{
+public:
+    FlightScope(const char* const call,
+        const NiFpga_Session session,
+        const Status& status,
+        const uint32_t resource = 0,
+        const size_t size       = 0)
+        : call(call)
+        , session(session)
+        , status(status)
+        , resource(resource)
+        , size(size)
+        , start(FlightRecorder::now())
+    {
+    }
+
+    ~FlightScope()
+    {
+        FlightRecorder::record(call, session, resource, size, status, start);
+    }
+
+    /**
+     * Sets the session for calls that open one.
+     */
+    void setSession(const NiFpga_Session session)
+    {
+        this->session = session;
+    }
+
+private:
+    const char* const call;
+    NiFpga_Session session;
+    const Status& status;
+    const uint32_t resource;
+    const size_t size;
+    const uint64_t start;
+
+    FlightScope(const FlightScope&) = delete;
+    FlightScope& operator=(const FlightScope&) = delete;
+};
+
+} // namespace nirio
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+#include <cstring> // memcpy
+
+namespace nirio {
+
+namespace hash {
+
+const uint64_t prime1 = 11400714785074694791ULL;
+const uint64_t prime2 = 14029467366897019727ULL;
+const uint64_t prime3 = 1609587929392839161ULL;
+const uint64_t prime4 = 9650029242287828579ULL;
+const uint64_t prime5 = 2870177450012600261ULL;
+
+inline uint64_t rotateLeft(const uint64_t value, const int bits)
+{
+    return value << bits | value >> (64 - bits);
+}
+
+template <typename T>
+inline T load(const uint8_t* const from)
+{
+    T value;
+    std::memcpy(&value, from, sizeof(value));
+    return value;
+}
+
+inline uint64_t accumulate(uint64_t accumulator, const uint64_t input)
+{
+    accumulator += input * prime2;
+    return rotateLeft(accumulator, 31) * prime1;
+}
+
+inline uint64_t mergeRound(const uint64_t accumulator, const uint64_t value)
+{
+    return (accumulator ^ accumulate(0, value)) * prime1 + prime4;
+}
+
+} // namespace hash
+
+/**
+ * Hashes bytes with XXH64, which is fast enough to check the contents of
+ * multi-megabyte bitfiles on every open and needs nothing outside this
+ * header. Results match the reference implementation on little-endian
+ * machines.
+ *
+ * @param data bytes to hash
+ * @param size number of bytes
+ * @param seed seed to start from
+ * @return 64-bit hash
+ */
+inline uint64_t hash64(const void* const data, const size_t size, const uint64_t seed = 0)
+{
+    using namespace hash;
+    const auto* bytes     = static_cast<const uint8_t*>(data);
+    const auto* const end = bytes + size;
+    uint64_t result;
+    // four independent lanes over each 32-byte stripe
+    if (size >= 32) {
+        uint64_t lane1 = seed + prime1 + prime2;
+        uint64_t lane2 = seed + prime2;
+        uint64_t lane3 = seed;
+        uint64_t lane4 = seed - prime1;
+        for (; end - bytes >= 32; bytes += 32) {
+            lane1 = accumulate(lane1, load<uint64_t>(bytes));
+            lane2 = accumulate(lane2, load<uint64_t>(bytes + 8));
+            lane3 = accumulate(lane3, load<uint64_t>(bytes + 16));
+            lane4 = accumulate(lane4, load<uint64_t>(bytes + 24));
+        }
+        result = rotateLeft(lane1, 1) + rotateLeft(lane2, 7) + rotateLeft(lane3, 12)
+                 + rotateLeft(lane4, 18);
+        result = mergeRound(result, lane1);
+        result = mergeRound(result, lane2);
+        result = mergeRound(result, lane3);
+        result = mergeRound(result, lane4);
+    } else
+        result = seed + prime5;
+    result += size;
+    // then whatever's left over
+    for (; end - bytes >= 8; bytes += 8) {
+        result ^= accumulate(0, load<uint64_t>(bytes));
+        result = rotateLeft(result, 27) * prime1 + prime4;
+    }
+    if (end - bytes >= 4) {
+        result ^= load<uint32_t>(bytes) * prime1;
+        result = rotateLeft(result, 23) * prime2 + prime3;
+        bytes += 4;
+    }
+    for (; bytes < end; bytes++)
+        result = rotateLeft(result ^ *bytes * prime5, 11) * prime1;
+    // avalanche
+    result ^= result >> 33;
+    result *= prime2;
+    result ^= result >> 29;
+    result *= prime3;
+    result ^= result >> 32;
+    return result;
+}
+
+} // namespace nirio
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+/**
+ * Marks the rest of the enclosing scope as a hot path: register and FIFO
+ * accesses that must never reach the allocator once a session is open.
+ *
+ * When built with NIRIO_HOT_PATH_CHECKS, this tracks per thread whether we're
+ * within a hot path, so that a test can replace the global operator new and
+ * fail on any allocation for which isInHotPath() is true. Otherwise it
+ * compiles away to nothing.
+ *
+ * NOTE: the tracking is per module, so the replacement operator new has to be
+ *       linked into the same module as the code under test.
+ */
+#ifdef NIRIO_HOT_PATH_CHECKS
+#    define NIRIO_HOT_PATH const nirio::HotPathScope hotPathScope
+#else
+#    define NIRIO_HOT_PATH \
+        do {               \
+        } while (false)
+#endif // NIRIO_HOT_PATH_CHECKS
+
+namespace nirio {
+
+#ifdef NIRIO_HOT_PATH_CHECKS
+
+inline thread_local unsigned int hotPathDepth = 0;
+
+/**
+ * Counts the hot path scopes we're nested within on this thread.
+ */
+class HotPathScope
+{
+public:
+    HotPathScope()
+    {
+        hotPathDepth++;
+    }
+
+    ~HotPathScope()
+    {
+        hotPathDepth--;
+    }
+
+private:
+    HotPathScope(const HotPathScope&) = delete;
+    HotPathScope& operator=(const HotPathScope&) = delete;
+};
+
+#endif // NIRIO_HOT_PATH_CHECKS
+
+/**
+ * Gets whether this thread is currently within a NIRIO_HOT_PATH scope.
+ *
+ * @return whether we're on a hot path, or always false without checks
+ */
+inline bool isInHotPath()
+{
+#ifdef NIRIO_HOT_PATH_CHECKS
+    return hotPathDepth != 0;
+#else
+    return false;
+#endif
+}
+
+} // namespace nirio
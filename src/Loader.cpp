@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "Loader.h"
+#include "Exception.h"
+#include <fcntl.h> // open
+#include <spawn.h> // posix_spawnp
+#include <sys/stat.h> // stat, mkdir
+#include <sys/wait.h> // waitpid
+#include <unistd.h> // write, close, rmdir, unlink, getpid
+#include <cerrno> // errno
+#include <cstdio> // rename
+#include <cstdlib> // getenv
+#include <cstring> // strcmp
+#include <iostream> // std::cerr, std::endl
+
+extern char** environ;
+
+namespace nirio {
+
+namespace {
+
+/**
+ * Runs a command without a shell and waits for it to finish.
+ *
+ * @return 0 if it ran and exited successfully, otherwise the error spawning or
+ *         waiting for it, its exit status, or 128 plus the signal that killed it
+ */
+int run(const std::vector<std::string>& command)
+{
+    std::vector<char*> argv;
+    for (const auto& argument : command)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(NULL);
+    pid_t pid;
+    // NOTE: posix_spawnp returns its error rather than setting errno
+    if (const int error = posix_spawnp(&pid, argv[0], NULL, NULL, argv.data(), environ))
+        return error;
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return errno;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+void writeAttribute(const std::string& path, const std::string& value)
+{
+    // NOTE: O_CREAT does nothing to the kernel's attributes, which always
+    //       exist, but lets the loader be pointed at an ordinary directory
+    const auto descriptor = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    const bool written    = descriptor >= 0
+                         && ::write(descriptor, value.data(), value.size())
+                                == static_cast<ssize_t>(value.size());
+    const auto error = errno;
+    if (descriptor >= 0)
+        ::close(descriptor);
+    if (!written) {
+        std::cerr << "failed to write " << value << " to " << path << ": " << error
+                  << std::endl;
+        NIRIO_THROW(SoftwareFaultException());
+    }
+}
+
+bool isNewer(const struct timespec& a, const struct timespec& b)
+{
+    return a.tv_sec != b.tv_sec ? a.tv_sec > b.tv_sec : a.tv_nsec > b.tv_nsec;
+}
+
+} // unnamed namespace
+
+void Loader::load(const Firmware& firmware)
+{
+    stages.clear();
+    loadStages(firmware);
+}
+
+const std::vector<Loader::Stage>& Loader::getStages() const
+{
+    return stages;
+}
+
+std::unique_ptr<Loader> Loader::create()
+{
+    const char* const name = getenv("NIFPGA_LOADER");
+    if (!name || !*name || !strcmp(name, "command"))
+        return std::make_unique<CommandLoader>();
+    else if (!strcmp(name, "direct"))
+        return std::make_unique<DirectLoader>(FirmwareCache::getDirectory());
+    else if (!strcmp(name, "mock"))
+        return std::make_unique<MockLoader>();
+    std::cerr << "unknown NIFPGA_LOADER: " << name << std::endl;
+    NIRIO_THROW(InvalidParameterException());
+}
+
+const char* CommandLoader::getName() const
+{
+    return "command";
+}
+
+void CommandLoader::loadStages(const Firmware& firmware)
+{
+    // TODO: drop addr= argument eventually, once uhd is updated
+    stage("uhd_image_loader", [&] {
+        const auto result = run({"uhd_image_loader",
+            "--args",
+            "type=x4xx,mgmt_addr=127.0.0.1,addr=169.254.0.2",
+            "--fpga-path",
+            firmware.bitstreamPath});
+        if (result) {
+            std::cerr << "call to load fpga failed: " << result << std::endl;
+            NIRIO_THROW(SoftwareFaultException());
+        }
+    });
+}
+
+DirectLoader::DirectLoader(const std::string& firmwareDirectory,
+    const std::string& overlays,
+    const std::string& fpgaManager)
+    : firmwareDirectory(firmwareDirectory), overlays(overlays), fpgaManager(fpgaManager)
+{
+}
+
+const char* DirectLoader::getName() const
+{
+    return "direct";
+}
+
+void DirectLoader::loadStages(const Firmware& firmware)
+{
+    const auto& dtsPath = firmware.overlayPath;
+    const auto dtboPath = firmware.compiledOverlayPath.empty()
+                              ? dtsPath.substr(0, dtsPath.rfind('.')) + ".dtbo"
+                              : firmware.compiledOverlayPath;
+    // the overlay only needs compiling if it wasn't already, and then only
+    // again if it's changed since last time
+    if (firmware.compiledOverlayPath.empty()) {
+        stage("compile overlay", [&] {
+            struct stat dts, dtbo;
+            if (stat(dtsPath.c_str(), &dts))
+                NIRIO_THROW(SoftwareFaultException());
+            if (!stat(dtboPath.c_str(), &dtbo) && !isNewer(dts.st_mtim, dtbo.st_mtim))
+                return;
+            const auto temporaryPath = dtboPath + "." + std::to_string(getpid()) + ".tmp";
+            const std::vector<std::string> dtc = {"dtc",
+                "-@",
+                "-q",
+                "-I",
+                "dts",
+                "-O",
+                "dtb",
+                "-o",
+                temporaryPath,
+                dtsPath};
+            const auto result = run(dtc);
+            if (result || std::rename(temporaryPath.c_str(), dtboPath.c_str())) {
+                const auto error = result ? result : errno;
+                ::unlink(temporaryPath.c_str());
+                std::cerr << "failed to compile " << dtsPath << ": " << error
+                          << std::endl;
+                NIRIO_THROW(SoftwareFaultException());
+            }
+        });
+    }
+    // the last bitfile's overlay describes hardware that's about to go away
+    const auto overlay = overlays + "/nifpga";
+    stage("remove overlay", [&] {
+        if (::rmdir(overlay.c_str()) && errno != ENOENT) {
+            std::cerr << "failed to remove " << overlay << ": " << errno << std::endl;
+            NIRIO_THROW(SoftwareFaultException());
+        }
+    });
+    stage("program", [&] {
+        const auto name = getFirmwareName(firmware.bitstreamPath);
+        writeAttribute(fpgaManager + "/firmware", name);
+    });
+    stage("apply overlay", [&] {
+        if (::mkdir(overlay.c_str(), 0755) && errno != EEXIST) {
+            std::cerr << "failed to create " << overlay << ": " << errno << std::endl;
+            NIRIO_THROW(SoftwareFaultException());
+        }
+        writeAttribute(overlay + "/path", getFirmwareName(dtboPath));
+    });
+}
+
+std::string DirectLoader::getFirmwareName(const std::string& path) const
+{
+    const auto prefix = firmwareDirectory + "/";
+    if (path.compare(0, prefix.size(), prefix)) {
+        std::cerr << path << " is not in " << firmwareDirectory << std::endl;
+        NIRIO_THROW(SoftwareFaultException());
+    }
+    return path.substr(prefix.size());
+}
+
+const char* MockLoader::getName() const
+{
+    return "mock";
+}
+
+const std::vector<Firmware>& MockLoader::getLoaded() const
+{
+    return loaded;
+}
+
+void MockLoader::loadStages(const Firmware& firmware)
+{
+    stage("load", [&] { loaded.push_back(firmware); });
+}
+
+} // namespace nirio
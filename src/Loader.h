@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "FirmwareCache.h"
+#include "Timing.h"
+#include <chrono> // std::chrono::steady_clock
+#include <memory> // std::unique_ptr
+#include <string> // std::string
+#include <vector> // std::vector
+
+namespace nirio {
+
+/**
+ * Loads prepared firmware onto the FPGA and applies its device tree overlay.
+ */
+class Loader
+{
+public:
+    /**
+     * How long one step of the last load took.
+     */
+    typedef TimedStep Stage;
+
+    virtual ~Loader() = default;
+
+    /**
+     * Loads firmware, throwing if it couldn't be loaded.
+     *
+     * @param firmware prepared firmware
+     */
+    void load(const Firmware& firmware);
+
+    /**
+     * Gets how long each stage of the last load took, in order, including any
+     * that failed.
+     *
+     * @return stages of the last load
+     */
+    const std::vector<Stage>& getStages() const;
+
+    /**
+     * Gets the name of the loader, as chosen by $NIFPGA_LOADER.
+     *
+     * @return name of the loader
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * Creates the loader chosen by $NIFPGA_LOADER: "command" (the default) for
+     * CommandLoader, "direct" for DirectLoader, or "mock" for MockLoader.
+     *
+     * @return new loader
+     */
+    static std::unique_ptr<Loader> create();
+
+protected:
+    virtual void loadStages(const Firmware& firmware) = 0;
+
+    /**
+     * Runs and times one stage of loading.
+     *
+     * @param name name of the stage, which must outlive the loader
+     * @param run runs the stage
+     */
+    template <typename Run>
+    void stage(const char* const name, Run&& run)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const auto start = Clock::now();
+        try {
+            run();
+        } catch (...) {
+            stages.push_back({name, Clock::now() - start});
+            throw;
+        }
+        stages.push_back({name, Clock::now() - start});
+    }
+
+private:
+    std::vector<Stage> stages;
+};
+
+/**
+ * Loads firmware by running uhd_image_loader, which asks MPM to do the rest.
+ * The command is run directly rather than through a shell.
+ */
+class CommandLoader : public Loader
+{
+public:
+    const char* getName() const override;
+
+protected:
+    void loadStages(const Firmware& firmware) override;
+};
+
+/**
+ * Loads firmware in-process through the kernel's interfaces: the bitstream is
+ * written with the FPGA manager, and the overlay, compiled with dtc only when
+ * it wasn't already compiled in-process and then only when it changes, is
+ * applied through configfs in place of the one last applied.
+ */
+class DirectLoader : public Loader
+{
+public:
+    /**
+     * @param firmwareDirectory directory the kernel loads firmware from
+     * @param overlays configfs directory of device tree overlays
+     * @param fpgaManager sysfs directory of the FPGA manager
+     */
+    explicit DirectLoader(const std::string& firmwareDirectory = "/lib/firmware",
+        const std::string& overlays = "/sys/kernel/config/device-tree/overlays",
+        const std::string& fpgaManager = "/sys/class/fpga_manager/fpga0");
+
+    const char* getName() const override;
+
+protected:
+    void loadStages(const Firmware& firmware) override;
+
+private:
+    /**
+     * Gets the name by which the kernel knows a firmware file.
+     */
+    std::string getFirmwareName(const std::string& path) const;
+
+    const std::string firmwareDirectory;
+    const std::string overlays;
+    const std::string fpgaManager;
+};
+
+/**
+ * Pretends to load firmware and remembers what it was asked to load, for
+ * testing without hardware.
+ */
+class MockLoader : public Loader
+{
+public:
+    const char* getName() const override;
+
+    /**
+     * Gets everything loaded so far, in order.
+     *
+     * @return firmware loaded
+     */
+    const std::vector<Firmware>& getLoaded() const;
+
+protected:
+    void loadStages(const Firmware& firmware) override;
+
+private:
+    std::vector<Firmware> loaded;
+};
+
+} // namespace nirio
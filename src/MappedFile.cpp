@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "MappedFile.h"
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap, munmap
+#include <unistd.h> // close, sysconf
+#include <cerrno> // errno
+#include <cstring> // memset
+
+namespace nirio {
+
+MappedFile::MappedFile(const std::string& path) : data(NULL), size(0), error(0)
+{
+    std::memset(&status, 0, sizeof(status));
+    const auto descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        error = errno;
+        return;
+    }
+    if (fstat(descriptor, &status))
+        error = errno;
+    else if (!S_ISREG(status.st_mode))
+        error = EINVAL;
+    else if (status.st_size > 0) {
+        size             = static_cast<size_t>(status.st_size);
+        const auto start = mmap(NULL, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // NOTE: we don't use MAP_FAILED to prevent "use of old-style cast" warning
+        if (start == reinterpret_cast<void*>(-1)) {
+            error = errno;
+            size  = 0;
+        } else
+            data = static_cast<const uint8_t*>(start);
+    }
+    // the mapping keeps the file alive without the descriptor
+    ::close(descriptor);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        munmap(const_cast<uint8_t*>(data), size);
+}
+
+bool MappedFile::isMapped() const
+{
+    return !error;
+}
+
+int MappedFile::getError() const
+{
+    return error;
+}
+
+const uint8_t* MappedFile::getData() const
+{
+    return data;
+}
+
+size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+const struct stat& MappedFile::getStat() const
+{
+    return status;
+}
+
+void MappedFile::release(const size_t offset, const size_t size) const
+{
+    static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto start           = offset / pageSize * pageSize;
+    const auto end             = (offset + size) / pageSize * pageSize;
+    if (data && end > start)
+        // NOTE: this can only fail for bad arguments, and it's only advice
+        madvise(const_cast<uint8_t*>(data) + start, end - start, MADV_DONTNEED);
+}
+
+} // namespace nirio
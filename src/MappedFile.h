@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <sys/stat.h> // struct stat
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t
+#include <string> // std::string
+
+namespace nirio {
+
+/**
+ * A whole regular file mapped read-only into memory, for reading files like
+ * bitfiles without copying them into buffers first.
+ *
+ * Failing to map isn't an error to every user, so the constructor doesn't
+ * throw; check isMapped afterwards.
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+
+    ~MappedFile();
+
+    /**
+     * Gets whether the file was opened and mapped.
+     *
+     * @return whether the file is mapped
+     */
+    bool isMapped() const;
+
+    /**
+     * Gets the errno from failing to open or map the file.
+     *
+     * @return errno, or 0 if mapped
+     */
+    int getError() const;
+
+    /**
+     * Gets the mapped contents, which are NULL for an empty file.
+     *
+     * @return start of the file
+     */
+    const uint8_t* getData() const;
+
+    /**
+     * Gets the size of the file.
+     *
+     * @return size in bytes
+     */
+    size_t getSize() const;
+
+    /**
+     * Gets the status of the file as of when it was mapped.
+     *
+     * @return file status
+     */
+    const struct stat& getStat() const;
+
+    /**
+     * Drops pages of the mapping that are done being read, so reading a large
+     * file front to back doesn't keep all of it resident. Reading them again
+     * just faults them back in.
+     *
+     * @param offset start of the range, which is rounded down to a page
+     * @param size size of the range, whose end is rounded down to a page
+     */
+    void release(size_t offset, size_t size) const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    struct stat status;
+    int error;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+} // namespace nirio
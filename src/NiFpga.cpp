@@ -16,18 +16,21 @@
 
 #include "NiFpga.h"
 #include "Common.h"
-#include "DeviceTree.h"
+#include "DeviceBackend.h"
 #include "ErrnoMap.h"
 #include "Exception.h"
+#include "FirmwareCache.h"
+#include "FlightRecorder.h"
+#include "Loader.h"
+#include "Preparation.h"
 #include "Session.h"
+#include "Timing.h"
 #include "Type.h"
-#include <sched.h> // sched_yield
 #include <cassert> // assert
 #include <cstdlib> // realpath
-#include <fstream>
 #include <iostream> // std::cerr, std::endl
 #include <map>
-#include <memory> // std::unique_ptr
+#include <memory> // std::shared_ptr, std::unique_ptr
 #include <mutex>
 
 using namespace nirio;
@@ -98,42 +101,185 @@ private:
     std::map<NiFpga_Session, std::unique_ptr<Session>> sessionMap;
 };
 
+// Bitfiles being prepared in the background, each handed out once and taken
+// back by whichever call finishes with it.
+class PreparationManager
+{
+public:
+    NiFpgaEx_PreparedBitfile registerPreparation(std::unique_ptr<Preparation> preparation)
+    {
+        lock_guard guard(lock);
+
+        do {
+            ++lastHandle;
+        } while (!lastHandle || preparationMap.find(lastHandle) != preparationMap.end());
+
+        preparationMap[lastHandle] = std::move(preparation);
+        return lastHandle;
+    }
+
+    std::shared_ptr<Preparation> takePreparation(NiFpgaEx_PreparedBitfile handle)
+    {
+        lock_guard guard(lock);
+
+        auto it = preparationMap.find(handle);
+        if (it == preparationMap.end())
+            NIRIO_THROW(InvalidParameterException());
+
+        auto preparation = std::move(it->second);
+        preparationMap.erase(it);
+        return preparation;
+    }
+
+    // Takes a preparation once it's finished, but only if it's of a bitfile
+    // with the given signature. One of another bitfile is left for whatever it
+    // was prepared for.
+    std::shared_ptr<Preparation> takePreparation(
+        NiFpgaEx_PreparedBitfile handle, const std::string& signature)
+    {
+        const auto preparation = getPreparation(handle);
+        try {
+            preparation->wait();
+        } catch (...) {
+            // it failed, which its taker finds out when finishing it
+            return takePreparation(handle);
+        }
+        if (preparation->getBitfile().getSignature() != signature)
+            NIRIO_THROW(SignatureMismatchException());
+        return takePreparation(handle);
+    }
+
+private:
+    std::shared_ptr<Preparation> getPreparation(NiFpgaEx_PreparedBitfile handle)
+    {
+        lock_guard guard(lock);
+
+        auto it = preparationMap.find(handle);
+        if (it == preparationMap.end())
+            NIRIO_THROW(InvalidParameterException());
+
+        return it->second;
+    }
+
+    typedef std::lock_guard<std::mutex> lock_guard;
+    std::mutex lock;
+    NiFpgaEx_PreparedBitfile lastHandle = 0;
+    std::map<NiFpgaEx_PreparedBitfile, std::shared_ptr<Preparation>> preparationMap;
+};
+
 namespace {
 SessionManager sessionManager;
+PreparationManager preparationManager;
 
 Session& getSession(NiFpga_Session session)
 {
     return sessionManager.getSession(session);
 }
 
+/**
+ * Records which loader was used and how long each of its steps took.
+ */
+void recordSteps(const Loader& loader)
+{
+    if (auto* const timings = TimingRecorder::getCurrent()) {
+        timings->loader      = loader.getName();
+        timings->loaderSteps = loader.getStages();
+    }
+}
+
+void load(const Firmware& firmware)
+{
+    const TimingScope timing(NiFpgaEx_TimingStage_Load);
+    const auto loader = DeviceBackend::get().createLoader();
+    try {
+        loader->load(firmware);
+    } catch (...) {
+        recordSteps(*loader);
+        throw;
+    }
+    recordSteps(*loader);
+}
+
 void download(const nirio::Bitfile& bitfile)
 {
-    const auto bitfileSignature = bitfile.getSignature();
-    const std::string fwPath    = "/lib/firmware";
-    const auto fpgaPath         = joinPath(fwPath, bitfileSignature + ".bin");
-    const auto dtsPath          = joinPath(fwPath, bitfileSignature + ".dts");
+    // reuse the bitstream and overlay from last time if they're still intact
+    load(FirmwareCache().prepare(bitfile));
+}
 
-    // write .dts and .bin to some location
-    if (!exists(fpgaPath)) {
-        auto&& bitstream = bitfile.getBitstream();
-        std::ofstream fpgaFile(fpgaPath);
-        fpgaFile.write(bitstream.data(), bitstream.size());
+/**
+ * Opens a session, downloading the bitfile unless it's already running.
+ *
+ * @param firmware the bitfile's prepared firmware, or NULL to prepare it now
+ * @return handle to the new session
+ */
+NiFpga_Session openSession(std::unique_ptr<Bitfile> bitfile,
+    const Firmware* const firmware,
+    const char* const signature,
+    const char* const resource,
+    const uint32_t attribute)
+{
+    auto bitfileSignature = bitfile->getSignature();
+    SysfsFile signatureFile(resource, "signature");
+    SysfsFile sessionCount(resource, "session_count");
+
+    bool alreadyDownloaded = false;
+
+    if (signatureFile.exists()) {
+        auto runningSignature = signatureFile.readLineNoErrno();
+        if (!strcasecmp(runningSignature.c_str(), bitfileSignature.c_str()))
+            alreadyDownloaded = true;
     }
 
-    {
-        auto dts = nirio::generateDeviceTree(bitfile);
-        std::ofstream dtsFile(dtsPath);
-        dtsFile.write(dts.c_str(), dts.size());
+    if (!alreadyDownloaded) {
+        if (!sessionCount.exists() || sessionCount.readU32() == 0) {
+            if (firmware)
+                load(*firmware);
+            else
+                download(*bitfile);
+        } else
+            NIRIO_THROW(FpgaBusyFpgaInterfaceCApiException());
     }
 
-    // invoke uhd_image_loader to load image
-    // TODO: drop addr= argument eventually, once uhd is updated
-    std::string cmd = "uhd_image_loader --args "
-                      "\"type=x4xx,mgmt_addr=127.0.0.1,addr=169.254.0.2\" --fpga-path ";
-    cmd += fpgaPath;
-    if (system(cmd.c_str())) {
-        std::cerr << "call to load fpga failed: " << errno << std::endl;
-        NIRIO_THROW(SoftwareFaultException());
+    // create a new session object, which opens and downloads if necessary
+    std::unique_ptr<Session> newSession(new Session(std::move(bitfile), resource));
+
+    // ensure signature matches unless they didn't pass one
+    if (!(attribute & NiFpga_OpenAttribute_NoSignatureCheck)
+        && (signature && signature != newSession->getBitfile().getSignature()))
+        NIRIO_THROW(SignatureMismatchException());
+    // Decide whether to run the FPGA. First, if they passed NoRun, we won't.
+    // But if they didn't, we have to decide whether it would've run itself.
+    // If it's NOT AutoRunWhenDownloaded, then we'll have to run it for them.
+    // If it IS AutoRunWhenDownloaded but it was already downloaded, we need
+    // to run it again because they expected it to be run during this open.
+    if (!(attribute & NiFpga_OpenAttribute_NoRun)
+        && (!newSession->getBitfile().isAutoRunWhenDownloaded() || alreadyDownloaded))
+        newSession->run();
+
+    // if everything worked, pass it on
+    return sessionManager.registerSession(newSession);
+}
+
+/**
+ * Downloads a session's bitfile again, closing the session if that fails.
+ *
+ * @param firmware the bitfile's prepared firmware, or NULL to prepare it now
+ */
+void redownload(const NiFpga_Session session, const Firmware* const firmware)
+{
+    auto& sessionObject = getSession(session);
+    try {
+        sessionObject.preDownload();
+        if (firmware)
+            load(*firmware);
+        else
+            download(sessionObject.getBitfile());
+        sessionObject.postDownload();
+    } catch (...) {
+        // If a download fails, close this session.
+        sessionObject.close();
+        sessionManager.unregisterSession(session);
+        throw;
     }
 }
 
@@ -158,48 +304,16 @@ NiFpga_Status NiFpga_Open(const char* const bitfilePath,
 
     // wrap all code that might throw in a big safety net
     Status status;
+    FlightScope flight(__func__, 0, status);
+    TimingRecorder recorder;
     try {
-        auto bitfile          = std::make_unique<Bitfile>(bitfilePath);
-        auto bitfileSignature = bitfile->getSignature();
-        SysfsFile signatureFile(resource, "signature");
-        SysfsFile sessionCount(resource, "session_count");
-
-        bool alreadyDownloaded = false;
-
-        if (signatureFile.exists()) {
-            auto runningSignature = signatureFile.readLineNoErrno();
-            if (!strcasecmp(runningSignature.c_str(), bitfileSignature.c_str()))
-                alreadyDownloaded = true;
-        }
-
-        if (!alreadyDownloaded) {
-            if (!sessionCount.exists() || sessionCount.readU32() == 0)
-                download(*bitfile);
-            else
-                NIRIO_THROW(FpgaBusyFpgaInterfaceCApiException());
-        }
-
-        // create a new session object, which opens and downloads if necessary
-        std::unique_ptr<Session> newSession(new Session(std::move(bitfile), resource));
-
-        // ensure signature matches unless they didn't pass one
-        if (!(attribute & NiFpga_OpenAttribute_NoSignatureCheck)
-            && (signature && signature != newSession->getBitfile().getSignature()))
-            NIRIO_THROW(SignatureMismatchException());
-        // Decide whether to run the FPGA. First, if they passed NoRun, we won't.
-        // But if they didn't, we have to decide whether it would've run itself.
-        // If it's NOT AutoRunWhenDownloaded, then we'll have to run it for them.
-        // If it IS AutoRunWhenDownloaded but it was already downloaded, we need
-        // to run it again because they expected it to be run during this open.
-        if (!(attribute & NiFpga_OpenAttribute_NoRun)
-            && (!newSession->getBitfile().isAutoRunWhenDownloaded() || alreadyDownloaded))
-            newSession->run();
-
-        // if everything worked, pass it on
-        *session = sessionManager.registerSession(newSession);
+        *session = openSession(
+            std::make_unique<Bitfile>(bitfilePath), NULL, signature, resource, attribute);
     }
     CATCH_ALL_AND_MERGE_STATUS(status)
 
+    flight.setSession(*session);
+    logTimings("NiFpga_Open", status, recorder.finish());
     return status;
 }
 
@@ -210,16 +324,21 @@ NiFpga_Status NiFpga_Close(const NiFpga_Session session, const uint32_t attribut
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
-    try {
-        auto& sessionObject = getSession(session);
-        // close either with or without reset
-        const auto resetIfLastSession =
-            !(attribute & NiFpga_CloseAttribute_NoResetIfLastSession);
-        sessionObject.close(resetIfLastSession);
-    }
-    CATCH_ALL_AND_MERGE_STATUS(status)
+    {
+        const FlightScope flight(__func__, session, status);
+        try {
+            auto& sessionObject = getSession(session);
+            // close either with or without reset
+            const auto resetIfLastSession =
+                !(attribute & NiFpga_CloseAttribute_NoResetIfLastSession);
+            sessionObject.close(resetIfLastSession);
+        }
+        CATCH_ALL_AND_MERGE_STATUS(status)
 
-    sessionManager.unregisterSession(session);
+        sessionManager.unregisterSession(session);
+    }
+    // NOTE: once out of scope, so the close itself is in the dump
+    FlightRecorder::dumpToLog();
     return status;
 }
 
@@ -230,6 +349,7 @@ NiFpga_Status NiFpga_Run(const NiFpga_Session session, const uint32_t attribute)
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         const auto& sessionObject = getSession(session);
         const auto alreadyRunning = sessionObject.run();
@@ -239,12 +359,10 @@ NiFpga_Status NiFpga_Run(const NiFpga_Session session, const uint32_t attribute)
 
         // if they want us to wait until done
         if (attribute & NiFpga_RunAttribute_WaitUntilDone) {
-            // loop until it's no longer running
-            while (sessionObject.isRunning()) {
-                // NOTE: "In the Linux implementation, sched_yield() always succeeds":
-                //    http://man7.org/linux/man-pages/man2/sched_yield.2.html
-                sched_yield();
-            }
+            // block until it's no longer running
+            const auto notRunning = NiFpgaEx_ViState_Finished | NiFpgaEx_ViState_Aborted;
+            NiFpgaEx_ViState state;
+            sessionObject.waitOnViState(notRunning, NiFpga_InfiniteTimeout, state);
         }
     }
     CATCH_ALL_AND_MERGE_STATUS(status)
@@ -258,6 +376,7 @@ NiFpga_Status NiFpga_Abort(const NiFpga_Session session)
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         const auto& sessionObject = getSession(session);
         sessionObject.abort();
@@ -273,6 +392,7 @@ NiFpga_Status NiFpga_Reset(const NiFpga_Session session)
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         const auto& sessionObject = getSession(session);
         sessionObject.reset();
@@ -285,18 +405,187 @@ NiFpga_Status NiFpga_Download(const NiFpga_Session session)
 {
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status);
+    TimingRecorder recorder;
     try {
-        auto& sessionObject = getSession(session);
-        try {
-            sessionObject.preDownload();
-            download(sessionObject.getBitfile());
-            sessionObject.postDownload();
-        } catch (...) {
-            // If a download fails, close this session.
-            sessionObject.close();
-            sessionManager.unregisterSession(session);
-            throw;
-        }
+        redownload(session, NULL);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    logTimings("NiFpga_Download", status, recorder.finish());
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_WarmFirmwareCache(const char* const bitfilePath)
+{
+    // validate parameters
+    if (!bitfilePath)
+        return NiFpga_Status_InvalidParameter;
+
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, 0, status);
+    TimingRecorder recorder;
+    try {
+        const Bitfile bitfile(bitfilePath);
+        FirmwareCache().prepare(bitfile);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    logTimings("NiFpgaEx_WarmFirmwareCache", status, recorder.finish());
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_PrepareBitfile(
+    const char* const bitfilePath, NiFpgaEx_PreparedBitfile* const prepared)
+{
+    // validate parameters
+    if (prepared)
+        *prepared = 0;
+    if (!bitfilePath || !prepared)
+        return NiFpga_Status_InvalidParameter;
+
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, 0, status);
+    try {
+        *prepared = preparationManager.registerPreparation(
+            std::make_unique<Preparation>(bitfilePath));
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_OpenPrepared(const NiFpgaEx_PreparedBitfile prepared,
+    const char* const signature,
+    const char* const resource,
+    const uint32_t attribute,
+    NiFpga_Session* const session)
+{
+    // validate parameters
+    if (session)
+        *session = 0;
+    if (!prepared || !session || !resource)
+        return NiFpga_Status_InvalidParameter;
+    if (attribute & ~(NiFpga_OpenAttribute_NoRun | NiFpga_OpenAttribute_NoSignatureCheck))
+        return NiFpga_Status_InvalidParameter;
+
+    // wrap all code that might throw in a big safety net
+    Status status;
+    FlightScope flight(__func__, 0, status);
+    TimingRecorder recorder;
+    try {
+        auto preparation    = preparationManager.takePreparation(prepared);
+        const auto firmware = preparation->finish();
+        TimingRecorder::getCurrent()->merge(preparation->getTimings());
+        *session            = openSession(
+            preparation->takeBitfile(), &firmware, signature, resource, attribute);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    flight.setSession(*session);
+    logTimings("NiFpgaEx_OpenPrepared", status, recorder.finish());
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_DownloadPrepared(
+    const NiFpga_Session session, const NiFpgaEx_PreparedBitfile prepared)
+{
+    // validate parameters
+    if (!session || !prepared)
+        return NiFpga_Status_InvalidParameter;
+
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status);
+    TimingRecorder recorder;
+    try {
+        // only the session's own bitfile can be downloaded to it
+        const auto& signature = getSession(session).getBitfile().getSignature();
+        auto preparation      = preparationManager.takePreparation(prepared, signature);
+        const auto firmware   = preparation->finish();
+        TimingRecorder::getCurrent()->merge(preparation->getTimings());
+        redownload(session, &firmware);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    logTimings("NiFpgaEx_DownloadPrepared", status, recorder.finish());
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_ReleasePrepared(const NiFpgaEx_PreparedBitfile prepared)
+{
+    // validate parameters
+    if (!prepared)
+        return NiFpga_Status_InvalidParameter;
+
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, 0, status);
+    try {
+        // NOTE: there's no stopping it partway, so wait for it to finish
+        preparationManager.takePreparation(prepared)->wait();
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_GetStageTimings(NiFpgaEx_StageTiming* const timings,
+    const size_t count,
+    uint64_t* const total)
+{
+    // validate parameters (total is optional)
+    if (!timings && count)
+        return NiFpga_Status_InvalidParameter;
+
+    const auto& last = TimingRecorder::getLast();
+    for (size_t i = 0; i < count && i < last.durations.size(); i++) {
+        timings[i].nanoseconds = static_cast<uint64_t>(last.durations[i].count());
+        timings[i].count       = last.counts[i];
+    }
+    if (total)
+        *total = static_cast<uint64_t>(last.total.count());
+    return NiFpga_Status_Success;
+}
+
+NiFpga_Status NiFpgaEx_DumpFlightRecorder(const int descriptor)
+{
+    // validate parameters
+    if (descriptor < 0)
+        return NiFpga_Status_InvalidParameter;
+    // NOTE: nothing here throws or allocates, so that it's safe to call from
+    //       a signal handler
+    switch (FlightRecorder::dump(descriptor)) {
+        case 0:
+            return NiFpga_Status_Success;
+        case EBADF:
+            return NiFpga_Status_InvalidParameter;
+        default:
+            return NiFpga_Status_SoftwareFault;
+    }
+}
+
+NiFpga_Status NiFpgaEx_WaitOnViState(const NiFpga_Session session,
+    const uint32_t states,
+    const uint32_t timeout,
+    NiFpgaEx_ViState* const state,
+    NiFpga_Bool* const timedOut)
+{
+    // validate parameters (state and timedOut are optional)
+    if (timedOut)
+        *timedOut = NiFpga_False;
+    if (!session || !states
+        || (states
+            & ~(NiFpgaEx_ViState_Running | NiFpgaEx_ViState_Finished
+                | NiFpgaEx_ViState_Aborted)))
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status);
+    try {
+        const auto& sessionObject = getSession(session);
+        NiFpgaEx_ViState localState;
+        const auto satisfied = sessionObject.waitOnViState(states, timeout, localState);
+        if (state)
+            *state = localState;
+        if (timedOut)
+            *timedOut = !satisfied;
     }
     CATCH_ALL_AND_MERGE_STATUS(status)
     return status;
@@ -314,6 +603,7 @@ NiFpga_Status NiFpgaEx_FindResource(const NiFpga_Session session,
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         const auto& sessionObject = getSession(session);
         sessionObject.findResource(name, type, *resource);
@@ -322,6 +612,41 @@ NiFpga_Status NiFpgaEx_FindResource(const NiFpga_Session session,
     return status;
 }
 
+NiFpga_Status NiFpgaEx_FindResources(const NiFpga_Session session,
+    const char* const* const names,
+    const NiFpgaEx_ResourceType* const types,
+    const size_t count,
+    NiFpgaEx_Resource* const resources,
+    NiFpga_Status* const statuses)
+{
+    // validate parameters
+    if (!session || (count && (!names || !types || !resources)))
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status, 0, count);
+    try {
+        const auto& sessionObject = getSession(session);
+        for (size_t i = 0; i < count; i++) {
+            // keep going after failures so the caller learns about all of them
+            Status found;
+            resources[i] = 0;
+            if (!names[i])
+                found.merge(NiFpga_Status_InvalidParameter);
+            else
+                try {
+                    sessionObject.findResource(names[i], types[i], resources[i]);
+                }
+                CATCH_ALL_AND_MERGE_STATUS(found)
+            if (statuses)
+                statuses[i] = found;
+            status.merge(found);
+        }
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
 // Macro to define a typed entry point for each type.
 #define NIFPGA_FOR_EACH_SCALAR(Generator)                                                \
     Generator(Bool) Generator(I8) Generator(U8) Generator(I16) Generator(U16) Generator( \
@@ -339,6 +664,8 @@ NiFpga_Status NiFpgaEx_FindResource(const NiFpga_Session session,
             return NiFpga_Status_InvalidParameter;               \
         /* wrap all code that might throw in a big safety net */ \
         Status status;                                           \
+        const FlightScope flight(                                \
+            __func__, session, status, reg, 1);                  \
         try {                                                    \
             const auto& sessionObject = getSession(session);     \
             sessionObject.read<T>(reg, *value);                  \
@@ -372,6 +699,8 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_READ)
             return NiFpga_Status_InvalidParameter;               \
         /* wrap all code that might throw in a big safety net */ \
         Status status;                                           \
+        const FlightScope flight(                                \
+            __func__, session, status, reg, 1);                  \
         try {                                                    \
             const auto& sessionObject = getSession(session);     \
             sessionObject.write<T>(reg, value);                  \
@@ -406,6 +735,8 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_WRITE)
             return NiFpga_Status_InvalidParameter;                  \
         /* wrap all code that might throw in a big safety net */    \
         Status status;                                              \
+        const FlightScope flight(                                   \
+            __func__, session, status, reg, size);                  \
         try {                                                       \
             const auto& sessionObject = getSession(session);        \
             sessionObject.readArray<T>(reg, values, size);          \
@@ -440,6 +771,8 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_READ_ARRAY)
             return NiFpga_Status_InvalidParameter;                   \
         /* wrap all code that might throw in a big safety net */     \
         Status status;                                               \
+        const FlightScope flight(                                    \
+            __func__, session, status, reg, size);                   \
         try {                                                        \
             const auto& sessionObject = getSession(session);         \
             sessionObject.writeArray<T>(reg, values, size);          \
@@ -463,10 +796,198 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_READ_ARRAY)
 //    NiFpga_WriteArrayDbl
 NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_WRITE_ARRAY)
 
+NiFpga_Status NiFpgaEx_GetMappedRegisters(const NiFpga_Session session,
+    volatile void** const registers,
+    size_t* const size)
+{
+    // validate parameters
+    if (!session || !registers || !size)
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status);
+    try {
+        const auto& sessionObject = getSession(session);
+        sessionObject.getMappedRegisters(*registers, *size);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_GetFxpTypeInfo(const NiFpga_Session session,
+    const NiFpgaEx_Register reg,
+    NiFpgaEx_FxpTypeInfo* const typeInfo)
+{
+    // validate parameters
+    if (!session || !typeInfo)
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status, reg);
+    try {
+        const auto& sessionObject = getSession(session);
+        sessionObject.getFxpTypeInfo(reg, *typeInfo);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
+// Macro to define a fixed-point entry point for each floating-point type.
+#define NIFPGA_FOR_EACH_FXP_CONVERSION(Generator) Generator(Sgl) Generator(Dbl)
+
+#define NIFPGA_DEFINE_READ_FXP(T)                                              \
+    NiFpga_Status NiFpgaEx_ReadFxp##T(const NiFpga_Session session,            \
+        const NiFpgaEx_RegisterFxp reg,                                        \
+        T::CType* const value,                                                 \
+        NiFpga_Bool* const overflow)                                           \
+    {                                                                          \
+        /* validate parameters */                                              \
+        if (value)                                                             \
+            *value = -1;                                                       \
+        if (overflow)                                                          \
+            *overflow = NiFpga_False;                                          \
+        if (!session || !value)                                                \
+            return NiFpga_Status_InvalidParameter;                             \
+        /* wrap all code that might throw in a big safety net */               \
+        Status status;                                                         \
+        const FlightScope flight(__func__, session, status, reg, 1);           \
+        try {                                                                  \
+            const auto& sessionObject = getSession(session);                   \
+            sessionObject.readFxp<T::CType>(reg, value, 1, false, overflow);   \
+        }                                                                      \
+        CATCH_ALL_AND_MERGE_STATUS(status)                                     \
+        return status;                                                         \
+    }
+
+// This generates the following functions:
+//
+//    NiFpgaEx_ReadFxpSgl
+//    NiFpgaEx_ReadFxpDbl
+NIFPGA_FOR_EACH_FXP_CONVERSION(NIFPGA_DEFINE_READ_FXP)
+
+#define NIFPGA_DEFINE_WRITE_FXP(T)                                             \
+    NiFpga_Status NiFpgaEx_WriteFxp##T(const NiFpga_Session session,           \
+        const NiFpgaEx_RegisterFxp reg,                                        \
+        const T::CType value)                                                  \
+    {                                                                          \
+        /* validate parameters */                                              \
+        if (!session)                                                          \
+            return NiFpga_Status_InvalidParameter;                             \
+        /* wrap all code that might throw in a big safety net */               \
+        Status status;                                                         \
+        const FlightScope flight(__func__, session, status, reg, 1);           \
+        try {                                                                  \
+            const auto& sessionObject = getSession(session);                   \
+            sessionObject.writeFxp<T::CType>(reg, &value, 1, false);           \
+        }                                                                      \
+        CATCH_ALL_AND_MERGE_STATUS(status)                                     \
+        return status;                                                         \
+    }
+
+// This generates the following functions:
+//
+//    NiFpgaEx_WriteFxpSgl
+//    NiFpgaEx_WriteFxpDbl
+NIFPGA_FOR_EACH_FXP_CONVERSION(NIFPGA_DEFINE_WRITE_FXP)
+
+#define NIFPGA_DEFINE_READ_ARRAY_FXP(T)                                          \
+    NiFpga_Status NiFpgaEx_ReadArrayFxp##T(const NiFpga_Session session,         \
+        const NiFpgaEx_RegisterArrayFxp reg,                                     \
+        T::CType* const values,                                                  \
+        const size_t size,                                                       \
+        NiFpga_Bool* const overflows)                                            \
+    {                                                                            \
+        /* validate parameters */                                                \
+        if (!session || !values)                                                 \
+            return NiFpga_Status_InvalidParameter;                               \
+        /* wrap all code that might throw in a big safety net */                 \
+        Status status;                                                           \
+        const FlightScope flight(__func__, session, status, reg, size);          \
+        try {                                                                    \
+            const auto& sessionObject = getSession(session);                     \
+            sessionObject.readFxp<T::CType>(reg, values, size, true, overflows); \
+        }                                                                        \
+        CATCH_ALL_AND_MERGE_STATUS(status)                                       \
+        return status;                                                           \
+    }
+
+// This generates the following functions:
+//
+//    NiFpgaEx_ReadArrayFxpSgl
+//    NiFpgaEx_ReadArrayFxpDbl
+NIFPGA_FOR_EACH_FXP_CONVERSION(NIFPGA_DEFINE_READ_ARRAY_FXP)
+
+#define NIFPGA_DEFINE_WRITE_ARRAY_FXP(T)                                       \
+    NiFpga_Status NiFpgaEx_WriteArrayFxp##T(const NiFpga_Session session,      \
+        const NiFpgaEx_RegisterArrayFxp reg,                                   \
+        const T::CType* const values,                                          \
+        const size_t size)                                                     \
+    {                                                                          \
+        /* validate parameters */                                              \
+        if (!session || !values)                                               \
+            return NiFpga_Status_InvalidParameter;                             \
+        /* wrap all code that might throw in a big safety net */               \
+        Status status;                                                         \
+        const FlightScope flight(__func__, session, status, reg, size);        \
+        try {                                                                  \
+            const auto& sessionObject = getSession(session);                   \
+            sessionObject.writeFxp<T::CType>(reg, values, size, true);         \
+        }                                                                      \
+        CATCH_ALL_AND_MERGE_STATUS(status)                                     \
+        return status;                                                         \
+    }
+
+// This generates the following functions:
+//
+//    NiFpgaEx_WriteArrayFxpSgl
+//    NiFpgaEx_WriteArrayFxpDbl
+NIFPGA_FOR_EACH_FXP_CONVERSION(NIFPGA_DEFINE_WRITE_ARRAY_FXP)
+
+NiFpga_Status NiFpgaEx_ReadCluster(const NiFpga_Session session,
+    const NiFpgaEx_RegisterCluster reg,
+    void* const cluster,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount)
+{
+    // validate parameters
+    if (!session || !cluster || !fieldOffsets)
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status, reg, fieldCount);
+    try {
+        const auto& sessionObject = getSession(session);
+        sessionObject.readCluster(reg, cluster, fieldOffsets, fieldCount);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_WriteCluster(const NiFpga_Session session,
+    const NiFpgaEx_RegisterCluster reg,
+    const void* const cluster,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount)
+{
+    // validate parameters
+    if (!session || !cluster || !fieldOffsets)
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status, reg, fieldCount);
+    try {
+        const auto& sessionObject = getSession(session);
+        sessionObject.writeCluster(reg, cluster, fieldOffsets, fieldCount);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
 NiFpga_Status NiFpga_ReserveIrqContext(
     const NiFpga_Session session, NiFpga_IrqContext* const context)
 {
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.reserveIrqContext(context);
@@ -479,6 +1000,7 @@ NiFpga_Status NiFpga_UnreserveIrqContext(
     const NiFpga_Session session, const NiFpga_IrqContext context)
 {
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.unreserveIrqContext(context);
@@ -495,6 +1017,7 @@ NiFpga_Status NiFpga_WaitOnIrqs(const NiFpga_Session session,
     NiFpga_Bool* const timedOut)
 {
     Status status;
+    const FlightScope flight(__func__, session, status, irqs);
     try {
         auto& sessionObject = getSession(session);
         bool timedOut_;
@@ -508,6 +1031,7 @@ NiFpga_Status NiFpga_WaitOnIrqs(const NiFpga_Session session,
 NiFpga_Status NiFpga_AcknowledgeIrqs(const NiFpga_Session session, const uint32_t irqs)
 {
     Status status;
+    const FlightScope flight(__func__, session, status, irqs);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.acknowledgeIrqs(irqs);
@@ -538,6 +1062,7 @@ NiFpga_Status NiFpga_ConfigureFifo2(const NiFpga_Session session,
         return NiFpga_Status_BadDepth;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status, fifo, requestedDepth);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.configureFifo(fifo, requestedDepth, actualDepth);
@@ -553,6 +1078,7 @@ NiFpga_Status NiFpga_StartFifo(const NiFpga_Session session, const NiFpgaEx_DmaF
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status, fifo);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.startFifo(fifo);
@@ -568,6 +1094,7 @@ NiFpga_Status NiFpga_StopFifo(const NiFpga_Session session, const NiFpgaEx_DmaFi
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status, fifo);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.stopFifo(fifo);
@@ -591,6 +1118,8 @@ NiFpga_Status NiFpga_StopFifo(const NiFpga_Session session, const NiFpgaEx_DmaFi
             return NiFpga_Status_InvalidParameter;                         \
         /* wrap all code that might throw in a big safety net */           \
         Status status;                                                     \
+        const FlightScope flight(                                          \
+            __func__, session, status, fifo, numberOfElements);            \
         try {                                                              \
             auto& sessionObject = getSession(session);                     \
             sessionObject.readFifo<T>(                                     \
@@ -630,6 +1159,8 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_READ_FIFO)
             return NiFpga_Status_InvalidParameter;                         \
         /* wrap all code that might throw in a big safety net */           \
         Status status;                                                     \
+        const FlightScope flight(                                          \
+            __func__, session, status, fifo, numberOfElements);            \
         try {                                                              \
             auto& sessionObject = getSession(session);                     \
             sessionObject.writeFifo<T>(                                    \
@@ -654,6 +1185,138 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_READ_FIFO)
 //    NiFpga_WriteFifoDbl
 NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_WRITE_FIFO)
 
+#define NIFPGA_DEFINE_READ_FIFO_FXP(T)                                           \
+    NiFpga_Status NiFpgaEx_ReadFifoFxp##T(const NiFpga_Session session,          \
+        const NiFpgaEx_TargetToHostFifoFxp fifo,                                 \
+        T::CType* const data,                                                    \
+        const size_t numberOfElements,                                           \
+        const uint32_t timeout,                                                  \
+        NiFpga_Bool* const overflows,                                            \
+        size_t* const elementsRemaining)                                         \
+    {                                                                            \
+        /* validate parameters (overflows and elementsRemaining are optional) */ \
+        if (elementsRemaining)                                                   \
+            *elementsRemaining = 0;                                              \
+        if (!session || !data)                                                   \
+            return NiFpga_Status_InvalidParameter;                               \
+        /* wrap all code that might throw in a big safety net */                 \
+        Status status;                                                           \
+        const FlightScope flight(                                                \
+            __func__, session, status, fifo, numberOfElements);                  \
+        try {                                                                    \
+            auto& sessionObject = getSession(session);                           \
+            sessionObject.readFifoFxp(                                           \
+                fifo, data, numberOfElements, timeout, overflows,                \
+                elementsRemaining);                                              \
+        }                                                                        \
+        CATCH_ALL_AND_MERGE_STATUS(status)                                       \
+        return status;                                                           \
+    }
+
+// This generates the following functions:
+//
+//    NiFpgaEx_ReadFifoFxpSgl
+//    NiFpgaEx_ReadFifoFxpDbl
+NIFPGA_FOR_EACH_FXP_CONVERSION(NIFPGA_DEFINE_READ_FIFO_FXP)
+
+#define NIFPGA_DEFINE_WRITE_FIFO_FXP(T)                                    \
+    NiFpga_Status NiFpgaEx_WriteFifoFxp##T(const NiFpga_Session session,   \
+        const NiFpgaEx_HostToTargetFifoFxp fifo,                           \
+        const T::CType* const data,                                        \
+        const size_t numberOfElements,                                     \
+        const uint32_t timeout,                                            \
+        size_t* const elementsRemaining)                                   \
+    {                                                                      \
+        /* validate parameters (elementsRemaining is optional) */          \
+        if (elementsRemaining)                                             \
+            *elementsRemaining = 0;                                        \
+        if (!session || !data)                                             \
+            return NiFpga_Status_InvalidParameter;                         \
+        /* wrap all code that might throw in a big safety net */           \
+        Status status;                                                     \
+        const FlightScope flight(                                          \
+            __func__, session, status, fifo, numberOfElements);            \
+        try {                                                              \
+            auto& sessionObject = getSession(session);                     \
+            sessionObject.writeFifoFxp(                                    \
+                fifo, data, numberOfElements, timeout, elementsRemaining); \
+        }                                                                  \
+        CATCH_ALL_AND_MERGE_STATUS(status)                                 \
+        return status;                                                     \
+    }
+
+// This generates the following functions:
+//
+//    NiFpgaEx_WriteFifoFxpSgl
+//    NiFpgaEx_WriteFifoFxpDbl
+NIFPGA_FOR_EACH_FXP_CONVERSION(NIFPGA_DEFINE_WRITE_FIFO_FXP)
+
+NiFpga_Status NiFpgaEx_ReadFifoCluster(const NiFpga_Session session,
+    const NiFpgaEx_TargetToHostFifoCluster fifo,
+    void* const data,
+    const size_t stride,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount,
+    const size_t numberOfElements,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    // validate parameters (elementsRemaining is optional)
+    if (elementsRemaining)
+        *elementsRemaining = 0;
+    if (!session || !data || !fieldOffsets)
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status, fifo, numberOfElements);
+    try {
+        auto& sessionObject = getSession(session);
+        sessionObject.readFifoCluster(fifo,
+            data,
+            stride,
+            fieldOffsets,
+            fieldCount,
+            numberOfElements,
+            timeout,
+            elementsRemaining);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
+NiFpga_Status NiFpgaEx_WriteFifoCluster(const NiFpga_Session session,
+    const NiFpgaEx_HostToTargetFifoCluster fifo,
+    const void* const data,
+    const size_t stride,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount,
+    const size_t numberOfElements,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    // validate parameters (elementsRemaining is optional)
+    if (elementsRemaining)
+        *elementsRemaining = 0;
+    if (!session || !data || !fieldOffsets)
+        return NiFpga_Status_InvalidParameter;
+    // wrap all code that might throw in a big safety net
+    Status status;
+    const FlightScope flight(__func__, session, status, fifo, numberOfElements);
+    try {
+        auto& sessionObject = getSession(session);
+        sessionObject.writeFifoCluster(fifo,
+            data,
+            stride,
+            fieldOffsets,
+            fieldCount,
+            numberOfElements,
+            timeout,
+            elementsRemaining);
+    }
+    CATCH_ALL_AND_MERGE_STATUS(status)
+    return status;
+}
+
 #define NIFPGA_DEFINE_ACQUIRE_FIFO_ELEMENTS(T, ReadOrWrite, TargetHost, IsWrite) \
     NiFpga_Status NiFpga_AcquireFifo##ReadOrWrite##Elements##T(                  \
         const NiFpga_Session session,                                            \
@@ -675,6 +1338,8 @@ NIFPGA_FOR_EACH_SCALAR(NIFPGA_DEFINE_WRITE_FIFO)
             return NiFpga_Status_InvalidParameter;                               \
         /* wrap all code that might throw in a big safety net */                 \
         Status status;                                                           \
+        const FlightScope flight(                                                \
+            __func__, session, status, fifo, elementsRequested);                 \
         try {                                                                    \
             auto& sessionObject = getSession(session);                           \
             sessionObject.acquireFifoElements<T, IsWrite>(fifo,                  \
@@ -732,6 +1397,7 @@ NiFpga_Status NiFpga_ReleaseFifoElements(
         return NiFpga_Status_InvalidParameter;
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status, fifo, elements);
     try {
         auto& sessionObject = getSession(session);
         sessionObject.releaseFifoElements(fifo, elements);
@@ -806,6 +1472,7 @@ NiFpga_Status NiFpga_GetBitfileSignature(
 
     // wrap all code that might throw in a big safety net
     Status status;
+    const FlightScope flight(__func__, session, status);
     try {
         const auto& sessionObject    = getSession(session);
         const auto& bitfileSignature = sessionObject.getBitfile().getSignature();
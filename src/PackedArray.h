@@ -13,6 +13,7 @@
  */
 
 #pragma once
+#include "PackedArraySimd.h"
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -46,33 +47,33 @@ struct BitsToType<16>
 
 // Helpers for dealing with packing elements with a bitwidth < 32
 // into a uint32_t array.
+//
+// Elements are packed most significant first. When there are fewer elements
+// than fit in a single word, that word is right-justified; otherwise any
+// trailing partial word is left-justified. Unused bits are zero.
 template <int logicalBits, typename T = typename BitsToType<logicalBits>::type>
 struct PackedArray
 {
-    static void set(uint32_t* array, size_t index, T value)
-    {
-        const auto shift = bitIndex(index);
-
-        array += arrayIndex(index);
-        *array &= ~(mask << shift);
-        *array |= (static_cast<uint32_t>(value) & mask) << shift;
-    }
-
-    static T get(uint32_t* array, size_t index)
-    {
-        return (array[arrayIndex(index)] >> bitIndex(index)) & mask;
-    }
+    static const size_t packedBits = std::numeric_limits<uint32_t>::digits;
+    static const size_t elements   = packedBits / logicalBits;
+    static const uint32_t mask     = (1UL << logicalBits) - 1;
 
-    static void rightJustify(uint32_t* in, size_t count)
+    // packs up to a word's worth of elements, right-justified
+    static uint32_t packWord(const T* in, size_t count)
     {
-        if (needJustify(count))
-            *in >>= justifyShift(count);
+        uint32_t word = 0;
+        for (size_t i = 0; i < count; i++)
+            word = (word << logicalBits) | (static_cast<uint32_t>(in[i]) & mask);
+        return word;
     }
 
-    static void leftJustify(uint32_t* in, size_t count)
+    // unpacks up to a word's worth of elements, right-justified
+    static void unpackWord(uint32_t word, T* out, size_t count)
     {
-        if (needJustify(count))
-            *in <<= justifyShift(count);
+        for (size_t i = count; i > 0; i--) {
+            out[i - 1] = word & mask;
+            word >>= logicalBits;
+        }
     }
 
     static T* logicalCast(void* in)
@@ -90,28 +91,59 @@ struct PackedArray
         return count < elements;
     }
 
-private:
-    static size_t arrayIndex(size_t index)
+    static size_t justifyShift(size_t count)
     {
-        return index * logicalBits / packedBits;
+        return (elements - count) * logicalBits;
     }
 
-    static size_t bitIndex(size_t index)
+    static_assert((packedBits % logicalBits) == 0);
+    static_assert(logicalBits < 32);
+};
+
+// Vectorized conversion of whole words, where we have one.
+template <int logicalBits>
+struct PackedArrayKernels;
+
+template <>
+struct PackedArrayKernels<1>
+{
+    static void pack(uint32_t* out, const uint8_t* in, size_t words)
     {
-        return packedBits - (((1 + index) * logicalBits) % packedBits);
+        simd::packBools(out, in, words);
     }
 
-    static size_t justifyShift(size_t count)
+    static void unpack(const uint32_t* in, uint8_t* out, size_t words)
     {
-        return (elements - count) * logicalBits;
+        simd::unpackBools(out, in, words);
     }
+};
 
-    static const size_t packedBits = std::numeric_limits<uint32_t>::digits;
-    static const size_t elements   = packedBits / logicalBits;
-    static const uint32_t mask     = (1UL << logicalBits) - 1;
+template <>
+struct PackedArrayKernels<8>
+{
+    static void pack(uint32_t* out, const uint8_t* in, size_t words)
+    {
+        simd::swapBytes(out, in, words);
+    }
 
-    static_assert((packedBits % logicalBits) == 0);
-    static_assert(logicalBits < 32);
+    static void unpack(const uint32_t* in, uint8_t* out, size_t words)
+    {
+        simd::swapBytes(out, in, words);
+    }
+};
+
+template <>
+struct PackedArrayKernels<16>
+{
+    static void pack(uint32_t* out, const uint16_t* in, size_t words)
+    {
+        simd::swapHalfwords(out, in, words);
+    }
+
+    static void unpack(const uint32_t* in, uint16_t* out, size_t words)
+    {
+        simd::swapHalfwords(out, in, words);
+    }
 };
 
 } // namespace
@@ -128,10 +160,20 @@ static void packArray(uint32_t* out, const void* in_, size_t inSize)
     using pa = PackedArray<logicalBits>;
     auto in  = pa::logicalCast(in_);
 
-    for (size_t i = 0; i < inSize; i++)
-        pa::set(out, i, in[i]);
+    // a lone partial word is right-justified
+    if (pa::needJustify(inSize)) {
+        if (inSize)
+            *out = pa::packWord(in, inSize);
+        return;
+    }
+
+    const auto words = inSize / pa::elements;
+    PackedArrayKernels<logicalBits>::pack(out, in, words);
 
-    pa::rightJustify(out, inSize);
+    // any trailing partial word is left-justified
+    if (const auto remaining = inSize % pa::elements)
+        out[words] = pa::packWord(in + words * pa::elements, remaining)
+                     << pa::justifyShift(remaining);
 }
 
 template <>
@@ -143,13 +185,7 @@ void packArray<32>(uint32_t* out, const void* in, size_t inSize)
 template <>
 void packArray<64>(uint32_t* out, const void* in, size_t inSize)
 {
-    auto in32 = static_cast<const uint32_t*>(in);
-    inSize *= 2;
-
-    for (size_t i = 0; i < inSize; i += 2) {
-        out[i]     = in32[i + 1];
-        out[i + 1] = in32[i];
-    }
+    simd::swapWords(out, in, inSize);
 }
 
 template <int logicalBits>
@@ -158,10 +194,21 @@ static void unpackArray(uint32_t* in, void* out_, size_t outSize)
     using pa = PackedArray<logicalBits>;
     auto out = pa::logicalCast(out_);
 
-    pa::leftJustify(in, outSize);
+    // a lone partial word is right-justified
+    if (pa::needJustify(outSize)) {
+        if (outSize)
+            pa::unpackWord(*in, out, outSize);
+        return;
+    }
+
+    const auto words = outSize / pa::elements;
+    PackedArrayKernels<logicalBits>::unpack(in, out, words);
 
-    for (size_t i = 0; i < outSize; i++)
-        out[i] = pa::get(in, i);
+    // any trailing partial word is left-justified
+    if (const auto remaining = outSize % pa::elements)
+        pa::unpackWord(in[words] >> pa::justifyShift(remaining),
+            out + words * pa::elements,
+            remaining);
 }
 
 template <>
@@ -173,12 +220,71 @@ void unpackArray<32>(uint32_t* in, void* out, size_t outSize)
 template <>
 void unpackArray<64>(uint32_t* in, void* out, size_t outSize)
 {
-    auto out32 = static_cast<uint32_t*>(out);
-    outSize *= 2;
+    simd::swapWords(out, in, outSize);
+}
+
+// Packing for elements of any width up to 64 bits, such as fixed-point types,
+// whose width is only known at runtime. These follow the same justification
+// rules as above, treating the array as one stream of bits.
+//
+// NOTE: so that large arrays can be converted in chunks without an unpacked
+//       copy of the whole array, these work on a range of elements within an
+//       array of totalCount elements.
+
+static inline size_t packedBitsSize(size_t bits, size_t count)
+{
+    return (bits * count + 31) / 32;
+}
+
+// bit offset of an element from the most significant bit of the first word
+static inline size_t packedBitOffset(size_t bits, size_t totalCount, size_t index)
+{
+    const auto totalBits = bits * totalCount;
+    return (totalBits < 32 ? 32 - totalBits : 0) + index * bits;
+}
 
-    for (size_t i = 0; i < outSize; i += 2) {
-        out32[i]     = in[i + 1];
-        out32[i + 1] = in[i];
+static inline uint64_t packedBitsMask(size_t bits)
+{
+    return bits < 64 ? (uint64_t(1) << bits) - 1 : ~uint64_t(0);
+}
+
+// precondition: out was zeroed before packing the first element
+static inline void packBits(uint32_t* out,
+    size_t bits,
+    size_t totalCount,
+    size_t first,
+    const uint64_t* in,
+    size_t count)
+{
+    const auto mask = packedBitsMask(bits);
+    for (size_t i = 0; i < count; i++) {
+        const auto bit = packedBitOffset(bits, totalCount, first + i);
+        const auto end = bit + bits;
+        // line the element up in a window starting at its first word, where
+        // it can span at most three words
+        auto window = static_cast<unsigned __int128>(in[i] & mask)
+                      << (128 - bit % 32 - bits);
+        for (auto word = bit / 32; word * 32 < end; word++, window <<= 32)
+            out[word] |= static_cast<uint32_t>(window >> 96);
+    }
+}
+
+static inline void unpackBits(const uint32_t* in,
+    size_t bits,
+    size_t totalCount,
+    size_t first,
+    uint64_t* out,
+    size_t count)
+{
+    const auto mask = packedBitsMask(bits);
+    for (size_t i = 0; i < count; i++) {
+        const auto bit = packedBitOffset(bits, totalCount, first + i);
+        const auto end = bit + bits;
+        unsigned __int128 window = 0;
+        size_t shift             = 96;
+        for (auto word = bit / 32; word * 32 < end; word++, shift -= 32)
+            window |= static_cast<unsigned __int128>(in[word]) << shift;
+        out[i] = static_cast<uint64_t>(window >> (128 - bit % 32 - bits)) & mask;
     }
 }
 
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uint32_t
+#include <cstring> // memcpy
+
+// NOTE: define NIRIO_PACKED_ARRAY_SCALAR to force the scalar versions, such as
+//       for comparing against them
+#if defined(NIRIO_PACKED_ARRAY_SCALAR)
+#elif defined(__AVX2__)
+#    include <immintrin.h>
+#    define NIRIO_PACKED_ARRAY_AVX2
+#    define NIRIO_PACKED_ARRAY_SSE2
+#elif defined(__SSE2__)
+#    include <emmintrin.h>
+#    define NIRIO_PACKED_ARRAY_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#    define NIRIO_PACKED_ARRAY_NEON
+#endif
+
+/**
+ * Kernels for converting whole 32-bit words between the layout of C arrays and
+ * the packed, big-endian-within-a-word layout the FPGA expects. See
+ * PackedArray.h for the layout itself, and for handling of partial words.
+ *
+ * Each kernel converts a given number of whole words, using the widest vector
+ * instructions the target was compiled for (AVX2 or SSE2 on x86, NEON on
+ * 64-bit ARM) and finishing any remainder with scalar code. Input and output
+ * need not be aligned, and may be the same buffer to convert in place, but
+ * must not otherwise overlap.
+ *
+ * Because the conversions for 8-bit, 16-bit, and 64-bit elements are their
+ * own inverses, the same kernel serves for both packing and unpacking.
+ */
+namespace nirio {
+namespace simd {
+
+namespace scalar {
+
+static inline uint32_t load32(const void* in)
+{
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+static inline void store32(void* out, const uint32_t value)
+{
+    memcpy(out, &value, sizeof(value));
+}
+
+static inline uint32_t reverseBits(uint32_t value)
+{
+    value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+    value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+    value = ((value >> 4) & 0x0f0f0f0f) | ((value & 0x0f0f0f0f) << 4);
+    return __builtin_bswap32(value);
+}
+
+static inline void swapBytes(uint8_t* out, const uint8_t* in, const size_t words)
+{
+    for (size_t i = 0; i < words; i++)
+        store32(out + i * 4, __builtin_bswap32(load32(in + i * 4)));
+}
+
+static inline void swapHalfwords(uint8_t* out, const uint8_t* in, const size_t words)
+{
+    for (size_t i = 0; i < words; i++) {
+        const auto value = load32(in + i * 4);
+        store32(out + i * 4, (value << 16) | (value >> 16));
+    }
+}
+
+static inline void swapWords(uint8_t* out, const uint8_t* in, const size_t dwords)
+{
+    for (size_t i = 0; i < dwords; i++) {
+        const auto low  = load32(in + i * 8);
+        const auto high = load32(in + i * 8 + 4);
+        store32(out + i * 8, high);
+        store32(out + i * 8 + 4, low);
+    }
+}
+
+static inline void packBools(uint32_t* out, const uint8_t* in, const size_t words)
+{
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word = 0;
+        for (size_t bit = 0; bit < 32; bit++)
+            word = (word << 1) | (in[i * 32 + bit] & 1);
+        out[i] = word;
+    }
+}
+
+static inline void unpackBools(uint8_t* out, const uint32_t* in, const size_t words)
+{
+    for (size_t i = 0; i < words; i++)
+        for (size_t bit = 0; bit < 32; bit++)
+            out[i * 32 + bit] = (in[i] >> (31 - bit)) & 1;
+}
+
+} // namespace scalar
+
+/**
+ * Reverses the bytes within each word, which packs or unpacks 8-bit elements.
+ */
+static inline void swapBytes(void* out_, const void* in_, const size_t words)
+{
+    auto out = static_cast<uint8_t*>(out_);
+    auto in  = static_cast<const uint8_t*>(in_);
+    size_t done = 0;
+#if defined(NIRIO_PACKED_ARRAY_AVX2)
+    const auto shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8,
+        15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; done + 8 <= words; done += 8) {
+        const auto v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done * 4));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out + done * 4), _mm256_shuffle_epi8(v, shuffle));
+    }
+#elif defined(NIRIO_PACKED_ARRAY_SSE2)
+    // no byte shuffle in plain SSE2, so swap bytes within halfwords, and then
+    // the halfwords themselves
+    for (; done + 4 <= words; done += 4) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done * 4));
+        v      = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v      = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v      = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done * 4), v);
+    }
+#elif defined(NIRIO_PACKED_ARRAY_NEON)
+    for (; done + 4 <= words; done += 4)
+        vst1q_u8(out + done * 4, vrev32q_u8(vld1q_u8(in + done * 4)));
+#endif
+    scalar::swapBytes(out + done * 4, in + done * 4, words - done);
+}
+
+/**
+ * Swaps the halfwords within each word, which packs or unpacks 16-bit
+ * elements.
+ */
+static inline void swapHalfwords(void* out_, const void* in_, const size_t words)
+{
+    auto out = static_cast<uint8_t*>(out_);
+    auto in  = static_cast<const uint8_t*>(in_);
+    size_t done = 0;
+#if defined(NIRIO_PACKED_ARRAY_AVX2)
+    for (; done + 8 <= words; done += 8) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done * 4));
+        v      = _mm256_or_si256(_mm256_slli_epi32(v, 16), _mm256_srli_epi32(v, 16));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done * 4), v);
+    }
+#elif defined(NIRIO_PACKED_ARRAY_SSE2)
+    for (; done + 4 <= words; done += 4) {
+        auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done * 4));
+        v      = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done * 4), v);
+    }
+#elif defined(NIRIO_PACKED_ARRAY_NEON)
+    for (; done + 4 <= words; done += 4) {
+        const auto v = vld1q_u16(reinterpret_cast<const uint16_t*>(in + done * 4));
+        vst1q_u16(reinterpret_cast<uint16_t*>(out + done * 4), vrev32q_u16(v));
+    }
+#endif
+    scalar::swapHalfwords(out + done * 4, in + done * 4, words - done);
+}
+
+/**
+ * Swaps the words within each 64-bit element, which packs or unpacks 64-bit
+ * elements.
+ */
+static inline void swapWords(void* out_, const void* in_, const size_t dwords)
+{
+    auto out = static_cast<uint8_t*>(out_);
+    auto in  = static_cast<const uint8_t*>(in_);
+    size_t done = 0;
+#if defined(NIRIO_PACKED_ARRAY_AVX2)
+    for (; done + 4 <= dwords; done += 4) {
+        const auto v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done * 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done * 8),
+            _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#elif defined(NIRIO_PACKED_ARRAY_SSE2)
+    for (; done + 2 <= dwords; done += 2) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done * 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done * 8),
+            _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+#elif defined(NIRIO_PACKED_ARRAY_NEON)
+    for (; done + 2 <= dwords; done += 2) {
+        const auto v = vld1q_u32(reinterpret_cast<const uint32_t*>(in + done * 8));
+        vst1q_u32(reinterpret_cast<uint32_t*>(out + done * 8), vrev64q_u32(v));
+    }
+#endif
+    scalar::swapWords(out + done * 8, in + done * 8, dwords - done);
+}
+
+/**
+ * Packs 32 Bools into each word, first Bool in the most significant bit. Only
+ * the least significant bit of each Bool is used.
+ */
+static inline void packBools(uint32_t* out, const uint8_t* in, const size_t words)
+{
+    size_t done = 0;
+#if defined(NIRIO_PACKED_ARRAY_SSE2)
+    // shift each Bool's bit up to the top of its byte for movemask, which
+    // gives us the first Bool in the least significant bit
+    for (; done < words; done++) {
+        const auto* const bools = in + done * 32;
+#    if defined(NIRIO_PACKED_ARRAY_AVX2)
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bools));
+        const auto mask =
+            static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_slli_epi16(v, 7)));
+#    else
+        const auto low  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bools));
+        const auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bools + 16));
+        const auto mask =
+            static_cast<uint32_t>(_mm_movemask_epi8(_mm_slli_epi16(low, 7)))
+            | static_cast<uint32_t>(_mm_movemask_epi8(_mm_slli_epi16(high, 7))) << 16;
+#    endif
+        out[done] = scalar::reverseBits(mask);
+    }
+#elif defined(NIRIO_PACKED_ARRAY_NEON)
+    // weight each Bool by its position within its byte, then sum each 8
+    const int8_t shiftValues[] = {7, 6, 5, 4, 3, 2, 1, 0, 7, 6, 5, 4, 3, 2, 1, 0};
+    const auto shifts          = vld1q_s8(shiftValues);
+    const auto one             = vdupq_n_u8(1);
+    for (; done < words; done++) {
+        uint32_t word = 0;
+        for (size_t half = 0; half < 2; half++) {
+            auto v = vandq_u8(vld1q_u8(in + done * 32 + half * 16), one);
+            v      = vshlq_u8(v, shifts);
+            word   = (word << 16) | static_cast<uint32_t>(vaddv_u8(vget_low_u8(v))) << 8
+                   | vaddv_u8(vget_high_u8(v));
+        }
+        out[done] = word;
+    }
+#endif
+    scalar::packBools(out + done, in + done * 32, words - done);
+}
+
+/**
+ * Unpacks 32 Bools from each word, first Bool in the most significant bit,
+ * into 0s and 1s.
+ */
+static inline void unpackBools(uint8_t* out, const uint32_t* in, const size_t words)
+{
+    size_t done = 0;
+#if defined(NIRIO_PACKED_ARRAY_SSE2)
+    // spread each byte of the word across 8 bytes, then test a different bit
+    // in each
+    const auto bits =
+        _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const auto one = _mm_set1_epi8(1);
+    for (; done < words; done++) {
+        // first Bool now in the least significant bit
+        auto v = _mm_cvtsi32_si128(static_cast<int>(scalar::reverseBits(in[done])));
+        v      = _mm_unpacklo_epi8(v, v);
+        v      = _mm_unpacklo_epi16(v, v);
+        const auto low  = _mm_unpacklo_epi32(v, v);
+        const auto high = _mm_unpackhi_epi32(v, v);
+        auto* const bools = out + done * 32;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bools),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(low, bits), bits), one));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bools + 16),
+            _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(high, bits), bits), one));
+    }
+#elif defined(NIRIO_PACKED_ARRAY_NEON)
+    const uint8_t bitValues[] = {
+        128, 64, 32, 16, 8, 4, 2, 1, 128, 64, 32, 16, 8, 4, 2, 1};
+    const auto bits = vld1q_u8(bitValues);
+    const auto one  = vdupq_n_u8(1);
+    for (; done < words; done++) {
+        const auto word = in[done];
+        for (size_t half = 0; half < 2; half++) {
+            const auto shift = 24 - half * 16;
+            const auto low   = vdup_n_u8(static_cast<uint8_t>(word >> shift));
+            const auto high  = vdup_n_u8(static_cast<uint8_t>(word >> (shift - 8)));
+            const auto v     = vcombine_u8(low, high);
+            vst1q_u8(out + done * 32 + half * 16, vandq_u8(vtstq_u8(v, bits), one));
+        }
+    }
+#endif
+    scalar::unpackBools(out + done * 32, in + done, words - done);
+}
+
+} // namespace simd
+} // namespace nirio
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "PathWaiter.h"
+#include "Timer.h"
+#include <poll.h> // poll
+#include <sched.h> // sched_yield
+#include <sys/inotify.h> // inotify_*
+#include <sys/stat.h> // stat
+#include <unistd.h> // read, close
+#include <algorithm> // std::min
+
+namespace nirio {
+
+namespace {
+
+// Bounds for the periodic re-check, for filesystems that don't notify.
+const uint32_t minimumPollTimeout = 1;
+const uint32_t maximumPollTimeout = 50;
+
+const uint32_t directoryEvents =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB;
+const uint32_t pathEvents = IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+
+const int invalidDescriptor = -1;
+
+/**
+ * Finds the closest directory at or above the parent of path that exists,
+ * which is where the next component of path will show up.
+ */
+std::string getNearestExistingParent(const std::string& path)
+{
+    auto parent = path;
+    struct stat s;
+    for (;;) {
+        const auto slash = parent.find_last_of('/');
+        if (slash == std::string::npos)
+            return ".";
+        else if (slash == 0)
+            return "/";
+        parent.erase(slash);
+        if (!::stat(parent.c_str(), &s) && S_ISDIR(s.st_mode))
+            return parent;
+    }
+}
+
+/**
+ * An inotify instance watching a path and its nearest existing parent.
+ */
+class Watch
+{
+public:
+    explicit Watch(const std::string& path)
+        : path(path)
+        , descriptor(::inotify_init1(IN_CLOEXEC | IN_NONBLOCK))
+    {
+    }
+
+    ~Watch()
+    {
+        if (isValid())
+            ::close(descriptor);
+    }
+
+    bool isValid() const
+    {
+        return descriptor != invalidDescriptor;
+    }
+
+    /**
+     * Points the watches at wherever the path is now, since directories along
+     * it may have come or gone since last time.
+     *
+     * NOTE: we don't remove watches we no longer need, since inotify_rm_watch
+     *       queues an IN_IGNORED event that would wake us right back up;
+     *       re-adding a watch on the same inode is silent, and the instance
+     *       cleans up after itself when closed
+     */
+    void rearm() const
+    {
+        ::inotify_add_watch(
+            descriptor, getNearestExistingParent(path).c_str(), directoryEvents);
+        // fails harmlessly if the path doesn't exist yet
+        ::inotify_add_watch(descriptor, path.c_str(), pathEvents);
+    }
+
+    /**
+     * Waits for any event, and consumes all that are pending.
+     *
+     * @return whether an event arrived before the timeout
+     */
+    bool wait(const uint32_t timeout) const
+    {
+        struct pollfd fd = {descriptor, POLLIN, 0};
+        if (::poll(&fd, 1, static_cast<int>(timeout)) <= 0)
+            return false;
+        // we only care that something happened, not what
+        alignas(struct inotify_event) char buffer[4096];
+        while (::read(descriptor, buffer, sizeof(buffer)) > 0)
+            ;
+        return true;
+    }
+
+private:
+    const std::string path;
+    const int descriptor;
+
+    Watch(const Watch&) = delete;
+    Watch& operator=(const Watch&) = delete;
+};
+
+} // unnamed namespace
+
+bool waitOnPath(const std::string& path,
+    const uint32_t timeout,
+    const std::function<bool()>& condition)
+{
+    const Timer timer(timeout);
+    if (condition())
+        return true;
+
+    Watch watch(path);
+    // last resort if we can't get an inotify instance, such as if we've hit
+    // max_user_instances
+    if (!watch.isValid()) {
+        do {
+            if (condition())
+                return true;
+            // NOTE: "In the Linux implementation, sched_yield() always succeeds":
+            //    http://man7.org/linux/man-pages/man2/sched_yield.2.html
+            sched_yield();
+        } while (!timer.isTimedOut());
+        return false;
+    }
+
+    auto pollTimeout = minimumPollTimeout;
+    for (;;) {
+        // arm before checking so we can't miss a change in between
+        watch.rearm();
+        if (condition())
+            return true;
+        const auto remaining = timer.getRemaining();
+        if (remaining == 0)
+            return false;
+        // react quickly while things are changing, and back off while they
+        // aren't
+        if (watch.wait(std::min(pollTimeout, remaining)))
+            pollTimeout = minimumPollTimeout;
+        else
+            pollTimeout = std::min(pollTimeout * 2, maximumPollTimeout);
+    }
+}
+
+} // namespace nirio
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <cstdint> // uint32_t
+#include <functional> // std::function
+#include <string> // std::string
+
+namespace nirio {
+
+/**
+ * Waits for a condition on a path to become true, such as a device node
+ * appearing after a download or a sysfs directory disappearing.
+ *
+ * Rather than spinning, this blocks on inotify for changes to the path and
+ * its nearest existing parent directory, re-checking the condition whenever
+ * something changes. Not every filesystem generates inotify events (sysfs
+ * creation and removal notably doesn't), so waits are also bounded by a short
+ * timeout that backs off, turning them into a cheap periodic check. Only if
+ * inotify is unavailable altogether do we fall back to yielding in a loop.
+ *
+ * @param path path whose appearance, disappearance, or attributes matter
+ * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+ * @param condition returns whether we're done waiting
+ * @return whether the condition became true before the timeout
+ */
+bool waitOnPath(const std::string& path,
+    uint32_t timeout,
+    const std::function<bool()>& condition);
+
+} // namespace nirio
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "Preparation.h"
+#include <unistd.h> // access
+
+namespace nirio {
+
+Preparation::Preparation(const std::string& path)
+    : done(std::async(std::launch::async, [this, path] {
+          TimingRecorder recorder;
+          try {
+              bitfile  = std::make_unique<Bitfile>(path);
+              firmware = FirmwareCache().prepare(*bitfile);
+          } catch (...) {
+              timings = recorder.finish();
+              throw;
+          }
+          timings = recorder.finish();
+      }).share())
+{
+}
+
+Preparation::~Preparation()
+{
+    // NOTE: the background thread uses our members, so it mustn't outlive us
+    done.wait();
+}
+
+void Preparation::wait() const
+{
+    done.get();
+}
+
+Firmware Preparation::finish()
+{
+    wait();
+    // NOTE: only check that the files are there, since verifying them again
+    //       is the very work we were asked to get out of the way
+    if (::access(firmware.bitstreamPath.c_str(), R_OK)
+        || ::access(firmware.overlayPath.c_str(), R_OK)
+        || (!firmware.compiledOverlayPath.empty()
+            && ::access(firmware.compiledOverlayPath.c_str(), R_OK)))
+        firmware = FirmwareCache().prepare(*bitfile);
+    return firmware;
+}
+
+const Bitfile& Preparation::getBitfile() const
+{
+    return *bitfile;
+}
+
+const Timings& Preparation::getTimings() const
+{
+    return timings;
+}
+
+std::unique_ptr<Bitfile> Preparation::takeBitfile()
+{
+    return std::move(bitfile);
+}
+
+} // namespace nirio
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "Bitfile.h"
+#include "FirmwareCache.h"
+#include "Timing.h"
+#include <future> // std::shared_future
+#include <memory> // std::unique_ptr
+#include <string> // std::string
+
+namespace nirio {
+
+/**
+ * Parses a bitfile and prepares its firmware on a background thread, so that
+ * it's ready to load by the time it's needed while whatever is running now
+ * keeps running.
+ */
+class Preparation
+{
+public:
+    /**
+     * Starts preparing a bitfile.
+     *
+     * @param path path to the bitfile
+     */
+    explicit Preparation(const std::string& path);
+
+    /**
+     * Waits for the preparation to finish, if it hasn't already.
+     */
+    ~Preparation();
+
+    /**
+     * Waits for the preparation to finish, throwing whatever it failed with.
+     */
+    void wait() const;
+
+    /**
+     * Waits for the preparation to finish, as wait() does, and gets the
+     * firmware it prepared.
+     *
+     * If the firmware has since been evicted from the cache by another
+     * bitfile, it's prepared again here rather than failing to load.
+     *
+     * @return the prepared firmware
+     */
+    Firmware finish();
+
+    /**
+     * Gets the parsed bitfile, once finished.
+     *
+     * @return the bitfile
+     */
+    const Bitfile& getBitfile() const;
+
+    /**
+     * Takes ownership of the parsed bitfile, once finished.
+     *
+     * @return the bitfile
+     */
+    std::unique_ptr<Bitfile> takeBitfile();
+
+    /**
+     * Gets how long each stage of the preparation took, once finished.
+     *
+     * @return timings of the preparation
+     */
+    const Timings& getTimings() const;
+
+private:
+    std::unique_ptr<Bitfile> bitfile;
+    Firmware firmware;
+    Timings timings;
+    std::shared_future<void> done;
+
+    Preparation(const Preparation&) = delete;
+    Preparation& operator=(const Preparation&) = delete;
+};
+
+} // namespace nirio
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "Probes.h"
+
+#ifdef ENABLE_USDT
+// NOTE: tracers find semaphores in the .probes section, as if they were
+//       generated by SystemTap's dtrace
+#    define NIRIO_DEFINE_PROBE_SEMAPHORE(name)               \
+        volatile unsigned short NIRIO_PROBE_SEMAPHORE(name) \
+            __attribute__((section(".probes"))) = 0;
+extern "C" {
+NIRIO_FOR_EACH_PROBE(NIRIO_DEFINE_PROBE_SEMAPHORE)
+}
+#endif // ENABLE_USDT
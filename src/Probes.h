@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "Common.h"
+#include <time.h> // clock_gettime
+#include <cstdint> // uint64_t
+
+/**
+ * USDT probes for perf, bpftrace, and SystemTap, under the "nifpga" provider.
+ *
+ * When built with ENABLE_USDT, NIRIO_PROBE(name, args...) marks a probe point
+ * with <sys/sdt.h>, which compiles to a single nop that a tracer replaces with
+ * a breakpoint only while it's attached. Its arguments are still evaluated, so
+ * they must be cheap; anything that isn't, such as timing a wait, is done only
+ * if NIRIO_PROBE_ENABLED(name) says a tracer is attached to that probe.
+ * Otherwise both compile away to nothing.
+ *
+ * Every probe has a semaphore counting the tracers attached to it, so it must
+ * be listed in NIRIO_FOR_EACH_PROBE. See tests/nifpga_latency.bt for what each
+ * one passes.
+ */
+#define NIRIO_FOR_EACH_PROBE(Probe) \
+    Probe(fifo_acquire_entry)       \
+    Probe(fifo_acquire_return)      \
+    Probe(fifo_release)             \
+    Probe(fifo_restart)             \
+    Probe(register_access_entry)    \
+    Probe(register_access_return)   \
+    Probe(irq_wait_entry)           \
+    Probe(irq_wait_return)          \
+    Probe(irq_ack)                  \
+    Probe(stage_entry)              \
+    Probe(stage_return)
+
+#ifdef ENABLE_USDT
+#    define _SDT_HAS_SEMAPHORES 1
+#    include <sys/sdt.h>
+#    define NIRIO_PROBE_SEMAPHORE(name) nifpga_##name##_semaphore
+#    define NIRIO_DECLARE_PROBE_SEMAPHORE(name) \
+        extern volatile unsigned short NIRIO_PROBE_SEMAPHORE(name);
+extern "C" {
+NIRIO_FOR_EACH_PROBE(NIRIO_DECLARE_PROBE_SEMAPHORE)
+}
+#    define NIRIO_PROBE(name, ...) STAP_PROBEV(nifpga, name, ##__VA_ARGS__)
+#    define NIRIO_PROBE_ENABLED(name) \
+        __builtin_expect(NIRIO_PROBE_SEMAPHORE(name) != 0, 0)
+#else
+#    define NIRIO_PROBE(name, ...) \
+        do {                       \
+        } while (false)
+#    define NIRIO_PROBE_ENABLED(name) false
+#endif // ENABLE_USDT
+
+namespace nirio {
+
+/**
+ * Times something for a probe to report, without reading the clock unless the
+ * probe was enabled when timing started.
+ */
+class ProbeTimer
+{
+public:
+    explicit ProbeTimer(const bool enabled) : start(enabled ? now() : 0) {}
+
+    /**
+     * @return nanoseconds since timing started, or 0 if it didn't
+     */
+    uint64_t getElapsed() const
+    {
+        return start ? now() - start : 0;
+    }
+
+private:
+    static uint64_t now()
+    {
+        struct timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+
+    const uint64_t start;
+};
+
+} // namespace nirio
@@ -14,6 +14,7 @@
 
 #include "RegisterInfo.h"
 #include <cassert> // assert
+#include <utility> // std::move
 
 namespace nirio {
 
@@ -22,12 +23,16 @@ RegisterInfo::RegisterInfo(const std::string& name,
     const NiFpgaEx_Register offset,
     const bool indicator,
     const bool array,
-    const bool accessMayTimeout)
+    const size_t size,
+    const bool accessMayTimeout,
+    std::shared_ptr<const ClusterPlan> clusterPlan)
     : ResourceInfo(name, type)
     , offset(offset)
     , indicator(indicator)
     , array(array)
+    , size(size)
     , accessMayTimeout(accessMayTimeout)
+    , clusterPlan(std::move(clusterPlan))
 {
 }
 
@@ -51,11 +56,26 @@ bool RegisterInfo::isArray() const
     return array;
 }
 
+size_t RegisterInfo::getSize() const
+{
+    return size;
+}
+
+size_t RegisterInfo::getPackedBytes() const
+{
+    return (size * type.getLogicalBits() + 31) / 32 * sizeof(uint32_t);
+}
+
 bool RegisterInfo::isAccessMayTimeout() const
 {
     return accessMayTimeout;
 }
 
+const ClusterPlan* RegisterInfo::getClusterPlan() const
+{
+    return clusterPlan.get();
+}
+
 bool RegisterInfo::matches(
     const std::string& name, const NiFpgaEx_ResourceType type) const
 {
@@ -14,7 +14,9 @@
 
 #pragma once
 
+#include "ClusterPlan.h"
 #include "ResourceInfo.h"
+#include <memory> // std::shared_ptr
 #include <vector> // std::vector
 
 namespace nirio {
@@ -30,7 +32,9 @@ public:
         NiFpgaEx_Register offset,
         bool control,
         bool array,
-        bool accessMayTimeout);
+        size_t size,
+        bool accessMayTimeout,
+        std::shared_ptr<const ClusterPlan> clusterPlan = nullptr);
 
     /**
      * Gets the offset of this register.
@@ -60,6 +64,22 @@ public:
      */
     bool isArray() const;
 
+    /**
+     * Gets the number of elements in this register, which is 1 for
+     * non-arrays.
+     *
+     * @return number of elements
+     */
+    size_t getSize() const;
+
+    /**
+     * Gets the size in bytes this register occupies when packed into 32-bit
+     * words as transferred to and from the FPGA.
+     *
+     * @return packed size in bytes
+     */
+    size_t getPackedBytes() const;
+
     /**
      * Gets whether reading or writing may timeout.
      *
@@ -67,6 +87,13 @@ public:
      */
     bool isAccessMayTimeout() const;
 
+    /**
+     * Gets the layout of a cluster control or indicator.
+     *
+     * @return layout of this cluster, or NULL if not a cluster
+     */
+    const ClusterPlan* getClusterPlan() const;
+
     virtual bool matches(const std::string& name, NiFpgaEx_ResourceType type) const;
 
 protected:
@@ -74,7 +101,10 @@ protected:
     NiFpgaEx_Register offset;
     bool indicator;
     bool array;
+    size_t size;
     bool accessMayTimeout;
+    // shared so that copies don't recompile it
+    std::shared_ptr<const ClusterPlan> clusterPlan;
 };
 
 typedef std::vector<RegisterInfo> RegisterInfoVector;
@@ -38,6 +38,14 @@ bool ResourceInfo::matches(
     if (type == NiFpgaEx_ResourceType_Any)
         return this->name == name;
 
+    // fixed-point formats vary, so any of them match
+    if (nirio::isFixedPoint(type))
+        return this->name == name && this->type.isFixedPoint();
+
+    // likewise for cluster layouts
+    if (nirio::isCluster(type))
+        return this->name == name && this->type.isCluster();
+
     // only matches name and type, so derived class much match the rest
     return this->name == name && this->type == nirio::getType(type);
 }
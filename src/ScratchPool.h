@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include <atomic> // std::atomic_flag
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uintptr_t
+#include <memory> // std::unique_ptr
+
+namespace nirio {
+
+/**
+ * A fixed set of preallocated scratch buffers that can be borrowed without
+ * locking or allocating, for staging register array accesses.
+ *
+ * All buffers are allocated up front, sized for the largest access we expect.
+ * Borrowing claims the first free slot with an atomic test-and-set, so
+ * concurrent callers never block one another. If every slot is busy, or a
+ * caller needs more than a slot holds, we fall back to the heap rather than
+ * fail; that should only happen under heavy contention or misuse.
+ */
+class ScratchPool
+{
+public:
+    /**
+     * Default number of slots, enough for a few threads hammering the same
+     * session at once.
+     */
+    static const size_t defaultSlots = 4;
+
+    /**
+     * A borrowed buffer, which returns itself to the pool when destroyed.
+     */
+    class Lease
+    {
+    public:
+        Lease(Lease&& other) noexcept
+            : pool(other.pool)
+            , slot(other.slot)
+            , data(other.data)
+            , heapData(std::move(other.heapData))
+        {
+            other.pool = nullptr;
+        }
+
+        ~Lease()
+        {
+            if (pool)
+                pool->release(slot);
+        }
+
+        uint8_t* get() const
+        {
+            return data;
+        }
+
+    private:
+        friend class ScratchPool;
+
+        // borrowed a slot from the pool
+        Lease(const ScratchPool& pool, const size_t slot)
+            : pool(&pool), slot(slot), data(pool.getSlot(slot))
+        {
+        }
+
+        // had to go to the heap instead
+        explicit Lease(const size_t size)
+            : pool(nullptr), slot(0), data(nullptr), heapData(new uint8_t[size])
+        {
+            data = heapData.get();
+        }
+
+        const ScratchPool* pool;
+        size_t slot;
+        uint8_t* data;
+        std::unique_ptr<uint8_t[]> heapData;
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+    };
+
+    /**
+     * @param slotBytes size in bytes of each buffer
+     * @param slots number of buffers
+     */
+    explicit ScratchPool(const size_t slotBytes, const size_t slots = defaultSlots)
+        : slotBytes(roundUp(slotBytes))
+        , slots(slotBytes ? slots : 0)
+        , storage(new uint8_t[this->slotBytes * this->slots + alignment])
+        , base(align(storage.get()))
+        , busy(new std::atomic_flag[this->slots])
+    {
+        for (size_t i = 0; i < this->slots; i++)
+            busy[i].clear();
+    }
+
+    /**
+     * Borrows a buffer of at least the given size.
+     *
+     * @param size number of bytes needed
+     * @return lease on the buffer
+     */
+    Lease acquire(const size_t size) const
+    {
+        if (size <= slotBytes)
+            for (size_t i = 0; i < slots; i++)
+                if (!busy[i].test_and_set(std::memory_order_acquire))
+                    return Lease(*this, i);
+        return Lease(size);
+    }
+
+    /**
+     * Gets the size of each preallocated buffer.
+     *
+     * @return size in bytes of each buffer
+     */
+    size_t getSlotBytes() const
+    {
+        return slotBytes;
+    }
+
+private:
+    // keep slots on separate cache lines so users don't false share
+    static const size_t alignment = 64;
+
+    static size_t roundUp(const size_t size)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    static uint8_t* align(uint8_t* const pointer)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(pointer);
+        return pointer + (roundUp(address) - address);
+    }
+
+    uint8_t* getSlot(const size_t slot) const
+    {
+        return base + slot * slotBytes;
+    }
+
+    void release(const size_t slot) const
+    {
+        busy[slot].clear(std::memory_order_release);
+    }
+
+    const size_t slotBytes;
+    const size_t slots;
+    const std::unique_ptr<uint8_t[]> storage;
+    uint8_t* const base;
+    const std::unique_ptr<std::atomic_flag[]> busy;
+
+    ScratchPool(const ScratchPool&) = delete;
+    ScratchPool& operator=(const ScratchPool&) = delete;
+};
+
+} // namespace nirio
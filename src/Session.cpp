@@ -16,8 +16,11 @@
 #include "ErrnoMap.h"
 #include "Exception.h"
 #include "NiFpga.h"
+#include "Probes.h"
 #include "SysfsFile.h"
+#include "Timing.h"
 #include <poll.h>
+#include <algorithm> // std::max
 
 namespace nirio {
 
@@ -37,14 +40,33 @@ public:
     }
 } alreadyErrnoMap;
 
+/**
+ * Gets the size of the largest array access this bitfile could need, including
+ * the ioctl header, so array accesses never have to allocate.
+ */
+size_t getLargestArrayIoctlSize(const Bitfile& bitfile)
+{
+    size_t largest = 0;
+    for (const auto& reg : bitfile.getRegisters())
+        if (reg.isArray() || reg.getClusterPlan())
+            largest = std::max(largest, reg.getPackedBytes());
+    return largest ? sizeof(ioctl_nirio_array) + largest : 0;
+}
+
 } // unnamed namespace
 
 Session::Session(std::unique_ptr<Bitfile> bitfile_, const std::string& device)
     : bitfile(std::move(bitfile_))
     , device(device)
+    , startedFile(device, "vi_started")
+    , finishedFile(device, "vi_finished")
+    , runFile(device, "run_vi", alreadyErrnoMap)
+    , abortFile(device, "abort_vi")
     , resetFile(device, "reset_vi")
+    , viStateMonitor(startedFile, finishedFile)
     , fpgaAddressSpaceSize(SysfsFile(device, "fpga_size").readU32())
     , baseAddressOnDevice(bitfile->getBaseAddressOnDevice())
+    , arrayScratch(getLargestArrayIoctlSize(*bitfile))
 {
     SysfsFile signatureFile(device, "signature");
 
@@ -60,14 +82,20 @@ Session::Session(std::unique_ptr<Bitfile> bitfile_, const std::string& device)
     createBoardFile();
 
     // for every FIFO in this bitfile
-    for (auto it = bitfile->getFifos().cbegin(), end = bitfile->getFifos().cend();
-         it != end;
-         ++it) {
-        // Bitfile constructor guarantees these are numbered [0,n-1]
-        assert(fifos.size() == it->getNumber());
-        // store in member as upgraded FifoInfo
-        fifos.emplace_back(new Fifo(*it, device));
+    {
+        const TimingScope timing(NiFpgaEx_TimingStage_Fifos);
+        for (auto it = bitfile->getFifos().cbegin(), end = bitfile->getFifos().cend();
+             it != end;
+             ++it) {
+            // Bitfile constructor guarantees these are numbered [0,n-1]
+            assert(fifos.size() == it->getNumber());
+            // store in member as upgraded FifoInfo
+            fifos.emplace_back(new Fifo(*it, device));
+        }
     }
+
+    for (const auto& reg : bitfile->getRegisters())
+        registersByOffset.emplace(reg.getOffset(), &reg);
 }
 
 void Session::createBoardFile()
@@ -98,12 +126,12 @@ void Session::close(const bool resetIfLastSession)
 
 bool Session::isStarted() const
 {
-    return SysfsFile(device, "vi_started").readBool();
+    return startedFile.readBool();
 }
 
 bool Session::isFinished() const
 {
-    return SysfsFile(device, "vi_finished").readBool();
+    return finishedFile.readBool();
 }
 
 bool Session::isRunning() const
@@ -111,6 +139,12 @@ bool Session::isRunning() const
     return isStarted() && !isFinished();
 }
 
+bool Session::waitOnViState(
+    const uint32_t states, const uint32_t timeout, NiFpgaEx_ViState& state) const
+{
+    return viStateMonitor.waitOnState(states, timeout, state);
+}
+
 void Session::checkControlRegisterStatus() const
 {
     // any sysfs attribute that reads the control register will report errors
@@ -125,7 +159,7 @@ bool Session::run() const
     bool alreadyRunning = false;
 
     try {
-        SysfsFile(device, "run_vi", alreadyErrnoMap).write(true);
+        runFile.write(true);
     } catch (const FpgaAlreadyRunningException&) {
         alreadyRunning = true;
     }
@@ -136,7 +170,7 @@ bool Session::run() const
 void Session::abort() const
 {
     // tell the kernel to abort
-    SysfsFile(device, "abort_vi").write(true);
+    abortFile.write(true);
     // kernel will stop all FIFOs, so we need to remember that it did
     setStoppedAllFifos();
 }
@@ -145,6 +179,7 @@ void Session::reset() const
 {
     // tell the kernel to reset
     resetFile.write(true);
+    invalidateAttributes();
     // kernel will stop all FIFOs, so we need to remember that it did
     setStoppedAllFifos();
 }
@@ -155,13 +190,25 @@ void Session::preDownload()
 
     boardFile.reset(nullptr);
     setStoppedAllFifos();
+    invalidateAttributes();
 }
 
 void Session::postDownload()
 {
+    // the download may have recreated the attributes we had open
+    invalidateAttributes();
     createBoardFile();
 }
 
+void Session::invalidateAttributes() const
+{
+    startedFile.invalidate();
+    finishedFile.invalidate();
+    runFile.invalidate();
+    abortFile.invalidate();
+    resetFile.invalidate();
+}
+
 void Session::setStoppedAllFifos() const
 {
     Status status;
@@ -193,30 +240,32 @@ void Session::findResource(const char* const name,
 {
     // validate parameters
     assert(name); // checked in NiFpga.cpp
+    // only resources with this name can match, and there's usually just one
+    const auto* const named = bitfile->findByName(name);
+    const std::string nameString(name);
     // handle registers
-    if (isRegister(type) || type == NiFpgaEx_ResourceType_Any) {
+    if (named && (isRegister(type) || type == NiFpgaEx_ResourceType_Any)) {
         // keep track of what we find
         bool found              = false;
         NiFpgaEx_Register local = 0;
-        // for each register
-        for (auto it  = bitfile->getRegisters().cbegin(),
-                  end = bitfile->getRegisters().cend();
-             it != end;
-             ++it) {
-            const auto& reg = *it;
+        // for each register by that name
+        for (const auto* const reg : named->registers) {
             // if we found a match
-            if (reg.matches(name, type)) {
+            if (reg->matches(nameString, type)) {
                 // if we _already_ found a match, it's ambiguous which they want,
                 // so return an error instead of giving the wrong one
                 if (found)
                     NIRIO_THROW(InvalidResourceNameException());
 
-                // remember this match, but keep looking
+                // remember this match, but keep looking if another register
+                // has the same name
                 found = true;
-                local = baseAddressOnDevice + reg.getOffset();
+                local = baseAddressOnDevice + reg->getOffset();
                 // mark "AccessMayTimeout" registers as such
-                if (reg.isAccessMayTimeout())
+                if (reg->isAccessMayTimeout())
                     setAccessMayTimeout(local);
+                if (!named->ambiguous)
+                    break;
             }
         }
         // if we found one-and-only-one, let 'em have it
@@ -227,14 +276,11 @@ void Session::findResource(const char* const name,
     }
 
     // handle FIFOs
-    if (isDmaFifo(type) || type == NiFpgaEx_ResourceType_Any) {
+    if (named && (isDmaFifo(type) || type == NiFpgaEx_ResourceType_Any)) {
         // TODO: support searching for P2P FIFOs instead of just these DMA FIFOs?
-        for (auto it = bitfile->getFifos().cbegin(), end = bitfile->getFifos().cend();
-             it != end;
-             ++it) {
-            const auto& fifo = *it;
-            if (fifo.matches(name, type)) {
-                resource = fifo.getNumber();
+        for (const auto* const fifo : named->fifos) {
+            if (fifo->matches(nameString, type)) {
+                resource = fifo->getNumber();
                 return;
             }
         }
@@ -248,6 +294,113 @@ void Session::findResource(const char* const name,
     NIRIO_THROW(ResourceNotFoundException());
 }
 
+/**
+ * Looks up the type of a fixed-point register.
+ *
+ * @param reg register as returned by findResource
+ * @param isArray whether this is an array access
+ * @param count number of elements to access, which must match the register
+ * @return type of the register's elements
+ */
+const Type& Session::getFxpType(
+    const NiFpgaEx_Register reg, const bool isArray, const size_t count) const
+{
+    const auto found = registersByOffset.find(getOffset(reg) - baseAddressOnDevice);
+    if (found == registersByOffset.cend())
+        NIRIO_THROW(InvalidParameterException());
+    const auto& info = *found->second;
+    const auto& type = info.getType();
+    if (!type.isFixedPoint() || info.isArray() != isArray)
+        NIRIO_THROW(InvalidParameterException());
+    if (count != info.getSize())
+        NIRIO_THROW(BadReadWriteCountException());
+    return type;
+}
+
+void Session::getMappedRegisters(volatile void*& registers, size_t& size) const
+{
+    // a download in progress or a device without mappable registers has
+    // nothing to hand out
+    if (!boardFile || !boardFile->isMapped())
+        NIRIO_THROW(FeatureNotSupportedException());
+    registers = boardFile->getMapped();
+    size      = boardFile->getMappedSize();
+}
+
+void Session::getFxpTypeInfo(
+    const NiFpgaEx_Register reg, NiFpgaEx_FxpTypeInfo& typeInfo) const
+{
+    const auto found = registersByOffset.find(getOffset(reg) - baseAddressOnDevice);
+    if (found == registersByOffset.cend())
+        NIRIO_THROW(InvalidParameterException());
+    const auto& type = found->second->getType();
+    if (!type.isFixedPoint())
+        NIRIO_THROW(InvalidParameterException());
+    typeInfo.isSigned              = type.isSigned();
+    typeInfo.wordLength            = type.getWordLength();
+    typeInfo.integerWordLength     = type.getIntegerWordLength();
+    typeInfo.includeOverflowStatus = type.hasOverflowStatus();
+}
+
+/**
+ * Looks up the layout of a cluster register.
+ *
+ * @param reg register as returned by findResource
+ * @param fieldCount number of fields the caller described, which must match
+ * @return layout of the cluster
+ */
+const ClusterPlan& Session::getClusterPlan(
+    const NiFpgaEx_Register reg, const size_t fieldCount) const
+{
+    const auto found = registersByOffset.find(getOffset(reg) - baseAddressOnDevice);
+    if (found == registersByOffset.cend())
+        NIRIO_THROW(InvalidParameterException());
+    const auto* const plan = found->second->getClusterPlan();
+    if (!plan || plan->getFieldCount() != fieldCount)
+        NIRIO_THROW(InvalidParameterException());
+    return *plan;
+}
+
+void Session::readCluster(const NiFpgaEx_Register reg,
+    void* const cluster,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount) const
+{
+    NIRIO_HOT_PATH;
+    NIRIO_PROBE(register_access_entry, reg, fieldCount, false);
+    const auto& plan  = getClusterPlan(reg, fieldCount);
+    const auto size   = plan.getPackedBytes();
+    const auto offset = getDeviceOffset(reg);
+    // the whole cluster is one wide register, read atomically like a U8 array
+    // and unpacked from the words in place
+    accessArray<false>(offset, packedArraySize<8>(size), [&](uint32_t* const words) {
+        unpackArray<8>(words, words, size);
+        plan.unpack(reinterpret_cast<const uint8_t*>(words), cluster, fieldOffsets);
+    });
+    if (isAccessMayTimeout(reg))
+        checkControlRegisterStatus();
+    NIRIO_PROBE(register_access_return, reg, fieldCount, false);
+}
+
+void Session::writeCluster(const NiFpgaEx_Register reg,
+    const void* const cluster,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount) const
+{
+    NIRIO_HOT_PATH;
+    NIRIO_PROBE(register_access_entry, reg, fieldCount, true);
+    const auto& plan  = getClusterPlan(reg, fieldCount);
+    const auto size   = plan.getPackedBytes();
+    const auto offset = getDeviceOffset(reg);
+    accessArray<true>(offset, packedArraySize<8>(size), [&](uint32_t* const words) {
+        plan.pack(cluster, fieldOffsets, reinterpret_cast<uint8_t*>(words));
+        packArray<8>(words, words, size);
+    });
+    if (isAccessMayTimeout(reg))
+        checkControlRegisterStatus();
+    NIRIO_PROBE(register_access_return, reg, fieldCount, true);
+}
+
 void Session::reserveIrqContext(void** ctx)
 {
     boardFile->ioctl(NIRIO_IOC_IRQ_CTX_ALLOC, ctx);
@@ -261,6 +414,7 @@ void Session::unreserveIrqContext(void* ctx)
 void Session::acknowledgeIrqs(uint32_t irqs)
 {
     boardFile->ioctl(NIRIO_IOC_IRQ_ACK, &irqs);
+    NIRIO_PROBE(irq_ack, irqs);
 }
 
 void Session::waitOnIrqs(void* ctx,
@@ -275,7 +429,11 @@ void Session::waitOnIrqs(void* ctx,
     wait.mask       = irqs;
     wait.timeout_ms = timeout;
 
+    NIRIO_PROBE(irq_wait_entry, irqs, timeout);
+    const ProbeTimer waited(NIRIO_PROBE_ENABLED(irq_wait_return));
     boardFile->ioctl(NIRIO_IOC_IRQ_WAIT, &wait);
+    NIRIO_PROBE(
+        irq_wait_return, irqs, wait.asserted, wait.timed_out, waited.getElapsed());
 
     *irqsAsserted = wait.asserted;
     *timedOut     = !!wait.timed_out;
@@ -312,6 +470,42 @@ void Session::stopFifo(const NiFpgaEx_DmaFifo fifo)
     fifos[fifo]->stop();
 }
 
+void Session::readFifoCluster(const NiFpgaEx_TargetToHostFifo fifo,
+    void* const data,
+    const size_t stride,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount,
+    const size_t count,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    // validate parameters
+    if (fifo >= fifos.size())
+        NIRIO_THROW(InvalidParameterException());
+
+    // pass it on
+    fifos[fifo]->readCluster(
+        data, stride, fieldOffsets, fieldCount, count, timeout, elementsRemaining);
+}
+
+void Session::writeFifoCluster(const NiFpgaEx_HostToTargetFifo fifo,
+    const void* const data,
+    const size_t stride,
+    const size_t* const fieldOffsets,
+    const size_t fieldCount,
+    const size_t count,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    // validate parameters
+    if (fifo >= fifos.size())
+        NIRIO_THROW(InvalidParameterException());
+
+    // pass it on
+    fifos[fifo]->writeCluster(
+        data, stride, fieldOffsets, fieldCount, count, timeout, elementsRemaining);
+}
+
 void Session::releaseFifoElements(const NiFpgaEx_DmaFifo fifo, const size_t elements)
 {
     // validate parameters
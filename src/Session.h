@@ -18,13 +18,21 @@
 #include "DeviceFile.h"
 #include "Exception.h"
 #include "Fifo.h"
+#include "FixedPoint.h"
+#include "HotPath.h"
 #include "PackedArray.h"
+#include "Probes.h"
+#include "ScratchPool.h"
 #include "Type.h"
+#include "ViStateMonitor.h"
 #include <misc/nirio.h>
 #include <type_traits>
+#include <algorithm> // std::min
 #include <cassert> // assert
 #include <cstring> // memcpy
 #include <memory> // std::unique_ptr
+#include <optional> // std::optional
+#include <unordered_map> // std::unordered_map
 #include <vector> // std::vector
 
 namespace nirio {
@@ -48,6 +56,8 @@ public:
 
     bool isRunning() const;
 
+    bool waitOnViState(uint32_t states, uint32_t timeout, NiFpgaEx_ViState& state) const;
+
     void checkControlRegisterStatus() const;
 
     // Returns true if the FPGA was already running when called
@@ -77,6 +87,31 @@ public:
     void writeArray(
         NiFpgaEx_RegisterArray reg, const typename T::CType* values, size_t count) const;
 
+    void getMappedRegisters(volatile void*& registers, size_t& size) const;
+
+    void getFxpTypeInfo(NiFpgaEx_Register reg, NiFpgaEx_FxpTypeInfo& typeInfo) const;
+
+    template <typename Float>
+    void readFxp(NiFpgaEx_Register reg,
+        Float* values,
+        size_t count,
+        bool isArray,
+        NiFpga_Bool* overflows) const;
+
+    template <typename Float>
+    void writeFxp(
+        NiFpgaEx_Register reg, const Float* values, size_t count, bool isArray) const;
+
+    void readCluster(NiFpgaEx_Register reg,
+        void* cluster,
+        const size_t* fieldOffsets,
+        size_t fieldCount) const;
+
+    void writeCluster(NiFpgaEx_Register reg,
+        const void* cluster,
+        const size_t* fieldOffsets,
+        size_t fieldCount) const;
+
     void reserveIrqContext(void** ctx);
 
     void unreserveIrqContext(void* ctx);
@@ -119,6 +154,39 @@ public:
         uint32_t timeout,
         size_t* elementsRemaining);
 
+    template <typename Float>
+    void readFifoFxp(NiFpgaEx_TargetToHostFifo fifo,
+        Float* data,
+        size_t count,
+        uint32_t timeout,
+        NiFpga_Bool* overflows,
+        size_t* elementsRemaining);
+
+    template <typename Float>
+    void writeFifoFxp(NiFpgaEx_HostToTargetFifo fifo,
+        const Float* data,
+        size_t count,
+        uint32_t timeout,
+        size_t* elementsRemaining);
+
+    void readFifoCluster(NiFpgaEx_TargetToHostFifo fifo,
+        void* data,
+        size_t stride,
+        const size_t* fieldOffsets,
+        size_t fieldCount,
+        size_t count,
+        uint32_t timeout,
+        size_t* elementsRemaining);
+
+    void writeFifoCluster(NiFpgaEx_HostToTargetFifo fifo,
+        const void* data,
+        size_t stride,
+        const size_t* fieldOffsets,
+        size_t fieldCount,
+        size_t count,
+        uint32_t timeout,
+        size_t* elementsRemaining);
+
 private:
     void createBoardFile();
 
@@ -172,16 +240,45 @@ private:
 
     void setStoppedAllFifos() const;
 
+    void invalidateAttributes() const;
+
     template <typename T, bool IsSingle, bool IsRead>
     void readOrWrite(
         NiFpgaEx_Register reg, typename T::CType* values, size_t count) const;
 
+    uint32_t getDeviceOffset(NiFpgaEx_Register reg) const;
+
+    template <bool IsWrite, typename Stage>
+    void accessArray(uint32_t offset, size_t u32Count, const Stage& stage) const;
+
+    const Type& getFxpType(NiFpgaEx_Register reg, bool isArray, size_t count) const;
+
+    const ClusterPlan& getClusterPlan(NiFpgaEx_Register reg, size_t fieldCount) const;
+
+    template <bool IsWrite, typename Convert>
+    void readOrWriteFxpArray(NiFpgaEx_Register reg,
+        const Type& type,
+        size_t count,
+        const Convert& convert) const;
+
+    /// Maximum number of fixed-point elements converted at once.
+    static constexpr size_t fxpChunk = 64;
+
     std::unique_ptr<Bitfile> bitfile;
     const std::string device;
     std::unique_ptr<DeviceFile> boardFile;
+    const SysfsFile startedFile;
+    const SysfsFile finishedFile;
+    const SysfsFile runFile;
+    const SysfsFile abortFile;
     const SysfsFile resetFile;
+    const ViStateMonitor viStateMonitor;
     const size_t fpgaAddressSpaceSize;
     const uint32_t baseAddressOnDevice;
+    /// Staging buffers for array accesses too large for the stack.
+    const ScratchPool arrayScratch;
+    /// Registers by their offset in the bitfile, for looking up their types.
+    std::unordered_map<NiFpgaEx_Register, const RegisterInfo*> registersByOffset;
 
     typedef std::vector<std::unique_ptr<Fifo>> FifoVector;
     FifoVector fifos;
@@ -190,6 +287,73 @@ private:
     Session& operator=(const Session&) = delete;
 };
 
+/**
+ * Gets the offset of a control or indicator into the device's FPGA address
+ * space, 32-bit aligned.
+ *
+ * @param reg control or indicator
+ * @return offset to access
+ */
+inline uint32_t Session::getDeviceOffset(const NiFpgaEx_Register reg) const
+{
+    // strip any extra bits
+    auto offset = getOffset(reg);
+    // All accesses must be 32-bit aligned to prevent a failed bus transaction.
+    // 16-bit and smaller registers have 2 added to the 32-bit aligned offset
+    // that we must mask out. We always mask out the bottom two bits for these
+    // sub-32-bit accesses and just in case a bad offset is passed.
+    offset &= ~3;
+    // The FPGA Interface C API Generator does not just copy control/indicator
+    // offsets found in the bitfile's XML, which describes the offset into the
+    // device's FPGA address space. Instead, capigen adds <BaseAddressOnDevice>
+    // to each control/indicator's offset. We need to subtract
+    // <BaseAddressOnDevice> to get back to matching the bitfile XML. This is
+    // correct because the mapping the kernel provides will begin at the start
+    // of FPGA address space.
+    return offset - baseAddressOnDevice;
+}
+
+/**
+ * Reads or writes a wide register atomically with one array ioctl, packing or
+ * unpacking its words in place in the ioctl's own buffer so that nothing is
+ * copied or allocated along the way.
+ *
+ * @tparam IsWrite whether this is a write operation instead of a read
+ * @param offset offset from getDeviceOffset
+ * @param u32Count number of 32-bit words in the register
+ * @param stage called with the words, to fill them in before a write or to
+ *              consume them after a read
+ */
+template <bool IsWrite, typename Stage>
+void Session::accessArray(
+    const uint32_t offset, const size_t u32Count, const Stage& stage) const
+{
+    // small accesses fit on the stack, and anything bigger borrows one of the
+    // buffers we sized for the largest array in the bitfile
+    alignas(ioctl_nirio_array) uint8_t stackBuffer[128];
+    std::optional<ScratchPool::Lease> lease;
+    struct ioctl_nirio_array* array;
+    const size_t size = sizeof(*array) + u32Count * sizeof(uint32_t);
+
+    if (size < sizeof(stackBuffer))
+        array = reinterpret_cast<ioctl_nirio_array*>(stackBuffer);
+    else {
+        lease.emplace(arrayScratch.acquire(size));
+        array = reinterpret_cast<ioctl_nirio_array*>(lease->get());
+    }
+
+    array->offset = offset;
+    array->count  = u32Count;
+
+    if (IsWrite) {
+        stage(array->data);
+        boardFile->ioctl(NIRIO_IOC_WRITE_ARRAY, array);
+    } else {
+        boardFile->ioctl(NIRIO_IOC_READ_ARRAY, array);
+        stage(array->data);
+    }
+}
+
 /**
  * Reads or writes from a control or indicator.
  *
@@ -209,21 +373,9 @@ template <typename T, bool IsSingle, bool IsWrite>
 void Session::readOrWrite(
     NiFpgaEx_Register reg, typename T::CType* const values, const size_t count) const
 {
-    // strip any extra bits
-    auto offset = getOffset(reg);
-    // All accesses must be 32-bit aligned to prevent a failed bus transaction.
-    // 16-bit and smaller registers have 2 added to the 32-bit aligned offset
-    // that we must mask out. We always mask out the bottom two bits for these
-    // sub-32-bit accesses and just in case a bad offset is passed.
-    offset &= ~3;
-    // The FPGA Interface C API Generator does not just copy control/indicator
-    // offsets found in the bitfile's XML, which describes the offset into the
-    // device's FPGA address space. Instead, capigen adds <BaseAddressOnDevice>
-    // to each control/indicator's offset. We need to subtract
-    // <BaseAddressOnDevice> to get back to matching the bitfile XML. This is
-    // correct because the mapping the kernel provides will begin at the start
-    // of FPGA address space.
-    offset -= baseAddressOnDevice;
+    NIRIO_HOT_PATH;
+    NIRIO_PROBE(register_access_entry, reg, count, IsWrite);
+    const auto offset = getDeviceOffset(reg);
     // 32-bit and smaller accesses are done by a single 32-bit access to the
     // mapped registers file
     if ((IsSingle || count == 1) && T::elementBytes <= 4 && boardFile->isMapped()) {
@@ -250,34 +402,18 @@ void Session::readOrWrite(
     // process from doing a partial read, we do them atomically in the kernel
     // with one ioctl. Other alternatives like global locking would incur more
     // user/kernel transitions that would negatively affect performance.
-    else {
-        uint8_t stackBuffer[128];
-        std::unique_ptr<uint8_t[]> heapBuffer;
-        struct ioctl_nirio_array* array;
-        const size_t u32Count = packedArraySize<T::logicalBits>(count);
-        const size_t size     = sizeof(*array) + u32Count * sizeof(uint32_t);
-
-        if (size < sizeof(stackBuffer))
-            array = reinterpret_cast<ioctl_nirio_array*>(stackBuffer);
-        else {
-            heapBuffer.reset(new uint8_t[size]);
-            array = reinterpret_cast<ioctl_nirio_array*>(heapBuffer.get());
-        }
-
-        array->offset = offset;
-        array->count  = u32Count;
-
-        if (IsWrite) {
-            packArray<T::logicalBits>(array->data, values, count);
-            boardFile->ioctl(NIRIO_IOC_WRITE_ARRAY, array);
-        } else {
-            boardFile->ioctl(NIRIO_IOC_READ_ARRAY, array);
-            unpackArray<T::logicalBits>(array->data, values, count);
-        }
-    }
+    else
+        accessArray<IsWrite>(
+            offset, packedArraySize<T::logicalBits>(count), [&](uint32_t* const data) {
+                if (IsWrite)
+                    packArray<T::logicalBits>(data, values, count);
+                else
+                    unpackArray<T::logicalBits>(data, values, count);
+            });
     // if access may timeout, check for errors
     if (isAccessMayTimeout(reg))
         checkControlRegisterStatus();
+    NIRIO_PROBE(register_access_return, reg, count, IsWrite);
 }
 
 template <typename T>
@@ -308,6 +444,118 @@ void Session::writeArray(const NiFpgaEx_RegisterArray reg,
     readOrWrite<T, false, true>(reg, const_cast<typename T::CType*>(values), count);
 }
 
+/**
+ * Reads or writes an entire fixed-point array as a stream of packed raw words,
+ * converting it in chunks straight to or from the ioctl's buffer so that no
+ * other copy of the whole array is needed.
+ *
+ * @tparam IsWrite whether this is a write operation instead of a read
+ * @param reg fixed-point array register
+ * @param type type of the register's elements
+ * @param count number of elements in the register
+ * @param convert called with (first, raw, count) for each chunk, which fills
+ *                raw for writes or consumes it for reads
+ */
+template <bool IsWrite, typename Convert>
+void Session::readOrWriteFxpArray(const NiFpgaEx_Register reg,
+    const Type& type,
+    const size_t count,
+    const Convert& convert) const
+{
+    NIRIO_HOT_PATH;
+    NIRIO_PROBE(register_access_entry, reg, count, IsWrite);
+    const auto bits     = type.getLogicalBits();
+    const auto u32Count = packedBitsSize(bits, count);
+    accessArray<IsWrite>(getDeviceOffset(reg), u32Count, [&](uint32_t* const words) {
+        uint64_t raw[fxpChunk];
+        if (IsWrite)
+            std::memset(words, 0, u32Count * sizeof(uint32_t));
+        for (size_t first = 0; first < count; first += fxpChunk) {
+            const auto chunk = std::min(fxpChunk, count - first);
+            if (IsWrite) {
+                convert(first, raw, chunk);
+                packBits(words, bits, count, first, raw, chunk);
+            } else {
+                unpackBits(words, bits, count, first, raw, chunk);
+                convert(first, raw, chunk);
+            }
+        }
+    });
+    if (isAccessMayTimeout(reg))
+        checkControlRegisterStatus();
+    NIRIO_PROBE(register_access_return, reg, count, IsWrite);
+}
+
+/**
+ * Reads fixed-point values, converted to floating point.
+ *
+ * @tparam Float float or double
+ * @param reg fixed-point register
+ * @param values outputs the values
+ * @param count number of values, which must match the register
+ * @param isArray whether this was called as an array access
+ * @param overflows outputs the overflow status of each value, or NULL
+ */
+template <typename Float>
+void Session::readFxp(const NiFpgaEx_Register reg,
+    Float* const values,
+    const size_t count,
+    const bool isArray,
+    NiFpga_Bool* const overflows) const
+{
+    const auto& type = getFxpType(reg, isArray, count);
+    const FixedPoint fixedPoint(type);
+    if (isArray) {
+        readOrWriteFxpArray<false>(
+            reg, type, count, [&](const size_t first, uint64_t* raw, const size_t n) {
+                fixedPoint.toFloat(
+                    raw, values + first, overflows ? overflows + first : nullptr, n);
+            });
+    } else {
+        // scalars are right-justified in a single 32- or 64-bit register
+        uint64_t raw;
+        if (type.getElementBytes() <= 4) {
+            uint32_t raw32;
+            read<U32>(reg, raw32);
+            raw = raw32;
+        } else
+            read<U64>(reg, raw);
+        fixedPoint.toFloat(&raw, values, overflows, 1);
+    }
+}
+
+/**
+ * Writes floating-point values to fixed-point, rounding and saturating them.
+ *
+ * @tparam Float float or double
+ * @param reg fixed-point register
+ * @param values values to write
+ * @param count number of values, which must match the register
+ * @param isArray whether this was called as an array access
+ */
+template <typename Float>
+void Session::writeFxp(const NiFpgaEx_Register reg,
+    const Float* const values,
+    const size_t count,
+    const bool isArray) const
+{
+    const auto& type = getFxpType(reg, isArray, count);
+    const FixedPoint fixedPoint(type);
+    if (isArray) {
+        readOrWriteFxpArray<true>(
+            reg, type, count, [&](const size_t first, uint64_t* raw, const size_t n) {
+                fixedPoint.fromFloat(values + first, raw, n);
+            });
+    } else {
+        uint64_t raw;
+        fixedPoint.fromFloat(values, &raw, 1);
+        if (type.getElementBytes() <= 4)
+            write<U32>(reg, static_cast<uint32_t>(raw));
+        else
+            write<U64>(reg, raw);
+    }
+}
+
 template <typename T, bool IsWrite>
 void Session::acquireFifoElements(const NiFpgaEx_DmaFifo fifo,
     typename T::CType*& elements,
@@ -355,4 +603,35 @@ void Session::writeFifo(const NiFpgaEx_HostToTargetFifo fifo,
     fifos[fifo]->write<T>(data, count, timeout, elementsRemaining);
 }
 
+template <typename Float>
+void Session::readFifoFxp(const NiFpgaEx_TargetToHostFifo fifo,
+    Float* const data,
+    const size_t count,
+    const uint32_t timeout,
+    NiFpga_Bool* const overflows,
+    size_t* const elementsRemaining)
+{
+    // validate parameters
+    if (fifo >= fifos.size())
+        NIRIO_THROW(InvalidParameterException());
+
+    // pass it on
+    fifos[fifo]->readFxp(data, count, timeout, overflows, elementsRemaining);
+}
+
+template <typename Float>
+void Session::writeFifoFxp(const NiFpgaEx_HostToTargetFifo fifo,
+    const Float* const data,
+    const size_t count,
+    const uint32_t timeout,
+    size_t* const elementsRemaining)
+{
+    // validate parameters
+    if (fifo >= fifos.size())
+        NIRIO_THROW(InvalidParameterException());
+
+    // pass it on
+    fifos[fifo]->writeFxp(data, count, timeout, elementsRemaining);
+}
+
 } // namespace nirio
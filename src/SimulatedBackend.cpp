@@ -0,0 +1,1039 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "SimulatedBackend.h"
+#include "ErrnoMap.h"
+#include "Exception.h"
+#include "Loader.h"
+#include "dtgen.h"
+#include "linux/dma-heap.h"
+#include <fcntl.h> // O_CLOEXEC
+#include <misc/nirio.h> // NIRIO_IOC_*
+#include <sys/mman.h> // memfd_create, mmap, munmap
+#include <unistd.h> // access, close, dup, ftruncate, pread, pwrite
+#include <algorithm> // std::min
+#include <cerrno> // errno
+#include <cmath> // std::floor
+#include <cstdio> // snprintf
+#include <cstdlib> // getenv, strtoull
+#include <cstring> // memcpy, memset
+#include <fstream> // std::ifstream
+#include <iostream> // std::cerr, std::endl
+#include <iterator> // std::istreambuf_iterator
+#include <set> // std::set
+#include <sstream> // std::istringstream
+
+namespace nirio {
+
+namespace {
+
+const uint32_t infiniteTimeout = 0xFFFFFFFF;
+
+const std::set<std::string> readableAttributes = {
+    "signature", "session_count", "fpga_size", "vi_started", "vi_finished"};
+
+const std::set<std::string> writableAttributes = {"run_vi", "abort_vi", "reset_vi"};
+
+const std::set<std::string> fifoAttributes = {"element_bytes"};
+
+int fail(const int error)
+{
+    errno = error;
+    return -1;
+}
+
+int createMemfd(const std::string& name, const int flags)
+{
+    return memfd_create(name.c_str(), flags & O_CLOEXEC ? MFD_CLOEXEC : 0);
+}
+
+/**
+ * Gets what a path names under a root, such as "RIO0/signature" for
+ * "/sys/class/nirio/RIO0/signature" under "/sys/class/nirio".
+ */
+bool isUnder(const std::string& path, const std::string& root, std::string& rest)
+{
+    if (path.size() <= root.size() + 1 || path.compare(0, root.size(), root)
+        || path[root.size()] != '/')
+        return false;
+    rest = path.substr(root.size() + 1);
+    return true;
+}
+
+/**
+ * Finds the device a name refers to, along with its FIFO for names such as
+ * "RIO0fifo1".
+ */
+SimulatedDevice* findDevice(const std::vector<std::unique_ptr<SimulatedDevice>>& devices,
+    const std::string& name,
+    int& fifo)
+{
+    for (const auto& device : devices) {
+        const auto& prefix = device->getName();
+        if (name == prefix) {
+            fifo = -1;
+            return device.get();
+        }
+        const auto digits = prefix.size() + sizeof("fifo") - 1;
+        if (name.size() > digits && !name.compare(0, prefix.size(), prefix)
+            && !name.compare(prefix.size(), digits - prefix.size(), "fifo")
+            && name.find_first_not_of("0123456789", digits) == std::string::npos) {
+            fifo = atoi(name.c_str() + digits);
+            return device.get();
+        }
+    }
+    return nullptr;
+}
+
+std::vector<std::string> getDeviceNames()
+{
+    std::vector<std::string> names;
+    const char* const list = getenv("NIFPGA_SIMULATOR_DEVICES");
+    std::istringstream stream(list ? list : "");
+    std::string name;
+    while (std::getline(stream, name, ','))
+        if (!name.empty())
+            names.push_back(name);
+    if (names.empty())
+        names.push_back("RIO0");
+    return names;
+}
+
+uint64_t getFifoRate()
+{
+    const char* const rate = getenv("NIFPGA_SIMULATOR_FIFO_RATE");
+    return rate ? strtoull(rate, NULL, 0) : 0;
+}
+
+bool isCompatible(const dtgen::dt_node& node, const std::string& compatible)
+{
+    const auto* const property = node.find_property("compatible");
+    if (!property)
+        return false;
+    // a list of NUL-terminated strings
+    const std::string list(property->value.begin(), property->value.end());
+    const std::string entry = compatible + '\0';
+    for (size_t start = 0; start < list.size(); start = list.find('\0', start) + 1)
+        if (!list.compare(start, entry.size(), entry))
+            return true;
+    return false;
+}
+
+uint32_t getCell(const dtgen::dt_node& node,
+    const char* const property,
+    const size_t index,
+    const uint32_t fallback)
+{
+    const auto* const found = node.find_property(property);
+    if (!found || found->value.size() < (index + 1) * 4)
+        return fallback;
+    const auto* const cell = &found->value[index * 4];
+    return static_cast<uint32_t>(cell[0]) << 24 | cell[1] << 16 | cell[2] << 8 | cell[3];
+}
+
+const dtgen::dt_node* findRio(const dtgen::dt_node& node)
+{
+    if (isCompatible(node, "ni,rio"))
+        return &node;
+    for (const auto& child : node.children())
+        if (const auto* const rio = findRio(*child))
+            return rio;
+    return nullptr;
+}
+
+/**
+ * Reads an overlay, preferring the compiled one.
+ */
+dtgen::dt_tree readOverlay(const Firmware& firmware)
+{
+    const auto compiled = !firmware.compiledOverlayPath.empty();
+    const auto& path    = compiled ? firmware.compiledOverlayPath : firmware.overlayPath;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "failed to read overlay " << path << std::endl;
+        NIRIO_THROW(SoftwareFaultException());
+    }
+    const std::string contents(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    try {
+        return compiled ? dtgen::dt_tree::unflatten(
+                              std::vector<uint8_t>(contents.begin(), contents.end()))
+                        : dtgen::dt_tree::parse(contents);
+    } catch (const dtgen::dt_error& e) {
+        std::cerr << "failed to read overlay " << path << ": " << e.what() << std::endl;
+        NIRIO_THROW(SoftwareFaultException());
+    }
+}
+
+/**
+ * Programs a device with what the overlay says the driver would have found.
+ */
+void apply(SimulatedDevice& device, const dtgen::dt_tree& overlay)
+{
+    auto* rio = findRio(*overlay.root);
+    for (auto it = overlay.orphans.cbegin(); !rio && it != overlay.orphans.cend(); ++it)
+        rio = findRio(*it->second);
+    if (!rio) {
+        std::cerr << "no nirio node in overlay" << std::endl;
+        NIRIO_THROW(SoftwareFaultException());
+    }
+
+    std::string signature;
+    const auto* const words = rio->find_property("signature");
+    for (size_t i = 0; words && i < words->value.size() / 4; i++) {
+        char word[sizeof("FFFFFFFF")];
+        snprintf(word, sizeof(word), "%08X", getCell(*rio, "signature", i, 0));
+        signature += word;
+    }
+
+    std::vector<SimulatedDevice::FifoConfig> fifos;
+    for (const auto& child : rio->children())
+        if (isCompatible(*child, "ni,rio-fifo"))
+            fifos.push_back({getCell(*child, "dma-channel", 0, 0),
+                getCell(*child, "bits-per-element", 0, 32) / 8,
+                child->find_property("ni,target-to-host") != nullptr});
+
+    // reg is two cells of address and two of size
+    device.program(signature,
+        fifos,
+        getCell(*rio, "reg", 3, 0x80000),
+        rio->find_property("ni,run-when-loaded") != nullptr);
+}
+
+/**
+ * Loads firmware onto a simulated device, making sure the bitstream is there
+ * and then programming the device from the overlay.
+ */
+class SimulatedLoader : public Loader
+{
+public:
+    explicit SimulatedLoader(SimulatedDevice& device) : device(device) {}
+
+    const char* getName() const override
+    {
+        return "simulated";
+    }
+
+protected:
+    void loadStages(const Firmware& firmware) override
+    {
+        stage("check bitstream", [&] {
+            if (access(firmware.bitstreamPath.c_str(), R_OK)) {
+                std::cerr << "failed to read bitstream " << firmware.bitstreamPath
+                          << ": " << errno << std::endl;
+                NIRIO_THROW(SoftwareFaultException());
+            }
+        });
+        stage("apply overlay", [&] { apply(device, readOverlay(firmware)); });
+    }
+
+private:
+    SimulatedDevice& device;
+};
+
+} // unnamed namespace
+
+SimulatedDevice::SimulatedDevice(const std::string& name, const uint64_t fifoRate)
+    : name(name)
+    , fifoRate(fifoRate)
+    , bar(createMemfd("nirio-" + name, O_CLOEXEC))
+    , programmed(false)
+    , fpgaSize(0)
+    , started(false)
+    , finished(false)
+    , sessions(0)
+    , asserted(0)
+    , nextIrqContext(1)
+{
+    if (bar == -1)
+        ErrnoMap::instance.throwErrno(errno);
+}
+
+SimulatedDevice::~SimulatedDevice()
+{
+    for (auto& fifo : fifos)
+        unsetBuffer(fifo);
+    ::close(bar);
+}
+
+const std::string& SimulatedDevice::getName() const
+{
+    return name;
+}
+
+void SimulatedDevice::program(const std::string& signature,
+    const std::vector<FifoConfig>& fifos,
+    const uint32_t fpgaSize,
+    const bool runWhenLoaded)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    for (auto& fifo : this->fifos)
+        unsetBuffer(fifo);
+    this->fifos.clear();
+    for (const auto& config : fifos) {
+        Fifo fifo = {};
+        fifo.config = config;
+        fifo.rate   = fifoRate;
+        this->fifos.push_back(fifo);
+    }
+    this->signature = signature;
+    this->fpgaSize  = fpgaSize;
+    if (const auto error = clearRegisters())
+        ErrnoMap::instance.throwErrno(error);
+    asserted   = 0;
+    started    = runWhenLoaded;
+    finished   = false;
+    programmed = true;
+    changed.notify_all();
+}
+
+bool SimulatedDevice::isProgrammed() const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    return programmed;
+}
+
+std::string SimulatedDevice::getSignature() const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    return signature;
+}
+
+bool SimulatedDevice::isStarted() const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    return started;
+}
+
+bool SimulatedDevice::isFinished() const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    return finished;
+}
+
+void SimulatedDevice::finish()
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (started)
+        finished = true;
+    changed.notify_all();
+}
+
+uint32_t SimulatedDevice::getSessionCount() const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    return sessions;
+}
+
+void SimulatedDevice::setFifoRate(const uint32_t fifo, const uint64_t elementsPerSecond)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    auto* const found = findFifo(static_cast<int>(fifo));
+    if (!found)
+        NIRIO_THROW(InvalidParameterException());
+    // settle up at the old rate before starting on the new one
+    advance(*found, Clock::now());
+    found->rate   = elementsPerSecond;
+    found->credit = 0;
+    changed.notify_all();
+}
+
+uint64_t SimulatedDevice::getFifoTransferred(const uint32_t fifo)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    auto* const found = findFifo(static_cast<int>(fifo));
+    if (!found)
+        NIRIO_THROW(InvalidParameterException());
+    advance(*found, Clock::now());
+    return found->transferred;
+}
+
+void SimulatedDevice::assertIrqs(const uint32_t irqs)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    asserted |= irqs;
+    changed.notify_all();
+}
+
+uint32_t SimulatedDevice::peek(const uint32_t offset) const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    uint32_t value = 0;
+    if (offset + sizeof(value) > fpgaSize)
+        NIRIO_THROW(InvalidParameterException());
+    if (::pread(bar, &value, sizeof(value), offset) == -1)
+        ErrnoMap::instance.throwErrno(errno);
+    return value;
+}
+
+void SimulatedDevice::poke(const uint32_t offset, const uint32_t value)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (offset + sizeof(value) > fpgaSize)
+        NIRIO_THROW(InvalidParameterException());
+    if (::pwrite(bar, &value, sizeof(value), offset) == -1)
+        ErrnoMap::instance.throwErrno(errno);
+}
+
+SimulatedDevice::Fifo* SimulatedDevice::findFifo(const int fifo)
+{
+    for (auto& found : fifos)
+        if (static_cast<int>(found.config.number) == fifo)
+            return &found;
+    return nullptr;
+}
+
+void SimulatedDevice::unsetBuffer(Fifo& fifo)
+{
+    fifo.started = false;
+    if (fifo.buffer)
+        munmap(fifo.buffer, fifo.bufferSize);
+    fifo.buffer     = NULL;
+    fifo.bufferSize = 0;
+    fifo.depth      = 0;
+}
+
+void SimulatedDevice::stopFifos()
+{
+    for (auto& fifo : fifos)
+        fifo.started = false;
+}
+
+int SimulatedDevice::clearRegisters()
+{
+    arrays.clear();
+    // truncating to nothing and back is the quickest way to zero a memfd, and
+    // keeps it mapped by any sessions that are still open
+    return ftruncate(bar, 0) || ftruncate(bar, fpgaSize) ? errno : 0;
+}
+
+void SimulatedDevice::advance(Fifo& fifo, const Clock::time_point now)
+{
+    if (!fifo.started)
+        return;
+    // the FPGA fills whatever the host isn't using, and drains whatever the
+    // host released
+    const auto room = fifo.config.targetToHost ? fifo.depth - fifo.ready - fifo.held
+                                               : fifo.pending;
+    auto moving = room;
+    if (fifo.rate) {
+        fifo.credit += std::chrono::duration<double>(now - fifo.last).count() * fifo.rate;
+        moving = std::min(room, static_cast<size_t>(std::floor(fifo.credit)));
+        // the FPGA stalls rather than getting ahead while there's no room
+        fifo.credit = moving < room ? fifo.credit - moving : 0;
+    }
+    fifo.last = now;
+
+    if (fifo.config.targetToHost) {
+        const auto bytes = fifo.config.elementBytes;
+        for (size_t i = 0; i < moving; i++) {
+            auto* const element = fifo.buffer + fifo.head * bytes;
+            memset(element, 0, bytes);
+            memcpy(element, &fifo.count, std::min<size_t>(bytes, sizeof(fifo.count)));
+            fifo.count++;
+            if (++fifo.head == fifo.depth)
+                fifo.head = 0;
+        }
+    } else
+        fifo.pending -= moving;
+    fifo.ready += moving;
+    fifo.transferred += moving;
+}
+
+int SimulatedDevice::acquire(std::unique_lock<std::mutex>& guard,
+    const int number,
+    ioctl_nirio_fifo_acquire& request)
+{
+    const auto infinite = request.timeout_ms == infiniteTimeout;
+    const auto deadline = Clock::now() + std::chrono::milliseconds(request.timeout_ms);
+    for (;;) {
+        // look it up again every time, since it may be stopped or even gone
+        // once we wake up
+        auto* const fifo = findFifo(number);
+        if (!fifo || !fifo->started)
+            return EPERM;
+        if (request.elements > fifo->depth)
+            return EINVAL;
+
+        const auto now = Clock::now();
+        advance(*fifo, now);
+        if (fifo->ready >= request.elements) {
+            fifo->ready -= request.elements;
+            fifo->held += request.elements;
+            request.available = fifo->ready;
+            request.timed_out = 0;
+            return 0;
+        } else if (!infinite && now >= deadline) {
+            request.available = fifo->ready;
+            request.timed_out = 1;
+            return 0;
+        }
+
+        // wake once the rate would have moved enough, or when anything changes
+        auto wake = infinite ? Clock::time_point::max() : deadline;
+        if (fifo->rate) {
+            const auto needed = request.elements - fifo->ready - fifo->credit;
+            wake              = std::min(wake,
+                now
+                    + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(needed / fifo->rate)));
+        }
+        if (wake == Clock::time_point::max())
+            changed.wait(guard);
+        else
+            changed.wait_until(guard, wake);
+    }
+}
+
+bool SimulatedDevice::exists(const int fifo) const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (!programmed)
+        return false;
+    for (const auto& found : fifos)
+        if (fifo < 0 || static_cast<int>(found.config.number) == fifo)
+            return true;
+    return fifo < 0;
+}
+
+int SimulatedDevice::openBoard()
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    const auto descriptor = dup(bar);
+    if (descriptor == -1)
+        return -1;
+    sessions++;
+    return descriptor;
+}
+
+void SimulatedDevice::closeBoard(const bool resetOnClose)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (!--sessions && resetOnClose) {
+        started  = false;
+        finished = false;
+        stopFifos();
+        clearRegisters();
+    }
+    changed.notify_all();
+}
+
+int SimulatedDevice::openFifo(const int fifo)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    auto* const found = findFifo(fifo);
+    if (!found)
+        return ENOENT;
+    // only one process may own a FIFO at a time
+    if (found->open)
+        return EBUSY;
+    found->open = true;
+    return 0;
+}
+
+void SimulatedDevice::closeFifo(const int fifo)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (auto* const found = findFifo(fifo)) {
+        unsetBuffer(*found);
+        found->open = false;
+    }
+    changed.notify_all();
+}
+
+int SimulatedDevice::readAttribute(
+    const std::string& attribute, const int fifo, std::string& value)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (!programmed)
+        return ENODEV;
+    std::ostringstream stream;
+    if (fifo >= 0) {
+        const auto* const found = findFifo(fifo);
+        if (!found)
+            return ENODEV;
+        stream << found->config.elementBytes;
+    } else if (attribute == "signature")
+        stream << signature;
+    else if (attribute == "session_count")
+        stream << sessions;
+    else if (attribute == "fpga_size")
+        stream << fpgaSize;
+    else if (attribute == "vi_started")
+        stream << started;
+    else if (attribute == "vi_finished")
+        stream << finished;
+    else
+        return EIO; // write-only, as sysfs reports it
+    stream << '\n';
+    value = stream.str();
+    return 0;
+}
+
+int SimulatedDevice::writeAttribute(
+    const std::string& attribute, const std::string& value)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    if (!programmed)
+        return ENODEV;
+    else if (!writableAttributes.count(attribute))
+        return EIO; // read-only, as sysfs reports it
+    else if (!strtoul(value.c_str(), NULL, 0))
+        return 0;
+
+    auto error = 0;
+    if (attribute == "run_vi") {
+        if (started && !finished)
+            return EALREADY;
+        started  = true;
+        finished = false;
+    } else if (attribute == "abort_vi") {
+        started = false;
+        stopFifos();
+    } else {
+        started  = false;
+        finished = false;
+        stopFifos();
+        error = clearRegisters();
+    }
+    changed.notify_all();
+    return error;
+}
+
+int SimulatedDevice::boardIoctl(
+    const unsigned long int request, void* const argument, bool& resetOnClose)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    switch (request) {
+        case NIRIO_IOC_READ_ARRAY:
+        case NIRIO_IOC_WRITE_ARRAY: {
+            auto* const array = static_cast<ioctl_nirio_array*>(argument);
+            if (uint64_t(array->offset) + uint64_t(array->count) * 4 > fpgaSize)
+                return EINVAL;
+            if (request == NIRIO_IOC_WRITE_ARRAY) {
+                arrays[array->offset].assign(array->data, array->data + array->count);
+                return 0;
+            }
+            const auto found = arrays.find(array->offset);
+            if (found == arrays.end())
+                memset(array->data, 0, array->count * sizeof(uint32_t));
+            // the array engine gets out of sync if the count is wrong
+            else if (found->second.size() != array->count)
+                return EINVAL;
+            else
+                std::copy(found->second.begin(), found->second.end(), array->data);
+            return 0;
+        }
+        case NIRIO_IOC_RESET_ON_LAST_REF:
+            if (sessions > 1)
+                return EBUSY;
+            resetOnClose = true;
+            return 0;
+        case NIRIO_IOC_FORCE_REDOWNLOAD:
+            return 0;
+        case NIRIO_IOC_IRQ_CTX_ALLOC:
+            *static_cast<uint64_t*>(argument) = nextIrqContext++;
+            return 0;
+        case NIRIO_IOC_IRQ_CTX_FREE:
+            return 0;
+        case NIRIO_IOC_IRQ_ACK:
+            asserted &= ~*static_cast<uint32_t*>(argument);
+            return 0;
+        case NIRIO_IOC_IRQ_WAIT: {
+            auto* const wait     = static_cast<ioctl_nirio_irq_wait*>(argument);
+            const auto satisfied = [&] { return (asserted & wait->mask) != 0; };
+            if (wait->timeout_ms == infiniteTimeout)
+                changed.wait(guard, satisfied);
+            else
+                changed.wait_for(
+                    guard, std::chrono::milliseconds(wait->timeout_ms), satisfied);
+            wait->asserted  = asserted & wait->mask;
+            wait->timed_out = !wait->asserted;
+            return 0;
+        }
+        default:
+            return ENOTTY;
+    }
+}
+
+int SimulatedDevice::fifoIoctl(
+    const int number, const unsigned long int request, void* const argument)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    auto* const fifo = findFifo(number);
+    if (!fifo)
+        return ENODEV;
+    switch (request) {
+        case NIRIO_IOC_FIFO_SET_BUF: {
+            const auto descriptor = static_cast<ioctl_nirio_fifo_set_buf*>(argument)->fd;
+            unsetBuffer(*fifo);
+            // 0 just unsets it
+            if (descriptor) {
+                struct stat status;
+                if (fstat(descriptor, &status))
+                    return errno;
+                void* const mapped = mmap(NULL,
+                    status.st_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_SHARED,
+                    descriptor,
+                    0);
+                if (mapped == reinterpret_cast<void*>(-1))
+                    return errno;
+                fifo->buffer     = static_cast<uint8_t*>(mapped);
+                fifo->bufferSize = status.st_size;
+                fifo->depth      = fifo->bufferSize / fifo->config.elementBytes;
+            }
+            break;
+        }
+        case NIRIO_IOC_FIFO_START:
+            if (fifo->started)
+                return EALREADY;
+            else if (!fifo->depth)
+                return EINVAL;
+            fifo->started = true;
+            fifo->ready   = fifo->config.targetToHost ? 0 : fifo->depth;
+            fifo->held    = 0;
+            fifo->pending = 0;
+            fifo->head    = 0;
+            fifo->count   = 0;
+            fifo->credit  = 0;
+            fifo->last    = Clock::now();
+            break;
+        case NIRIO_IOC_FIFO_ACQUIRE:
+            return acquire(
+                guard, number, *static_cast<ioctl_nirio_fifo_acquire*>(argument));
+        case NIRIO_IOC_FIFO_RELEASE: {
+            const auto elements = *static_cast<uint64_t*>(argument);
+            if (!fifo->started)
+                return EPERM;
+            else if (elements > fifo->held)
+                return ENODATA;
+            fifo->held -= elements;
+            if (!fifo->config.targetToHost)
+                fifo->pending += elements;
+            advance(*fifo, Clock::now());
+            break;
+        }
+        case NIRIO_IOC_FIFO_GET_AVAIL:
+            if (!fifo->started)
+                return EPERM;
+            advance(*fifo, Clock::now());
+            *static_cast<uint64_t*>(argument) = fifo->ready;
+            break;
+        default:
+            return ENOTTY;
+    }
+    changed.notify_all();
+    return 0;
+}
+
+SimulatedBackend::SimulatedBackend(const std::string& sysfsRoot,
+    const std::string& devRoot,
+    const std::string& dmaHeapRoot)
+    : DeviceBackend(sysfsRoot, devRoot, dmaHeapRoot)
+{
+    const auto rate = getFifoRate();
+    for (const auto& name : getDeviceNames())
+        devices.emplace_back(new SimulatedDevice(name, rate));
+}
+
+int SimulatedBackend::resolve(const std::string& path, Open& open) const
+{
+    open = {Attribute, nullptr, "", -1, 0, false};
+    std::string rest;
+    // heaps first, since they're usually under /dev too
+    if (isUnder(path, getDmaHeapRoot(), rest)) {
+        if (rest.find('/') != std::string::npos)
+            return ENOENT;
+        open.kind      = Heap;
+        open.attribute = rest;
+        return 0;
+    } else if (isUnder(path, getSysfsRoot(), rest)) {
+        const auto slash = rest.find('/');
+        open.device      = findDevice(devices, rest.substr(0, slash), open.fifo);
+        if (slash != std::string::npos)
+            open.attribute = rest.substr(slash + 1);
+        const auto& attributes = open.fifo < 0 ? readableAttributes : fifoAttributes;
+        if (!open.device || !open.device->exists(open.fifo)
+            || (slash != std::string::npos && !attributes.count(open.attribute)
+                && (open.fifo >= 0 || !writableAttributes.count(open.attribute))))
+            return ENOENT;
+        return 0;
+    } else if (isUnder(path, getDevRoot(), rest)
+               && (open.device = findDevice(devices, rest, open.fifo))) {
+        open.kind = open.fifo < 0 ? Board : FifoCdev;
+        return open.device->exists(open.fifo) ? 0 : ENOENT;
+    }
+    return -1;
+}
+
+bool SimulatedBackend::find(const int descriptor, Open& open) const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    const auto found = descriptors.find(descriptor);
+    if (found == descriptors.end())
+        return false;
+    open = found->second;
+    return true;
+}
+
+int SimulatedBackend::open(const std::string& path, const int flags)
+{
+    Open open;
+    const auto resolved = resolve(path, open);
+    if (resolved == -1)
+        return system.open(path, flags);
+    else if (resolved)
+        return fail(resolved);
+
+    int descriptor;
+    switch (open.kind) {
+        case Attribute:
+            if (open.attribute.empty())
+                return fail(EISDIR);
+            descriptor = createMemfd(path, flags);
+            break;
+        case Board:
+            descriptor = open.device->openBoard();
+            break;
+        case FifoCdev:
+            if (const auto error = open.device->openFifo(open.fifo))
+                return fail(error);
+            descriptor = createMemfd(path, flags);
+            if (descriptor == -1) {
+                const auto error = errno;
+                open.device->closeFifo(open.fifo);
+                errno = error;
+            }
+            break;
+        case Heap:
+        default:
+            descriptor = createMemfd(path, flags);
+            break;
+    }
+    if (descriptor != -1) {
+        const std::lock_guard<std::mutex> guard(lock);
+        descriptors[descriptor] = open;
+    }
+    return descriptor;
+}
+
+int SimulatedBackend::close(const int descriptor)
+{
+    Open open;
+    {
+        // forget it before closing it, since the number may be reused as soon
+        // as it's closed
+        const std::lock_guard<std::mutex> guard(lock);
+        const auto found = descriptors.find(descriptor);
+        if (found == descriptors.end())
+            return system.close(descriptor);
+        open = found->second;
+        descriptors.erase(found);
+    }
+    if (open.kind == Board)
+        open.device->closeBoard(open.resetOnClose);
+    else if (open.kind == FifoCdev)
+        open.device->closeFifo(open.fifo);
+    return ::close(descriptor);
+}
+
+ssize_t SimulatedBackend::readAt(
+    const int descriptor, void* const buffer, const size_t size, off_t* const offset)
+{
+    Open open;
+    if (!find(descriptor, open))
+        return offset ? system.pread(descriptor, buffer, size, *offset)
+                      : system.read(descriptor, buffer, size);
+    else if (open.kind != Attribute)
+        return fail(EINVAL);
+
+    std::string value;
+    if (const auto error = open.device->readAttribute(open.attribute, open.fifo, value))
+        return fail(error);
+    const auto start = static_cast<size_t>(offset ? *offset : open.position);
+    const auto count = start < value.size() ? std::min(size, value.size() - start) : 0;
+    memcpy(buffer, value.data() + start, count);
+    if (!offset) {
+        const std::lock_guard<std::mutex> guard(lock);
+        const auto found = descriptors.find(descriptor);
+        if (found != descriptors.end())
+            found->second.position = start + count;
+    }
+    return count;
+}
+
+ssize_t SimulatedBackend::writeAt(const int descriptor,
+    const void* const buffer,
+    const size_t size,
+    off_t* const offset)
+{
+    Open open;
+    if (!find(descriptor, open))
+        return offset ? system.pwrite(descriptor, buffer, size, *offset)
+                      : system.write(descriptor, buffer, size);
+    else if (open.kind != Attribute)
+        return fail(EINVAL);
+
+    // like sysfs, each write is the whole value, wherever it's written
+    const std::string value(static_cast<const char*>(buffer), size);
+    if (const auto error = open.device->writeAttribute(open.attribute, value))
+        return fail(error);
+    return size;
+}
+
+ssize_t SimulatedBackend::read(
+    const int descriptor, void* const buffer, const size_t size)
+{
+    return readAt(descriptor, buffer, size, NULL);
+}
+
+ssize_t SimulatedBackend::write(
+    const int descriptor, const void* const buffer, const size_t size)
+{
+    return writeAt(descriptor, buffer, size, NULL);
+}
+
+ssize_t SimulatedBackend::pread(
+    const int descriptor, void* const buffer, const size_t size, const off_t offset)
+{
+    auto at = offset;
+    return readAt(descriptor, buffer, size, &at);
+}
+
+ssize_t SimulatedBackend::pwrite(const int descriptor,
+    const void* const buffer,
+    const size_t size,
+    const off_t offset)
+{
+    auto at = offset;
+    return writeAt(descriptor, buffer, size, &at);
+}
+
+off_t SimulatedBackend::lseek(const int descriptor, const off_t offset, const int whence)
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    const auto found = descriptors.find(descriptor);
+    if (found == descriptors.end())
+        return system.lseek(descriptor, offset, whence);
+    else if (found->second.kind != Attribute)
+        return fail(ESPIPE);
+
+    auto& position = found->second.position;
+    if (whence == SEEK_SET && offset >= 0)
+        position = offset;
+    else if (whence == SEEK_CUR && position + offset >= 0)
+        position += offset;
+    else
+        return fail(EINVAL);
+    return position;
+}
+
+int SimulatedBackend::ioctl(
+    const int descriptor, const unsigned long int request, void* const argument)
+{
+    Open open;
+    if (!find(descriptor, open))
+        return system.ioctl(descriptor, request, argument);
+
+    int error = ENOTTY;
+    switch (open.kind) {
+        case Heap:
+            if (request == DMA_HEAP_IOCTL_ALLOC) {
+                auto* const allocation = static_cast<dma_heap_allocation_data*>(argument);
+                const auto buffer = createMemfd("dma-buf", allocation->fd_flags);
+                if (buffer == -1 || ftruncate(buffer, allocation->len)) {
+                    error = errno;
+                    if (buffer != -1)
+                        ::close(buffer);
+                    break;
+                }
+                allocation->fd = buffer;
+                error          = 0;
+            }
+            break;
+        case Board: {
+            auto resetOnClose = false;
+            error             = open.device->boardIoctl(request, argument, resetOnClose);
+            if (resetOnClose) {
+                const std::lock_guard<std::mutex> guard(lock);
+                const auto found = descriptors.find(descriptor);
+                if (found != descriptors.end())
+                    found->second.resetOnClose = true;
+            }
+            break;
+        }
+        case FifoCdev:
+            error = open.device->fifoIoctl(open.fifo, request, argument);
+            break;
+        case Attribute:
+        default:
+            break;
+    }
+    return error ? fail(error) : 0;
+}
+
+int SimulatedBackend::stat(const std::string& path, struct stat* const status)
+{
+    Open open;
+    const auto resolved = resolve(path, open);
+    if (resolved == -1)
+        return system.stat(path, status);
+    else if (resolved)
+        return fail(resolved);
+
+    memset(status, 0, sizeof(*status));
+    if (open.kind != Attribute)
+        status->st_mode = S_IFCHR | 0666;
+    else if (open.attribute.empty())
+        status->st_mode = S_IFDIR | 0755;
+    else if (writableAttributes.count(open.attribute))
+        status->st_mode = S_IFREG | 0200;
+    else
+        status->st_mode = S_IFREG | 0444;
+    return 0;
+}
+
+void* SimulatedBackend::mmap(void* const address,
+    const size_t size,
+    const int protection,
+    const int flags,
+    const int descriptor,
+    const off_t offset)
+{
+    // every descriptor is a memfd, which maps like anything else
+    return system.mmap(address, size, protection, flags, descriptor, offset);
+}
+
+int SimulatedBackend::munmap(void* const address, const size_t size)
+{
+    return system.munmap(address, size);
+}
+
+std::unique_ptr<Loader> SimulatedBackend::createLoader()
+{
+    // there's only the one FPGA manager to load through
+    return std::make_unique<SimulatedLoader>(*devices.front());
+}
+
+SimulatedDevice* SimulatedBackend::getDevice(const std::string& name) const
+{
+    for (const auto& device : devices)
+        if (device->getName() == name)
+            return device.get();
+    return nullptr;
+}
+
+} // namespace nirio
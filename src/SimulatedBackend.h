@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "DeviceBackend.h"
+#include <chrono> // std::chrono::steady_clock
+#include <condition_variable> // std::condition_variable
+#include <cstdint> // uint32_t, uint64_t
+#include <map> // std::map
+#include <memory> // std::unique_ptr
+#include <mutex> // std::mutex
+#include <string> // std::string
+#include <vector> // std::vector
+
+struct ioctl_nirio_fifo_acquire;
+
+namespace nirio {
+
+/**
+ * One simulated NI-RIO device, such as "RIO0", as the driver would present it
+ * once firmware has been loaded onto it.
+ *
+ * The BAR is a memfd that sessions map just as they would the real one, so
+ * registers read back whatever was last written to them. Wide registers,
+ * accessed through the array ioctls, are kept apart from it, as the array
+ * engine does, and must be read with the same number of words they were
+ * written with. Target-to-host FIFOs fill their buffers with an incrementing
+ * count, and host-to-target FIFOs drain theirs, either instantly or at a set
+ * number of elements per second.
+ *
+ * Until it's programmed, the device doesn't exist: none of its attributes or
+ * character devices can be found.
+ */
+class SimulatedDevice
+{
+public:
+    /**
+     * A DMA FIFO of the firmware loaded onto the device.
+     */
+    struct FifoConfig
+    {
+        uint32_t number; ///< DMA channel.
+        uint32_t elementBytes; ///< Bytes per element in the buffer.
+        bool targetToHost; ///< Whether the FPGA produces elements.
+    };
+
+    /**
+     * @param name name of the device, such as "RIO0"
+     * @param fifoRate rate FIFOs start out at, in elements per second
+     */
+    explicit SimulatedDevice(const std::string& name, uint64_t fifoRate = 0);
+
+    ~SimulatedDevice();
+
+    const std::string& getName() const;
+
+    /**
+     * Loads firmware, as the loader does once an overlay is applied, aborting
+     * anything that was running and forgetting everything that was written.
+     *
+     * @param signature signature of the firmware, in hex
+     * @param fifos DMA FIFOs of the firmware
+     * @param fpgaSize size of the BAR, in bytes
+     * @param runWhenLoaded whether the VI starts running right away
+     */
+    void program(const std::string& signature,
+        const std::vector<FifoConfig>& fifos,
+        uint32_t fpgaSize,
+        bool runWhenLoaded);
+
+    bool isProgrammed() const;
+
+    std::string getSignature() const;
+
+    bool isStarted() const;
+
+    bool isFinished() const;
+
+    /**
+     * Makes the running VI finish, as if it reached the end of its diagram.
+     */
+    void finish();
+
+    /**
+     * Gets the number of open descriptors of the board's character device.
+     */
+    uint32_t getSessionCount() const;
+
+    /**
+     * Sets how fast a FIFO produces or consumes elements once started.
+     *
+     * @param fifo DMA channel
+     * @param elementsPerSecond rate, or 0 for as fast as there's room
+     */
+    void setFifoRate(uint32_t fifo, uint64_t elementsPerSecond);
+
+    /**
+     * Gets the number of elements a FIFO has produced or consumed in total.
+     */
+    uint64_t getFifoTransferred(uint32_t fifo);
+
+    /**
+     * Asserts IRQs, waking anyone waiting on them until they're acknowledged.
+     */
+    void assertIrqs(uint32_t irqs);
+
+    uint32_t peek(uint32_t offset) const;
+
+    void poke(uint32_t offset, uint32_t value);
+
+private:
+    friend class SimulatedBackend;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Fifo
+    {
+        FifoConfig config;
+        uint64_t rate; ///< Elements per second, or 0 for unlimited.
+        bool open; ///< Whether someone has the character device open.
+        bool started;
+        uint8_t* buffer; ///< Mapped DMA buffer, or NULL if none is set.
+        size_t bufferSize;
+        size_t depth; ///< Elements that fit in the buffer.
+        size_t ready; ///< Elements the host could acquire.
+        size_t held; ///< Elements the host acquired but hasn't released.
+        size_t pending; ///< Host-to-target elements released but not consumed.
+        size_t head; ///< Next element the FPGA will write.
+        uint64_t count; ///< Next value the FPGA will write.
+        uint64_t transferred;
+        double credit; ///< Elements the rate allows to move so far.
+        Clock::time_point last; ///< When the credit was last updated.
+    };
+
+    // called with the lock held
+    Fifo* findFifo(int fifo);
+    void unsetBuffer(Fifo& fifo);
+    void stopFifos();
+    int clearRegisters();
+    void advance(Fifo& fifo, Clock::time_point now);
+    int acquire(std::unique_lock<std::mutex>& guard,
+        int fifo,
+        ioctl_nirio_fifo_acquire& request);
+
+    // called by SimulatedBackend, returning an errno rather than setting it
+    bool exists(int fifo) const;
+    int openBoard();
+    void closeBoard(bool resetOnClose);
+    int openFifo(int fifo);
+    void closeFifo(int fifo);
+    int readAttribute(const std::string& attribute, int fifo, std::string& value);
+    int writeAttribute(const std::string& attribute, const std::string& value);
+    int boardIoctl(unsigned long int request, void* argument, bool& resetOnClose);
+    int fifoIoctl(int fifo, unsigned long int request, void* argument);
+
+    const std::string name;
+    const uint64_t fifoRate;
+    mutable std::mutex lock;
+    std::condition_variable changed; ///< Signaled whenever any state changes.
+    const int bar; ///< memfd holding the registers.
+    bool programmed;
+    std::string signature;
+    uint32_t fpgaSize;
+    bool started;
+    bool finished;
+    uint32_t sessions;
+    std::map<uint32_t, std::vector<uint32_t>> arrays; ///< Wide registers.
+    uint32_t asserted; ///< IRQs asserted and not yet acknowledged.
+    uint64_t nextIrqContext;
+    std::vector<Fifo> fifos;
+
+    SimulatedDevice(const SimulatedDevice&) = delete;
+    SimulatedDevice& operator=(const SimulatedDevice&) = delete;
+};
+
+/**
+ * Simulates the NI-RIO driver and DMA heap in-process, so that the library can
+ * be tested and benchmarked on any Linux host.
+ *
+ * Everything under the sysfs, character device, and DMA heap roots is
+ * simulated; anything else, such as other files under /dev, is passed on to
+ * the system. The devices are named by $NIFPGA_SIMULATOR_DEVICES, a
+ * comma-separated list defaulting to "RIO0", and their FIFOs run at the rate
+ * in $NIFPGA_SIMULATOR_FIFO_RATE, in elements per second, defaulting to as
+ * fast as there's room.
+ *
+ * Descriptors handed out are memfds: the BAR's own for the board, a new buffer
+ * for each DMA heap allocation, and placeholders for everything else, whose
+ * reads, writes, and ioctls are handled here. Attributes never signal
+ * POLLPRI, so anyone waiting on them falls back to polling.
+ *
+ * Loading firmware reads the device tree overlay, compiled or not, and
+ * programs the first device with the signature, BAR size, and FIFOs of the
+ * nirio node in it.
+ */
+class SimulatedBackend : public DeviceBackend
+{
+public:
+    SimulatedBackend(const std::string& sysfsRoot,
+        const std::string& devRoot,
+        const std::string& dmaHeapRoot);
+
+    int open(const std::string& path, int flags) override;
+
+    int close(int descriptor) override;
+
+    ssize_t read(int descriptor, void* buffer, size_t size) override;
+
+    ssize_t write(int descriptor, const void* buffer, size_t size) override;
+
+    ssize_t pread(int descriptor, void* buffer, size_t size, off_t offset) override;
+
+    ssize_t pwrite(
+        int descriptor, const void* buffer, size_t size, off_t offset) override;
+
+    off_t lseek(int descriptor, off_t offset, int whence) override;
+
+    int ioctl(int descriptor, unsigned long int request, void* argument) override;
+
+    int stat(const std::string& path, struct stat* status) override;
+
+    void* mmap(void* address,
+        size_t size,
+        int protection,
+        int flags,
+        int descriptor,
+        off_t offset) override;
+
+    int munmap(void* address, size_t size) override;
+
+    std::unique_ptr<Loader> createLoader() override;
+
+    /**
+     * Gets a simulated device by name.
+     *
+     * @param name name of the device, such as "RIO0"
+     * @return device, or NULL if there's no such device
+     */
+    SimulatedDevice* getDevice(const std::string& name) const;
+
+private:
+    enum Kind { Attribute, Board, FifoCdev, Heap };
+
+    /**
+     * What a simulated descriptor refers to.
+     */
+    struct Open
+    {
+        Kind kind;
+        SimulatedDevice* device;
+        std::string attribute;
+        int fifo; ///< DMA channel, or -1 if not a FIFO's.
+        off_t position; ///< Where read continues from.
+        bool resetOnClose;
+    };
+
+    /**
+     * Works out what a path refers to, if it's one of ours.
+     *
+     * @return 0 if it's simulated, ENOENT if it's ours but doesn't exist, or
+     *         -1 if the system should handle it
+     */
+    int resolve(const std::string& path, Open& open) const;
+
+    bool find(int descriptor, Open& open) const;
+
+    ssize_t readAt(int descriptor, void* buffer, size_t size, off_t* offset);
+    ssize_t writeAt(int descriptor, const void* buffer, size_t size, off_t* offset);
+
+    SystemBackend system;
+    std::vector<std::unique_ptr<SimulatedDevice>> devices;
+    mutable std::mutex lock; ///< Serializes access to descriptors.
+    std::map<int, Open> descriptors;
+};
+
+} // namespace nirio
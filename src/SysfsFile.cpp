@@ -13,31 +13,37 @@
  */
 
 #include "SysfsFile.h"
-#include "Timer.h"
 #include <cstdio> // sscanf
 #define __STDC_FORMAT_MACROS // PRIu32
+#include "DeviceBackend.h"
 #include "Exception.h"
-#include <sched.h> // sched_yield
+#include "PathWaiter.h"
+#include "Timing.h"
+#include <fcntl.h> // O_RDONLY, O_CLOEXEC
 #include <sys/stat.h>
 #include <cinttypes> // PRIu32
-#include <fstream> // std::ifstream
 #include <limits> // std::numeric_limits
 
 namespace nirio {
 
 namespace {
 
-const std::string baseSysfsPath("/sys/class/nirio");
+const std::string& getSysfsRoot()
+{
+    return DeviceBackend::get().getSysfsRoot();
+}
 
 std::string getSubdevicePath(const std::string& device, const std::string& subdevice)
 {
-    return joinPath(baseSysfsPath, (device + subdevice));
+    return joinPath(getSysfsRoot(), (device + subdevice));
 }
 } // unnamed namespace
 
 SysfsFile::SysfsFile(
     const std::string& device, const std::string& attribute, const ErrnoMap& errnoMap)
-    : path(joinPath(baseSysfsPath, device, attribute)), errnoMap(errnoMap)
+    : path(joinPath(getSysfsRoot(), device, attribute))
+    , errnoMap(errnoMap)
+    , staleErrnoMap(errnoMap)
 {
 }
 
@@ -45,12 +51,14 @@ SysfsFile::SysfsFile(const std::string& device,
     const std::string& subdevice,
     const std::string& attribute,
     const ErrnoMap& errnoMap)
-    : path(joinPath(getSubdevicePath(device, subdevice), attribute)), errnoMap(errnoMap)
+    : path(joinPath(getSubdevicePath(device, subdevice), attribute))
+    , errnoMap(errnoMap)
+    , staleErrnoMap(errnoMap)
 {
 }
 
 SysfsFile::SysfsFile(const std::string& path, const ErrnoMap& errnoMap)
-    : path(path), errnoMap(errnoMap)
+    : path(path), errnoMap(errnoMap), staleErrnoMap(errnoMap)
 {
 }
 
@@ -59,22 +67,62 @@ const std::string& SysfsFile::getPath() const
     return path;
 }
 
+template <typename Operation>
+auto SysfsFile::withFile(const DeviceFile::Access access, Operation operation) const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    // try the cached descriptor first, and if the attribute was removed out
+    // from under it (e.g., by hotplug), try one more time on a fresh one
+    for (auto retried = false;; retried = true) {
+        try {
+            if (!file || file->getAccess() != access)
+                file.reset(new DeviceFile(path, access, staleErrnoMap));
+            return operation(*file);
+        } catch (const StaleDescriptor&) {
+            file.reset();
+            if (retried)
+                errnoMap.throwErrno(ENODEV);
+        }
+    }
+}
+
+std::shared_ptr<const DeviceFile> SysfsFile::getFile() const
+{
+    // NOTE: the operation runs under the lock, so the cached file is still
+    //       the one it was given
+    return withFile(DeviceFile::ReadOnly, [this](const DeviceFile&) {
+        return std::shared_ptr<const DeviceFile>(file);
+    });
+}
+
+void SysfsFile::invalidate() const
+{
+    const std::lock_guard<std::mutex> guard(lock);
+    file.reset();
+}
+
+size_t SysfsFile::read(void* const buffer, const size_t size) const
+{
+    const TimingScope timing(NiFpgaEx_TimingStage_SysfsRead);
+    // sysfs attributes are always read in their entirety from the beginning
+    return withFile(DeviceFile::ReadOnly,
+        [=](const DeviceFile& file) { return file.pread(buffer, size, 0); });
+}
+
 bool SysfsFile::readBool() const
 {
-    const DeviceFile file(path, DeviceFile::ReadOnly, errnoMap);
     char buffer = '0';
     // TODO: error if we didn't read 0 or 1?
-    file.read(&buffer, 1);
+    read(&buffer, 1);
     return buffer == '1';
 }
 
 uint32_t SysfsFile::readU32() const
 {
-    const DeviceFile file(path, DeviceFile::ReadOnly, errnoMap);
     // enough room for longest possible uint32_t plus a trailing '\0'
     assert(std::numeric_limits<uint32_t>::max() == 4294967295U);
     char buffer[sizeof("4294967295") + 1] = {};
-    file.read(buffer, sizeof(buffer));
+    read(buffer, sizeof(buffer));
     uint32_t result;
     if (sscanf(buffer, "%" PRIu32, &result) != 1)
         NIRIO_THROW(SoftwareFaultException()); // TODO: better error?
@@ -83,55 +131,61 @@ uint32_t SysfsFile::readU32() const
 
 uint32_t SysfsFile::readU32Hex() const
 {
-    const DeviceFile file(path, DeviceFile::ReadOnly, errnoMap);
-    return nirio::readU32Hex(file);
+    // enough room for longest possible 32bit hex value plus a trailing '\0'
+    char buffer[sizeof("0xffffffff") + 1] = {};
+    read(buffer, sizeof(buffer));
+    uint32_t result;
+    if (sscanf(buffer, "%x", &result) != 1)
+        NIRIO_THROW(SoftwareFaultException());
+    return result;
 }
 
 std::string SysfsFile::readLineNoErrno() const
 {
-    // easy way to get arbitrarily long strings from a file, but doesn't allow
-    // for arbitrary errnos to be returned
+    const TimingScope timing(NiFpgaEx_TimingStage_SysfsRead);
+    // reads arbitrarily long strings from a file, but doesn't allow for
+    // arbitrary errnos to be returned
     //
-    std::ifstream file(path.c_str());
-    if (!file) {
+    auto& backend         = DeviceBackend::get();
+    const auto descriptor = backend.open(path, O_RDONLY | O_CLOEXEC);
+    if (descriptor == -1)
         NIRIO_THROW(ResourceNotFoundException());
-        return std::string();
-    }
     std::string line;
-    std::getline(file, line);
-    if (file.fail() || file.bad())
+    char buffer[256];
+    ssize_t result;
+    while ((result = backend.read(descriptor, buffer, sizeof(buffer))) > 0) {
+        line.append(buffer, result);
+        if (line.find('\n') != std::string::npos)
+            break;
+    }
+    backend.close(descriptor);
+    if (result == -1 || line.empty())
         NIRIO_THROW(SoftwareFaultException()); // TODO: better error?
-    return line;
+    return line.substr(0, line.find('\n'));
 }
 
 void SysfsFile::write(const std::string& value) const
 {
-    const DeviceFile file(path, DeviceFile::WriteOnly, errnoMap);
-    file.write(value.c_str(), value.size());
+    withFile(DeviceFile::WriteOnly, [&](const DeviceFile& file) {
+        return file.pwrite(value.c_str(), value.size(), 0);
+    });
 }
 
 bool SysfsFile::exists() const
 {
     struct stat s;
-    return !::stat(path.c_str(), &s);
+    return !DeviceBackend::get().stat(path, &s);
 }
 
 bool SysfsFile::waitUntilExistence(const bool exists, const size_t milliseconds) const
 {
-    // start the clock
-    const Timer timer(milliseconds);
+    const TimingScope timing(NiFpgaEx_TimingStage_DeviceNode);
+    auto& backend = DeviceBackend::get();
     struct stat s;
-    // try until we timeout
-    do {
-        // return if the path existence is what we wanted
-        if (exists == !::stat(path.c_str(), &s))
-            return true;
-        // NOTE: "In the Linux implementation, sched_yield() always succeeds":
-        //    http://man7.org/linux/man-pages/man2/sched_yield.2.html
-        sched_yield();
-    } while (!timer.isTimedOut());
-    // didn't notice the correct existence in time
-    return false;
+    return waitOnPath(path, static_cast<uint32_t>(milliseconds), [&] {
+        // done if the path existence is what we wanted
+        return exists == !backend.stat(path, &s);
+    });
 }
 
 bool SysfsFile::waitUntilExists(const size_t milliseconds) const
@@ -148,7 +202,7 @@ FifoSysfsFile::FifoSysfsFile(const std::string& device,
     const NiFpgaEx_DmaFifo fifo,
     const std::string& attribute,
     const ErrnoMap& errnoMap)
-    : SysfsFile(baseSysfsPath, errnoMap)
+    : SysfsFile(getSysfsRoot(), errnoMap)
 {
     std::ostringstream temp;
     temp << device << "fifo" << fifo;
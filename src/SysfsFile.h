@@ -17,13 +17,22 @@
 #include "DeviceFile.h"
 #include "ErrnoMap.h"
 #include "Status.h"
+#include <memory> // std::shared_ptr
+#include <mutex> // std::mutex
 #include <sstream> // std::ostringstream
 #include <string> // std::string
 
 namespace nirio {
 
 /**
- * Represents a sysfs attribute under the /sys virtual filesystem.
+ * Represents a sysfs attribute under the /sys virtual filesystem, or wherever
+ * the DeviceBackend keeps them.
+ *
+ * The attribute is opened on first access and the descriptor is kept open, so
+ * that repeated accesses are a single pread or pwrite at offset 0 instead of
+ * an open, read, and close. Call invalidate whenever the attribute may have
+ * been recreated, such as after a download; a descriptor that went stale due
+ * to hotplug is also noticed and reopened automatically.
  */
 class SysfsFile
 {
@@ -44,6 +53,21 @@ public:
 
     const std::string& getPath() const;
 
+    /**
+     * Gets the cached open attribute, opening it for reading if necessary.
+     * This is meant for poll()ing the attribute; it stays open for as long as
+     * the caller holds on to it, even if invalidate is called meanwhile.
+     *
+     * @return open attribute
+     */
+    std::shared_ptr<const DeviceFile> getFile() const;
+
+    /**
+     * Drops the cached descriptor so that the next access reopens the
+     * attribute. It's closed once nobody polling it still holds it.
+     */
+    void invalidate() const;
+
     bool readBool() const;
 
     uint32_t readU32() const;
@@ -100,7 +124,44 @@ private:
      */
     bool waitUntilExistence(bool exists, size_t milliseconds) const;
 
+    /**
+     * Thrown when an operation on the cached descriptor fails because the
+     * attribute behind it was removed.
+     */
+    struct StaleDescriptor
+    {
+    };
+
+    /**
+     * Maps errnos for the cached descriptor, distinguishing a stale
+     * descriptor from other errors, which are passed on to the errno map the
+     * user gave us.
+     */
+    class StaleErrnoMap : public ErrnoMap
+    {
+    public:
+        explicit StaleErrnoMap(const ErrnoMap& next) : next(next) {}
+
+        virtual void throwErrno(const int error) const
+        {
+            if (error == ENODEV)
+                throw StaleDescriptor();
+            next.throwErrno(error);
+        }
+
+    private:
+        const ErrnoMap& next;
+    };
+
+    template <typename Operation>
+    auto withFile(DeviceFile::Access access, Operation operation) const;
+
+    size_t read(void* buffer, size_t size) const;
+
     const ErrnoMap& errnoMap;
+    const StaleErrnoMap staleErrnoMap;
+    mutable std::mutex lock; ///< Serializes use of the cached file.
+    mutable std::shared_ptr<DeviceFile> file; ///< Cached open attribute.
 };
 
 class FifoSysfsFile : public SysfsFile
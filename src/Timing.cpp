@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "Timing.h"
+#include "Probes.h"
+#include <fcntl.h> // open
+#include <sys/utsname.h> // uname
+#include <unistd.h> // write, close
+#include <cstdlib> // getenv
+#include <sstream> // std::ostringstream
+
+namespace nirio {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+thread_local Timings last;
+thread_local bool isRecording = false;
+thread_local TimingScope* innermost = NULL;
+
+const char* const stageNames[] = {
+    "parse",
+    "decode",
+    "write",
+    "verify",
+    "overlay",
+    "load",
+    "device_node",
+    "sysfs_read",
+    "map_memory",
+    "fifos",
+};
+
+static_assert(sizeof(stageNames) / sizeof(stageNames[0]) == NiFpgaEx_TimingStage_Count,
+    "every stage needs a name");
+
+} // unnamed namespace
+
+void Timings::merge(const Timings& other)
+{
+    for (size_t i = 0; i < durations.size(); i++) {
+        durations[i] += other.durations[i];
+        counts[i] += other.counts[i];
+    }
+    if (!other.loader.empty()) {
+        loader      = other.loader;
+        loaderSteps = other.loaderSteps;
+    }
+}
+
+TimingRecorder::TimingRecorder() : start(Clock::now()), finished(false)
+{
+    last        = Timings();
+    isRecording = true;
+}
+
+TimingRecorder::~TimingRecorder()
+{
+    finish();
+}
+
+const Timings& TimingRecorder::finish()
+{
+    if (!finished) {
+        finished    = true;
+        isRecording = false;
+        last.total  = Clock::now() - start;
+    }
+    return last;
+}
+
+Timings* TimingRecorder::getCurrent()
+{
+    return isRecording ? &last : NULL;
+}
+
+const Timings& TimingRecorder::getLast()
+{
+    return last;
+}
+
+TimingScope::TimingScope(const NiFpgaEx_TimingStage stage)
+    : stage(stage)
+    , recording(isRecording)
+    , parent(recording ? innermost : NULL)
+    , nested(0)
+{
+    NIRIO_PROBE(stage_entry, stage, stageNames[stage]);
+    // NOTE: not even reading the clock when not recording keeps this cheap
+    //       enough for sysfs reads made outside of opening a session
+    if (recording) {
+        innermost = this;
+        start     = Clock::now();
+    }
+}
+
+TimingScope::~TimingScope()
+{
+    NIRIO_PROBE(stage_return, stage, stageNames[stage]);
+    if (!recording)
+        return;
+    const auto elapsed = Clock::now() - start;
+    last.durations[stage] += elapsed - nested;
+    last.counts[stage]++;
+    if (parent)
+        parent->nested += elapsed;
+    innermost = parent;
+}
+
+void logTimings(
+    const char* const call, const NiFpga_Status status, const Timings& timings)
+{
+    const char* const destination = getenv("NIFPGA_TIMING_LOG");
+    if (!destination || !*destination)
+        return;
+    std::ostringstream line;
+    line << "{\"call\":\"" << call << "\",\"status\":" << status
+         << ",\"total_ns\":" << timings.total.count() << ",\"stages\":{";
+    for (size_t i = 0; i < timings.durations.size(); i++)
+        line << (i ? "," : "") << "\"" << stageNames[i]
+             << "\":{\"ns\":" << timings.durations[i].count()
+             << ",\"count\":" << timings.counts[i] << "}";
+    line << "}";
+    if (!timings.loader.empty()) {
+        line << ",\"loader\":{\"name\":\"" << timings.loader << "\",\"steps\":{";
+        for (size_t i = 0; i < timings.loaderSteps.size(); i++)
+            line << (i ? "," : "") << "\"" << timings.loaderSteps[i].name
+                 << "\":" << timings.loaderSteps[i].duration.count();
+        line << "}}";
+    }
+    // the driver is built with the kernel, so its release identifies both
+    struct utsname system;
+    if (!uname(&system))
+        line << ",\"kernel\":\"" << system.release << "\"";
+    line << "}\n";
+    const auto text = line.str();
+    // NOTE: one write per line keeps lines from different processes whole
+    if (destination[0] == '/') {
+        const auto descriptor =
+            ::open(destination, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (descriptor >= 0) {
+            if (::write(descriptor, text.data(), text.size()) < 0) {
+                // nowhere left to report it
+            }
+            ::close(descriptor);
+        }
+    } else if (::write(STDERR_FILENO, text.data(), text.size()) < 0) {
+        // nowhere left to report it
+    }
+}
+
+} // namespace nirio
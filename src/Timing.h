@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "NiFpga.h"
+#include <array> // std::array
+#include <chrono> // std::chrono::
+#include <string> // std::string
+#include <vector> // std::vector
+
+namespace nirio {
+
+/**
+ * How long one named step took.
+ */
+struct TimedStep
+{
+    const char* name; ///< Must outlive whatever holds the step.
+    std::chrono::nanoseconds duration;
+};
+
+/**
+ * How long each stage of one call took, summed across every time it happened.
+ */
+struct Timings
+{
+    std::chrono::nanoseconds total{};
+    std::array<std::chrono::nanoseconds, NiFpgaEx_TimingStage_Count> durations{};
+    std::array<uint32_t, NiFpgaEx_TimingStage_Count> counts{};
+    std::string loader; ///< Name of the loader, if anything was loaded.
+    std::vector<TimedStep> loaderSteps;
+
+    /**
+     * Adds the stages of another call, such as the one preparing a bitfile.
+     */
+    void merge(const Timings& other);
+};
+
+/**
+ * Records the stages of the call being made on this thread until finished or
+ * destroyed. Only one can be recording on a thread at a time.
+ */
+class TimingRecorder
+{
+public:
+    TimingRecorder();
+
+    ~TimingRecorder();
+
+    /**
+     * Stops recording.
+     *
+     * @return what was recorded
+     */
+    const Timings& finish();
+
+    /**
+     * Gets what's being recorded on this thread.
+     *
+     * @return timings being recorded, or NULL if not recording
+     */
+    static Timings* getCurrent();
+
+    /**
+     * Gets what was last recorded on this thread.
+     *
+     * @return timings last recorded
+     */
+    static const Timings& getLast();
+
+private:
+    const std::chrono::steady_clock::time_point start;
+    bool finished;
+
+    TimingRecorder(const TimingRecorder&) = delete;
+    TimingRecorder& operator=(const TimingRecorder&) = delete;
+};
+
+/**
+ * Times a stage for as long as it's in scope, if this thread is recording.
+ * Time spent in scopes nested within it counts toward theirs instead.
+ */
+class TimingScope
+{
+public:
+    explicit TimingScope(NiFpgaEx_TimingStage stage);
+
+    ~TimingScope();
+
+private:
+    const NiFpgaEx_TimingStage stage;
+    const bool recording;
+    TimingScope* const parent;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::nanoseconds nested;
+
+    TimingScope(const TimingScope&) = delete;
+    TimingScope& operator=(const TimingScope&) = delete;
+};
+
+/**
+ * Logs the timings of a call as one line of JSON, if $NIFPGA_TIMING_LOG is
+ * set: appended to the file it names if it's an absolute path, or written to
+ * stderr otherwise.
+ *
+ * @param call name of the call
+ * @param status what the call returned
+ * @param timings timings of the call
+ */
+void logTimings(const char* call, NiFpga_Status status, const Timings& timings);
+
+} // namespace nirio
@@ -0,0 +1,744 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "TraceBackend.h"
+#include "Exception.h"
+#include "Loader.h"
+#include "linux/dma-heap.h"
+#include <misc/nirio.h> // NIRIO_IOC_READ_ARRAY, ioctl_nirio_array
+#include <sys/ioctl.h> // _IOC_DIR, _IOC_READ, _IOC_SIZE
+#include <sys/mman.h> // memfd_create, mmap, munmap
+#include <unistd.h> // close, ftruncate
+#include <algorithm> // std::min
+#include <cerrno> // errno
+#include <cstring> // memcpy, memset, strerror
+#include <fstream> // std::ifstream
+#include <iostream> // std::cerr, std::endl
+#include <iterator> // std::istreambuf_iterator
+#include <thread> // std::this_thread::sleep_until
+
+namespace nirio {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char magic[]     = "NIFTRACE";
+const uint64_t version = 1;
+
+const char* const opNames[] = {"open",
+    "close",
+    "read",
+    "write",
+    "pread",
+    "pwrite",
+    "lseek",
+    "ioctl",
+    "stat",
+    "mmap",
+    "munmap"};
+
+uint64_t getNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch())
+        .count();
+}
+
+void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void putSigned(std::string& out, const int64_t value)
+{
+    // zigzag, so that small negative numbers stay small
+    putVarint(out,
+        (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void putString(std::string& out, const std::string& value)
+{
+    putVarint(out, value.size());
+    out += value;
+}
+
+[[noreturn]] void corrupt()
+{
+    std::cerr << "truncated or corrupt trace" << std::endl;
+    NIRIO_THROW(InvalidParameterException());
+}
+
+/**
+ * Reads back what put* wrote, throwing if it runs out.
+ */
+class Decoder
+{
+public:
+    Decoder(const std::string& in, const size_t position) : in(in), position(position)
+    {
+    }
+
+    bool isDone() const
+    {
+        return position == in.size();
+    }
+
+    uint64_t getVarint()
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            if (position == in.size() || shift > 63)
+                corrupt();
+            const auto byte = static_cast<uint8_t>(in[position++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    }
+
+    int64_t getSigned()
+    {
+        const auto value = getVarint();
+        return static_cast<int64_t>((value >> 1) ^ -(value & 1));
+    }
+
+    std::string getString()
+    {
+        const auto size = getVarint();
+        if (size > in.size() - position)
+            corrupt();
+        const auto value = in.substr(position, size);
+        position += size;
+        return value;
+    }
+
+private:
+    const std::string& in;
+    size_t position;
+};
+
+/**
+ * Gets how much of an ioctl's argument the driver fills in.
+ */
+size_t getReturnedSize(const unsigned long int request, const void* const argument)
+{
+    if (!argument || !(_IOC_DIR(request) & _IOC_READ))
+        return 0;
+    // the words of an array follow its header
+    if (request == NIRIO_IOC_READ_ARRAY)
+        return sizeof(ioctl_nirio_array)
+               + static_cast<const ioctl_nirio_array*>(argument)->count
+                     * sizeof(uint32_t);
+    return _IOC_SIZE(request);
+}
+
+void* const mapFailed = reinterpret_cast<void*>(-1);
+
+} // unnamed namespace
+
+TracingBackend::TracingBackend(
+    std::unique_ptr<DeviceBackend> backend, const std::string& path)
+    : DeviceBackend(
+        backend->getSysfsRoot(), backend->getDevRoot(), backend->getDmaHeapRoot())
+    , backend(std::move(backend))
+    , begin(getNanoseconds())
+    , file(fopen(path.c_str(), "we"))
+    , lastStart(0)
+    , nextHandle(1)
+{
+    if (!file) {
+        std::cerr << "couldn't write trace " << path << ": " << strerror(errno)
+                  << std::endl;
+        NIRIO_THROW(InvalidParameterException());
+    }
+    // records are small and many, so write them out in big batches
+    setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+    std::string header(magic, sizeof(magic) - 1);
+    putVarint(header, version);
+    putString(header, getSysfsRoot());
+    putString(header, getDevRoot());
+    putString(header, getDmaHeapRoot());
+    fwrite(header.data(), 1, header.size(), file);
+}
+
+TracingBackend::~TracingBackend()
+{
+    fclose(file);
+}
+
+TracingBackend::Time TracingBackend::now() const
+{
+    return getNanoseconds() - begin;
+}
+
+void TracingBackend::record(TraceRecord& call,
+    const int descriptor,
+    const Time start,
+    const int64_t result,
+    const int error,
+    const int adopted)
+{
+    call.start    = start;
+    call.duration = now() - start;
+    call.result   = result;
+    call.error    = result == -1 ? error : 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (call.op == TraceRecord::Open)
+            call.handle = result == -1 ? 0 : handles[result] = nextHandle++;
+        else {
+            const auto found = handles.find(descriptor);
+            call.handle      = found == handles.end() ? 0 : found->second;
+            // the descriptor is gone even if closing it failed
+            if (call.op == TraceRecord::Close && found != handles.end())
+                handles.erase(found);
+        }
+        if (adopted != -1)
+            call.adopted = handles[adopted] = nextHandle++;
+
+        encoded.clear();
+        putVarint(encoded, call.op);
+        putVarint(encoded, call.handle);
+        // calls return out of order, so this can go backwards
+        putSigned(encoded, static_cast<int64_t>(call.start - lastStart));
+        lastStart = call.start;
+        putVarint(encoded, call.duration);
+        putSigned(encoded, call.result);
+        putSigned(encoded, call.error);
+        putVarint(encoded, call.request);
+        putVarint(encoded, call.size);
+        putSigned(encoded, call.offset);
+        putVarint(encoded, call.adopted);
+        putString(encoded, call.path);
+        putString(encoded, call.data);
+        fwrite(encoded.data(), 1, encoded.size(), file);
+    }
+    errno = error;
+}
+
+int TracingBackend::open(const std::string& path, const int flags)
+{
+    TraceRecord call = {TraceRecord::Open};
+    call.path        = path;
+    call.request     = flags;
+    const auto start = now();
+    const int result = backend->open(path, flags);
+    record(call, -1, start, result, errno);
+    return result;
+}
+
+int TracingBackend::close(const int descriptor)
+{
+    TraceRecord call = {TraceRecord::Close};
+    const auto start = now();
+    const int result = backend->close(descriptor);
+    record(call, descriptor, start, result, errno);
+    return result;
+}
+
+ssize_t TracingBackend::read(const int descriptor, void* const buffer, const size_t size)
+{
+    TraceRecord call  = {TraceRecord::Read};
+    call.size         = size;
+    const auto start  = now();
+    const auto result = backend->read(descriptor, buffer, size);
+    const int error   = errno;
+    if (result > 0)
+        call.data.assign(static_cast<const char*>(buffer), result);
+    record(call, descriptor, start, result, error);
+    return result;
+}
+
+ssize_t TracingBackend::write(
+    const int descriptor, const void* const buffer, const size_t size)
+{
+    TraceRecord call  = {TraceRecord::Write};
+    call.size         = size;
+    const auto start  = now();
+    const auto result = backend->write(descriptor, buffer, size);
+    record(call, descriptor, start, result, errno);
+    return result;
+}
+
+ssize_t TracingBackend::pread(
+    const int descriptor, void* const buffer, const size_t size, const off_t offset)
+{
+    TraceRecord call  = {TraceRecord::Pread};
+    call.size         = size;
+    call.offset       = offset;
+    const auto start  = now();
+    const auto result = backend->pread(descriptor, buffer, size, offset);
+    const int error   = errno;
+    if (result > 0)
+        call.data.assign(static_cast<const char*>(buffer), result);
+    record(call, descriptor, start, result, error);
+    return result;
+}
+
+ssize_t TracingBackend::pwrite(const int descriptor,
+    const void* const buffer,
+    const size_t size,
+    const off_t offset)
+{
+    TraceRecord call  = {TraceRecord::Pwrite};
+    call.size         = size;
+    call.offset       = offset;
+    const auto start  = now();
+    const auto result = backend->pwrite(descriptor, buffer, size, offset);
+    record(call, descriptor, start, result, errno);
+    return result;
+}
+
+off_t TracingBackend::lseek(const int descriptor, const off_t offset, const int whence)
+{
+    TraceRecord call  = {TraceRecord::Lseek};
+    call.request      = whence;
+    call.offset       = offset;
+    const auto start  = now();
+    const auto result = backend->lseek(descriptor, offset, whence);
+    record(call, descriptor, start, result, errno);
+    return result;
+}
+
+int TracingBackend::ioctl(
+    const int descriptor, const unsigned long int request, void* const argument)
+{
+    TraceRecord call = {TraceRecord::Ioctl};
+    call.request     = request;
+    const auto start = now();
+    const int result = backend->ioctl(descriptor, request, argument);
+    const int error  = errno;
+    int adopted      = -1;
+    if (result != -1) {
+        call.data.assign(
+            static_cast<const char*>(argument), getReturnedSize(request, argument));
+        if (request == DMA_HEAP_IOCTL_ALLOC)
+            adopted = static_cast<const dma_heap_allocation_data*>(argument)->fd;
+    }
+    record(call, descriptor, start, result, error, adopted);
+    return result;
+}
+
+int TracingBackend::stat(const std::string& path, struct stat* const status)
+{
+    TraceRecord call = {TraceRecord::Stat};
+    call.path        = path;
+    const auto start = now();
+    const int result = backend->stat(path, status);
+    const int error  = errno;
+    // only the type and size are ever looked at, and the rest varies by
+    // architecture
+    if (!result) {
+        call.request = status->st_mode;
+        call.size    = status->st_size;
+    }
+    record(call, -1, start, result, error);
+    return result;
+}
+
+void* TracingBackend::mmap(void* const address,
+    const size_t size,
+    const int protection,
+    const int flags,
+    const int descriptor,
+    const off_t offset)
+{
+    TraceRecord call = {TraceRecord::Mmap};
+    call.request     = protection;
+    call.size        = size;
+    call.offset      = offset;
+    const auto start = now();
+    void* const result =
+        backend->mmap(address, size, protection, flags, descriptor, offset);
+    const int error = errno;
+    if (result != mapFailed) {
+        std::lock_guard<std::mutex> guard(lock);
+        mappings[result] = descriptor;
+    }
+    record(call, descriptor, start, result == mapFailed ? -1 : 0, error);
+    return result;
+}
+
+int TracingBackend::munmap(void* const address, const size_t size)
+{
+    int descriptor = -1;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const auto found = mappings.find(address);
+        if (found != mappings.end()) {
+            descriptor = found->second;
+            mappings.erase(found);
+        }
+    }
+    TraceRecord call = {TraceRecord::Munmap};
+    call.size        = size;
+    const auto start = now();
+    const int result = backend->munmap(address, size);
+    record(call, descriptor, start, result, errno);
+    return result;
+}
+
+std::unique_ptr<Loader> TracingBackend::createLoader()
+{
+    return backend->createLoader();
+}
+
+ReplayBackend::ReplayBackend(const std::string& path, const bool timed)
+    : ReplayBackend(load(path), timed)
+{
+}
+
+ReplayBackend::ReplayBackend(Trace&& loaded, const bool timed)
+    : DeviceBackend(loaded.sysfsRoot, loaded.devRoot, loaded.dmaHeapRoot)
+    , trace(std::move(loaded))
+    , timed(timed)
+    , faithful(true)
+{
+    for (const auto& record : trace.records) {
+        if (record.op == TraceRecord::Open)
+            opens[record.path].records.push_back(&record);
+        else if (record.op == TraceRecord::Stat)
+            stats[record.path].records.push_back(&record);
+        else if (record.handle)
+            handles[record.handle].records.push_back(&record);
+    }
+}
+
+ReplayBackend::~ReplayBackend()
+{
+    for (const auto& descriptor : live)
+        ::close(descriptor.first);
+}
+
+ReplayBackend::Trace ReplayBackend::load(const std::string& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        std::cerr << "couldn't read trace " << path << std::endl;
+        NIRIO_THROW(InvalidParameterException());
+    }
+    const std::string in(
+        (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    if (in.compare(0, sizeof(magic) - 1, magic))
+        corrupt();
+    Decoder decoder(in, sizeof(magic) - 1);
+    if (decoder.getVarint() != version) {
+        std::cerr << "unsupported trace version" << std::endl;
+        NIRIO_THROW(VersionMismatchException());
+    }
+
+    Trace trace;
+    trace.sysfsRoot   = decoder.getString();
+    trace.devRoot     = decoder.getString();
+    trace.dmaHeapRoot = decoder.getString();
+    uint64_t start    = 0;
+    while (!decoder.isDone()) {
+        TraceRecord record;
+        const auto op = decoder.getVarint();
+        if (op > TraceRecord::Munmap)
+            corrupt();
+        record.op       = static_cast<TraceRecord::Op>(op);
+        record.handle   = static_cast<uint32_t>(decoder.getVarint());
+        start          += decoder.getSigned();
+        record.start    = start;
+        record.duration = decoder.getVarint();
+        record.result   = decoder.getSigned();
+        record.error    = static_cast<int32_t>(decoder.getSigned());
+        record.request  = decoder.getVarint();
+        record.size     = decoder.getVarint();
+        record.offset   = decoder.getSigned();
+        record.adopted  = static_cast<uint32_t>(decoder.getVarint());
+        record.path     = decoder.getString();
+        record.data     = decoder.getString();
+        trace.records.push_back(std::move(record));
+    }
+    return trace;
+}
+
+const TraceRecord* ReplayBackend::matchPath(
+    std::map<std::string, Calls>& calls, const std::string& path)
+{
+    const auto found = calls.find(path);
+    if (found == calls.end())
+        return NULL;
+    auto& list = found->second;
+    // once they run out, the last one repeats
+    const auto* const record =
+        list.records[std::min(list.next, list.records.size() - 1)];
+    if (list.next < list.records.size())
+        ++list.next;
+    return record;
+}
+
+const TraceRecord* ReplayBackend::matchCall(
+    const int descriptor, const TraceRecord::Op op, const uint64_t request)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const auto found = live.find(descriptor);
+    if (found == live.end()) {
+        errno = EBADF;
+        return NULL;
+    }
+    auto& state         = found->second;
+    const auto& records = state.calls->records;
+    for (auto i = state.next; i < records.size(); ++i) {
+        if (records[i]->op == op
+            && (op != TraceRecord::Ioctl || records[i]->request == request)) {
+            state.next = i + 1;
+            return records[i];
+        }
+    }
+    diverged(std::string("no more ") + opNames[op] + " of " + state.path);
+    errno = EIO;
+    return NULL;
+}
+
+int ReplayBackend::adopt(
+    const uint32_t handle, const std::string& path, const size_t size)
+{
+    const int descriptor = memfd_create("nifpga-replay", MFD_CLOEXEC);
+    if (descriptor == -1)
+        return -1;
+    if (size && ftruncate(descriptor, size)) {
+        const int error = errno;
+        ::close(descriptor);
+        errno = error;
+        return -1;
+    }
+    live[descriptor] = {&handles[handle], 0, path};
+    return descriptor;
+}
+
+void ReplayBackend::diverged(const std::string& what)
+{
+    if (faithful)
+        std::cerr << "replay diverged from trace: " << what << std::endl;
+    faithful = false;
+}
+
+int64_t ReplayBackend::finish(
+    const TraceRecord& record, const Clock::time_point start) const
+{
+    if (timed) {
+        const auto deadline = start + std::chrono::nanoseconds(record.duration);
+        // sleeping overshoots by tens of microseconds, so spin out the rest
+        const auto spin = std::chrono::microseconds(100);
+        if (deadline - Clock::now() > spin)
+            std::this_thread::sleep_until(deadline - spin);
+        while (Clock::now() < deadline) {
+        }
+    }
+    errno = record.error;
+    return record.result;
+}
+
+int ReplayBackend::open(const std::string& path, const int)
+{
+    const auto start = Clock::now();
+    const TraceRecord* record;
+    int descriptor = -1;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        record = matchPath(opens, path);
+        if (!record) {
+            diverged("no open of " + path);
+            errno = EIO;
+            return -1;
+        }
+        if (record->result != -1) {
+            descriptor = adopt(record->handle, path, 0);
+            if (descriptor == -1)
+                return -1;
+        }
+    }
+    finish(*record, start);
+    return descriptor;
+}
+
+int ReplayBackend::close(const int descriptor)
+{
+    const auto start   = Clock::now();
+    const auto* record = matchCall(descriptor, TraceRecord::Close);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!live.erase(descriptor))
+            return -1;
+    }
+    ::close(descriptor);
+    return record ? finish(*record, start) : -1;
+}
+
+ssize_t ReplayBackend::read(const int descriptor, void* const buffer, const size_t size)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Read);
+    if (!record)
+        return -1;
+    const auto copied = std::min(size, record->data.size());
+    memcpy(buffer, record->data.data(), copied);
+    const auto result = finish(*record, start);
+    return result > 0 ? static_cast<ssize_t>(copied) : result;
+}
+
+ssize_t ReplayBackend::write(const int descriptor, const void*, const size_t)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Write);
+    return record ? finish(*record, start) : -1;
+}
+
+ssize_t ReplayBackend::pread(
+    const int descriptor, void* const buffer, const size_t size, const off_t)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Pread);
+    if (!record)
+        return -1;
+    const auto copied = std::min(size, record->data.size());
+    memcpy(buffer, record->data.data(), copied);
+    const auto result = finish(*record, start);
+    return result > 0 ? static_cast<ssize_t>(copied) : result;
+}
+
+ssize_t ReplayBackend::pwrite(
+    const int descriptor, const void*, const size_t, const off_t)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Pwrite);
+    return record ? finish(*record, start) : -1;
+}
+
+off_t ReplayBackend::lseek(const int descriptor, const off_t, const int)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Lseek);
+    return record ? finish(*record, start) : -1;
+}
+
+int ReplayBackend::ioctl(
+    const int descriptor, const unsigned long int request, void* const argument)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Ioctl, request);
+    if (!record)
+        return -1;
+    if (record->result != -1 && argument) {
+        memcpy(argument,
+            record->data.data(),
+            std::min(record->data.size(), getReturnedSize(request, argument)));
+        // the DMA buffer the driver handed out becomes one of ours
+        if (record->adopted) {
+            auto* const allocation = static_cast<dma_heap_allocation_data*>(argument);
+            std::lock_guard<std::mutex> guard(lock);
+            const int adopted = adopt(record->adopted, "DMA buffer", allocation->len);
+            if (adopted == -1)
+                return -1;
+            allocation->fd = adopted;
+        }
+    }
+    return finish(*record, start);
+}
+
+int ReplayBackend::stat(const std::string& path, struct stat* const status)
+{
+    const auto start = Clock::now();
+    const TraceRecord* record;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        record = matchPath(stats, path);
+        if (!record) {
+            diverged("no stat of " + path);
+            errno = EIO;
+            return -1;
+        }
+    }
+    if (!record->result) {
+        memset(status, 0, sizeof(*status));
+        status->st_mode = record->request;
+        status->st_size = record->size;
+    }
+    return finish(*record, start);
+}
+
+void* ReplayBackend::mmap(void* const address,
+    const size_t size,
+    const int protection,
+    const int flags,
+    const int descriptor,
+    const off_t offset)
+{
+    const auto start         = Clock::now();
+    const auto* const record = matchCall(descriptor, TraceRecord::Mmap);
+    if (!record)
+        return mapFailed;
+    if (record->result == -1) {
+        finish(*record, start);
+        return mapFailed;
+    }
+    // whatever is mapped has to be backed by the memfd
+    struct stat status;
+    const off_t end = offset + size;
+    if (fstat(descriptor, &status)
+        || (status.st_size < end && ftruncate(descriptor, end)))
+        return mapFailed;
+    void* const mapped = ::mmap(address, size, protection, flags, descriptor, offset);
+    if (mapped == mapFailed)
+        return mapFailed;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        mappings[mapped] = descriptor;
+    }
+    finish(*record, start);
+    return mapped;
+}
+
+int ReplayBackend::munmap(void* const address, const size_t size)
+{
+    const auto start = Clock::now();
+    int descriptor   = -1;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        const auto found = mappings.find(address);
+        if (found != mappings.end()) {
+            descriptor = found->second;
+            mappings.erase(found);
+        }
+    }
+    if (::munmap(address, size))
+        return -1;
+    if (descriptor == -1)
+        return 0;
+    const auto* const record = matchCall(descriptor, TraceRecord::Munmap);
+    return record ? finish(*record, start) : -1;
+}
+
+std::unique_ptr<Loader> ReplayBackend::createLoader()
+{
+    // whatever loading did to the driver is in the trace
+    return std::make_unique<MockLoader>();
+}
+
+bool ReplayBackend::isFaithful() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return faithful;
+}
+
+} // namespace nirio
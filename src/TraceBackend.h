@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "DeviceBackend.h"
+#include <chrono> // std::chrono::steady_clock
+#include <cstdint> // uint32_t, uint64_t, int64_t
+#include <cstdio> // FILE
+#include <map> // std::map
+#include <memory> // std::unique_ptr
+#include <mutex> // std::mutex
+#include <string> // std::string
+#include <vector> // std::vector
+
+namespace nirio {
+
+/**
+ * One call recorded in a trace.
+ *
+ * A trace starts with "NIFTRACE", the format version, and the sysfs, character
+ * device, and DMA heap roots the library was using, followed by one record per
+ * call in the order the calls returned. Every field of every record is written,
+ * as a LEB128 varint (zigzagged if signed) or as a length-prefixed string, so
+ * fields a call doesn't use cost a byte apiece.
+ */
+struct TraceRecord
+{
+    enum Op : uint8_t {
+        Open,
+        Close,
+        Read,
+        Write,
+        Pread,
+        Pwrite,
+        Lseek,
+        Ioctl,
+        Stat,
+        Mmap,
+        Munmap,
+    };
+
+    Op op;
+    /// Descriptor the call was on, numbered from 1 in the order they were
+    /// opened; for Open, the one it opened; 0 if none.
+    uint32_t handle;
+    uint64_t start; ///< When the call was made, in ns since the trace began.
+    uint64_t duration; ///< How long the call took, in ns.
+    int64_t result;
+    int32_t error; ///< errno if the call failed, otherwise 0.
+    /// ioctl request, open flags, lseek whence, mmap protection, or st_mode.
+    uint64_t request;
+    uint64_t size; ///< Size asked to be read, written, or mapped, or st_size.
+    int64_t offset; ///< Offset of pread, pwrite, or lseek.
+    uint32_t adopted; ///< For an ioctl that returned a descriptor, its handle.
+    std::string path; ///< Path opened or stat'ed.
+    std::string data; ///< Bytes read, or the ioctl argument as returned.
+};
+
+/**
+ * Records every call made through another backend to a compact binary trace,
+ * for replaying with ReplayBackend.
+ *
+ * Chosen by setting $NIFPGA_TRACE to the path of the trace, which wraps
+ * whichever backend $NIFPGA_BACKEND chose. Everything the library asks of the
+ * driver is recorded, along with what the driver answered and how long it
+ * took. Written data isn't recorded, and nor are loads and stores to mapped
+ * registers and DMA buffers, which never reach the backend.
+ *
+ * The trace is buffered, and flushed when the process exits normally.
+ */
+class TracingBackend : public DeviceBackend
+{
+public:
+    /**
+     * @param backend backend to record calls to
+     * @param path path of the trace to write, which is truncated
+     */
+    TracingBackend(std::unique_ptr<DeviceBackend> backend, const std::string& path);
+
+    ~TracingBackend() override;
+
+    int open(const std::string& path, int flags) override;
+
+    int close(int descriptor) override;
+
+    ssize_t read(int descriptor, void* buffer, size_t size) override;
+
+    ssize_t write(int descriptor, const void* buffer, size_t size) override;
+
+    ssize_t pread(int descriptor, void* buffer, size_t size, off_t offset) override;
+
+    ssize_t pwrite(
+        int descriptor, const void* buffer, size_t size, off_t offset) override;
+
+    off_t lseek(int descriptor, off_t offset, int whence) override;
+
+    int ioctl(int descriptor, unsigned long int request, void* argument) override;
+
+    int stat(const std::string& path, struct stat* status) override;
+
+    void* mmap(void* address,
+        size_t size,
+        int protection,
+        int flags,
+        int descriptor,
+        off_t offset) override;
+
+    int munmap(void* address, size_t size) override;
+
+    std::unique_ptr<Loader> createLoader() override;
+
+private:
+    typedef uint64_t Time;
+
+    Time now() const;
+
+    /**
+     * Fills in and appends a record of a call on a descriptor that just
+     * returned, numbering any descriptor it opened or that an ioctl adopted,
+     * and restores errno.
+     */
+    void record(TraceRecord& record,
+        int descriptor,
+        Time start,
+        int64_t result,
+        int error,
+        int adopted = -1);
+
+    const std::unique_ptr<DeviceBackend> backend;
+    const Time begin;
+    std::mutex lock; ///< Serializes writing the trace and numbering handles.
+    FILE* const file;
+    std::string encoded; ///< Reused to encode each record.
+    Time lastStart;
+    uint32_t nextHandle;
+    std::map<int, uint32_t> handles; ///< Handles of open descriptors.
+    std::map<const void*, int> mappings; ///< Descriptors of mapped addresses.
+};
+
+/**
+ * Answers calls with the responses recorded in a trace, taking as long as the
+ * driver originally did, so that the rest of the library can be profiled
+ * without hardware.
+ *
+ * Chosen by setting $NIFPGA_BACKEND to "replay" and $NIFPGA_REPLAY to the path
+ * of the trace, and then running the same thing that was traced. The roots are
+ * those the trace was recorded with. Setting $NIFPGA_REPLAY_TIMING to "none"
+ * answers every call right away instead.
+ *
+ * Calls are matched to records by what they're on rather than strictly in
+ * order, since threads may interleave differently: opens and stats by path,
+ * in the order they were recorded for it, and everything else by the call's
+ * descriptor, skipping ahead to the next record of the same kind (and the same
+ * request, for ioctls). Once the recorded opens or stats of a path run out,
+ * the last one is repeated, so polling that goes on longer than it did when
+ * recorded keeps seeing the same thing. A call that can't be matched fails
+ * with EIO, and the first such divergence is reported to stderr.
+ *
+ * Descriptors handed out are memfds, so they can still be mapped and polled;
+ * mapped registers read back whatever the library last wrote to them, and DMA
+ * buffers hold whatever the library left in them.
+ */
+class ReplayBackend : public DeviceBackend
+{
+public:
+    /**
+     * Loads a trace, throwing if it couldn't be read.
+     *
+     * @param path path of the trace
+     * @param timed whether calls take as long as they did when recorded
+     */
+    explicit ReplayBackend(const std::string& path, bool timed = true);
+
+    ~ReplayBackend() override;
+
+    int open(const std::string& path, int flags) override;
+
+    int close(int descriptor) override;
+
+    ssize_t read(int descriptor, void* buffer, size_t size) override;
+
+    ssize_t write(int descriptor, const void* buffer, size_t size) override;
+
+    ssize_t pread(int descriptor, void* buffer, size_t size, off_t offset) override;
+
+    ssize_t pwrite(
+        int descriptor, const void* buffer, size_t size, off_t offset) override;
+
+    off_t lseek(int descriptor, off_t offset, int whence) override;
+
+    int ioctl(int descriptor, unsigned long int request, void* argument) override;
+
+    int stat(const std::string& path, struct stat* status) override;
+
+    void* mmap(void* address,
+        size_t size,
+        int protection,
+        int flags,
+        int descriptor,
+        off_t offset) override;
+
+    int munmap(void* address, size_t size) override;
+
+    std::unique_ptr<Loader> createLoader() override;
+
+    /**
+     * Gets whether every call so far has matched a record.
+     */
+    bool isFaithful() const;
+
+private:
+    struct Trace
+    {
+        std::string sysfsRoot;
+        std::string devRoot;
+        std::string dmaHeapRoot;
+        std::vector<TraceRecord> records;
+    };
+
+    /**
+     * Recorded calls on one handle, or to open or stat one path.
+     */
+    struct Calls
+    {
+        std::vector<const TraceRecord*> records;
+        size_t next; ///< Next record of a path to match.
+    };
+
+    /**
+     * A descriptor handed out, and where it is in its handle's calls.
+     */
+    struct Live
+    {
+        const Calls* calls;
+        size_t next;
+        std::string path; ///< What was opened, for reporting divergence.
+    };
+
+    ReplayBackend(Trace&& trace, bool timed);
+
+    static Trace load(const std::string& path);
+
+    // called with the lock held
+    const TraceRecord* matchPath(std::map<std::string, Calls>& calls,
+        const std::string& path);
+    int adopt(uint32_t handle, const std::string& path, size_t size);
+    void diverged(const std::string& what);
+
+    /**
+     * Matches a call on a descriptor to the next record of it, setting errno
+     * and returning NULL if there isn't one.
+     */
+    const TraceRecord* matchCall(
+        int descriptor, TraceRecord::Op op, uint64_t request = 0);
+
+    /**
+     * Takes as long as the record did, counting from when the call was made,
+     * then returns its result with errno set from it.
+     */
+    int64_t finish(
+        const TraceRecord& record, std::chrono::steady_clock::time_point start) const;
+
+    const Trace trace;
+    const bool timed;
+    mutable std::mutex lock;
+    std::map<uint32_t, Calls> handles;
+    std::map<std::string, Calls> opens;
+    std::map<std::string, Calls> stats;
+    std::map<int, Live> live;
+    std::map<const void*, int> mappings; ///< Descriptors of mapped addresses.
+    bool faithful;
+};
+
+} // namespace nirio
@@ -18,10 +18,36 @@
 namespace nirio {
 
 Type::Type(const size_t logicalBits, const size_t elementBytes, const bool isSigned)
-    : logicalBits(logicalBits), elementBytes(elementBytes), typeIsSigned(isSigned)
+    : logicalBits(logicalBits)
+    , elementBytes(elementBytes)
+    , typeIsSigned(isSigned)
+    , fixedPoint(false)
+    , integerWordLength(0)
+    , overflowStatus(false)
+    , cluster(false)
+    , floatingPoint(false)
 {
 }
 
+FxpType::FxpType(const bool isSigned,
+    const size_t wordLength,
+    const int integerWordLength,
+    const bool overflowStatus)
+    : Type(wordLength + overflowStatus,
+        wordLength + overflowStatus > 32 ? sizeof(uint64_t) : sizeof(uint32_t),
+        isSigned)
+{
+    fixedPoint              = true;
+    this->integerWordLength = integerWordLength;
+    this->overflowStatus    = overflowStatus;
+}
+
+ClusterType::ClusterType(const size_t logicalBits)
+    : Type(logicalBits, (logicalBits + 7) / 8, false)
+{
+    cluster = true;
+}
+
 size_t Type::getLogicalBits() const
 {
     return logicalBits;
@@ -37,10 +63,43 @@ bool Type::isSigned() const
     return typeIsSigned;
 }
 
+bool Type::isFixedPoint() const
+{
+    return fixedPoint;
+}
+
+size_t Type::getWordLength() const
+{
+    return logicalBits - overflowStatus;
+}
+
+int Type::getIntegerWordLength() const
+{
+    return integerWordLength;
+}
+
+bool Type::hasOverflowStatus() const
+{
+    return overflowStatus;
+}
+
+bool Type::isCluster() const
+{
+    return cluster;
+}
+
+bool Type::isFloatingPoint() const
+{
+    return floatingPoint;
+}
+
 bool Type::operator==(const Type& other) const
 {
     return logicalBits == other.logicalBits && elementBytes == other.elementBytes
-           && typeIsSigned == other.typeIsSigned;
+           && typeIsSigned == other.typeIsSigned && fixedPoint == other.fixedPoint
+           && integerWordLength == other.integerWordLength
+           && overflowStatus == other.overflowStatus && cluster == other.cluster
+           && floatingPoint == other.floatingPoint;
 }
 
 bool Type::operator!=(const Type& other) const
@@ -161,6 +220,9 @@ bool isIndicator(const NiFpgaEx_ResourceType type)
         case NiFpgaEx_ResourceType_IndicatorArrayU64:
         case NiFpgaEx_ResourceType_IndicatorArraySgl:
         case NiFpgaEx_ResourceType_IndicatorArrayDbl:
+        case NiFpgaEx_ResourceType_IndicatorFxp:
+        case NiFpgaEx_ResourceType_IndicatorArrayFxp:
+        case NiFpgaEx_ResourceType_IndicatorCluster:
             return true;
         default:
             return false;
@@ -192,6 +254,9 @@ bool isControl(const NiFpgaEx_ResourceType type)
         case NiFpgaEx_ResourceType_ControlArrayU64:
         case NiFpgaEx_ResourceType_ControlArraySgl:
         case NiFpgaEx_ResourceType_ControlArrayDbl:
+        case NiFpgaEx_ResourceType_ControlFxp:
+        case NiFpgaEx_ResourceType_ControlArrayFxp:
+        case NiFpgaEx_ResourceType_ControlCluster:
             return true;
         default:
             return false;
@@ -228,6 +293,8 @@ bool isArray(const NiFpgaEx_ResourceType type)
         case NiFpgaEx_ResourceType_ControlArrayU64:
         case NiFpgaEx_ResourceType_ControlArraySgl:
         case NiFpgaEx_ResourceType_ControlArrayDbl:
+        case NiFpgaEx_ResourceType_IndicatorArrayFxp:
+        case NiFpgaEx_ResourceType_ControlArrayFxp:
             return true;
         default:
             return false;
@@ -248,6 +315,8 @@ bool isTargetToHostFifo(const NiFpgaEx_ResourceType type)
         case NiFpgaEx_ResourceType_TargetToHostFifoU64:
         case NiFpgaEx_ResourceType_TargetToHostFifoSgl:
         case NiFpgaEx_ResourceType_TargetToHostFifoDbl:
+        case NiFpgaEx_ResourceType_TargetToHostFifoFxp:
+        case NiFpgaEx_ResourceType_TargetToHostFifoCluster:
             return true;
         default:
             return false;
@@ -268,6 +337,8 @@ bool isHostToTargetFifo(const NiFpgaEx_ResourceType type)
         case NiFpgaEx_ResourceType_HostToTargetFifoU64:
         case NiFpgaEx_ResourceType_HostToTargetFifoSgl:
         case NiFpgaEx_ResourceType_HostToTargetFifoDbl:
+        case NiFpgaEx_ResourceType_HostToTargetFifoFxp:
+        case NiFpgaEx_ResourceType_HostToTargetFifoCluster:
             return true;
         default:
             return false;
@@ -279,6 +350,34 @@ bool isDmaFifo(const NiFpgaEx_ResourceType type)
     return isTargetToHostFifo(type) || isHostToTargetFifo(type);
 }
 
+bool isFixedPoint(const NiFpgaEx_ResourceType type)
+{
+    switch (type) {
+        case NiFpgaEx_ResourceType_IndicatorFxp:
+        case NiFpgaEx_ResourceType_ControlFxp:
+        case NiFpgaEx_ResourceType_IndicatorArrayFxp:
+        case NiFpgaEx_ResourceType_ControlArrayFxp:
+        case NiFpgaEx_ResourceType_TargetToHostFifoFxp:
+        case NiFpgaEx_ResourceType_HostToTargetFifoFxp:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isCluster(const NiFpgaEx_ResourceType type)
+{
+    switch (type) {
+        case NiFpgaEx_ResourceType_IndicatorCluster:
+        case NiFpgaEx_ResourceType_ControlCluster:
+        case NiFpgaEx_ResourceType_TargetToHostFifoCluster:
+        case NiFpgaEx_ResourceType_HostToTargetFifoCluster:
+            return true;
+        default:
+            return false;
+    }
+}
+
 // TODO: make NiFpgaEx_FindResource support P2P by adding and using these, as
 //       well as adding them to getType above?
 /*
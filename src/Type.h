@@ -15,7 +15,7 @@
 #pragma once
 
 #include "NiFpga.h"
-#include <type_traits> // std::is_signed
+#include <type_traits> // std::is_signed, std::is_floating_point
 
 namespace nirio {
 
@@ -51,6 +51,55 @@ public:
      */
     bool isSigned() const;
 
+    /**
+     * Whether this is a fixed-point type, in which case the word length,
+     * integer word length, and overflow status describe its format.
+     *
+     * @return whether this type is fixed-point
+     */
+    bool isFixedPoint() const;
+
+    /**
+     * The number of bits in the value of a fixed-point type, not including
+     * any overflow status bit. For other types, this is the logical bits.
+     *
+     * @return number of bits in the value
+     */
+    size_t getWordLength() const;
+
+    /**
+     * The number of integer bits in a fixed-point type, which may be negative
+     * or larger than the word length. The value is the word interpreted as an
+     * integer, multiplied by 2^(integerWordLength - wordLength).
+     *
+     * @return number of integer bits, or 0 if not fixed-point
+     */
+    int getIntegerWordLength() const;
+
+    /**
+     * Whether a fixed-point type carries an overflow status bit just above
+     * its most significant value bit.
+     *
+     * @return whether there is an overflow status bit
+     */
+    bool hasOverflowStatus() const;
+
+    /**
+     * Whether this is the type of a whole cluster, whose logical bits are the
+     * sum of its fields' and whose layout is described by a ClusterPlan.
+     *
+     * @return whether this type is a cluster
+     */
+    bool isCluster() const;
+
+    /**
+     * Whether this is Sgl or Dbl, which are otherwise indistinguishable from
+     * I32 and I64.
+     *
+     * @return whether this type is floating point
+     */
+    bool isFloatingPoint() const;
+
     /**
      * Whether two types are exactly the same type.
      *
@@ -72,6 +121,34 @@ protected:
     size_t logicalBits;
     size_t elementBytes;
     bool typeIsSigned; // had to disambiguate name from function and keyword
+    bool fixedPoint;
+    int integerWordLength;
+    bool overflowStatus;
+    bool cluster;
+    bool floatingPoint;
+};
+
+/**
+ * A LabVIEW fixed-point type, whose format is only known at runtime from the
+ * bitfile. Values are transferred as raw integers in the smallest of 32 or 64
+ * bits that fits the word plus any overflow status bit.
+ */
+class FxpType : public Type
+{
+public:
+    FxpType(bool isSigned,
+        size_t wordLength,
+        int integerWordLength,
+        bool overflowStatus);
+};
+
+/**
+ * The type of a whole cluster, which is transferred as one wide register.
+ */
+class ClusterType : public Type
+{
+public:
+    explicit ClusterType(size_t logicalBits);
 };
 
 /**
@@ -109,7 +186,10 @@ public:
      */
     static const bool isSigned = std::is_signed<CType>::value;
 
-    TypeTemplate() : Type(logicalBits, elementBytes, isSigned) {}
+    TypeTemplate() : Type(logicalBits, elementBytes, isSigned)
+    {
+        floatingPoint = std::is_floating_point<CType>::value;
+    }
 };
 
 typedef TypeTemplate<void, 0, 0> UnsupportedType;
@@ -141,4 +221,8 @@ bool isHostToTargetFifo(NiFpgaEx_ResourceType type);
 
 bool isDmaFifo(NiFpgaEx_ResourceType type);
 
+bool isFixedPoint(NiFpgaEx_ResourceType type);
+
+bool isCluster(NiFpgaEx_ResourceType type);
+
 } // namespace nirio
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "ViStateMonitor.h"
+#include "Exception.h"
+#include "Timer.h"
+#include <poll.h> // poll
+#include <algorithm> // std::min
+#include <cerrno> // errno
+
+namespace nirio {
+
+namespace {
+
+// Bounds for the adaptive poll timeout. We start short so that a VI that
+// finishes right away is noticed quickly, and back off to the maximum so a
+// long run costs a handful of wakeups per second even if the driver never
+// notifies the attributes.
+const uint32_t minimumPollTimeout = 1;
+const uint32_t maximumPollTimeout = 100;
+
+} // unnamed namespace
+
+ViStateMonitor::ViStateMonitor(
+    const SysfsFile& startedFile, const SysfsFile& finishedFile)
+    : startedFile(startedFile), finishedFile(finishedFile)
+{
+}
+
+NiFpgaEx_ViState ViStateMonitor::getState() const
+{
+    // check finished first, since a VI that finished may still read started
+    //
+    // NOTE: sysfs attributes must be re-read from the beginning after a
+    //       notification to re-arm POLLPRI, which SysfsFile does for us
+    if (finishedFile.readBool())
+        return NiFpgaEx_ViState_Finished;
+    else if (startedFile.readBool())
+        return NiFpgaEx_ViState_Running;
+    else
+        return NiFpgaEx_ViState_Aborted;
+}
+
+bool ViStateMonitor::waitOnState(
+    const uint32_t states, const uint32_t timeout, NiFpgaEx_ViState& state) const
+{
+    const Timer timer(timeout);
+    auto pollTimeout = minimumPollTimeout;
+    // reading the state before polling also arms the notification
+    state = getState();
+    while (!(state & states)) {
+        const auto remaining = timer.getRemaining();
+        if (remaining == 0)
+            return false;
+
+        // hold on to the attributes while polling them, so that a download
+        // or reset invalidating them meanwhile can't close them under poll()
+        const auto started  = startedFile.getFile();
+        const auto finished = finishedFile.getFile();
+        struct pollfd fds[] = {
+            {started->getDescriptor(), POLLPRI | POLLERR, 0},
+            {finished->getDescriptor(), POLLPRI | POLLERR, 0},
+        };
+        const auto result = ::poll(fds, 2, std::min(pollTimeout, remaining));
+        if (result == -1 && errno != EINTR)
+            ErrnoMap::instance.throwErrno(errno);
+
+        const auto previous = state;
+        state               = getState();
+        // keep reacting quickly while things are changing, and back off while
+        // they aren't
+        if (state != previous)
+            pollTimeout = minimumPollTimeout;
+        else
+            pollTimeout = std::min(pollTimeout * 2, maximumPollTimeout);
+    }
+    return true;
+}
+
+} // namespace nirio
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#pragma once
+
+#include "NiFpga.h"
+#include "SysfsFile.h"
+
+namespace nirio {
+
+/**
+ * Watches the run state of the FPGA VI through the vi_started and
+ * vi_finished sysfs attributes.
+ *
+ * Rather than spinning on the attributes, waiters block in poll() for
+ * POLLPRI, which the kernel raises when the driver calls sysfs_notify on an
+ * attribute. Drivers that don't notify never wake the poll early, so each
+ * poll is also bounded by a timeout that backs off adaptively, which turns
+ * the wait into a cheap periodic check in that case.
+ */
+class ViStateMonitor
+{
+public:
+    /**
+     * @param startedFile the device's vi_started attribute
+     * @param finishedFile the device's vi_finished attribute
+     */
+    ViStateMonitor(const SysfsFile& startedFile, const SysfsFile& finishedFile);
+
+    /**
+     * Reads the current state of the VI.
+     *
+     * @return exactly one NiFpgaEx_ViState
+     */
+    NiFpgaEx_ViState getState() const;
+
+    /**
+     * Waits until the VI is in any of the given states, or for the timeout
+     * to expire.
+     *
+     * @param states bitwise OR of NiFpgaEx_ViStates to wait on
+     * @param timeout timeout in milliseconds, or NiFpga_InfiniteTimeout
+     * @param state outputs the last state observed
+     * @return whether one of the states was observed before the timeout
+     */
+    bool waitOnState(uint32_t states, uint32_t timeout, NiFpgaEx_ViState& state) const;
+
+private:
+    const SysfsFile& startedFile;
+    const SysfsFile& finishedFile;
+
+    ViStateMonitor(const ViStateMonitor&) = delete;
+    ViStateMonitor& operator=(const ViStateMonitor&) = delete;
+};
+
+} // namespace nirio
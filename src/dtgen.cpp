@@ -13,9 +13,26 @@
  */
 
 #include "dtgen.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
 
 namespace dtgen {
 
+// tokens and magic number of the flattened device tree format
+static const uint32_t fdt_magic      = 0xd00dfeed;
+static const uint32_t fdt_begin_node = 0x1;
+static const uint32_t fdt_end_node   = 0x2;
+static const uint32_t fdt_prop       = 0x3;
+static const uint32_t fdt_nop        = 0x4;
+static const uint32_t fdt_end        = 0x9;
+
+// what dtc leaves in a cell referring to a label the overlay doesn't define
+static const uint32_t unresolved_phandle = 0xffffffff;
+
 static std::string indent(int indent)
 {
     std::string s;
@@ -44,47 +61,127 @@ static std::string hexify(unsigned long long val)
     return std::string(tmp);
 }
 
+static void put_cell(std::vector<uint8_t>& bytes, uint32_t value)
+{
+    bytes.push_back(static_cast<uint8_t>(value >> 24));
+    bytes.push_back(static_cast<uint8_t>(value >> 16));
+    bytes.push_back(static_cast<uint8_t>(value >> 8));
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+static void set_cell(std::vector<uint8_t>& bytes, size_t offset, uint32_t value)
+{
+    bytes[offset]     = static_cast<uint8_t>(value >> 24);
+    bytes[offset + 1] = static_cast<uint8_t>(value >> 16);
+    bytes[offset + 2] = static_cast<uint8_t>(value >> 8);
+    bytes[offset + 3] = static_cast<uint8_t>(value);
+}
+
+static uint32_t get_cell(const std::vector<uint8_t>& bytes, size_t offset)
+{
+    if (offset + 4 > bytes.size())
+        throw dt_error("truncated device tree blob");
+    return static_cast<uint32_t>(bytes[offset]) << 24
+           | static_cast<uint32_t>(bytes[offset + 1]) << 16
+           | static_cast<uint32_t>(bytes[offset + 2]) << 8
+           | static_cast<uint32_t>(bytes[offset + 3]);
+}
+
+// renders a flattened value the way dtc decompiles one
+static std::string describe(const std::vector<uint8_t>& value)
+{
+    if (value.empty())
+        return "";
+
+    bool strings = value.front() && !value.back();
+    for (size_t i = 0; strings && i < value.size(); i++)
+        strings = value[i] ? isprint(value[i]) : value[i - 1] != 0;
+
+    std::string s = " = ";
+    if (strings) {
+        for (size_t i = 0; i < value.size();) {
+            const std::string string(reinterpret_cast<const char*>(&value[i]));
+            s += (i ? ", \"" : "\"") + string + "\"";
+            i += string.size() + 1;
+        }
+    } else if (value.size() % 4 == 0) {
+        s += "<";
+        for (size_t i = 0; i < value.size(); i += 4)
+            s += (i ? " 0x" : "0x") + hexify(get_cell(value, i));
+        s += ">";
+    } else {
+        char tmp[4];
+        s += "[";
+        for (size_t i = 0; i < value.size(); i++) {
+            sprintf(tmp, i ? " %02x" : "%02x", value[i]);
+            s += tmp;
+        }
+        s += "]";
+    }
+    return s;
+}
+
 dt_node::dt_node(
     std::string name, std::optional<unsigned long long> unit, std::string label)
-    : name(name), unit(unit), label(label)
+    : name(name), unit(unit)
 {
+    if (!label.empty())
+        labels.push_back(label);
 }
 
 void dt_node::add_property(std::string prop)
 {
-    add_property_(prop + ";");
+    add_property_({prop, "", {}, {}});
 }
 void dt_node::add_property(std::string prop, const char* value)
 {
-    add_property_(prop + " = \"" + std::string(value) + "\";");
+    const auto length = strlen(value);
+    add_property_({prop,
+        " = \"" + std::string(value) + "\"",
+        std::vector<uint8_t>(value, value + length + 1),
+        {}});
 }
 
 void dt_node::add_property(std::string prop, uint32_t value)
 {
-    add_property_(prop + " = <0x" + hexify(value) + ">;");
+    std::vector<uint8_t> bytes;
+    put_cell(bytes, value);
+    add_property_({prop, " = <0x" + hexify(value) + ">", bytes, {}});
 }
 
 void dt_node::add_property(std::string prop, const std::vector<uint32_t>& values)
 {
     std::string s;
+    std::vector<uint8_t> bytes;
 
-    s += prop + " = <";
-    for (uint32_t value : values)
+    s += " = <";
+    for (uint32_t value : values) {
         s += std::string("0x") + hexify(value) + " ";
+        put_cell(bytes, value);
+    }
 
-    s += ">;";
+    s += ">";
 
-    add_property_(s);
+    add_property_({prop, s, bytes, {}});
 }
 
 void dt_node::add_property_phandle(std::string prop, std::string value)
 {
-    add_property_(prop + " = <&" + value + ">;");
+    std::vector<uint8_t> bytes;
+    put_cell(bytes, unresolved_phandle);
+    add_property_({prop, " = <&" + value + ">", bytes, {{0, value}}});
 }
 
-void dt_node::add_property_(std::string prop)
+void dt_node::add_property_(dt_property prop)
 {
-    properties.push_back(prop);
+    // like dtc, a property given again replaces what it was
+    for (auto&& existing : properties) {
+        if (existing.name == prop.name) {
+            existing = std::move(prop);
+            return;
+        }
+    }
+    properties.push_back(std::move(prop));
 }
 
 void dt_node::add_node(std::unique_ptr<dt_node> node)
@@ -96,21 +193,23 @@ std::string dt_node::render(int depth) const
 {
     std::string buf = indent(depth);
 
-    if (!label.empty()) {
+    for (auto&& label : labels) {
         buf += label;
         buf += ": ";
     }
 
-    buf += name;
+    buf += full_name();
+    buf += render_body(depth);
 
-    if (unit) {
-        buf += "@";
-        buf += hexify(*unit);
-    }
-    buf += " {\n";
+    return buf;
+}
+
+std::string dt_node::render_body(int depth) const
+{
+    std::string buf = " {\n";
 
     for (auto&& prop : properties)
-        buf += indent(depth + 1) + prop + "\n";
+        buf += indent(depth + 1) + prop.name + prop.text + ";\n";
 
     for (auto&& node : child_nodes)
         buf += node->render(depth + 1);
@@ -121,4 +220,642 @@ std::string dt_node::render(int depth) const
     return buf;
 }
 
+std::string dt_node::full_name() const
+{
+    return unit ? name + "@" + hexify(*unit) : name;
+}
+
+const dt_node* dt_node::find_node(const std::string& path) const
+{
+    const auto slash = path.find('/');
+    const auto first = path.substr(0, slash);
+    if (first.empty())
+        return slash == std::string::npos ? this : find_node(path.substr(slash + 1));
+    for (auto&& node : child_nodes)
+        if (node->full_name() == first)
+            return slash == std::string::npos ? node.get()
+                                              : node->find_node(path.substr(slash + 1));
+    return nullptr;
+}
+
+const dt_property* dt_node::find_property(const std::string& prop) const
+{
+    for (auto&& existing : properties)
+        if (existing.name == prop)
+            return &existing;
+    return nullptr;
+}
+
+const std::vector<std::unique_ptr<dt_node>>& dt_node::children() const
+{
+    return child_nodes;
+}
+
+std::unique_ptr<dt_node> dt_node::clone() const
+{
+    auto copy        = std::make_unique<dt_node>(name, unit);
+    copy->labels     = labels;
+    copy->properties = properties;
+    for (auto&& node : child_nodes)
+        copy->child_nodes.push_back(node->clone());
+    return copy;
+}
+
+struct dt_tree::parser
+{
+    explicit parser(const std::string& source) : source(source), position(0) {}
+
+    dt_tree parse()
+    {
+        dt_tree tree;
+        for (skip(); position < source.size(); skip()) {
+            if (accept("/dts-v1/")) {
+                expect(";");
+            } else if (accept("/plugin/")) {
+                expect(";");
+                tree.plugin = true;
+            } else if (accept("&")) {
+                auto label = parse_reference();
+                auto node  = std::make_unique<dt_node>("");
+                parse_body(*node);
+                expect(";");
+                tree.orphans.emplace_back(label, std::move(node));
+            } else if (accept("/")) {
+                auto node = std::make_unique<dt_node>("/");
+                parse_body(*node);
+                expect(";");
+                merge(*tree.root, std::move(node));
+            } else {
+                fail("expected a node");
+            }
+        }
+        return tree;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& what) const
+    {
+        const auto line = std::count(source.begin(), source.begin() + position, '\n') + 1;
+        throw dt_error(what + " at line " + std::to_string(line));
+    }
+
+    char peek() const
+    {
+        return position < source.size() ? source[position] : '\0';
+    }
+
+    // skips whitespace and comments
+    void skip()
+    {
+        while (position < source.size()) {
+            if (isspace(source[position])) {
+                position++;
+            } else if (!source.compare(position, 2, "//")) {
+                position = source.find('\n', position);
+            } else if (!source.compare(position, 2, "/*")) {
+                const auto end = source.find("*/", position + 2);
+                if (end == std::string::npos)
+                    fail("unterminated comment");
+                position = end + 2;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool accept(const char* token)
+    {
+        skip();
+        const auto length = strlen(token);
+        if (source.compare(position, length, token))
+            return false;
+        position += length;
+        return true;
+    }
+
+    void expect(const char* token)
+    {
+        if (!accept(token))
+            fail(std::string("expected '") + token + "'");
+    }
+
+    std::string parse_name()
+    {
+        skip();
+        const auto start = position;
+        while (position < source.size()
+               && (isalnum(source[position]) || strchr(",._+*#?@-", source[position])))
+            position++;
+        if (position == start)
+            fail("expected a name");
+        return source.substr(start, position - start);
+    }
+
+    std::string parse_reference()
+    {
+        if (peek() == '{')
+            fail("path references aren't supported");
+        return parse_name();
+    }
+
+    void parse_body(dt_node& node)
+    {
+        expect("{");
+        while (!accept("}")) {
+            std::vector<std::string> labels;
+            auto name = parse_name();
+            while (accept(":")) {
+                labels.push_back(name);
+                name = parse_name();
+            }
+            skip();
+            if (peek() == '{') {
+                auto child    = std::make_unique<dt_node>(name);
+                child->labels = labels;
+                parse_body(*child);
+                expect(";");
+                merge_child(node, std::move(child));
+            } else {
+                // NOTE: labels on properties don't end up in the blob
+                dt_property prop;
+                prop.name = name;
+                if (accept("=")) {
+                    skip();
+                    const auto start = position;
+                    parse_value(prop);
+                    prop.text = " = " + source.substr(start, position - start);
+                }
+                expect(";");
+                node.add_property_(std::move(prop));
+            }
+        }
+    }
+
+    void parse_value(dt_property& prop)
+    {
+        for (;;) {
+            if (accept("\""))
+                parse_string(prop.value);
+            else if (accept("<"))
+                parse_cells(prop);
+            else if (accept("["))
+                parse_bytes(prop.value);
+            else if (peek() == '&')
+                fail("path references aren't supported");
+            else
+                fail("expected a value");
+            // NOTE: look ahead without moving past any trailing space, so
+            //       that it's left out of the text
+            const auto end = position;
+            if (!accept(",")) {
+                position = end;
+                return;
+            }
+        }
+    }
+
+    void parse_string(std::vector<uint8_t>& value)
+    {
+        for (;;) {
+            if (position >= source.size())
+                fail("unterminated string");
+            char c = source[position++];
+            if (c == '"')
+                break;
+            if (c == '\\' && position < source.size()) {
+                c = source[position++];
+                switch (c) {
+                    case 'n':
+                        c = '\n';
+                        break;
+                    case 't':
+                        c = '\t';
+                        break;
+                    case 'r':
+                        c = '\r';
+                        break;
+                    case 'x':
+                    case '0':
+                    case '1':
+                    case '2':
+                    case '3':
+                    case '4':
+                    case '5':
+                    case '6':
+                    case '7': {
+                        const bool hex     = c == 'x';
+                        const auto start   = hex ? position : position - 1;
+                        const auto digits  = hex ? 2 : 3;
+                        const auto literal = source.substr(start, digits);
+                        char* end          = nullptr;
+                        const auto base    = hex ? 16 : 8;
+                        c = static_cast<char>(strtoul(literal.c_str(), &end, base));
+                        position = start + static_cast<size_t>(end - literal.c_str());
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+            value.push_back(static_cast<uint8_t>(c));
+        }
+        value.push_back(0);
+    }
+
+    void parse_cells(dt_property& prop)
+    {
+        while (!accept(">")) {
+            if (accept("&")) {
+                prop.references.emplace_back(prop.value.size(), parse_reference());
+                put_cell(prop.value, unresolved_phandle);
+            } else if (isdigit(peek())) {
+                char* end        = nullptr;
+                const auto value = strtoull(source.c_str() + position, &end, 0);
+                position         = static_cast<size_t>(end - source.c_str());
+                while (peek() == 'U' || peek() == 'L' || peek() == 'u' || peek() == 'l')
+                    position++;
+                if (value > 0xFFFFFFFF)
+                    fail("cell out of range");
+                put_cell(prop.value, static_cast<uint32_t>(value));
+            } else {
+                fail("expressions and macros aren't supported");
+            }
+        }
+    }
+
+    void parse_bytes(std::vector<uint8_t>& value)
+    {
+        while (!accept("]")) {
+            if (position + 1 >= source.size() || !isxdigit(source[position])
+                || !isxdigit(source[position + 1]))
+                fail("expected a byte");
+            const auto byte = source.substr(position, 2);
+            value.push_back(static_cast<uint8_t>(strtoul(byte.c_str(), NULL, 16)));
+            position += 2;
+        }
+    }
+
+    // like dtc, nodes given again add to what was there
+    static void merge(dt_node& into, std::unique_ptr<dt_node> from)
+    {
+        for (auto&& label : from->labels)
+            if (std::count(into.labels.begin(), into.labels.end(), label) == 0)
+                into.labels.push_back(label);
+        for (auto&& prop : from->properties)
+            into.add_property_(std::move(prop));
+        for (auto&& child : from->child_nodes)
+            merge_child(into, std::move(child));
+    }
+
+    static void merge_child(dt_node& parent, std::unique_ptr<dt_node> child)
+    {
+        for (auto&& existing : parent.child_nodes) {
+            if (existing->full_name() == child->full_name()) {
+                merge(*existing, std::move(child));
+                return;
+            }
+        }
+        parent.add_node(std::move(child));
+    }
+
+    const std::string& source;
+    size_t position;
+};
+
+struct dt_tree::flattener
+{
+    explicit flattener(const bool plugin) : plugin(plugin), next_phandle(0) {}
+
+    // assigns phandles and resolves references, recording the ones left for
+    // the kernel to fix up if this is an overlay
+    void resolve(dt_node& root)
+    {
+        walk(root, "/");
+
+        for (auto&& reference : references) {
+            auto& prop        = reference.node->properties[reference.property];
+            const auto target = std::find_if(labeled.begin(),
+                labeled.end(),
+                [&](const label_info& info) { return info.label == reference.label; });
+            const auto location = reference.path + ":" + prop.name + ":"
+                                  + std::to_string(reference.offset);
+            if (target != labeled.end()) {
+                set_cell(prop.value, reference.offset, get_phandle(*target->node));
+                local_fixups.push_back({reference.path, prop.name, reference.offset});
+            } else if (plugin) {
+                set_cell(prop.value, reference.offset, unresolved_phandle);
+                auto fixup = std::find_if(fixups.begin(),
+                    fixups.end(),
+                    [&](const fixup_info& info) {
+                        return info.label == reference.label;
+                    });
+                if (fixup == fixups.end())
+                    fixup = fixups.insert(fixups.end(), {reference.label, {}});
+                fixup->locations.push_back(location);
+            } else {
+                throw dt_error("reference to undefined label " + reference.label);
+            }
+        }
+
+        if (!plugin)
+            return;
+
+        // overlays may be referred to by others, so everything labeled gets a
+        // phandle and a symbol
+        if (!labeled.empty()) {
+            auto symbols = std::make_unique<dt_node>("__symbols__");
+            for (auto&& info : labeled) {
+                get_phandle(*info.node);
+                symbols->add_property(info.label, info.path.c_str());
+            }
+            root.add_node(std::move(symbols));
+        }
+
+        if (!fixups.empty()) {
+            auto node = std::make_unique<dt_node>("__fixups__");
+            for (auto&& fixup : fixups) {
+                dt_property prop;
+                prop.name = fixup.label;
+                for (auto&& location : fixup.locations) {
+                    prop.value.insert(prop.value.end(), location.begin(), location.end());
+                    prop.value.push_back(0);
+                }
+                prop.text = describe(prop.value);
+                node->add_property_(std::move(prop));
+            }
+            root.add_node(std::move(node));
+        }
+
+        if (!local_fixups.empty()) {
+            auto node = std::make_unique<dt_node>("__local_fixups__");
+            for (auto&& fixup : local_fixups) {
+                // mirror the path of the property with the phandle
+                dt_node* parent = node.get();
+                const auto path_size = fixup.path.size();
+                for (size_t start = 1; start < path_size;) {
+                    const auto end  = std::min(fixup.path.find('/', start), path_size);
+                    const auto name = fixup.path.substr(start, end - start);
+                    auto child      = std::find_if(parent->child_nodes.begin(),
+                        parent->child_nodes.end(),
+                        [&](const std::unique_ptr<dt_node>& node) {
+                            return node->name == name;
+                        });
+                    if (child == parent->child_nodes.end())
+                        child = parent->child_nodes.insert(
+                            parent->child_nodes.end(), std::make_unique<dt_node>(name));
+                    parent = child->get();
+                    start  = end + 1;
+                }
+                auto prop = std::find_if(parent->properties.begin(),
+                    parent->properties.end(),
+                    [&](const dt_property& p) { return p.name == fixup.property; });
+                if (prop == parent->properties.end())
+                    prop = parent->properties.insert(
+                        parent->properties.end(), {fixup.property, "", {}, {}});
+                put_cell(prop->value, static_cast<uint32_t>(fixup.offset));
+                prop->text = describe(prop->value);
+            }
+            root.add_node(std::move(node));
+        }
+    }
+
+    std::vector<uint8_t> flatten(const dt_node& root)
+    {
+        write_node(root, "");
+        put_cell(structure, fdt_end);
+
+        // laid out as dtc does: header, empty reserve map, structure, strings
+        const uint32_t header_size   = 40;
+        const uint32_t reserve_size  = 16;
+        const uint32_t structure_off = header_size + reserve_size;
+        const auto structure_size    = static_cast<uint32_t>(structure.size());
+        const auto strings_size      = static_cast<uint32_t>(strings.size());
+        const auto strings_off       = structure_off + structure_size;
+        const auto total_size        = strings_off + strings_size;
+
+        std::vector<uint8_t> blob;
+        blob.reserve(total_size);
+        put_cell(blob, fdt_magic);
+        put_cell(blob, total_size);
+        put_cell(blob, structure_off);
+        put_cell(blob, strings_off);
+        put_cell(blob, header_size);
+        put_cell(blob, 17); // version
+        put_cell(blob, 16); // last compatible version
+        put_cell(blob, 0); // boot CPU
+        put_cell(blob, strings_size);
+        put_cell(blob, structure_size);
+        blob.resize(structure_off, 0);
+        blob.insert(blob.end(), structure.begin(), structure.end());
+        blob.insert(blob.end(), strings.begin(), strings.end());
+        return blob;
+    }
+
+private:
+    struct label_info
+    {
+        std::string label;
+        dt_node* node;
+        std::string path;
+    };
+
+    struct reference_info
+    {
+        dt_node* node;
+        size_t property;
+        size_t offset;
+        std::string label;
+        std::string path;
+    };
+
+    struct fixup_info
+    {
+        std::string label;
+        std::vector<std::string> locations;
+    };
+
+    struct local_fixup_info
+    {
+        std::string path;
+        std::string property;
+        size_t offset;
+    };
+
+    void walk(dt_node& node, const std::string& path)
+    {
+        for (auto&& label : node.labels) {
+            for (auto&& info : labeled)
+                if (info.label == label)
+                    throw dt_error("duplicate label " + label);
+            labeled.push_back({label, &node, path});
+        }
+        for (size_t i = 0; i < node.properties.size(); i++) {
+            const auto& prop = node.properties[i];
+            if (prop.name == "phandle" && prop.value.size() == 4)
+                next_phandle = std::max(next_phandle, get_cell(prop.value, 0));
+            for (auto&& reference : prop.references)
+                references.push_back({&node, i, reference.first, reference.second, path});
+        }
+        for (auto&& child : node.child_nodes)
+            walk(*child, (path == "/" ? path : path + "/") + child->full_name());
+    }
+
+    uint32_t get_phandle(dt_node& node)
+    {
+        if (const auto* prop = node.find_property("phandle"))
+            return get_cell(prop->value, 0);
+        node.add_property("phandle", ++next_phandle);
+        return next_phandle;
+    }
+
+    // like dtc, reuses any earlier name this one is the end of
+    uint32_t string_offset(const std::string& name)
+    {
+        const std::string_view table(
+            reinterpret_cast<const char*>(strings.data()), strings.size());
+        const std::string_view key(name.c_str(), name.size() + 1);
+        const auto found = table.find(key);
+        if (found != std::string_view::npos)
+            return static_cast<uint32_t>(found);
+        const auto offset = strings.size();
+        strings.insert(strings.end(), key.begin(), key.end());
+        return static_cast<uint32_t>(offset);
+    }
+
+    void pad()
+    {
+        while (structure.size() % 4)
+            structure.push_back(0);
+    }
+
+    void write_node(const dt_node& node, const std::string& name)
+    {
+        put_cell(structure, fdt_begin_node);
+        structure.insert(structure.end(), name.begin(), name.end());
+        structure.push_back(0);
+        pad();
+
+        for (auto&& prop : node.properties) {
+            put_cell(structure, fdt_prop);
+            put_cell(structure, static_cast<uint32_t>(prop.value.size()));
+            put_cell(structure, string_offset(prop.name));
+            structure.insert(structure.end(), prop.value.begin(), prop.value.end());
+            pad();
+        }
+
+        for (auto&& child : node.child_nodes)
+            write_node(*child, child->full_name());
+
+        put_cell(structure, fdt_end_node);
+    }
+
+    const bool plugin;
+    uint32_t next_phandle;
+    std::vector<label_info> labeled;
+    std::vector<reference_info> references;
+    std::vector<fixup_info> fixups;
+    std::vector<local_fixup_info> local_fixups;
+    std::vector<uint8_t> structure;
+    std::vector<uint8_t> strings;
+};
+
+dt_tree::dt_tree() : plugin(false), root(std::make_unique<dt_node>("/")) {}
+
+dt_tree dt_tree::parse(const std::string& source)
+{
+    return parser(source).parse();
+}
+
+dt_tree dt_tree::unflatten(const std::vector<uint8_t>& blob)
+{
+    if (blob.size() < 40 || get_cell(blob, 0) != fdt_magic)
+        throw dt_error("not a device tree blob");
+    const auto total_size = get_cell(blob, 4);
+    const auto strings    = get_cell(blob, 12);
+    if (total_size > blob.size() || get_cell(blob, 20) < 16 || strings >= total_size)
+        throw dt_error("unsupported device tree blob");
+
+    const auto get_string = [&](size_t offset) {
+        if (offset >= total_size)
+            throw dt_error("truncated device tree blob");
+        const auto* const begin = reinterpret_cast<const char*>(&blob[offset]);
+        return std::string(begin, strnlen(begin, total_size - offset));
+    };
+    const auto align = [](size_t offset) { return (offset + 3) & ~size_t(3); };
+
+    dt_tree tree;
+    std::vector<dt_node*> nodes;
+    for (size_t offset = get_cell(blob, 8);;) {
+        const auto token = get_cell(blob, offset);
+        offset += 4;
+        if (token == fdt_begin_node) {
+            const auto name = get_string(offset);
+            offset          = align(offset + name.size() + 1);
+            if (nodes.empty()) {
+                nodes.push_back(tree.root.get());
+            } else {
+                nodes.back()->add_node(std::make_unique<dt_node>(name));
+                nodes.push_back(nodes.back()->child_nodes.back().get());
+            }
+        } else if (token == fdt_prop) {
+            const auto size = get_cell(blob, offset);
+            if (nodes.empty() || offset + 8 + size > total_size)
+                throw dt_error("corrupt device tree blob");
+            dt_property prop;
+            prop.name = get_string(strings + get_cell(blob, offset + 4));
+            const auto value = blob.begin() + offset + 8;
+            prop.value.assign(value, value + size);
+            prop.text = describe(prop.value);
+            nodes.back()->properties.push_back(std::move(prop));
+            offset = align(offset + 8 + size);
+        } else if (token == fdt_end_node && !nodes.empty()) {
+            nodes.pop_back();
+        } else if (token == fdt_end && nodes.empty()) {
+            break;
+        } else if (token != fdt_nop) {
+            throw dt_error("corrupt device tree blob");
+        }
+    }
+    return tree;
+}
+
+void dt_tree::add_orphan(std::string label, std::unique_ptr<dt_node> node)
+{
+    orphans.emplace_back(label, std::move(node));
+}
+
+std::string dt_tree::render() const
+{
+    std::string buf = "/dts-v1/;\n";
+    if (plugin)
+        buf += "/plugin/;\n";
+
+    buf += "\n" + root->render(0);
+
+    for (auto&& orphan : orphans)
+        buf += "\n&" + orphan.first + orphan.second->render_body(0);
+
+    return buf;
+}
+
+std::vector<uint8_t> dt_tree::flatten() const
+{
+    auto flat = root->clone();
+
+    // like dtc, each "&label { ... };" becomes a fragment to overlay onto it
+    for (size_t i = 0; i < orphans.size(); i++) {
+        auto overlay  = orphans[i].second->clone();
+        overlay->name = "__overlay__";
+        overlay->unit = std::nullopt;
+        auto fragment = std::make_unique<dt_node>("fragment", i);
+        fragment->add_property_phandle("target", orphans[i].first);
+        fragment->add_node(std::move(overlay));
+        flat->add_node(std::move(fragment));
+    }
+
+    flattener writer(plugin);
+    writer.resolve(*flat);
+    return writer.flatten(*flat);
+}
+
 } // namespace dtgen
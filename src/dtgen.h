@@ -12,14 +12,36 @@
  * Lesser General Public License for more details.
  */
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace dtgen {
 
+/**
+ * Thrown for device tree source that can't be parsed or flattened, including
+ * the parts of the language not supported here, such as macros, expressions,
+ * and path references, for which dtc is still needed.
+ */
+struct dt_error : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct dt_property
+{
+    std::string name;
+    std::string text; ///< Value as written in source, such as " = <0x1>".
+    std::vector<uint8_t> value; ///< Value as flattened.
+    /// Offsets into value of cells holding the phandle of a label.
+    std::vector<std::pair<size_t, std::string>> references;
+};
+
 struct dt_node
 {
     dt_node(std::string name,
@@ -35,14 +57,52 @@ struct dt_node
     void add_node(std::unique_ptr<dt_node> node);
     std::string render(int depth) const;
 
+    std::string full_name() const;
+    const dt_node* find_node(const std::string& path) const;
+    const dt_property* find_property(const std::string& prop) const;
+    const std::vector<std::unique_ptr<dt_node>>& children() const;
+
 private:
-    void add_property_(std::string);
+    friend struct dt_tree;
 
-    const std::string name;
-    const std::optional<unsigned long long> unit;
-    const std::string label;
-    std::vector<std::string> properties;
+    void add_property_(dt_property prop);
+    std::string render_body(int depth) const;
+    std::unique_ptr<dt_node> clone() const;
+
+    std::string name;
+    std::optional<unsigned long long> unit;
+    std::vector<std::string> labels;
+    std::vector<dt_property> properties;
     std::vector<std::unique_ptr<dt_node>> child_nodes;
 };
 
+/**
+ * A whole device tree source file: the root node, and for a plugin, the nodes
+ * to overlay onto labels in the live tree ("&label { ... };").
+ *
+ * Flattening a plugin does what "dtc -@" does: each of those nodes becomes a
+ * fragment, labels are listed in __symbols__, and references to labels are
+ * recorded in __fixups__ or __local_fixups__ for the kernel to resolve when
+ * the overlay is applied.
+ */
+struct dt_tree
+{
+    dt_tree();
+
+    static dt_tree parse(const std::string& source);
+    static dt_tree unflatten(const std::vector<uint8_t>& blob);
+
+    void add_orphan(std::string label, std::unique_ptr<dt_node> node);
+    std::string render() const;
+    std::vector<uint8_t> flatten() const;
+
+    bool plugin;
+    std::unique_ptr<dt_node> root;
+    std::vector<std::pair<std::string, std::unique_ptr<dt_node>>> orphans;
+
+private:
+    struct parser;
+    struct flattener;
+};
+
 } // namespace dtgen
@@ -14,16 +14,200 @@
 
 #include "Bitfile.h"
 #include "DeviceTree.h"
+#include "Exception.h"
+#include "FirmwareCache.h"
+#include "Timing.h"
+#include <dirent.h> // opendir, readdir, closedir
+#include <fcntl.h>
 #include <stdio.h>
+#include <sys/stat.h> // stat
 #include <unistd.h>
-#include <fstream>
+#include <algorithm> // std::min, std::sort
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::
+#include <cstdlib> // strtoul
+#include <cstring> // strcmp
 #include <iostream>
 #include <memory>
+#include <mutex> // std::mutex, std::lock_guard
+#include <string> // std::string
+#include <thread> // std::thread
+#include <vector> // std::vector
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+void usage(const char* const name)
+{
+    fprintf(stderr,
+        "usage: %s <bitfile.lvbitx>\n"
+        "       %s --batch [-j <jobs>] [-o <directory>] <bitfile.lvbitx|directory>...\n",
+        name,
+        name);
+}
+
+uint64_t getFileSize(const std::string& path)
+{
+    struct stat status;
+    return stat(path.c_str(), &status) ? 0 : static_cast<uint64_t>(status.st_size);
+}
+
+/**
+ * Adds a bitfile named on the command line, or every *.lvbitx in a directory.
+ *
+ * @return whether the path could be read
+ */
+bool addBitfiles(const std::string& path, std::vector<std::string>& bitfiles)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status)) {
+        perror(path.c_str());
+        return false;
+    }
+    if (!S_ISDIR(status.st_mode)) {
+        bitfiles.push_back(path);
+        return true;
+    }
+    DIR* const listing = opendir(path.c_str());
+    if (!listing) {
+        perror(path.c_str());
+        return false;
+    }
+    static const std::string extension = ".lvbitx";
+    std::vector<std::string> found;
+    while (const auto* const entry = readdir(listing)) {
+        const std::string name = entry->d_name;
+        if (name.size() > extension.size() && name[0] != '.'
+            && !name.compare(name.size() - extension.size(), extension.size(), extension))
+            found.push_back(path + "/" + name);
+    }
+    closedir(listing);
+    // NOTE: readdir's order is arbitrary, but the output shouldn't be
+    std::sort(found.begin(), found.end());
+    bitfiles.insert(bitfiles.end(), found.begin(), found.end());
+    return true;
+}
+
+double toMilliseconds(const std::chrono::nanoseconds duration)
+{
+    return static_cast<double>(duration.count()) / 1e6;
+}
+
+double toMegabytesPerSecond(const uint64_t bytes, const std::chrono::nanoseconds duration)
+{
+    return duration.count() ? static_cast<double>(bytes) * 1e3 / duration.count() : 0;
+}
+
+/**
+ * Prepares the firmware of many bitfiles at once, as the library would before
+ * loading them, across a pool of workers. Each bitfile's <signature>.bin,
+ * .hash, .dts, and, if it can be compiled here, .dtbo are written to the
+ * output directory, skipping bitstreams already there and intact.
+ */
+int runBatch(const int argc, char** const argv)
+{
+    std::vector<std::string> bitfiles;
+    std::string directory = ".";
+    unsigned jobs         = std::thread::hardware_concurrency();
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            jobs = static_cast<unsigned>(strtoul(argv[++i], NULL, 10));
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            directory = argv[++i];
+        else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else if (!addBitfiles(argv[i], bitfiles))
+            return 1;
+    }
+    if (bitfiles.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    jobs = std::max(1u, std::min(jobs, static_cast<unsigned>(bitfiles.size())));
+
+    const nirio::FirmwareCache cache(directory, 0);
+    std::atomic<size_t> next(0);
+    std::mutex mutex; // guards everything below, and stdout
+    size_t written = 0, reused = 0, failed = 0;
+    uint64_t bitfileBytes = 0, bitstreamBytes = 0;
+    const auto start = Clock::now();
+    const auto work  = [&] {
+        for (size_t i; (i = next++) < bitfiles.size();) {
+            const auto& path = bitfiles[i];
+            nirio::TimingRecorder recorder;
+            int32_t status = NiFpga_Status_Success;
+            std::string signature;
+            uint64_t bitstreamSize = 0;
+            try {
+                const nirio::Bitfile bitfile(path);
+                const auto firmware = cache.prepare(bitfile);
+                signature           = bitfile.getSignature();
+                bitstreamSize       = getFileSize(firmware.bitstreamPath);
+            } catch (const nirio::ExceptionBase& e) {
+                status = e.getCode();
+            } catch (...) {
+                status = NiFpga_Status_SoftwareFault;
+            }
+            const auto& timings = recorder.finish();
+            // nothing was decoded if the bitstream was already there
+            const bool decoded = timings.counts[NiFpgaEx_TimingStage_Decode] > 0;
+            const auto bitfileSize = getFileSize(path);
+
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (status) {
+                failed++;
+                printf("%s: failed with status %d\n", path.c_str(), status);
+                continue;
+            }
+            (decoded ? written : reused)++;
+            bitfileBytes += bitfileSize;
+            if (decoded)
+                bitstreamBytes += bitstreamSize;
+            const auto& durations = timings.durations;
+            printf("%s: %s %s in %.1f ms"
+                   " (parse %.1f, decode %.1f, write %.1f, verify %.1f, overlay %.1f)\n",
+                path.c_str(),
+                signature.c_str(),
+                decoded ? "written" : "up to date",
+                toMilliseconds(timings.total),
+                toMilliseconds(durations[NiFpgaEx_TimingStage_Parse]),
+                toMilliseconds(durations[NiFpgaEx_TimingStage_Decode]),
+                toMilliseconds(durations[NiFpgaEx_TimingStage_Write]),
+                toMilliseconds(durations[NiFpgaEx_TimingStage_Verify]),
+                toMilliseconds(durations[NiFpgaEx_TimingStage_Overlay]));
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < jobs; i++)
+        workers.emplace_back(work);
+    work();
+    for (auto& worker : workers)
+        worker.join();
+    const auto elapsed = Clock::now() - start;
+
+    printf("%zu written, %zu up to date, %zu failed in %.1f ms with %u jobs:"
+           " %.1f MB/s of bitfiles read, %.1f MB/s of bitstreams written\n",
+        written,
+        reused,
+        failed,
+        toMilliseconds(elapsed),
+        jobs,
+        toMegabytesPerSecond(bitfileBytes, elapsed),
+        toMegabytesPerSecond(bitstreamBytes, elapsed));
+    return failed ? 1 : 0;
+}
+
+} // unnamed namespace
 
 int main(int argc, char** argv)
 {
+    if (argc > 1 && !strcmp(argv[1], "--batch"))
+        return runBatch(argc, argv);
+
     if (argc != 2) {
-        fprintf(stderr, "usage: %s <bitfile.lvbitx>\n", argv[0]);
+        usage(argv[0]);
         return 1;
     }
 
@@ -31,11 +215,34 @@ int main(int argc, char** argv)
 
     std::cout << nirio::generateDeviceTree(bitfile) << std::endl;
 
-    auto&& bitstream = bitfile.getBitstream();
-
     const auto bitstreamName = bitfile.getSignature() + ".bin";
-    std::ofstream bitstream_file(bitstreamName);
-    bitstream_file.write(bitstream.data(), bitstream.size());
+    const int bitstream_file =
+        open(bitstreamName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (bitstream_file < 0) {
+        perror(bitstreamName.c_str());
+        return 1;
+    }
+    bitfile.writeBitstream(bitstream_file);
+    close(bitstream_file);
+
+    // NOTE: nothing is written if the bitfile's overlay can only be compiled
+    //       by dtc
+    if (const auto dtbo = nirio::generateCompiledDeviceTree(bitfile)) {
+        const auto overlayName = bitfile.getSignature() + ".dtbo";
+        const int overlay_file =
+            open(overlayName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (overlay_file < 0) {
+            perror(overlayName.c_str());
+            return 1;
+        }
+        if (write(overlay_file, dtbo->data(), dtbo->size())
+            != static_cast<ssize_t>(dtbo->size())) {
+            perror(overlayName.c_str());
+            close(overlay_file);
+            return 1;
+        }
+        close(overlay_file);
+    }
 
     return 0;
 }
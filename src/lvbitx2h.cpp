@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "Bitfile.h"
+#include <stdio.h>
+#include <cctype> // isalnum, isdigit
+#include <iostream>
+#include <map> // std::map
+#include <set> // std::set
+#include <sstream> // std::ostringstream
+#include <string> // std::string
+
+// Generates a C++ header describing every control, indicator, and DMA FIFO of
+// a bitfile for use with NiFpgaTyped.h, so that applications get each
+// resource's offset, type, and signature at compile time instead of looking
+// them up by name at run time.
+
+namespace {
+
+/**
+ * Turns a LabVIEW name, which may contain spaces and punctuation, into a C++
+ * identifier, appending an underscore to keywords and to the names the
+ * generated header itself uses unqualified.
+ */
+std::string toIdentifier(const std::string& name)
+{
+    static const std::set<std::string> reserved = {"alignas", "alignof", "and",
+        "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+        "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const",
+        "consteval", "constexpr", "constinit", "const_cast", "continue", "co_await",
+        "co_return", "co_yield", "decltype", "default", "delete", "do", "double",
+        "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float",
+        "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace",
+        "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq",
+        "private", "protected", "public", "register", "reinterpret_cast", "requires",
+        "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast",
+        "struct", "switch", "template", "this", "thread_local", "throw", "true", "try",
+        "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void",
+        "volatile", "wchar_t", "while", "xor", "xor_eq",
+        // NOTE: a register named either of these would hide what the declarations
+        //       after it in the same namespace refer to
+        "Bitfile", "nifpga"};
+    std::string identifier;
+    for (const char c : name)
+        identifier += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    if (identifier.empty() || std::isdigit(static_cast<unsigned char>(identifier[0])))
+        identifier.insert(0, "_");
+    if (reserved.count(identifier))
+        identifier += '_';
+    return identifier;
+}
+
+/**
+ * Gets the NiFpgaTyped.h element type for a type, or an empty string if it
+ * has none.
+ */
+std::string getTypeName(const nirio::Type& type)
+{
+    if (type.isFixedPoint()) {
+        std::ostringstream name;
+        name << "nifpga::Fxp<" << (type.isSigned() ? "true" : "false") << ", "
+             << type.getWordLength() << ", " << type.getIntegerWordLength() << ", "
+             << (type.hasOverflowStatus() ? "true" : "false") << ">";
+        return name.str();
+    }
+    const struct
+    {
+        nirio::Type type;
+        const char* name;
+    } names[] = {
+        {nirio::Bool(), "Bool"},
+        {nirio::I8(), "I8"},
+        {nirio::U8(), "U8"},
+        {nirio::I16(), "I16"},
+        {nirio::U16(), "U16"},
+        {nirio::I32(), "I32"},
+        {nirio::U32(), "U32"},
+        {nirio::I64(), "I64"},
+        {nirio::U64(), "U64"},
+        {nirio::Sgl(), "Sgl"},
+        {nirio::Dbl(), "Dbl"},
+    };
+    for (const auto& entry : names)
+        if (entry.type == type)
+            return std::string("nifpga::") + entry.name;
+    return std::string();
+}
+
+/**
+ * Collects the declarations for one namespace of the generated header,
+ * keeping identifiers unique since different LabVIEW names can map to the
+ * same one.
+ */
+class Group
+{
+public:
+    /**
+     * Adds a declaration of the form "<before><identifier><after>".
+     */
+    void add(const std::string& name, const std::string& before, const std::string& after)
+    {
+        auto identifier = toIdentifier(name);
+        const auto base = identifier;
+        for (int suffix = 2; !identifiers.insert(identifier).second; suffix++)
+            identifier = base + "_" + std::to_string(suffix);
+        lines << "  " << before << identifier << after << "\n";
+    }
+
+    void skip(const std::string& name)
+    {
+        lines << "  // " << name << ": unsupported type\n";
+    }
+
+    void print(std::ostream& out, const std::string& name) const
+    {
+        if (lines.str().empty())
+            return;
+        out << "namespace " << name << " {\n" << lines.str() << "} // namespace " << name
+            << "\n\n";
+    }
+
+private:
+    std::set<std::string> identifiers;
+    std::ostringstream lines;
+};
+
+std::string hex(const uint32_t value)
+{
+    char buffer[sizeof("0xffffffff")];
+    snprintf(buffer, sizeof(buffer), "0x%x", value);
+    return buffer;
+}
+
+std::string toBool(const bool value)
+{
+    return value ? "true" : "false";
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "usage: %s <bitfile.lvbitx> [namespace]\n", argv[0]);
+        return 1;
+    }
+
+    nirio::Bitfile bitfile(argv[1]);
+
+    // default to the bitfile's name, as the C API generator does
+    std::string name;
+    if (argc == 3)
+        name = argv[2];
+    else {
+        const std::string path = argv[1];
+        const auto slash       = path.find_last_of('/');
+        name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+        name = "NiFpga_" + name.substr(0, name.find('.'));
+    }
+    name = toIdentifier(name);
+
+    std::map<std::string, Group> groups;
+    for (const auto& reg : bitfile.getRegisters()) {
+        const auto kind = std::string(reg.isIndicator() ? "Indicator" : "Control")
+                          + (reg.isArray() ? "Array" : "");
+        const auto& type = reg.getType();
+        if (type.isCluster()) {
+            groups[std::string(reg.isIndicator() ? "Indicator" : "Control") + "Cluster"]
+                .add(reg.getName(),
+                    "constexpr NiFpgaEx_RegisterCluster ",
+                    " = "
+                        + hex((bitfile.getBaseAddressOnDevice() + reg.getOffset())
+                              | (reg.isAccessMayTimeout() ? 1U << 31 : 0))
+                        + ";");
+            continue;
+        }
+        const auto typeName = getTypeName(type);
+        if (typeName.empty()) {
+            groups[kind].skip(reg.getName());
+            continue;
+        }
+        std::ostringstream declaration;
+        if (reg.isArray())
+            declaration << " = nifpga::ArrayRegister<Bitfile, " << typeName
+                        << ", " << hex(reg.getOffset()) << ", " << reg.getSize() << ", "
+                        << toBool(reg.isIndicator()) << ", "
+                        << toBool(reg.isAccessMayTimeout()) << ">;";
+        else
+            declaration << " = nifpga::Register<Bitfile, " << typeName << ", "
+                        << hex(reg.getOffset()) << ", " << toBool(reg.isIndicator())
+                        << ", " << toBool(reg.isAccessMayTimeout()) << ">;";
+        groups[kind].add(reg.getName(), "using ", declaration.str());
+    }
+    for (const auto& fifo : bitfile.getFifos()) {
+        const auto kind =
+            std::string(fifo.isHostToTarget() ? "HostToTarget" : "TargetToHost") + "Fifo";
+        const auto& type = fifo.getType();
+        if (type.isCluster()) {
+            groups[kind + "Cluster"].add(fifo.getName(),
+                "constexpr NiFpgaEx_" + kind + "Cluster ",
+                " = " + std::to_string(fifo.getNumber()) + ";");
+            continue;
+        }
+        const auto typeName = getTypeName(type);
+        if (typeName.empty()) {
+            groups[kind].skip(fifo.getName());
+            continue;
+        }
+        groups[kind].add(fifo.getName(),
+            "using ",
+            " = nifpga::Fifo<Bitfile, " + typeName + ", "
+                + std::to_string(fifo.getNumber()) + ", "
+                + toBool(fifo.isHostToTarget()) + ">;");
+    }
+
+    auto& out = std::cout;
+    out << "/*\n"
+        << " * Generated by lvbitx2h from " << bitfile.getPath() << ".\n"
+        << " * Do not edit; regenerate whenever the bitfile is recompiled.\n"
+        << " */\n\n"
+        << "#pragma once\n\n"
+        << "#include <NiFpgaTyped.h>\n\n"
+        << "namespace " << name << " {\n\n"
+        << "struct Bitfile {\n"
+        << "  static constexpr const char *signature = \"" << bitfile.getSignature()
+        << "\";\n"
+        << "  static constexpr uint32_t baseAddressOnDevice = "
+        << hex(bitfile.getBaseAddressOnDevice()) << ";\n"
+        << "};\n\n";
+    for (const auto& group : groups)
+        group.second.print(out, group.first);
+    out << "} // namespace " << name << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Files, directories, and fixtures shared by the tests.
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// a new directory under /tmp named after a test, or "" if it can't be made
+inline std::string make_temporary_directory(const std::string& name) {
+  std::string path = "/tmp/" + name + ".XXXXXX";
+  return mkdtemp(&path[0]) ? path : "";
+}
+
+// removes a directory and everything in it
+inline bool remove_directory(const std::string& path) {
+  const std::string command = "rm -rf '" + path + "'";
+  return system(command.c_str()) == 0;
+}
+
+inline void write_file(const std::string& path, const std::string& contents) {
+  FILE* file = fopen(path.c_str(), "w");
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+}
+
+// everything in a file, or "" if it can't be read
+inline std::string read_file(const std::string& path) {
+  std::string contents;
+  if (FILE* file = fopen(path.c_str(), "r")) {
+    char buffer[256];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)))
+      contents.append(buffer, size);
+    fclose(file);
+  }
+  return contents;
+}
+
+// base64 of "Hello, bitstream!!"
+static const char* const hello_bitstream = "SGVsbG8sIGJpdHN0cmVhbSEh\n";
+
+// the smallest bitfile that opens, with only the internal registers
+inline std::string make_bitfile(const std::string& signature,
+                                const std::string& bitstream =
+                                    hello_bitstream) {
+  return "<?xml version=\"1.0\"?>\n"
+         "<Bitfile><BitfileVersion>4.0</BitfileVersion>"
+         "<SignatureRegister>" +
+         signature +
+         "</SignatureRegister>"
+         "<BitstreamVersion>2</BitstreamVersion>"
+         "<VI><RegisterList>"
+         "<Register><Name>ViSignature</Name><Offset>0x1fff0</Offset>"
+         "<Internal>true</Internal></Register>"
+         "<Register><Name>ViControl</Name><Offset>0x1fff4</Offset>"
+         "<Internal>true</Internal></Register>"
+         "<Register><Name>DiagramReset</Name><Offset>0x1fff8</Offset>"
+         "<Internal>true</Internal></Register>"
+         "</RegisterList></VI>"
+         "<Project><TargetClass>USRP</TargetClass>"
+         "<AutoRunWhenDownloaded>false</AutoRunWhenDownloaded>"
+         "<CompilationResultsTree><CompilationResults><NiFpga>"
+         "<BaseAddressOnDevice>0x40000</BaseAddressOnDevice>"
+         "<DmaChannelAllocationList></DmaChannelAllocationList>"
+         "</NiFpga></CompilationResults></CompilationResultsTree></Project>"
+         "<Bitstream>" +
+         bitstream +
+         "</Bitstream>"
+         "</Bitfile>\n";
+}
+
+// firmware for the simulated backend: a target-to-host FIFO 0 of 32-bit
+// elements and a host-to-target FIFO 1 of 64-bit elements
+static const char* const simulated_signature =
+    "0123456789ABCDEF0123456789ABCDEF";
+
+static const char* const simulated_overlay =
+    "/dts-v1/;\n"
+    "/plugin/;\n"
+    "\n"
+    "&fpga_full {\n"
+    "\tnirio@1300000000 {\n"
+    "\t\tcompatible = \"ni,rio\";\n"
+    "\t\tsignature = <0x1234567 0x89abcdef 0x1234567 0x89abcdef>;\n"
+    "\t\treg = <0x13 0x0 0x0 0x80000>;\n"
+    "\t\tdma-fifo@0 {\n"
+    "\t\t\tcompatible = \"ni,rio-fifo\";\n"
+    "\t\t\tdma-channel = <0>;\n"
+    "\t\t\tbits-per-element = <32>;\n"
+    "\t\t\tni,target-to-host;\n"
+    "\t\t};\n"
+    "\t\tdma-fifo@1 {\n"
+    "\t\t\tcompatible = \"ni,rio-fifo\";\n"
+    "\t\t\tdma-channel = <1>;\n"
+    "\t\t\tbits-per-element = <64>;\n"
+    "\t\t\tni,host-to-target;\n"
+    "\t\t};\n"
+    "\t};\n"
+    "};\n";
+
+// the overlay of the simulated bitfile, which the library adds the nirio node
+// to, hex-encoded the way bitfiles store it
+inline std::string make_simulated_bitfile_overlay() {
+  static const char source[] = "/dts-v1/;\n"
+                               "/plugin/;\n"
+                               "\n"
+                               "&fpga_full {\n"
+                               "\t#address-cells = <2>;\n"
+                               "\t#size-cells = <2>;\n"
+                               "};\n";
+  std::string hex;
+  for (const char c : std::string(source)) {
+    char digits[3];
+    snprintf(digits, sizeof(digits), "%02x", static_cast<unsigned char>(c));
+    hex += digits;
+  }
+  return hex;
+}
+
+// points the library at a simulated device, keeping everything it writes
+// under root
+inline void use_simulated_backend(const std::string& root) {
+  setenv("NIFPGA_BACKEND", "simulated", 1);
+  setenv("NIFPGA_SYSFS_ROOT", (root + "/sys").c_str(), 1);
+  setenv("NIFPGA_DEV_ROOT", (root + "/dev").c_str(), 1);
+  setenv("NIFPGA_DMA_HEAP_ROOT", (root + "/heap").c_str(), 1);
+  setenv("NIFPGA_FIRMWARE_DIR", root.c_str(), 1);
+  setenv("NIFPGA_BITFILE_CACHE", "", 1);
+}
+
+// a control or indicator of a bitfile
+inline std::string make_register(const std::string& name, const char* offset,
+                                 const bool indicator,
+                                 const bool access_may_timeout,
+                                 const std::string& datatype) {
+  return "<Register><Name>" + name + "</Name><Offset>" + offset +
+         "</Offset><Internal>false</Internal><Indicator>" +
+         (indicator ? "true" : "false") + "</Indicator><AccessMayTimeout>" +
+         (access_may_timeout ? "true" : "false") +
+         "</AccessMayTimeout><Datatype>" + datatype + "</Datatype></Register>";
+}
+
+// a bitfile that opens on the simulated backend, with a register of each
+// kind of access and a FIFO in each direction:
+//
+//   0x18   Count    U32 indicator
+//   0x1c   Rate     SGL control
+//   0x22   Gain     I16 control whose access may time out
+//   0x26   Enable   Boolean control
+//   0x28   Total    U64 indicator
+//   0x100  Samples  array of 256 U32s
+//   0x600  Taps     array of 200 I16s
+//   0x800  Flags    array of 1000 Booleans
+//   0x900  Wave     array of 100 <+-4,12> fixed-point values
+//   0xa00  Record   cluster of a Boolean, a U16, and 40 U32s
+//   FIFO 0 Input    I32s, target to host
+//   FIFO 1 Output   U64s, host to target
+//
+// and an overlay of its own, so that the library compiles it in-process
+inline std::string make_simulated_bitfile(const std::string& registers = "") {
+  const std::string fxp = "<FXP><Signed>true</Signed><WordLength>12"
+                          "</WordLength><IntegerWordLength>4"
+                          "</IntegerWordLength></FXP>";
+  return std::string("<?xml version=\"1.0\"?>\n"
+                     "<Bitfile><BitfileVersion>4.0</BitfileVersion>"
+                     "<SignatureRegister>") +
+         simulated_signature +
+         "</SignatureRegister>"
+         "<BitstreamVersion>2</BitstreamVersion>"
+         "<VI><RegisterList>"
+         "<Register><Name>ViSignature</Name><Offset>0x1fff0</Offset>"
+         "<Internal>true</Internal></Register>"
+         "<Register><Name>ViControl</Name><Offset>0x1fff4</Offset>"
+         "<Internal>true</Internal></Register>"
+         "<Register><Name>DiagramReset</Name><Offset>0x1fff8</Offset>"
+         "<Internal>true</Internal></Register>" +
+         make_register("Count", "0x18", true, false, "<U32/>") +
+         make_register("Rate", "0x1c", false, false, "<SGL/>") +
+         make_register("Gain", "0x22", false, true, "<I16/>") +
+         make_register("Enable", "0x26", false, false, "<Boolean/>") +
+         make_register("Total", "0x28", true, false, "<U64/>") +
+         make_register("Samples", "0x100", false, false,
+                       "<Array><Size>256</Size><Type><U32/></Type></Array>") +
+         make_register("Taps", "0x600", false, false,
+                       "<Array><Size>200</Size><Type><I16/></Type></Array>") +
+         make_register(
+             "Flags", "0x800", false, false,
+             "<Array><Size>1000</Size><Type><Boolean/></Type></Array>") +
+         make_register("Wave", "0x900", false, false,
+                       "<Array><Size>100</Size><Type>" + fxp +
+                           "</Type></Array>") +
+         make_register("Record", "0xa00", false, false,
+                       "<Cluster><TypeList><Boolean/><U16/><Array><Size>40"
+                       "</Size><Type><U32/></Type></Array></TypeList>"
+                       "</Cluster>") +
+         registers +
+         "</RegisterList></VI>"
+         "<Project><TargetClass>USRP-X410 (Embedded)</TargetClass>"
+         "<AutoRunWhenDownloaded>false</AutoRunWhenDownloaded>"
+         "<CompilationResultsTree><CompilationResults><NiFpga>"
+         "<BaseAddressOnDevice>0x40000</BaseAddressOnDevice>"
+         "<DmaChannelAllocationList>"
+         "<Channel name=\"Input\"><Number>0</Number><ControlSet>0</ControlSet>"
+         "<Direction>TargetToHost</Direction>"
+         "<DataType><SubType>I32</SubType></DataType>"
+         "<BaseAddressTag>f0</BaseAddressTag></Channel>"
+         "<Channel name=\"Output\"><Number>1</Number><ControlSet>0</ControlSet>"
+         "<Direction>HostToTarget</Direction>"
+         "<DataType><SubType>U64</SubType></DataType>"
+         "<BaseAddressTag>f1</BaseAddressTag></Channel>"
+         "</DmaChannelAllocationList>"
+         "<RegisterBlockList>"
+         "<RegisterBlock name=\"f0\"><Offset>0x1000</Offset></RegisterBlock>"
+         "<RegisterBlock name=\"f1\"><Offset>0x1100</Offset></RegisterBlock>"
+         "</RegisterBlockList>"
+         "</NiFpga><deviceTreeOverlay>" +
+         make_simulated_bitfile_overlay() +
+         "</deviceTreeOverlay></CompilationResults></CompilationResultsTree>"
+         "</Project><Bitstream></Bitstream></Bitfile>\n";
+}
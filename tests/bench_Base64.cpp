@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Measures Base64Decoder throughput against libb64 on a bitstream-sized
+// payload, decoded in the same 256 KiB blocks as Bitfile::writeBitstream.
+// Build with -DNIRIO_BASE64_SCALAR to compare against the scalar version.
+
+#include "../src/Base64.h"
+#include "../src/libb64/cdecode.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace nirio;
+
+static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const size_t block_size = 256 * 1024;
+
+// keeps the compiler from optimizing away the work
+static volatile uint8_t sink;
+
+template <typename Decode>
+double measure(const std::string& text, std::vector<uint8_t>& out,
+               Decode&& decode) {
+  typedef std::chrono::steady_clock clock;
+  double best = 1e30;
+  for (int run = 0; run < 5; run++) {
+    const auto start = clock::now();
+    decode(text, out);
+    sink = out[0];
+    best = std::min(
+        best,
+        std::chrono::duration<double>(clock::now() - start).count());
+  }
+  return text.size() / best / 1e6;
+}
+
+static void bench(const char* name, const std::string& text) {
+  std::vector<uint8_t> out(block_size);
+
+  typedef std::vector<uint8_t> bytes;
+  const double libb64 =
+      measure(text, out, [](const std::string& text, bytes& out) {
+        base64_decodestate state;
+        base64_init_decodestate(&state);
+        for (size_t offset = 0; offset < text.size(); offset += block_size)
+          base64_decode_block(text.data() + offset,
+                              std::min(block_size, text.size() - offset),
+                              reinterpret_cast<char*>(out.data()), &state);
+      });
+
+  const double decoder =
+      measure(text, out, [](const std::string& text, bytes& out) {
+        Base64Decoder decoder;
+        for (size_t offset = 0; offset < text.size(); offset += block_size)
+          decoder.decode(out.data(), text.data() + offset,
+                         std::min(block_size, text.size() - offset));
+      });
+
+  printf("%-12s libb64 %8.1f MB/s, Base64Decoder %8.1f MB/s (%.1fx)\n", name,
+         libb64, decoder, decoder / libb64);
+}
+
+int main() {
+  // about the size of an X410 bitstream
+  std::string text(40 * 1024 * 1024, 'A');
+  srand(1);
+  for (auto& character : text)
+    character = alphabet[rand() % 64];
+
+  bench("unwrapped", text);
+
+  std::string wrapped;
+  for (size_t i = 0; i < text.size(); i += 76)
+    wrapped += text.substr(i, 76) + "\n";
+  bench("76 per line", wrapped);
+
+  return 0;
+}
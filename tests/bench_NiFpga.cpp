@@ -0,0 +1,527 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Measures the latency of the C API against a bitfile: opening a session,
+// finding resources, reading and writing scalar and array registers of each
+// type, reading and writing each DMA FIFO in chunks of various sizes, and
+// acquiring and releasing FIFO elements. Each is timed call by call and
+// reported as a mean along with the 50th, 99th, and 99.9th percentiles, and
+// FIFO transfers also as a throughput.
+//
+// Runs against real hardware, or against the simulated driver on any Linux
+// box with NIFPGA_BACKEND=simulated (see DeviceBackend.h). Controls are
+// written with the values they already hold, and host-to-target FIFOs with
+// zeros; pass -r to only read. Pass -o to also write the results as JSON,
+// for comparing one run against another.
+//
+//   bench_nifpga [-r] [-n iterations] [-o results.json] [-d RIO0] bitfile
+
+#include "../src/Bitfile.h"
+#include "../src/FifoInfo.h"
+#include "../src/RegisterInfo.h"
+#include "NiFpgaTyped.h"
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef std::chrono::steady_clock bench_clock;
+
+enum kind {
+  indicator,
+  control,
+  indicator_array,
+  control_array,
+  target_to_host,
+  host_to_target
+};
+
+// what the C API calls each element type, for NiFpgaEx_FindResource and
+// zero-copy FIFO access, which NiFpgaTyped.h doesn't cover
+template <typename T> struct traits;
+
+#define BENCH_TYPE(T, First, Stride)                                           \
+  template <> struct traits<nifpga::T> {                                       \
+    typedef nifpga::T::CType C;                                                \
+    static const char *name() { return #T; }                                   \
+    static NiFpgaEx_ResourceType resource_type(kind kind) {                    \
+      return NiFpgaEx_ResourceType(First + kind * Stride);                     \
+    }                                                                          \
+    static NiFpga_Status acquire_read(NiFpga_Session session, uint32_t fifo,   \
+                                      C **elements, size_t requested,          \
+                                      uint32_t timeout, size_t *acquired) {    \
+      return NiFpga_AcquireFifoReadElements##T(session, fifo, elements,        \
+                                               requested, timeout, acquired,   \
+                                               NULL);                          \
+    }                                                                          \
+    static NiFpga_Status acquire_write(NiFpga_Session session, uint32_t fifo,  \
+                                       C **elements, size_t requested,         \
+                                       uint32_t timeout, size_t *acquired) {   \
+      return NiFpga_AcquireFifoWriteElements##T(session, fifo, elements,       \
+                                                requested, timeout, acquired,  \
+                                                NULL);                         \
+    }                                                                          \
+  };
+
+BENCH_TYPE(Bool, 0, 9)
+BENCH_TYPE(I8, 1, 9)
+BENCH_TYPE(U8, 2, 9)
+BENCH_TYPE(I16, 3, 9)
+BENCH_TYPE(U16, 4, 9)
+BENCH_TYPE(I32, 5, 9)
+BENCH_TYPE(U32, 6, 9)
+BENCH_TYPE(I64, 7, 9)
+BENCH_TYPE(U64, 8, 9)
+BENCH_TYPE(Sgl, 54, 1)
+BENCH_TYPE(Dbl, 60, 1)
+
+#undef BENCH_TYPE
+
+// calls visit with the nifpga element type matching a bitfile type, returning
+// false for fixed-point and cluster types, which aren't measured
+template <typename Visit>
+bool visit_type(const nirio::Type &type, Visit &&visit) {
+  if (type.isFixedPoint() || type.isCluster())
+    return false;
+  if (type.isFloatingPoint()) {
+    if (type.getElementBytes() == 4)
+      visit(nifpga::Sgl());
+    else
+      visit(nifpga::Dbl());
+    return true;
+  }
+  const bool is_signed = type.isSigned();
+  switch (type.getLogicalBits()) {
+  case 1:
+    visit(nifpga::Bool());
+    return true;
+  case 8:
+    is_signed ? visit(nifpga::I8()) : visit(nifpga::U8());
+    return true;
+  case 16:
+    is_signed ? visit(nifpga::I16()) : visit(nifpga::U16());
+    return true;
+  case 32:
+    is_signed ? visit(nifpga::I32()) : visit(nifpga::U32());
+    return true;
+  case 64:
+    is_signed ? visit(nifpga::I64()) : visit(nifpga::U64());
+    return true;
+  default:
+    return false;
+  }
+}
+
+struct result {
+  std::string name;
+  std::vector<double> samples; // nanoseconds per call
+  size_t bytes_per_call;       // 0 if not a transfer
+  double mean;
+  double p50;
+  double p99;
+  double p999;
+  double max;
+};
+
+struct bench {
+  NiFpga_Session session;
+  size_t iterations;
+  bool read_only;
+  std::vector<result> results;
+};
+
+// nearest-rank percentile of sorted samples
+double percentile(const std::vector<double> &sorted, double fraction) {
+  const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+  return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+void report(bench &bench, const std::string &name,
+            std::vector<double> &&samples, size_t bytes_per_call = 0) {
+  if (samples.empty())
+    return;
+  result result;
+  result.name = name;
+  result.samples = std::move(samples);
+  result.bytes_per_call = bytes_per_call;
+  std::vector<double> sorted = result.samples;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  for (const auto sample : sorted)
+    total += sample;
+  result.mean = total / sorted.size();
+  result.p50 = percentile(sorted, 0.5);
+  result.p99 = percentile(sorted, 0.99);
+  result.p999 = percentile(sorted, 0.999);
+  result.max = sorted.back();
+  printf("%-44s %7zu %10.0f %10.0f %10.0f %10.0f", result.name.c_str(),
+         result.samples.size(), result.mean, result.p50, result.p99,
+         result.p999);
+  if (bytes_per_call)
+    printf(" %9.1f MB/s", bytes_per_call / result.mean * 1e3);
+  printf("\n");
+  bench.results.push_back(std::move(result));
+}
+
+// times a call until it fails or has run the given number of times, returning
+// false if it failed
+template <typename Call>
+bool measure(bench &bench, const std::string &name, size_t iterations,
+             Call &&call, size_t bytes_per_call = 0) {
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (size_t i = 0; i < iterations; i++) {
+    const auto start = bench_clock::now();
+    const NiFpga_Status status = call();
+    const auto end = bench_clock::now();
+    if (NiFpga_IsError(status)) {
+      fprintf(stderr, "%s: failed with %d, skipping\n", name.c_str(), status);
+      return false;
+    }
+    samples.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  report(bench, name, std::move(samples), bytes_per_call);
+  return true;
+}
+
+void bench_open(bench &bench, const char *bitfile, const char *resource,
+                size_t iterations) {
+  // the session being benchmarked stays open, so the bitfile is already
+  // downloaded and closing never resets the FPGA
+  std::vector<double> opens;
+  std::vector<double> closes;
+  for (size_t i = 0; i < iterations; i++) {
+    NiFpga_Session session;
+    auto start = bench_clock::now();
+    NiFpga_Status status = NiFpga_Open(bitfile, NULL, resource, 0, &session);
+    auto end = bench_clock::now();
+    if (NiFpga_IsError(status)) {
+      fprintf(stderr, "open: failed with %d, skipping\n", status);
+      return;
+    }
+    opens.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+    start = bench_clock::now();
+    status = NiFpga_Close(session, NiFpga_CloseAttribute_NoResetIfLastSession);
+    end = bench_clock::now();
+    closes.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  report(bench, "open", std::move(opens));
+  report(bench, "close", std::move(closes));
+}
+
+struct named_resource {
+  std::string name;
+  NiFpgaEx_ResourceType type;
+};
+
+void bench_find_resource(bench &bench,
+                         const std::vector<named_resource> &resources) {
+  if (resources.empty())
+    return;
+  size_t next = 0;
+  measure(bench, "find_resource", bench.iterations, [&] {
+    const auto &resource = resources[next++ % resources.size()];
+    NiFpgaEx_Resource found;
+    return NiFpgaEx_FindResource(bench.session, resource.name.c_str(),
+                                 resource.type, &found);
+  });
+}
+
+template <typename T>
+void bench_register(bench &bench, const nirio::RegisterInfo &info,
+                    uint32_t reg) {
+  typedef typename T::CType C;
+  const std::string suffix =
+      std::string("/") + traits<T>::name() + "/" + info.getName();
+  C value = C();
+  measure(bench, "read_register" + suffix, bench.iterations,
+          [&] { return T::read(bench.session, reg, &value); });
+  if (info.isControl() && !bench.read_only)
+    measure(bench, "write_register" + suffix, bench.iterations,
+            [&] { return T::write(bench.session, reg, value); });
+}
+
+template <typename T>
+void bench_array_register(bench &bench, const nirio::RegisterInfo &info,
+                          uint32_t reg) {
+  typedef typename T::CType C;
+  const std::string suffix = std::string("/") + traits<T>::name() + "[" +
+                             std::to_string(info.getSize()) + "]/" +
+                             info.getName();
+  std::vector<C> array(info.getSize());
+  measure(bench, "read_array_register" + suffix, bench.iterations, [&] {
+    return T::readArray(bench.session, reg, array.data(), array.size());
+  });
+  if (info.isControl() && !bench.read_only)
+    measure(bench, "write_array_register" + suffix, bench.iterations, [&] {
+      return T::writeArray(bench.session, reg, array.data(), array.size());
+    });
+}
+
+const size_t chunks[] = {1, 16, 256, 4096, 65536};
+
+// how much is transferred at each chunk size, so that small chunks get enough
+// calls to be worth measuring and large ones don't take forever
+const size_t bytes_per_chunk_size = 64 * 1024 * 1024;
+
+template <typename T>
+void bench_fifo(bench &bench, const nirio::FifoInfo &info, uint32_t fifo,
+                size_t depth) {
+  typedef typename T::CType C;
+  const bool reading = info.isTargetToHost();
+  if (!reading && bench.read_only)
+    return;
+  const uint32_t timeout = 1000;
+  const std::string suffix =
+      std::string("/") + traits<T>::name() + "/" + info.getName() + "/";
+  std::vector<C> buffer(depth);
+  for (const auto chunk : chunks) {
+    if (chunk > depth / 2)
+      break;
+    const size_t iterations = std::min(
+        bench.iterations,
+        std::max<size_t>(16, bytes_per_chunk_size / (chunk * sizeof(C))));
+    const bool transferred =
+        reading
+            ? measure(
+                  bench, "read_fifo" + suffix + std::to_string(chunk),
+                  iterations,
+                  [&] {
+                    return T::readFifo(bench.session, fifo, buffer.data(),
+                                       chunk, timeout, NULL);
+                  },
+                  chunk * sizeof(C))
+            : measure(
+                  bench, "write_fifo" + suffix + std::to_string(chunk),
+                  iterations,
+                  [&] {
+                    return T::writeFifo(bench.session, fifo, buffer.data(),
+                                        chunk, timeout, NULL);
+                  },
+                  chunk * sizeof(C));
+    if (!transferred)
+      return;
+    const bool acquired = measure(
+        bench, "acquire_release" + suffix + std::to_string(chunk), iterations,
+        [&] {
+          C *elements;
+          size_t count;
+          const NiFpga_Status status =
+              reading ? traits<T>::acquire_read(bench.session, fifo,
+                                                &elements, chunk, timeout,
+                                                &count)
+                      : traits<T>::acquire_write(bench.session, fifo,
+                                                 &elements, chunk, timeout,
+                                                 &count);
+          if (NiFpga_IsError(status))
+            return status;
+          return NiFpga_ReleaseFifoElements(bench.session, fifo, count);
+        },
+        chunk * sizeof(C));
+    if (!acquired)
+      return;
+  }
+}
+
+std::string escape(const std::string &text) {
+  std::string escaped;
+  for (const char character : text) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+      escaped += character;
+    } else if (static_cast<unsigned char>(character) < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", character);
+      escaped += code;
+    } else
+      escaped += character;
+  }
+  return escaped;
+}
+
+bool write_json(const bench &bench, const char *path, const char *bitfile,
+                const char *resource) {
+  FILE *const file = fopen(path, "w");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  const char *const backend = getenv("NIFPGA_BACKEND");
+  fprintf(file, "{\n");
+  fprintf(file, "  \"bitfile\": \"%s\",\n", escape(bitfile).c_str());
+  fprintf(file, "  \"resource\": \"%s\",\n", escape(resource).c_str());
+  fprintf(file, "  \"backend\": \"%s\",\n",
+          escape(backend && *backend ? backend : "system").c_str());
+  fprintf(file, "  \"results\": [");
+  for (size_t i = 0; i < bench.results.size(); i++) {
+    const auto &result = bench.results[i];
+    fprintf(file, "%s\n    {\"name\": \"%s\", \"samples\": %zu", i ? "," : "",
+            escape(result.name).c_str(), result.samples.size());
+    fprintf(file,
+            ", \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f"
+            ", \"p999_ns\": %.1f, \"max_ns\": %.1f",
+            result.mean, result.p50, result.p99, result.p999, result.max);
+    if (result.bytes_per_call)
+      fprintf(file, ", \"bytes_per_call\": %zu, \"bytes_per_second\": %.0f",
+              result.bytes_per_call,
+              result.bytes_per_call / result.mean * 1e9);
+    fprintf(file, "}");
+  }
+  fprintf(file, "\n  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+void usage() {
+  fprintf(stderr, "usage: bench_nifpga [-r] [-n iterations] "
+                  "[-o results.json] [-d RIO0] bitfile\n");
+}
+
+} // unnamed namespace
+
+int main(int argc, char **argv) {
+  size_t iterations = 10000;
+  const char *json = NULL;
+  const char *resource = "RIO0";
+  bool read_only = false;
+  int option;
+  while ((option = getopt(argc, argv, "rn:o:d:")) != -1) {
+    switch (option) {
+    case 'r':
+      read_only = true;
+      break;
+    case 'n':
+      iterations = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      json = optarg;
+      break;
+    case 'd':
+      resource = optarg;
+      break;
+    default:
+      usage();
+      return 2;
+    }
+  }
+  if (optind != argc - 1 || !iterations) {
+    usage();
+    return 2;
+  }
+  const char *const path = argv[optind];
+
+  // the C API can't enumerate resources, so find out what to measure from the
+  // bitfile itself
+  const nirio::Bitfile bitfile(path);
+
+  bench bench;
+  bench.iterations = iterations;
+  bench.read_only = read_only;
+  printf("%-44s %7s %10s %10s %10s %10s\n", "ns per call", "samples", "mean",
+         "p50", "p99", "p99.9");
+
+  std::vector<double> first(1);
+  const auto start = bench_clock::now();
+  const NiFpga_Status status =
+      NiFpga_Open(path, NULL, resource, 0, &bench.session);
+  first[0] = std::chrono::duration<double, std::nano>(bench_clock::now() -
+                                                      start)
+                 .count();
+  if (NiFpga_IsError(status)) {
+    fprintf(stderr, "opening %s on %s failed with %d\n", path, resource,
+            status);
+    return 1;
+  }
+  report(bench, "open_first", std::move(first));
+  bench_open(bench, path, resource, std::max<size_t>(10, iterations / 100));
+
+  std::vector<named_resource> resources;
+  for (const auto &info : bitfile.getRegisters()) {
+    const kind kind = info.isArray()
+                          ? info.isControl() ? control_array : indicator_array
+                          : info.isControl() ? control : indicator;
+    visit_type(info.getType(), [&](auto type) {
+      resources.push_back(
+          {info.getName(), traits<decltype(type)>::resource_type(kind)});
+    });
+  }
+  for (const auto &info : bitfile.getFifos()) {
+    const kind kind = info.isTargetToHost() ? target_to_host : host_to_target;
+    visit_type(info.getType(), [&](auto type) {
+      resources.push_back(
+          {info.getName(), traits<decltype(type)>::resource_type(kind)});
+    });
+  }
+  bench_find_resource(bench, resources);
+
+  // one register of each kind and type is representative of the rest
+  std::set<std::pair<int, std::string>> measured;
+  for (const auto &info : bitfile.getRegisters()) {
+    const kind kind = info.isArray()
+                          ? info.isControl() ? control_array : indicator_array
+                          : info.isControl() ? control : indicator;
+    visit_type(info.getType(), [&](auto type) {
+      typedef decltype(type) T;
+      if (!measured.insert({kind, traits<T>::name()}).second)
+        return;
+      NiFpgaEx_Resource reg;
+      if (NiFpga_IsError(NiFpgaEx_FindResource(bench.session,
+                                               info.getName().c_str(),
+                                               traits<T>::resource_type(kind),
+                                               &reg)))
+        return;
+      if (info.isArray())
+        bench_array_register<T>(bench, info, reg);
+      else
+        bench_register<T>(bench, info, reg);
+    });
+  }
+
+  for (const auto &info : bitfile.getFifos()) {
+    const kind kind = info.isTargetToHost() ? target_to_host : host_to_target;
+    visit_type(info.getType(), [&](auto type) {
+      typedef decltype(type) T;
+      NiFpgaEx_Resource fifo;
+      size_t depth = 0;
+      if (NiFpga_IsError(NiFpgaEx_FindResource(
+              bench.session, info.getName().c_str(),
+              traits<T>::resource_type(kind), &fifo)) ||
+          NiFpga_IsError(
+              NiFpga_ConfigureFifo2(bench.session, fifo, 262144, &depth)) ||
+          NiFpga_IsError(NiFpga_StartFifo(bench.session, fifo))) {
+        fprintf(stderr, "%s: couldn't start, skipping\n",
+                info.getName().c_str());
+        return;
+      }
+      bench_fifo<T>(bench, info, fifo, depth);
+      NiFpga_StopFifo(bench.session, fifo);
+    });
+  }
+
+  NiFpga_Close(bench.session, 0);
+
+  if (json && !write_json(bench, json, path, resource))
+    return 1;
+  return 0;
+}
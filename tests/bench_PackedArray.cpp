@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Measures packArray/unpackArray throughput for typical array sizes. Build
+// with -DNIRIO_PACKED_ARRAY_SCALAR to compare against the scalar versions.
+
+#include "../src/PackedArray.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace nirio;
+
+// keeps the compiler from optimizing away the work
+static volatile uint32_t sink;
+
+template <typename T, int type_bits>
+void bench(const char *name, size_t count) {
+  const size_t iterations = 20000000 / count + 1;
+  std::vector<T> native(count, 1);
+  std::vector<uint32_t> packed(packedArraySize<type_bits>(count) + 1);
+  typedef std::chrono::steady_clock clock;
+
+  auto start = clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    packArray<type_bits>(packed.data(), native.data(), count);
+    sink = packed[0];
+  }
+  const double pack_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count() /
+      iterations;
+
+  start = clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    unpackArray<type_bits>(packed.data(), native.data(), count);
+    sink = native[0];
+  }
+  const double unpack_ns =
+      std::chrono::duration<double, std::nano>(clock::now() - start).count() /
+      iterations;
+
+  printf("%-5s %6zu elements: pack %9.1f ns, unpack %9.1f ns\n", name, count,
+         pack_ns, unpack_ns);
+}
+
+int main() {
+  const size_t counts[] = {8, 64, 256, 4096};
+
+  for (auto count : counts) {
+    bench<uint8_t, 1>("bool", count);
+    bench<uint8_t, 8>("u8", count);
+    bench<uint16_t, 16>("u16", count);
+    bench<uint32_t, 32>("u32", count);
+    bench<uint64_t, 64>("u64", count);
+  }
+
+  return 0;
+}
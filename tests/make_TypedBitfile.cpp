@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Writes the bitfile test_lvbitx2h generates its header from and then opens:
+// the simulated bitfile, plus an I16 control that's accessed through the
+// mapping from 2 past an aligned word, and controls named after the generated
+// Bitfile struct and a C++ keyword, ahead of it so it'd use the wrong Bitfile.
+
+#include "TestHelpers.h"
+#include <cstdio>
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <bitfile.lvbitx>\n", argv[0]);
+    return 1;
+  }
+  write_file(argv[1],
+             make_simulated_bitfile(
+                 make_register("Bitfile", "0x34", false, false, "<U32/>") +
+                 make_register("default", "0x38", false, false, "<U32/>") +
+                 make_register("Trim", "0x32", false, false, "<I16/>")));
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Checks Base64Decoder against libb64, which bitfiles were always decoded
+// with, byte for byte. Build with -DNIRIO_BASE64_SCALAR, -mssse3, or -mavx2
+// to check each version.
+
+#include "../src/Base64.h"
+#include "../src/libb64/cdecode.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace nirio;
+
+static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string encode(const std::vector<uint8_t>& bytes) {
+  std::string text;
+  size_t i = 0;
+  for (; i + 3 <= bytes.size(); i += 3) {
+    const uint32_t quantum = bytes[i] << 16 | bytes[i + 1] << 8 | bytes[i + 2];
+    for (int shift = 18; shift >= 0; shift -= 6)
+      text += alphabet[(quantum >> shift) & 0x3f];
+  }
+  if (i + 1 == bytes.size()) {
+    text += alphabet[bytes[i] >> 2];
+    text += alphabet[(bytes[i] & 0x03) << 4];
+    text += "==";
+  } else if (i + 2 == bytes.size()) {
+    text += alphabet[bytes[i] >> 2];
+    text += alphabet[(bytes[i] & 0x03) << 4 | bytes[i + 1] >> 4];
+    text += alphabet[(bytes[i + 1] & 0x0f) << 2];
+    text += "=";
+  }
+  return text;
+}
+
+// decodes in blocks of the given sizes, repeating the last, and checks every
+// block decodes to exactly what libb64 decodes it to
+static bool compare(const std::string& text,
+                    const std::vector<size_t>& block_sizes) {
+  std::vector<char> expected(text.size() + 4);
+  std::vector<uint8_t> actual(Base64Decoder::getMaxDecodedSize(text.size()));
+  base64_decodestate state;
+  base64_init_decodestate(&state);
+  Base64Decoder decoder;
+  size_t expected_size = 0;
+  size_t actual_size = 0;
+  size_t block = 0;
+  for (size_t offset = 0; offset < text.size(); block++) {
+    const auto size = std::min(
+        block_sizes[std::min(block, block_sizes.size() - 1)],
+        text.size() - offset);
+    expected_size +=
+        base64_decode_block(text.data() + offset, static_cast<int>(size),
+                            expected.data() + expected_size, &state);
+    actual_size +=
+        decoder.decode(actual.data() + actual_size, text.data() + offset, size);
+    if (actual_size != expected_size)
+      return false;
+    offset += size;
+  }
+  for (size_t i = 0; i < actual_size; i++)
+    if (actual[i] != static_cast<uint8_t>(expected[i]))
+      return false;
+  return true;
+}
+
+static std::vector<uint8_t> random_bytes(size_t size) {
+  std::vector<uint8_t> bytes(size);
+  for (auto& byte : bytes)
+    byte = static_cast<uint8_t>(rand());
+  return bytes;
+}
+
+int main() {
+  srand(1);
+  bool ok = true;
+
+  // every length of a line, to hit each tail and padding
+  bool pass = true;
+  for (size_t size = 0; size < 200 && pass; size++)
+    pass = compare(encode(random_bytes(size)), {4096});
+  printf("lengths: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // wrapped lines of the usual widths, with Windows line endings too
+  pass = true;
+  const auto bytes = random_bytes(100000);
+  const auto text = encode(bytes);
+  const size_t widths[] = {60, 64, 76, 77, 1000};
+  for (auto width : widths)
+    for (const char* newline : {"\n", "\r\n"}) {
+      std::string wrapped;
+      for (size_t i = 0; i < text.size(); i += width)
+        wrapped += text.substr(i, width) + newline;
+      pass &= compare(wrapped, {65536});
+    }
+  printf("wrapped: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // anything outside the alphabet anywhere, including mid-stream padding
+  // and bytes with the high bit set, is skipped
+  // NOTE: '{' is left out since libb64 reads past its table for it
+  pass = true;
+  const char noise[] = {' ', '\t', '\n', '=', '-', '_', '.', '@', '[', '`',
+                        '\0', '\x7f', '\x80', '\xc0', '\xff'};
+  for (int trial = 0; trial < 50 && pass; trial++) {
+    std::string noisy = encode(random_bytes(5000));
+    for (int i = 0; i < 200; i++)
+      noisy.insert(noisy.begin() + rand() % (noisy.size() + 1),
+                   noise[rand() % sizeof(noise)]);
+    pass = compare(noisy, {65536});
+  }
+  printf("noise: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // blocks may split quanta anywhere
+  pass = true;
+  for (size_t block = 1; block <= 70 && pass; block++)
+    pass = compare(text.substr(0, 20000), {block}) &&
+           compare(text.substr(0, 20000), {block, 4096});
+  printf("blocks: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  return ok ? 0 : 1;
+}
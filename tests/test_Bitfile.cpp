@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Bitfile.h"
+#include "../src/Exception.h"
+#include "TestHelpers.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace nirio;
+
+static const char header_xml[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<Bitfile><BitfileVersion>4.0</BitfileVersion>"
+    "<SignatureRegister>0123456789ABCDEF0123456789ABCDEF</SignatureRegister>"
+    "<BitstreamEncoding>base64</BitstreamEncoding>"
+    "<BitstreamVersion>2</BitstreamVersion>";
+
+static const char vi_xml[] =
+    "<VI><RegisterList>"
+    "<Register><Name>ViSignature</Name><Offset>0x1fff0</Offset>"
+    "<Internal>true</Internal></Register>"
+    "<Register><Name>ViControl</Name><Offset>0x1fff4</Offset>"
+    "<Internal>true</Internal></Register>"
+    "<Register><Name>DiagramReset</Name><Offset>0x1fff8</Offset>"
+    "<Internal>true</Internal></Register>"
+    "<Register><Name>Count</Name><Offset>0x18</Offset><Internal>false</Internal>"
+    "<Indicator>true</Indicator><AccessMayTimeout>false</AccessMayTimeout>"
+    "<Datatype><U32/></Datatype></Register>"
+    "</RegisterList></VI>";
+
+static const char project_xml[] =
+    "<Project><TargetClass>USRP</TargetClass>"
+    "<AutoRunWhenDownloaded>false</AutoRunWhenDownloaded>"
+    "<CompilationResultsTree><CompilationResults><NiFpga>"
+    "<BaseAddressOnDevice>0x40000</BaseAddressOnDevice>"
+    "<DmaChannelAllocationList></DmaChannelAllocationList>"
+    "</NiFpga></CompilationResults></CompilationResultsTree></Project>";
+
+// "Hello, bitstream!" wrapped across lines the way bitfiles wrap it
+static const char bitstream_xml[] =
+    "<Bitstream>SGVsbG8sIGJp\ndHN0cmVhbSE=\n</Bitstream>";
+static const std::string decoded = "Hello, bitstream!";
+
+static bool check(const std::string& path, const std::string& contents,
+                  const std::string& expected) {
+  write_file(path, contents);
+  const Bitfile bitfile(path);
+  const auto bitstream = bitfile.getBitstream();
+  return bitfile.getTargetClass() == "USRP" &&
+         bitfile.getBaseAddressOnDevice() == 0x40000 &&
+         bitfile.getRegisters().size() == 1 &&
+         bitfile.getRegisters()[0].getName() == "Count" &&
+         std::string(bitstream.begin(), bitstream.end()) == expected;
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_bitfile");
+  if (root.empty())
+    return 1;
+  const std::string path = root + "/test.lvbitx";
+  // parse every time instead of reading back the cache
+  setenv("NIFPGA_BITFILE_CACHE", "", 1);
+
+  bool ok = true;
+
+  // the usual layout, with the bitstream last
+  bool pass = check(path,
+                    std::string(header_xml) + vi_xml + project_xml +
+                        bitstream_xml + "</Bitfile>\n",
+                    decoded);
+  printf("bitstream last: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // metadata on both sides of the bitstream is still found
+  pass = check(path,
+               std::string(header_xml) + vi_xml + bitstream_xml + project_xml +
+                   "</Bitfile>\n",
+               decoded);
+  printf("bitstream between: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // an empty element isn't cut out, but parses all the same
+  pass = check(path,
+               std::string(header_xml) + vi_xml + project_xml +
+                   "<Bitstream/></Bitfile>\n",
+               "");
+  printf("empty bitstream: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // streaming across many chunks decodes the same as all at once, using
+  // lines without padding since that may only come at the very end
+  std::string encoded;
+  std::string expected;
+  for (int line = 0; line < 20000; line++) {
+    encoded += "SGVsbG8sIGJpdHN0cmVhbSEh\n";
+    expected += "Hello, bitstream!!";
+  }
+  write_file(path, std::string(header_xml) + vi_xml + project_xml +
+                       "<Bitstream>" + encoded + "</Bitstream></Bitfile>\n");
+  const std::string binPath = root + "/test.bin";
+  const int descriptor = open(binPath.c_str(), O_WRONLY | O_CREAT, 0644);
+  Bitfile(path).writeBitstream(descriptor);
+  close(descriptor);
+  std::string written(expected.size() + 1, '\0');
+  FILE* file = fopen(binPath.c_str(), "r");
+  written.resize(fread(&written[0], 1, written.size(), file));
+  fclose(file);
+  pass = written == expected && check(path, std::string(header_xml) + vi_xml +
+                                                project_xml + "<Bitstream>" +
+                                                encoded + "</Bitstream></Bitfile>\n",
+                                      expected);
+  printf("streamed: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // running out of space says so, rather than being a software fault
+  const int full = open("/dev/full", O_WRONLY);
+  bool threw = false;
+  try {
+    Bitfile(path).writeBitstream(full);
+  } catch (const MemoryFullException&) {
+    threw = true;
+  }
+  close(full);
+  printf("write failure: %s\n", threw ? "ok" : "FAIL");
+  ok &= threw;
+
+  // metadata missing from around the bitstream is still an error
+  threw = false;
+  write_file(path, std::string(header_xml) + vi_xml + bitstream_xml +
+                       "</Bitfile>\n");
+  try {
+    const Bitfile bitfile(path);
+  } catch (const CorruptBitfileException&) {
+    threw = true;
+  }
+  printf("missing project: %s\n", threw ? "ok" : "FAIL");
+  ok &= threw;
+
+  // an encoding we can't decode is caught on opening, since decoding doesn't
+  // parse the metadata again
+  std::string header = header_xml;
+  header.replace(header.find("base64"), 6, "base32");
+  threw = false;
+  write_file(path, header + vi_xml + project_xml + bitstream_xml +
+                       "</Bitfile>\n");
+  try {
+    const Bitfile bitfile(path);
+  } catch (const CorruptBitfileException&) {
+    threw = true;
+  }
+  printf("unknown encoding: %s\n", threw ? "ok" : "FAIL");
+  ok &= threw;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Bitfile.h"
+#include "../src/BitfileCache.h"
+#include "../src/ClusterPlan.h"
+#include "TestHelpers.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nirio;
+
+// a bitfile with one of everything the cache has to describe
+static const char bitfile_xml[] =
+    "<?xml version=\"1.0\"?>\n"
+    "<Bitfile><BitfileVersion>4.0</BitfileVersion>"
+    "<SignatureRegister>0123456789ABCDEF0123456789ABCDEF</SignatureRegister>"
+    "<BitstreamVersion>2</BitstreamVersion>"
+    "<VI><RegisterList>"
+    "<Register><Name>ViSignature</Name><Offset>0x1fff0</Offset>"
+    "<Internal>true</Internal></Register>"
+    "<Register><Name>ViControl</Name><Offset>0x1fff4</Offset>"
+    "<Internal>true</Internal></Register>"
+    "<Register><Name>DiagramReset</Name><Offset>0x1fff8</Offset>"
+    "<Internal>true</Internal></Register>"
+    "<Register><Name>Count</Name><Offset>0x18</Offset><Internal>false</Internal>"
+    "<Indicator>true</Indicator><AccessMayTimeout>false</AccessMayTimeout>"
+    "<Datatype><U32/></Datatype></Register>"
+    "<Register><Name>Rate</Name><Offset>0x1c</Offset><Internal>false</Internal>"
+    "<Indicator>false</Indicator><AccessMayTimeout>true</AccessMayTimeout>"
+    "<Datatype><SGL/></Datatype></Register>"
+    "<Register><Name>Taps</Name><Offset>0x20</Offset><Internal>false</Internal>"
+    "<Indicator>false</Indicator><AccessMayTimeout>false</AccessMayTimeout>"
+    "<Datatype><Array><Size>4</Size><Type><I16/></Type></Array></Datatype>"
+    "</Register>"
+    "<Register><Name>Level</Name><Offset>0x30</Offset><Internal>false</Internal>"
+    "<Indicator>true</Indicator><AccessMayTimeout>false</AccessMayTimeout>"
+    "<Datatype><FXP><Signed>true</Signed><WordLength>12</WordLength>"
+    "<IntegerWordLength>4</IntegerWordLength>"
+    "<IncludeOverflowStatus>true</IncludeOverflowStatus></FXP></Datatype>"
+    "</Register>"
+    "<Register><Name>Status</Name><Offset>0x40</Offset><Internal>false</Internal>"
+    "<Indicator>true</Indicator><AccessMayTimeout>false</AccessMayTimeout>"
+    "<Datatype><Cluster><TypeList><Boolean/><U16/></TypeList></Cluster>"
+    "</Datatype></Register>"
+    "</RegisterList></VI>"
+    "<Project><TargetClass>USRP</TargetClass>"
+    "<AutoRunWhenDownloaded>false</AutoRunWhenDownloaded>"
+    "<CompilationResultsTree><CompilationResults><NiFpga>"
+    "<BaseAddressOnDevice>0x40000</BaseAddressOnDevice>"
+    "<DmaChannelAllocationList><Channel name=\"Samples\"><Number>0</Number>"
+    "<ControlSet>0</ControlSet><Direction>TargetToHost</Direction>"
+    "<DataType><SubType>I32</SubType></DataType>"
+    "<BaseAddressTag>f0</BaseAddressTag></Channel></DmaChannelAllocationList>"
+    "<RegisterBlockList><RegisterBlock name=\"f0\"><Offset>0x1000</Offset>"
+    "</RegisterBlock></RegisterBlockList>"
+    "</NiFpga></CompilationResults></CompilationResultsTree></Project>"
+    "<Bitstream></Bitstream></Bitfile>\n";
+
+// the number of files in a directory, besides . and ..
+static int count_files(const std::string& path) {
+  DIR* const directory = opendir(path.c_str());
+  if (!directory)
+    return -1;
+  int count = 0;
+  while (const dirent* const entry = readdir(directory))
+    count += strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..");
+  closedir(directory);
+  return count;
+}
+
+static bool same(const Bitfile& a, const Bitfile& b) {
+  bool pass = a.getSignature() == b.getSignature() &&
+              a.getBaseAddressOnDevice() == b.getBaseAddressOnDevice() &&
+              a.getControlRegister() == b.getControlRegister() &&
+              a.getBitstreamVersion() == b.getBitstreamVersion() &&
+              a.getRegisters().size() == b.getRegisters().size() &&
+              a.getFifos().size() == b.getFifos().size();
+  for (size_t i = 0; pass && i < a.getRegisters().size(); i++) {
+    const auto& x = a.getRegisters()[i];
+    const auto& y = b.getRegisters()[i];
+    pass = x.getName() == y.getName() && x.getType() == y.getType() &&
+           x.getOffset() == y.getOffset() &&
+           x.isIndicator() == y.isIndicator() && x.isArray() == y.isArray() &&
+           x.getSize() == y.getSize() &&
+           x.isAccessMayTimeout() == y.isAccessMayTimeout() &&
+           !x.getClusterPlan() == !y.getClusterPlan();
+    if (pass && x.getClusterPlan())
+      pass = x.getClusterPlan()->getBits() == y.getClusterPlan()->getBits() &&
+             x.getClusterPlan()->getFieldCount() ==
+                 y.getClusterPlan()->getFieldCount();
+  }
+  for (size_t i = 0; pass && i < a.getFifos().size(); i++) {
+    const auto& x = a.getFifos()[i];
+    const auto& y = b.getFifos()[i];
+    pass = x.getName() == y.getName() && x.getType() == y.getType() &&
+           x.getNumber() == y.getNumber() && x.getOffset() == y.getOffset() &&
+           x.isHostToTarget() == y.isHostToTarget();
+  }
+  return pass;
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_bitfilecache");
+  if (root.empty())
+    return 1;
+  const std::string directory = root + "/cache";
+  const std::string path = root + "/test.lvbitx";
+  setenv("NIFPGA_BITFILE_CACHE", directory.c_str(), 1);
+  write_file(path, bitfile_xml);
+
+  bool ok = true;
+
+  // the first open parses and fills the cache, the second reads it back
+  const Bitfile parsed(path);
+  Bitfile scratch(path);
+  const bool hit = BitfileCache(path, directory).load(scratch);
+  const Bitfile cached(path);
+  bool pass = hit && same(parsed, cached) &&
+              cached.getRegisters()[1].getType() == Sgl();
+  printf("round trip: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // same size and modification time but different contents must miss
+  struct stat before;
+  stat(path.c_str(), &before);
+  std::string renamed = bitfile_xml;
+  renamed.replace(renamed.find("Count"), 5, "Total");
+  write_file(path, renamed);
+  const struct timespec times[] = {before.st_atim, before.st_mtim};
+  utimensat(AT_FDCWD, path.c_str(), times, 0);
+  const bool stale = !BitfileCache(path, directory).load(scratch);
+  const Bitfile reparsed(path);
+  pass = stale && reparsed.getRegisters()[0].getName() == "Total";
+  printf("stale contents: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // but the bitstream isn't cached, so it isn't read to check it either
+  const std::string recompiled = root + "/recompiled.lvbitx";
+  std::string bitstream = bitfile_xml;
+  bitstream.replace(bitstream.find("<Bitstream>"), 11, "<Bitstream>AAAA");
+  write_file(recompiled, bitstream);
+  const Bitfile original(recompiled);
+  stat(recompiled.c_str(), &before);
+  bitstream.replace(bitstream.find("AAAA"), 4, "BBBB");
+  write_file(recompiled, bitstream);
+  const struct timespec same_times[] = {before.st_atim, before.st_mtim};
+  utimensat(AT_FDCWD, recompiled.c_str(), same_times, 0);
+  pass = BitfileCache(recompiled, directory).load(scratch);
+  printf("bitstream: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // threads storing the same entry at once each write their own copy, so the
+  // entry is always whole when read back, and no copies are left behind
+  const std::string shared = root + "/shared";
+  setenv("NIFPGA_BITFILE_CACHE", "", 1);
+  const Bitfile uncached(path);
+  std::vector<std::thread> threads;
+  std::vector<char> whole(8, true);
+  for (int i = 0; i < 8; i++)
+    threads.emplace_back([&, i] {
+      Bitfile loaded(path);
+      for (int j = 0; j < 200; j++) {
+        BitfileCache(path, shared).store(uncached);
+        whole[i] &= BitfileCache(path, shared).load(loaded);
+      }
+    });
+  for (auto&& thread : threads)
+    thread.join();
+  pass = BitfileCache(path, shared).load(scratch) && same(uncached, scratch) &&
+         count_files(shared) == 1;
+  for (const char hit : whole)
+    pass &= hit != 0;
+  printf("concurrent: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // an empty directory disables caching altogether
+  pass = !BitfileCache(path, "").load(scratch);
+  printf("disabled: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/ClusterPlan.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+using namespace nirio;
+
+// what a caller would describe for a cluster of
+// { Bool, U16, I8[2], FXP <+/-12,4> with overflow status, Sgl }
+struct cluster {
+  NiFpga_Bool flag;
+  uint16_t word;
+  int8_t bytes[2];
+  double fxp;
+  float sgl;
+};
+
+static const size_t offsets[] = {
+    offsetof(cluster, flag), offsetof(cluster, word), offsetof(cluster, bytes),
+    offsetof(cluster, fxp), offsetof(cluster, sgl),
+};
+
+// fields one after another from the most significant bit, padded to bytes
+static const uint8_t expected_packed[] = {0xd5, 0xe6, 0xff, 0x82, 0xb6,
+                                          0x00, 0xff, 0x00, 0x00, 0x00};
+
+static ClusterPlan make_plan() {
+  ClusterPlan plan;
+  plan.addField(Bool(), 1);
+  plan.addField(U16(), 1);
+  plan.addField(I8(), 2);
+  plan.addField(FxpType(true, 12, 4, true), 1);
+  plan.addField(Sgl(), 1);
+  return plan;
+}
+
+static bool run_layout_test() {
+  const auto plan = make_plan();
+  bool pass = plan.getFieldCount() == 5 && plan.getBits() == 78 &&
+              plan.getPackedBytes() == sizeof(expected_packed);
+
+  const cluster in = {1, 0xabcd, {-1, 5}, -2.5, 1.5f};
+  uint8_t packed[sizeof(expected_packed)];
+  memset(packed, 0xa5, sizeof(packed));
+  plan.pack(&in, offsets, packed);
+  if (memcmp(packed, expected_packed, sizeof(packed))) {
+    printf("layout: pack mismatch:");
+    for (auto byte : packed)
+      printf(" %02x", byte);
+    printf("\n");
+    pass = false;
+  }
+
+  cluster out;
+  memset(&out, 0, sizeof(out));
+  plan.unpack(packed, &out, offsets);
+  if (out.flag != in.flag || out.word != in.word ||
+      out.bytes[0] != in.bytes[0] || out.bytes[1] != in.bytes[1] ||
+      out.fxp != in.fxp || out.sgl != in.sgl) {
+    printf("layout: unpack mismatch\n");
+    pass = false;
+  }
+
+  printf("layout: %s\n", pass ? "ok" : "FAIL");
+  return pass;
+}
+
+// fixed-point fields saturate like NiFpgaEx_WriteFxpDbl and report it in
+// their overflow status bit
+static bool run_saturation_test() {
+  const auto plan = make_plan();
+  cluster in = {0, 0, {0, 0}, 1000.0, 0.0f};
+  uint8_t packed[sizeof(expected_packed)];
+  plan.pack(&in, offsets, packed);
+
+  // overflow status, then 0x7ff, starting 33 bits in after the zero bytes[1]
+  const bool pass = packed[4] == 0x5f && packed[5] == 0xfc;
+  printf("saturation: %s\n", pass ? "ok" : "FAIL");
+  return pass;
+}
+
+// cluster FIFO elements are right-justified, so the fields can start at any
+// bit, and everything before them must be zeroed
+static bool run_first_bit_test() {
+  const auto plan = make_plan();
+  const size_t first_bit = 128 - plan.getBits();
+  const cluster in = {1, 0xabcd, {-1, 5}, -2.5, 1.5f};
+  uint8_t packed[16];
+  memset(packed, 0xa5, sizeof(packed));
+  plan.pack(&in, offsets, packed, first_bit);
+
+  bool pass = true;
+  // shifting the whole element left by first_bit gives the unpadded form
+  for (size_t i = 0; i < sizeof(expected_packed); i++) {
+    const size_t bit = first_bit + i * 8;
+    const uint8_t byte = static_cast<uint8_t>(
+        packed[bit / 8] << bit % 8 |
+        (bit / 8 + 1 < sizeof(packed) ? packed[bit / 8 + 1] >> (8 - bit % 8)
+                                      : 0));
+    pass &= byte == expected_packed[i];
+  }
+  for (size_t i = 0; i < first_bit / 8; i++)
+    pass &= packed[i] == 0;
+  pass &= packed[first_bit / 8] >> (8 - first_bit % 8) == 0;
+
+  cluster out;
+  memset(&out, 0, sizeof(out));
+  plan.unpack(packed, &out, offsets, first_bit);
+  pass &= out.flag == in.flag && out.word == in.word && out.fxp == in.fxp &&
+          out.sgl == in.sgl;
+
+  printf("first bit: %s\n", pass ? "ok" : "FAIL");
+  return pass;
+}
+
+int main() {
+  bool ok = true;
+  ok &= run_layout_test();
+  ok &= run_saturation_test();
+  ok &= run_first_bit_test();
+  return ok ? 0 : 1;
+}
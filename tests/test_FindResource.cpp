@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Finds resources by name in a session on the simulated backend, one at a
+// time and all at once.
+
+#include "NiFpga.h"
+#include "TestHelpers.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// finds one resource, returning its status and outputting it
+static NiFpga_Status find(const NiFpga_Session session, const char* name,
+                          const NiFpgaEx_ResourceType type,
+                          NiFpgaEx_Resource& resource) {
+  return NiFpgaEx_FindResource(session, name, type, &resource);
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_findresource");
+  if (root.empty())
+    return 1;
+  use_simulated_backend(root);
+  // two indicators named Twice, and a control named after FIFO 0
+  const std::string bitfile = root + "/find.lvbitx";
+  write_file(bitfile,
+             make_simulated_bitfile(
+                 make_register("Twice", "0x30", true, false, "<U32/>") +
+                 make_register("Twice", "0x34", true, false, "<U32/>") +
+                 make_register("Input", "0x38", false, false, "<U32/>")));
+  NiFpga_Session session;
+  if (NiFpga_IsError(NiFpga_Open(bitfile.c_str(), simulated_signature, "RIO0",
+                                 0, &session)))
+    return 1;
+
+  bool ok = true;
+
+  // a unique name is found only as its own kind of resource
+  NiFpgaEx_Resource resource = 0;
+  bool pass = find(session, "Count", NiFpgaEx_ResourceType_IndicatorU32,
+                   resource) == NiFpga_Status_Success &&
+              resource == 0x40018 &&
+              find(session, "Count", NiFpgaEx_ResourceType_ControlU32,
+                   resource) == NiFpga_Status_ResourceNotFound &&
+              resource == 0 &&
+              find(session, "Gain", NiFpgaEx_ResourceType_ControlI16,
+                   resource) == NiFpga_Status_Success &&
+              resource == 0x80040022 &&
+              find(session, "Nothing", NiFpgaEx_ResourceType_Any, resource) ==
+                  NiFpga_Status_ResourceNotFound;
+  printf("unique: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // any kind of resource can be found without saying which
+  pass = find(session, "Rate", NiFpgaEx_ResourceType_Any, resource) ==
+             NiFpga_Status_Success &&
+         resource == 0x4001c &&
+         find(session, "Output", NiFpgaEx_ResourceType_Any, resource) ==
+             NiFpga_Status_Success &&
+         resource == 1;
+  printf("any: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // registers that share a name can't be told apart, rather than one being
+  // picked arbitrarily
+  pass = find(session, "Twice", NiFpgaEx_ResourceType_IndicatorU32,
+              resource) == NiFpga_Status_InvalidResourceName &&
+         find(session, "Twice", NiFpgaEx_ResourceType_Any, resource) ==
+             NiFpga_Status_InvalidResourceName &&
+         resource == 0;
+  printf("ambiguous: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // but a register and a FIFO that share a name are told apart by type, and
+  // the register is found without one
+  pass = find(session, "Input", NiFpgaEx_ResourceType_ControlU32, resource) ==
+             NiFpga_Status_Success &&
+         resource == 0x40038 &&
+         find(session, "Input", NiFpgaEx_ResourceType_TargetToHostFifoI32,
+              resource) == NiFpga_Status_Success &&
+         resource == 0 &&
+         find(session, "Input", NiFpgaEx_ResourceType_Any, resource) ==
+             NiFpga_Status_Success &&
+         resource == 0x40038;
+  printf("register and fifo: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // many are found at once, each with its own status, and the first failure
+  // is the result
+  const char* const names[] = {"Count", "Twice", NULL, "Nothing", "Output"};
+  const NiFpgaEx_ResourceType types[] = {
+      NiFpgaEx_ResourceType_IndicatorU32, NiFpgaEx_ResourceType_Any,
+      NiFpgaEx_ResourceType_Any, NiFpgaEx_ResourceType_Any,
+      NiFpgaEx_ResourceType_HostToTargetFifoU64};
+  NiFpgaEx_Resource resources[] = {9, 9, 9, 9, 9};
+  NiFpga_Status statuses[5];
+  pass = NiFpgaEx_FindResources(session, names, types, 5, resources,
+                                statuses) ==
+             NiFpga_Status_InvalidResourceName &&
+         resources[0] == 0x40018 && resources[1] == 0 && resources[2] == 0 &&
+         resources[3] == 0 && resources[4] == 1 &&
+         statuses[0] == NiFpga_Status_Success &&
+         statuses[1] == NiFpga_Status_InvalidResourceName &&
+         statuses[2] == NiFpga_Status_InvalidParameter &&
+         statuses[3] == NiFpga_Status_ResourceNotFound &&
+         statuses[4] == NiFpga_Status_Success &&
+         NiFpgaEx_FindResources(session, names, types, 1, resources, NULL) ==
+             NiFpga_Status_Success &&
+         NiFpgaEx_FindResources(session, NULL, types, 1, resources, NULL) ==
+             NiFpga_Status_InvalidParameter;
+  printf("batch: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= NiFpga_Close(session, 0) == NiFpga_Status_Success;
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
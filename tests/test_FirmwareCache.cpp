@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Bitfile.h"
+#include "../src/FirmwareCache.h"
+#include "../src/dtgen.h"
+#include "TestHelpers.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace nirio;
+
+static ino_t inode(const std::string& path) {
+  struct stat status;
+  return stat(path.c_str(), &status) ? 0 : status.st_ino;
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_firmwarecache");
+  if (root.empty())
+    return 1;
+  setenv("NIFPGA_BITFILE_CACHE", "", 1);
+  const std::string directory = root;
+  const std::string signature = "0123456789ABCDEF0123456789ABCDEF";
+  const std::string base = directory + "/" + signature;
+  // a bitstream of more than one line
+  std::string bitstream, expected;
+  for (int i = 0; i < 4; i++) {
+    bitstream += hello_bitstream;
+    expected += "Hello, bitstream!!";
+  }
+  write_file(directory + "/a.lvbitx", make_bitfile(signature, bitstream));
+  const Bitfile bitfile(directory + "/a.lvbitx");
+
+  bool ok = true;
+
+  // the first prepare writes everything
+  const FirmwareCache cache(directory, 0);
+  const auto firmware = cache.prepare(bitfile);
+  bool pass = firmware.bitstreamPath == base + ".bin" &&
+              firmware.overlayPath == base + ".dts" &&
+              // with no overlay of its own, there's no fpga_full to target
+              firmware.compiledOverlayPath.empty() &&
+              read_file(base + ".bin") == expected &&
+              !read_file(base + ".hash").empty() &&
+              !read_file(base + ".dts").empty();
+  printf("added: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // preparing again rewrites nothing
+  const auto bin = inode(base + ".bin");
+  const auto dts = inode(base + ".dts");
+  cache.prepare(bitfile);
+  pass = inode(base + ".bin") == bin && inode(base + ".dts") == dts;
+  printf("reused: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a truncated or altered bitstream is written again
+  truncate((base + ".bin").c_str(), 10);
+  cache.prepare(bitfile);
+  pass = read_file(base + ".bin") == expected;
+  write_file(base + ".bin", std::string(expected.size(), 'x'));
+  cache.prepare(bitfile);
+  pass &= read_file(base + ".bin") == expected;
+  printf("damaged: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // beyond the budget, the least recently used entries go first, while
+  // firmware that isn't ours stays
+  write_file(directory + "/other.bin", "not ours");
+  const std::string signatures[] = {"11111111111111111111111111111111",
+                                    "22222222222222222222222222222222"};
+  const auto entry_size =
+      expected.size() + read_file(base + ".dts").size();
+  const FirmwareCache small(directory, 2 * entry_size);
+  for (const auto& other : signatures) {
+    write_file(directory + "/b.lvbitx", make_bitfile(other, bitstream));
+    usleep(20000);
+    small.prepare(Bitfile(directory + "/b.lvbitx"));
+  }
+  pass = read_file(base + ".bin").empty() &&
+         read_file(base + ".hash").empty() &&
+         read_file(directory + "/" + signatures[0] + ".bin") == expected &&
+         read_file(directory + "/" + signatures[1] + ".bin") == expected &&
+         read_file(directory + "/other.bin") == "not ours";
+  printf("evicted: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a bitfile with an overlay of its own has it compiled in-process, with the
+  // nirio node added
+  write_file(directory + "/simulated.lvbitx", make_simulated_bitfile());
+  const auto compiled =
+      cache.prepare(Bitfile(directory + "/simulated.lvbitx"));
+  const std::string dtbo = read_file(compiled.compiledOverlayPath);
+  pass = compiled.compiledOverlayPath ==
+             directory + "/" + simulated_signature + ".dtbo" &&
+         dtgen::dt_tree::unflatten(std::vector<uint8_t>(dtbo.begin(),
+                                                        dtbo.end()))
+                 .render()
+                 .find("nirio@") != std::string::npos;
+  printf("compiled: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
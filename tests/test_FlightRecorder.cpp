@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/FlightRecorder.h"
+#include "TestHelpers.h"
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace nirio;
+
+// dumps through a temporary file
+static std::vector<std::string> dump_lines(const std::string& path) {
+  FILE* const file = fopen(path.c_str(), "w+");
+  FlightRecorder::dump(fileno(file));
+  fclose(file);
+  std::vector<std::string> lines;
+  const auto contents = read_file(path);
+  for (size_t start = 0, end; start < contents.size(); start = end + 1) {
+    end = contents.find('\n', start);
+    lines.push_back(contents.substr(start, end - start));
+  }
+  return lines;
+}
+
+// lines of one call
+static std::vector<std::string> lines_of(const std::vector<std::string>& lines,
+                                         const std::string& call) {
+  std::vector<std::string> matching;
+  for (const auto& line : lines)
+    if (line.find("\"call\":\"" + call + "\"") != std::string::npos)
+      matching.push_back(line);
+  return matching;
+}
+
+static uint64_t field(const std::string& line, const std::string& name) {
+  const auto position = line.find("\"" + name + "\":");
+  if (position == std::string::npos)
+    return -1;
+  return strtoull(line.c_str() + position + name.size() + 3, NULL, 10);
+}
+
+static bool is_whole(const std::string& line) {
+  return line.compare(0, 10, "{\"thread\":") == 0 && line.back() == '}' &&
+         line.find("\"ns\":") != std::string::npos;
+}
+
+static void record(const char* const call, const uint64_t size) {
+  Status status;
+  FlightScope flight(call, 1, status, 0, size);
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_flightrecorder");
+  if (root.empty())
+    return 1;
+  const std::string dump = root + "/dump";
+
+  bool ok = true;
+
+  // a call is recorded with what it returned and how long it took
+  {
+    Status status;
+    FlightScope flight("first", 5, status, 3, 7);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    status.merge(NiFpga_Status_FifoTimeout);
+  }
+  auto lines = lines_of(dump_lines(dump), "first");
+  const auto thread = static_cast<uint64_t>(syscall(SYS_gettid));
+  bool pass = lines.size() == 1 && is_whole(lines[0]) &&
+              field(lines[0], "thread") == thread &&
+              field(lines[0], "session") == 5 &&
+              field(lines[0], "resource") == 3 &&
+              field(lines[0], "size") == 7 &&
+              lines[0].find("\"status\":-50400") != std::string::npos &&
+              field(lines[0], "ns") >= 10000000 &&
+              field(lines[0], "ns") < 1000000000 &&
+              field(lines[0], "time") + 60 > static_cast<uint64_t>(time(NULL));
+  printf("record: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // only the last calls are kept, oldest first
+  for (uint64_t i = 0; i < FlightRecorder::capacity + 10; i++)
+    record("wrapped", i);
+  lines = lines_of(dump_lines(dump), "wrapped");
+  pass = lines.size() == FlightRecorder::capacity &&
+         field(lines.front(), "size") == 10 &&
+         field(lines.back(), "size") == FlightRecorder::capacity + 9 &&
+         lines_of(dump_lines(dump), "first").empty();
+  printf("wrap: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a thread's calls outlive it, until the next thread reuses its ring
+  std::thread([] { record("exited", 1); }).join();
+  pass = lines_of(dump_lines(dump), "exited").size() == 1;
+  std::thread([] {
+    for (size_t i = 0; i < FlightRecorder::capacity; i++)
+      record("reused", i);
+  }).join();
+  lines = dump_lines(dump);
+  pass = pass && lines_of(lines, "exited").empty() &&
+         lines_of(lines, "reused").size() == FlightRecorder::capacity &&
+         lines_of(lines, "wrapped").size() == FlightRecorder::capacity;
+  printf("threads: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // dumping while another thread records only ever sees whole records
+  std::atomic<bool> stop(false);
+  std::thread busy([&] {
+    for (uint64_t i = 0; !stop; i++)
+      record("busy", i);
+  });
+  pass = true;
+  for (int i = 0; i < 50; i++) {
+    lines = dump_lines(dump);
+    for (const auto& line : lines)
+      pass = pass && is_whole(line);
+    const auto busy_lines = lines_of(lines, "busy");
+    for (size_t j = 1; j < busy_lines.size(); j++)
+      pass = pass && field(busy_lines[j], "size") >
+                         field(busy_lines[j - 1], "size");
+  }
+  stop = true;
+  busy.join();
+  printf("concurrent: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // SIGUSR2 dumps to the log, if there is one
+  const std::string log = root + "/log";
+  pass = !FlightRecorder::installSignalHandler();
+  setenv("NIFPGA_FLIGHT_RECORDER_LOG", log.c_str(), 1);
+  pass = pass && FlightRecorder::installSignalHandler() &&
+         FlightRecorder::installSignalHandler();
+  record("signaled", 1);
+  raise(SIGUSR2);
+  pass = pass &&
+         read_file(log).find("\"call\":\"signaled\"") != std::string::npos;
+  printf("signal: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // but never takes it from something else that handles it
+  signal(SIGUSR2, SIG_IGN);
+  pass = !FlightRecorder::installSignalHandler();
+  printf("handled: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
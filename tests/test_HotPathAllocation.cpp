@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Drives a session on the simulated backend through every register and FIFO
+// entry point, with the library built into this test so that its hot paths
+// are seen by the operator new below.
+
+#include "../src/HotPath.h"
+#include "../src/ScratchPool.h"
+#include "NiFpga.h"
+#include "TestHelpers.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace nirio;
+
+// allocations made while within a NIRIO_HOT_PATH scope, on any thread
+static std::atomic<size_t> hot_path_allocations(0);
+
+static void* allocate(size_t size) {
+  if (isInHotPath())
+    hot_path_allocations++;
+  if (void* p = malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return allocate(size); }
+
+void* operator new[](size_t size) { return allocate(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete[](void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// registers and FIFOs of make_simulated_bitfile
+static const uint32_t count_register = 0x40018;
+static const uint32_t rate_register = 0x4001c;
+static const uint32_t gain_register = 0x80040022;
+static const uint32_t enable_register = 0x40026;
+static const uint32_t total_register = 0x40028;
+static const uint32_t samples_register = 0x40100;
+static const uint32_t taps_register = 0x40600;
+static const uint32_t flags_register = 0x40800;
+static const uint32_t wave_register = 0x40900;
+static const uint32_t record_register = 0x40a00;
+static const uint32_t input_fifo = 0;
+static const uint32_t output_fifo = 1;
+
+struct record {
+  NiFpga_Bool flag;
+  uint16_t number;
+  uint32_t values[40];
+};
+
+static const size_t record_offsets[] = {offsetof(record, flag),
+                                        offsetof(record, number),
+                                        offsetof(record, values)};
+
+// the wide registers, which go through an array ioctl and so scratch
+static bool access_arrays(const NiFpga_Session session) {
+  static thread_local std::vector<uint32_t> samples(256, 0x12345678);
+  static thread_local std::vector<int16_t> taps(200, -1234);
+  static thread_local std::vector<NiFpga_Bool> flags(1000, 1);
+  static thread_local std::vector<double> wave(100, 1.5);
+  static thread_local record cluster = {1, 0xabcd, {}};
+  const auto size = sizeof(record_offsets) / sizeof(*record_offsets);
+  NiFpga_Status status = NiFpga_Status_Success;
+  NiFpga_MergeStatus(&status, NiFpga_WriteArrayU32(session, samples_register,
+                                                   samples.data(), 256));
+  NiFpga_MergeStatus(&status, NiFpga_ReadArrayU32(session, samples_register,
+                                                  samples.data(), 256));
+  NiFpga_MergeStatus(&status, NiFpga_WriteArrayI16(session, taps_register,
+                                                   taps.data(), 200));
+  NiFpga_MergeStatus(&status, NiFpga_ReadArrayI16(session, taps_register,
+                                                  taps.data(), 200));
+  NiFpga_MergeStatus(&status, NiFpga_WriteArrayBool(session, flags_register,
+                                                    flags.data(), 1000));
+  NiFpga_MergeStatus(&status, NiFpga_ReadArrayBool(session, flags_register,
+                                                   flags.data(), 1000));
+  NiFpga_MergeStatus(&status, NiFpgaEx_WriteArrayFxpDbl(
+                                  session, wave_register, wave.data(), 100));
+  NiFpga_MergeStatus(&status,
+                     NiFpgaEx_ReadArrayFxpDbl(session, wave_register,
+                                              wave.data(), 100, NULL));
+  NiFpga_MergeStatus(&status,
+                     NiFpgaEx_WriteCluster(session, record_register, &cluster,
+                                           record_offsets, size));
+  NiFpga_MergeStatus(&status,
+                     NiFpgaEx_ReadCluster(session, record_register, &cluster,
+                                          record_offsets, size));
+  return status == NiFpga_Status_Success && samples[255] == 0x12345678 &&
+         taps[199] == -1234 && flags[999] && wave[99] == 1.5 &&
+         cluster.number == 0xabcd;
+}
+
+// every entry point that has a hot path, once
+static bool access_everything(const NiFpga_Session session) {
+  NiFpga_Status status = NiFpga_Status_Success;
+  uint32_t count;
+  float rate = 2.5f;
+  int16_t gain = -3;
+  NiFpga_Bool enable = 1;
+  uint64_t total;
+  NiFpga_MergeStatus(&status, NiFpga_ReadU32(session, count_register, &count));
+  NiFpga_MergeStatus(&status, NiFpga_WriteSgl(session, rate_register, rate));
+  NiFpga_MergeStatus(&status, NiFpga_ReadSgl(session, rate_register, &rate));
+  NiFpga_MergeStatus(&status, NiFpga_WriteI16(session, gain_register, gain));
+  NiFpga_MergeStatus(&status, NiFpga_ReadI16(session, gain_register, &gain));
+  NiFpga_MergeStatus(&status,
+                     NiFpga_WriteBool(session, enable_register, enable));
+  NiFpga_MergeStatus(&status,
+                     NiFpga_ReadBool(session, enable_register, &enable));
+  NiFpga_MergeStatus(&status, NiFpga_ReadU64(session, total_register, &total));
+  const bool arrays = access_arrays(session);
+
+  int32_t input[100];
+  uint64_t output[100] = {};
+  size_t remaining;
+  NiFpga_MergeStatus(&status, NiFpga_ReadFifoI32(session, input_fifo, input,
+                                                 100, 1000, &remaining));
+  NiFpga_MergeStatus(&status, NiFpga_WriteFifoU64(session, output_fifo, output,
+                                                  100, 1000, &remaining));
+  int32_t* elements;
+  size_t acquired;
+  NiFpga_MergeStatus(&status, NiFpga_AcquireFifoReadElementsI32(
+                                  session, input_fifo, &elements, 100, 1000,
+                                  &acquired, &remaining));
+  NiFpga_MergeStatus(&status,
+                     NiFpga_ReleaseFifoElements(session, input_fifo, acquired));
+  return status == NiFpga_Status_Success && arrays && rate == 2.5f &&
+         gain == -3 && enable;
+}
+
+static bool check(const char* name, bool pass) {
+  printf("%s: %s\n", name, pass ? "ok" : "FAIL");
+  return pass;
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_hotpathallocation");
+  if (root.empty())
+    return 1;
+  use_simulated_backend(root);
+  const std::string bitfile = root + "/hot.lvbitx";
+  write_file(bitfile, make_simulated_bitfile());
+  NiFpga_Session session;
+  if (NiFpga_IsError(NiFpga_Open(bitfile.c_str(), simulated_signature, "RIO0",
+                                 0, &session)))
+    return 1;
+
+  bool ok = true;
+
+  // the first accesses configure and start the FIFOs, which may allocate
+  ok &= check("warm", access_everything(session));
+
+  hot_path_allocations = 0;
+  bool pass = true;
+  for (int i = 0; i < 100; i++)
+    pass &= access_everything(session);
+  ok &= check("sequential", pass && hot_path_allocations == 0);
+
+  // as many threads as there are scratch slots each get their own slot, as
+  // long as every access takes only one
+  hot_path_allocations = 0;
+  std::atomic<bool> all_passed(true);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < ScratchPool::defaultSlots; t++)
+    threads.emplace_back([session, &all_passed] {
+      bool passed = true;
+      for (int i = 0; i < 200; i++)
+        passed &= access_arrays(session);
+      if (!passed)
+        all_passed = false;
+    });
+  for (auto&& thread : threads)
+    thread.join();
+  ok &= check("concurrent", all_passed && hot_path_allocations == 0);
+
+  // make sure the hook itself works: an access larger than the scratch was
+  // sized for has to go to the heap, and must be noticed
+  hot_path_allocations = 0;
+  std::vector<uint32_t> too_many(512, 0);
+  NiFpga_WriteArrayU32(session, samples_register, too_many.data(), 512);
+  ok &= check("detects allocation", hot_path_allocations != 0);
+
+  // nothing is counted outside of a hot path
+  hot_path_allocations = 0;
+  delete new int(0);
+  ok &= check("outside hot path", hot_path_allocations == 0);
+
+  NiFpga_Close(session, 0);
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Loader.h"
+#include "TestHelpers.h"
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace nirio;
+
+static bool is_directory(const std::string& path) {
+  struct stat status;
+  return !stat(path.c_str(), &status) && S_ISDIR(status.st_mode);
+}
+
+static bool has_stages(const Loader& loader, const char* const* names,
+                       size_t count) {
+  const auto& stages = loader.getStages();
+  if (stages.size() != count)
+    return false;
+  for (size_t i = 0; i < count; i++)
+    if (strcmp(stages[i].name, names[i]) || stages[i].duration.count() < 0)
+      return false;
+  return true;
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_loader");
+  if (root.empty())
+    return 1;
+  const std::string firmware_directory = root + "/firmware";
+  const std::string overlays = root + "/overlays";
+  const std::string fpga_manager = root + "/fpga0";
+  mkdir(firmware_directory.c_str(), 0755);
+  mkdir(overlays.c_str(), 0755);
+  mkdir(fpga_manager.c_str(), 0755);
+  const std::string base = firmware_directory + "/0123456789ABCDEF";
+  const Firmware firmware = {base + ".bin", base + ".dts", ""};
+  write_file(firmware.bitstreamPath, "bitstream");
+  write_file(firmware.overlayPath, "/dts-v1/;\n/plugin/;\n");
+
+  bool ok = true;
+
+  // the mock remembers what it was asked to load
+  setenv("NIFPGA_LOADER", "mock", 1);
+  auto loader = Loader::create();
+  loader->load(firmware);
+  const auto& loaded = static_cast<MockLoader&>(*loader).getLoaded();
+  const char* const mock_stages[] = {"load"};
+  bool pass = !strcmp(loader->getName(), "mock") && loaded.size() == 1 &&
+              loaded[0].bitstreamPath == firmware.bitstreamPath &&
+              has_stages(*loader, mock_stages, 1);
+  printf("mock: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // the direct loader programs the FPGA manager and replaces the overlay,
+  // reusing the compiled overlay since it's newer than its source
+  write_file(base + ".dtbo", "compiled");
+  struct timeval times[2] = {{1, 0}, {1, 0}};
+  utimes(firmware.overlayPath.c_str(), times);
+  write_file(fpga_manager + "/firmware", "");
+  mkdir((overlays + "/nifpga").c_str(), 0755);
+  DirectLoader direct(firmware_directory, overlays, fpga_manager);
+  bool threw = false;
+  try {
+    direct.load(firmware);
+  } catch (...) {
+    threw = true;
+  }
+  const char* const direct_stages[] = {"compile overlay", "remove overlay",
+                                       "program", "apply overlay"};
+  pass = !threw && read_file(base + ".dtbo") == "compiled" &&
+         read_file(fpga_manager + "/firmware") == "0123456789ABCDEF.bin" &&
+         is_directory(overlays + "/nifpga") &&
+         read_file(overlays + "/nifpga/path") == "0123456789ABCDEF.dtbo" &&
+         has_stages(direct, direct_stages, 4);
+  printf("direct: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // an overlay compiled in-process needs no compiling here, even if older
+  const Firmware compiled = {base + ".bin", base + ".dts",
+                             firmware_directory + "/prebuilt.dtbo"};
+  write_file(compiled.compiledOverlayPath, "prebuilt");
+  utimes(compiled.compiledOverlayPath.c_str(), times);
+  remove((overlays + "/nifpga/path").c_str());
+  DirectLoader precompiled(firmware_directory, overlays, fpga_manager);
+  threw = false;
+  try {
+    precompiled.load(compiled);
+  } catch (...) {
+    threw = true;
+  }
+  const char* const precompiled_stages[] = {"remove overlay", "program",
+                                            "apply overlay"};
+  pass = !threw && read_file(compiled.compiledOverlayPath) == "prebuilt" &&
+         read_file(overlays + "/nifpga/path") == "prebuilt.dtbo" &&
+         has_stages(precompiled, precompiled_stages, 3);
+  printf("precompiled: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // firmware the kernel can't find fails, and the failed stage is still timed
+  remove((overlays + "/nifpga/path").c_str());
+  DirectLoader elsewhere(root + "/elsewhere", overlays, fpga_manager);
+  threw = false;
+  try {
+    elsewhere.load(firmware);
+  } catch (...) {
+    threw = true;
+  }
+  pass = threw && elsewhere.getStages().size() == 3 &&
+         !strcmp(elsewhere.getStages().back().name, "program");
+  printf("failed: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Uses the header lvbitx2h generated from make_typedbitfile's bitfile at build
+// time, on the simulated backend, checking each accessor against the C API.
+
+#include "NiFpga_Typed.h"
+#include "TestHelpers.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace NiFpga_Typed;
+
+// whether a generated resource is what finding it by name at run time gives
+template <typename R>
+static bool is_found(const NiFpga_Session session, const char* name) {
+  NiFpgaEx_Resource resource;
+  return NiFpgaEx_FindResource(session, name, NiFpgaEx_ResourceType_Any,
+                               &resource) == NiFpga_Status_Success &&
+         resource == R::resource;
+}
+
+static bool is_found(const NiFpga_Session session, const char* name,
+                     const uint32_t expected) {
+  NiFpgaEx_Resource resource;
+  return NiFpgaEx_FindResource(session, name, NiFpgaEx_ResourceType_Any,
+                               &resource) == NiFpga_Status_Success &&
+         resource == expected;
+}
+
+// 32-bit and smaller registers go straight to the mapping, from 2 past an
+// aligned word if smaller than 32 bits
+static_assert(Indicator::Count::isMappable, "U32 is mapped");
+static_assert(Control::Rate::isMappable, "Sgl is mapped");
+static_assert(Control::Enable::isMappable, "Bool is mapped");
+static_assert(Control::Trim::isMappable && Control::Trim::offset % 4 == 2,
+              "I16 is mapped from 2 past an aligned word");
+// others go through the library
+static_assert(!Control::Gain::isMappable, "access may time out");
+static_assert(!Indicator::Total::isMappable, "U64 isn't mapped");
+
+int main(int argc, char** argv) {
+  if (argc != 2)
+    return 1;
+  const std::string root = make_temporary_directory("test_lvbitx2h");
+  if (root.empty())
+    return 1;
+  use_simulated_backend(root);
+  // the same bitfile, recompiled since the header was generated
+  const std::string stale = root + "/stale.lvbitx";
+  std::string recompiled = make_simulated_bitfile();
+  const auto signature = recompiled.find(simulated_signature);
+  recompiled.replace(signature, 32, "FEDCBA9876543210FEDCBA9876543210");
+  write_file(stale, recompiled);
+
+  bool ok = true;
+
+  // a bitfile other than the one the header was generated from doesn't open
+  bool pass = nifpga::Session<Bitfile>(stale.c_str(), "RIO0").getStatus() ==
+              NiFpga_Status_SignatureMismatch;
+  nifpga::Session<Bitfile> session(argv[1], "RIO0");
+  pass = pass && session.getStatus() == NiFpga_Status_Success;
+  printf("signature: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+  if (NiFpga_IsError(session.getStatus()))
+    return 1;
+
+  // every resource is what the library would find by name
+  const auto handle = session.get();
+  pass = is_found<Indicator::Count>(handle, "Count") &&
+         is_found<Control::Rate>(handle, "Rate") &&
+         is_found<Control::Gain>(handle, "Gain") &&
+         (Control::Gain::resource & nifpga::accessMayTimeoutBit) &&
+         is_found<Control::Trim>(handle, "Trim") &&
+         is_found<Control::Bitfile_>(handle, "Bitfile") &&
+         is_found<Control::default_>(handle, "default") &&
+         is_found<Indicator::Total>(handle, "Total") &&
+         is_found<ControlArray::Samples>(handle, "Samples") &&
+         is_found<ControlArray::Wave>(handle, "Wave") &&
+         is_found(handle, "Record", ControlCluster::Record) &&
+         is_found(handle, "Input", TargetToHostFifo::Input::number) &&
+         is_found(handle, "Output", HostToTargetFifo::Output::number);
+  printf("resources: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // mapped accesses see what the library wrote and the other way around
+  volatile void* mapped = NULL;
+  size_t size = 0;
+  float rate = 0;
+  int16_t trim = 0;
+  NiFpga_Bool enable = 0;
+  uint32_t count = 1;
+  pass = NiFpgaEx_GetMappedRegisters(handle, &mapped, &size) ==
+             NiFpga_Status_Success &&
+         mapped && size > Control::Trim::offset &&
+         session.write<Control::Rate>(2.5f) == NiFpga_Status_Success &&
+         NiFpga_ReadSgl(handle, Control::Rate::resource, &rate) ==
+             NiFpga_Status_Success &&
+         rate == 2.5f &&
+         NiFpga_WriteSgl(handle, Control::Rate::resource, -4.0f) ==
+             NiFpga_Status_Success &&
+         session.read<Control::Rate>(rate) == NiFpga_Status_Success &&
+         rate == -4.0f &&
+         session.write<Control::Trim>(-1234) == NiFpga_Status_Success &&
+         NiFpga_ReadI16(handle, Control::Trim::resource, &trim) ==
+             NiFpga_Status_Success &&
+         trim == -1234 &&
+         NiFpga_WriteI16(handle, Control::Trim::resource, 77) ==
+             NiFpga_Status_Success &&
+         session.read<Control::Trim>(trim) == NiFpga_Status_Success &&
+         trim == 77 &&
+         session.write<Control::Enable>(1) == NiFpga_Status_Success &&
+         NiFpga_ReadBool(handle, Control::Enable::resource, &enable) ==
+             NiFpga_Status_Success &&
+         enable &&
+         session.read<Indicator::Count>(count) == NiFpga_Status_Success &&
+         count == 0;
+  printf("mapped: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // accesses that may time out or don't fit in one word use the library
+  int16_t gain = 0;
+  uint64_t total = 0;
+  pass = session.write<Control::Gain>(-3) == NiFpga_Status_Success &&
+         NiFpga_ReadI16(handle, Control::Gain::resource, &gain) ==
+             NiFpga_Status_Success &&
+         gain == -3 &&
+         session.write<Indicator::Total>(0x123456789abcdefULL) ==
+             NiFpga_Status_Success &&
+         session.read<Indicator::Total>(total) == NiFpga_Status_Success &&
+         total == 0x123456789abcdefULL;
+  printf("unmapped: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // as do arrays, including fixed-point ones
+  static uint32_t samples[ControlArray::Samples::size];
+  static double wave[ControlArray::Wave::size];
+  for (size_t i = 0; i < ControlArray::Samples::size; i++)
+    samples[i] = static_cast<uint32_t>(i * 3);
+  for (size_t i = 0; i < ControlArray::Wave::size; i++)
+    wave[i] = (static_cast<double>(i) - 50) / 8;
+  pass = session.writeArray<ControlArray::Samples>(samples) ==
+             NiFpga_Status_Success &&
+         session.writeArray<ControlArray::Wave>(wave) == NiFpga_Status_Success;
+  for (auto&& sample : samples)
+    sample = 0;
+  for (auto&& value : wave)
+    value = 0;
+  pass = pass &&
+         session.readArray<ControlArray::Samples>(samples) ==
+             NiFpga_Status_Success &&
+         session.readArray<ControlArray::Wave>(wave) == NiFpga_Status_Success &&
+         samples[255] == 255 * 3 && wave[0] == -6.25 && wave[99] == 6.125;
+  printf("arrays: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // FIFOs go to their own numbers
+  int32_t input[16];
+  uint64_t output[16] = {};
+  pass = session.readFifo<TargetToHostFifo::Input>(input, 16, 1000) ==
+             NiFpga_Status_Success &&
+         session.writeFifo<HostToTargetFifo::Output>(output, 16, 1000) ==
+             NiFpga_Status_Success;
+  printf("fifos: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // downloading again replaces the mapping, which keeps working
+  pass = session.download() == NiFpga_Status_Success &&
+         session.write<Control::Trim>(-5) == NiFpga_Status_Success &&
+         NiFpga_ReadI16(handle, Control::Trim::resource, &trim) ==
+             NiFpga_Status_Success &&
+         trim == -5;
+  printf("download: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -13,6 +13,7 @@
  */
 
 #include "../src/PackedArray.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
@@ -208,6 +209,207 @@ bool run_test(const char *name, int i, const struct test_case<T> &test) {
   return pack && unpack;
 }
 
+// The original element-at-a-time packing, which the optimized versions must
+// match bit for bit.
+template <int type_bits, typename T>
+void reference_pack(uint32_t *out, const T *in, size_t count) {
+  const size_t elements = 32 / type_bits;
+  const uint32_t mask = (1UL << type_bits) - 1;
+
+  for (size_t i = 0; i < count; i++) {
+    const size_t shift = (32 - ((1 + i) * type_bits) % 32) % 32;
+    out[i * type_bits / 32] &= ~(mask << shift);
+    out[i * type_bits / 32] |= (static_cast<uint32_t>(in[i]) & mask) << shift;
+  }
+  if (count && count < elements)
+    out[0] >>= (elements - count) * type_bits;
+}
+
+template <int type_bits, typename T>
+void reference_unpack(const uint32_t *in_, T *out, size_t count) {
+  const size_t elements = 32 / type_bits;
+  const uint32_t mask = (1UL << type_bits) - 1;
+  std::vector<uint32_t> in(in_, in_ + packedArraySize<type_bits>(count));
+
+  if (count && count < elements)
+    in[0] <<= (elements - count) * type_bits;
+  for (size_t i = 0; i < count; i++) {
+    const size_t shift = (32 - ((1 + i) * type_bits) % 32) % 32;
+    out[i] = (in[i * type_bits / 32] >> shift) & mask;
+  }
+}
+
+template <>
+void reference_pack<64, uint64_t>(uint32_t *out, const uint64_t *in,
+                                  size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    out[i * 2] = in[i] >> 32;
+    out[i * 2 + 1] = static_cast<uint32_t>(in[i]);
+  }
+}
+
+template <>
+void reference_unpack<64, uint64_t>(const uint32_t *in, uint64_t *out,
+                                    size_t count) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = static_cast<uint64_t>(in[i * 2]) << 32 | in[i * 2 + 1];
+}
+
+// Compares against the reference for every count up to max_count, at every
+// element alignment within a vector, with pseudo-random contents. Bools get arbitrary byte values to
+// make sure only the least significant bit is used.
+template <typename T, int type_bits>
+bool run_equivalence_test(const char *name, size_t max_count) {
+  bool pass = true;
+  uint32_t seed = 0x12345678;
+  auto next = [&seed] {
+    seed = seed * 1664525 + 1013904223;
+    return seed;
+  };
+
+  for (size_t count = 0; count <= max_count && pass; count++) {
+    for (size_t offset = 0; offset < 16 && pass; offset += sizeof(T)) {
+      const size_t words = packedArraySize<type_bits>(count);
+      // leave room to misalign everything by offset bytes
+      std::vector<uint8_t> native_storage(count * sizeof(T) + offset + 1);
+      std::vector<uint8_t> unpacked_storage(count * sizeof(T) + offset + 1);
+      // always allocate something, so we never pass null
+      std::vector<uint32_t> expected(words + 1, 0), actual(words + 1, 0);
+      std::vector<T> expected_native(count), actual_native(count);
+
+      auto native = &native_storage[offset];
+      for (size_t i = 0; i < count; i++) {
+        T value;
+        const uint64_t random = static_cast<uint64_t>(next()) << 32 | next();
+        memcpy(&value, &random, sizeof(value));
+        memcpy(native + i * sizeof(T), &value, sizeof(value));
+      }
+      std::vector<T> aligned(count);
+      if (count)
+        memcpy(&aligned[0], native, count * sizeof(T));
+
+      reference_pack<type_bits>(expected.data(), aligned.data(), count);
+      packArray<type_bits>(actual.data(), native, count);
+      if (!std::equal(expected.begin(), expected.begin() + words,
+                      actual.begin())) {
+        printf("%s: pack mismatch: count: %zu, offset: %zu\n", name, count,
+               offset);
+        pass = false;
+      }
+
+      auto unpacked = &unpacked_storage[offset];
+      reference_unpack<type_bits>(expected.data(), expected_native.data(),
+                                  count);
+      unpackArray<type_bits>(expected.data(), unpacked, count);
+      if (count)
+        memcpy(&actual_native[0], unpacked, count * sizeof(T));
+      if (expected_native != actual_native) {
+        printf("%s: unpack mismatch: count: %zu, offset: %zu\n", name, count,
+               offset);
+        pass = false;
+      }
+    }
+  }
+
+  printf("%s: equivalence: %s\n", name, pass ? "ok" : "FAIL");
+  return pass;
+}
+
+// Every possible word of Bools must round trip.
+bool run_exhaustive_bool_test() {
+  bool pass = true;
+  uint8_t bools[32];
+  uint32_t word;
+
+  for (uint64_t pattern = 0; pattern <= 0xffffffff && pass;
+       pattern += 0x10001) {
+    const auto expected = static_cast<uint32_t>(pattern);
+    unpackArray<1>(const_cast<uint32_t *>(&expected), bools, 32);
+    packArray<1>(&word, bools, 32);
+    if (word != expected) {
+      printf("bool: round trip mismatch: %08x, got %08x\n", expected, word);
+      pass = false;
+    }
+  }
+
+  printf("bool: exhaustive: %s\n", pass ? "ok" : "FAIL");
+  return pass;
+}
+
+// The runtime-width packing must match the fixed-width packing wherever they
+// overlap, even when done a few elements at a time.
+template <typename T, int type_bits>
+bool run_bits_equivalence_test(const char *name, size_t max_count) {
+  bool pass = true;
+  uint32_t seed = 0x9abcdef0;
+  const size_t chunk = 7;
+
+  for (size_t count = 0; count <= max_count && pass; count++) {
+    const size_t words = packedArraySize<type_bits>(count);
+    std::vector<T> native(count);
+    std::vector<uint64_t> raw(count), unpacked(count);
+    std::vector<uint32_t> expected(words + 1, 0), actual(words + 1, 0);
+    for (size_t i = 0; i < count; i++) {
+      seed = seed * 1664525 + 1013904223;
+      raw[i] = (static_cast<uint64_t>(seed) << 32 | seed * 3) &
+               packedBitsMask(type_bits);
+      native[i] = static_cast<T>(raw[i]);
+    }
+
+    packArray<type_bits>(expected.data(), native.data(), count);
+    for (size_t first = 0; first < count; first += chunk)
+      packBits(actual.data(), type_bits, count, first, &raw[first],
+               std::min(chunk, count - first));
+    if (packedBitsSize(type_bits, count) != words ||
+        !std::equal(expected.begin(), expected.begin() + words,
+                    actual.begin())) {
+      printf("%s: bits pack mismatch: count: %zu\n", name, count);
+      pass = false;
+    }
+
+    for (size_t first = 0; first < count; first += chunk)
+      unpackBits(expected.data(), type_bits, count, first, &unpacked[first],
+                 std::min(chunk, count - first));
+    if (unpacked != raw) {
+      printf("%s: bits unpack mismatch: count: %zu\n", name, count);
+      pass = false;
+    }
+  }
+
+  printf("%s: bits equivalence: %s\n", name, pass ? "ok" : "FAIL");
+  return pass;
+}
+
+// Widths with no fixed-width equivalent, such as fixed-point words, must round
+// trip and use exactly as many bits as they need.
+bool run_bits_round_trip_test() {
+  bool pass = true;
+  uint32_t seed = 0x0badf00d;
+
+  for (size_t bits = 1; bits <= 64 && pass; bits++) {
+    for (size_t count = 0; count <= 100 && pass; count++) {
+      const size_t words = packedBitsSize(bits, count);
+      std::vector<uint64_t> raw(count), unpacked(count);
+      std::vector<uint32_t> packed(words + 1, 0);
+      for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525 + 1013904223;
+        raw[i] = (static_cast<uint64_t>(seed) << 32 | ~seed) &
+                 packedBitsMask(bits);
+      }
+      packBits(packed.data(), bits, count, 0, raw.data(), count);
+      unpackBits(packed.data(), bits, count, 0, unpacked.data(), count);
+      if (unpacked != raw || packed[words] != 0) {
+        printf("bits: round trip mismatch: bits: %zu, count: %zu\n", bits,
+               count);
+        pass = false;
+      }
+    }
+  }
+
+  printf("bits: round trip: %s\n", pass ? "ok" : "FAIL");
+  return pass;
+}
+
 int main() {
   bool ok = true;
   int i;
@@ -240,5 +442,18 @@ int main() {
   for (auto &&test : test_cases_dbl)
     ok &= run_test("dbl", i++, test);
 
+  ok &= run_equivalence_test<uint8_t, 1>("bool", 300);
+  ok &= run_equivalence_test<uint8_t, 8>("u8", 300);
+  ok &= run_equivalence_test<uint16_t, 16>("u16", 300);
+  ok &= run_equivalence_test<uint32_t, 32>("u32", 300);
+  ok &= run_equivalence_test<uint64_t, 64>("u64", 300);
+  ok &= run_exhaustive_bool_test();
+  ok &= run_bits_equivalence_test<uint8_t, 1>("bool", 100);
+  ok &= run_bits_equivalence_test<uint8_t, 8>("u8", 100);
+  ok &= run_bits_equivalence_test<uint16_t, 16>("u16", 100);
+  ok &= run_bits_equivalence_test<uint32_t, 32>("u32", 100);
+  ok &= run_bits_equivalence_test<uint64_t, 64>("u64", 100);
+  ok &= run_bits_round_trip_test();
+
   return ok ? 0 : 1;
 }
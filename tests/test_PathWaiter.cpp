@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/PathWaiter.h"
+#include "TestHelpers.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace nirio;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+static bool exists(const std::string& path) {
+  struct stat status;
+  return !stat(path.c_str(), &status);
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_pathwaiter");
+  if (root.empty())
+    return 1;
+
+  bool ok = true;
+
+  // a path created while waiting is seen, even when the directories leading
+  // to it don't exist yet either
+  const std::string created = root + "/a/b/created";
+  std::thread creator([&] {
+    std::this_thread::sleep_for(milliseconds(50));
+    mkdir((root + "/a").c_str(), 0755);
+    std::this_thread::sleep_for(milliseconds(50));
+    mkdir((root + "/a/b").c_str(), 0755);
+    write_file(created, "");
+  });
+  bool pass = waitOnPath(created, 5000, [&] { return exists(created); });
+  creator.join();
+  printf("created: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // as is one deleted while waiting
+  std::thread deleter([&] {
+    std::this_thread::sleep_for(milliseconds(50));
+    unlink(created.c_str());
+  });
+  pass = waitOnPath(created, 5000, [&] { return !exists(created); });
+  deleter.join();
+  printf("deleted: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a condition that never comes true times out, but not before the timeout
+  const auto start = steady_clock::now();
+  pass = !waitOnPath(root + "/missing", 100,
+                     [&] { return exists(root + "/missing"); }) &&
+         steady_clock::now() - start >= milliseconds(100);
+  printf("timeout: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
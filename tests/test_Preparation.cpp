@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Preparation.h"
+#include "TestHelpers.h"
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace nirio;
+
+static bool is_readable(const std::string& path) {
+  return !access(path.c_str(), R_OK);
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_preparation");
+  if (root.empty())
+    return 1;
+  setenv("NIFPGA_BITFILE_CACHE", "", 1);
+  setenv("NIFPGA_FIRMWARE_DIR", root.c_str(), 1);
+  const std::string directory = root;
+  const std::string signature = "0123456789ABCDEF0123456789ABCDEF";
+  const std::string base = directory + "/" + signature;
+  write_file(directory + "/a.lvbitx", make_bitfile(signature));
+
+  bool ok = true;
+
+  // the bitfile is parsed and its firmware cached in the background
+  Preparation preparation(directory + "/a.lvbitx");
+  auto firmware = preparation.finish();
+  bool pass = firmware.bitstreamPath == base + ".bin" &&
+              firmware.overlayPath == base + ".dts" &&
+              is_readable(firmware.bitstreamPath) &&
+              is_readable(firmware.overlayPath) &&
+              preparation.getBitfile().getSignature() == signature;
+  printf("prepared: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // firmware evicted since is prepared again rather than lost
+  remove(firmware.bitstreamPath.c_str());
+  firmware = preparation.finish();
+  pass = is_readable(firmware.bitstreamPath) && preparation.takeBitfile();
+  printf("evicted: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // failures are held until finished
+  Preparation missing(directory + "/missing.lvbitx");
+  bool threw = false;
+  try {
+    missing.finish();
+  } catch (...) {
+    threw = true;
+  }
+  printf("failed: %s\n", threw ? "ok" : "FAIL");
+  ok &= threw;
+
+  // one that's never finished is waited on before it goes away
+  { Preparation unused(directory + "/a.lvbitx"); }
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
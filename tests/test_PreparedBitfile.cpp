@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+// Opens and downloads prepared bitfiles on the simulated backend through the
+// NiFpgaEx_*Prepared API.
+
+#include "NiFpga.h"
+#include "TestHelpers.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// the U32 indicator of make_simulated_bitfile
+static const uint32_t count_register = 0x40018;
+
+int main() {
+  const std::string root = make_temporary_directory("test_preparedbitfile");
+  if (root.empty())
+    return 1;
+  use_simulated_backend(root);
+  const std::string bitfile = root + "/simulated.lvbitx";
+  const std::string other = root + "/other.lvbitx";
+  write_file(bitfile, make_simulated_bitfile());
+  write_file(other, make_bitfile("FEDCBA9876543210FEDCBA9876543210"));
+
+  bool ok = true;
+
+  // a session opened from a prepared bitfile works like any other, and the
+  // prepared bitfile is released by opening it
+  NiFpgaEx_PreparedBitfile prepared;
+  NiFpga_Session session = 0;
+  uint32_t count = 1;
+  bool pass =
+      NiFpgaEx_PrepareBitfile(bitfile.c_str(), &prepared) ==
+          NiFpga_Status_Success &&
+      NiFpgaEx_OpenPrepared(prepared, simulated_signature, "RIO0", 0,
+                            &session) == NiFpga_Status_Success &&
+      NiFpga_ReadU32(session, count_register, &count) ==
+          NiFpga_Status_Success &&
+      count == 0 &&
+      NiFpgaEx_ReleasePrepared(prepared) == NiFpga_Status_InvalidParameter;
+  printf("open: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // so is downloading the session's own bitfile again
+  pass = NiFpgaEx_PrepareBitfile(bitfile.c_str(), &prepared) ==
+             NiFpga_Status_Success &&
+         NiFpgaEx_DownloadPrepared(session, prepared) ==
+             NiFpga_Status_Success &&
+         NiFpgaEx_ReleasePrepared(prepared) == NiFpga_Status_InvalidParameter;
+  printf("download: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // another bitfile can't be downloaded to the session, but stays prepared
+  // for whatever it was meant for
+  pass = NiFpgaEx_PrepareBitfile(other.c_str(), &prepared) ==
+             NiFpga_Status_Success &&
+         NiFpgaEx_DownloadPrepared(session, prepared) ==
+             NiFpga_Status_SignatureMismatch &&
+         NiFpgaEx_ReleasePrepared(prepared) == NiFpga_Status_Success &&
+         NiFpgaEx_ReleasePrepared(prepared) == NiFpga_Status_InvalidParameter;
+  printf("mismatch: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // nor can anything be downloaded to a session that isn't open
+  pass = NiFpgaEx_PrepareBitfile(bitfile.c_str(), &prepared) ==
+             NiFpga_Status_Success &&
+         NiFpgaEx_DownloadPrepared(session + 1, prepared) ==
+             NiFpga_Status_InvalidSession &&
+         NiFpgaEx_ReleasePrepared(prepared) == NiFpga_Status_Success;
+  printf("invalid session: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a bitfile that failed to prepare fails whatever it's passed to, which
+  // releases it
+  const std::string missing = root + "/missing.lvbitx";
+  pass = NiFpgaEx_PrepareBitfile(missing.c_str(), &prepared) ==
+             NiFpga_Status_Success &&
+         NiFpga_IsError(NiFpgaEx_DownloadPrepared(session, prepared)) &&
+         NiFpgaEx_ReleasePrepared(prepared) == NiFpga_Status_InvalidParameter;
+  printf("failure: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= NiFpga_Close(session, 0) == NiFpga_Status_Success;
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
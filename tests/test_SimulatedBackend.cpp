@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/DmaBuf.h"
+#include "../src/Loader.h"
+#include "../src/SimulatedBackend.h"
+#include "../src/SysfsFile.h"
+#include "../src/dtgen.h"
+#include "TestHelpers.h"
+#include <fcntl.h>
+#include <misc/nirio.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace nirio;
+
+// returns the errno of writing an attribute, or 0
+static int write_attribute(DeviceBackend& backend, const char* attribute,
+                           const char* value) {
+  const auto path = backend.getSysfsRoot() + "/RIO0/" + attribute;
+  const int descriptor = backend.open(path, O_WRONLY | O_CLOEXEC);
+  if (descriptor == -1)
+    return errno;
+  const int error =
+      backend.write(descriptor, value, strlen(value)) == -1 ? errno : 0;
+  backend.close(descriptor);
+  return error;
+}
+
+// returns the errno of an ioctl, or 0
+static int try_ioctl(DeviceBackend& backend, int descriptor,
+                     unsigned long request, void* argument = NULL) {
+  return backend.ioctl(descriptor, request, argument) == -1 ? errno : 0;
+}
+
+static bool read_bool(const char* attribute) {
+  return SysfsFile("RIO0", attribute).readBool();
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_simulatedbackend");
+  if (root.empty())
+    return 1;
+  // nothing is ever created under the roots; they only have to be ours
+  setenv("NIFPGA_BACKEND", "simulated", 1);
+  setenv("NIFPGA_SYSFS_ROOT", (root + "/sys").c_str(), 1);
+  setenv("NIFPGA_DEV_ROOT", (root + "/dev").c_str(), 1);
+  setenv("NIFPGA_DMA_HEAP_ROOT", (root + "/heap").c_str(), 1);
+  auto& backend = DeviceBackend::get();
+  auto* const simulated = dynamic_cast<SimulatedBackend*>(&backend);
+  auto* const device = simulated ? simulated->getDevice("RIO0") : nullptr;
+  if (!device)
+    return 1;
+
+  const std::string base = root + "/" + simulated_signature;
+  const Firmware firmware = {base + ".bin", base + ".dts", ""};
+  write_file(firmware.bitstreamPath, "bitstream");
+  write_file(firmware.overlayPath, simulated_overlay);
+
+  bool ok = true;
+
+  // nothing exists until firmware is loaded from its overlay, compiled or not
+  SysfsFile signature_file("RIO0", "signature");
+  bool pass = !signature_file.exists();
+  backend.createLoader()->load(firmware);
+  pass = pass && signature_file.exists() &&
+         signature_file.readLineNoErrno() == simulated_signature &&
+         SysfsFile("RIO0", "fpga_size").readU32() == 0x80000 &&
+         FifoSysfsFile("RIO0", 1, "element_bytes").readU32() == 8 &&
+         !read_bool("vi_started");
+  const Firmware compiled = {firmware.bitstreamPath, firmware.overlayPath,
+                             base + ".dtbo"};
+  const auto blob = dtgen::dt_tree::parse(simulated_overlay).flatten();
+  write_file(compiled.compiledOverlayPath,
+             std::string(blob.begin(), blob.end()));
+  write_file(compiled.overlayPath, "not device tree source");
+  backend.createLoader()->load(compiled);
+  pass = pass && device->getSignature() == simulated_signature;
+  printf("load: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // the VI runs, finishes, and aborts as the driver's attributes say
+  pass = write_attribute(backend, "run_vi", "1") == 0 &&
+         read_bool("vi_started") &&
+         write_attribute(backend, "run_vi", "1") == EALREADY;
+  device->finish();
+  pass = pass && read_bool("vi_finished") &&
+         write_attribute(backend, "run_vi", "1") == 0 &&
+         !read_bool("vi_finished") &&
+         write_attribute(backend, "abort_vi", "1") == 0 &&
+         !read_bool("vi_started") &&
+         write_attribute(backend, "signature", "1") == EIO;
+  // an attribute being polled stays open even if it's invalidated meanwhile
+  const SysfsFile started_file("RIO0", "vi_started");
+  const auto polled = started_file.getFile();
+  started_file.invalidate();
+  char started = 0;
+  pass = pass && polled->pread(&started, 1, 0) == 1 && started == '0' &&
+         started_file.getFile() != polled;
+  printf("run: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // registers are shared with the BAR, and wide ones need matching counts
+  auto board = std::make_unique<DeviceFile>(DeviceFile::getCdevPath("RIO0"),
+                                            DeviceFile::ReadWrite);
+  board->mapMemory(0x80000);
+  board->mappedWrite<uint32_t>(0x100, 42);
+  device->poke(0x104, 7);
+  alignas(ioctl_nirio_array) uint8_t buffer[sizeof(ioctl_nirio_array) + 16];
+  auto* const array = reinterpret_cast<ioctl_nirio_array*>(buffer);
+  array->offset = 0x200;
+  array->count = 4;
+  for (uint32_t i = 0; i < 4; i++)
+    array->data[i] = i + 1;
+  pass = device->peek(0x100) == 42 &&
+         board->mappedRead<uint32_t>(0x104) == 7 &&
+         try_ioctl(backend, board->getDescriptor(), NIRIO_IOC_WRITE_ARRAY,
+                   array) == 0;
+  memset(array->data, 0, 16);
+  pass = pass &&
+         try_ioctl(backend, board->getDescriptor(), NIRIO_IOC_READ_ARRAY,
+                   array) == 0 &&
+         array->data[0] == 1 && array->data[3] == 4;
+  array->count = 2;
+  pass = pass && try_ioctl(backend, board->getDescriptor(),
+                           NIRIO_IOC_READ_ARRAY, array) == EINVAL;
+  printf("registers: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // target-to-host FIFOs fill with a count, and only one may own each
+  std::unique_ptr<DmaBuf> dma(DmaBuf::allocate(4096));
+  DeviceFile fifo(DeviceFile::getFifoCdevPath("RIO0", 0), DeviceFile::ReadOnly);
+  const int descriptor = fifo.getDescriptor();
+  struct ioctl_nirio_fifo_set_buf set_buf = {dma->getDescriptor()};
+  struct ioctl_nirio_fifo_acquire acquire = {10, 0, 0, 0};
+  uint64_t count = 20;
+  pass = backend.open(DeviceFile::getFifoCdevPath("RIO0", 0), O_RDONLY) ==
+             -1 &&
+         errno == EBUSY &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_ACQUIRE, &acquire) ==
+             EPERM &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_SET_BUF, &set_buf) ==
+             0 &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_START) == 0 &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_START) == EALREADY &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_ACQUIRE, &acquire) ==
+             0 &&
+         !acquire.timed_out && acquire.available == 1014;
+  const auto* const elements =
+      static_cast<const volatile uint32_t*>(dma->getPointer());
+  pass = pass && elements[0] == 0 && elements[9] == 9 &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_RELEASE, &count) ==
+             ENODATA;
+  count = 10;
+  pass = pass &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_RELEASE, &count) == 0 &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_GET_AVAIL, &count) ==
+             0 &&
+         count == 1024 && device->getFifoTransferred(0) == 1034;
+  printf("fifo: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // host-to-target FIFOs drain at their rate
+  std::unique_ptr<DmaBuf> slow_dma(DmaBuf::allocate(4096));
+  DeviceFile slow(DeviceFile::getFifoCdevPath("RIO0", 1),
+                  DeviceFile::WriteOnly);
+  device->setFifoRate(1, 1000);
+  set_buf.fd = slow_dma->getDescriptor();
+  slow.ioctl(NIRIO_IOC_FIFO_SET_BUF, &set_buf);
+  slow.ioctl(NIRIO_IOC_FIFO_START);
+  acquire = {512, 0, 0, 0};
+  slow.ioctl(NIRIO_IOC_FIFO_ACQUIRE, &acquire);
+  count = 512;
+  slow.ioctl(NIRIO_IOC_FIFO_RELEASE, &count);
+  acquire = {100, 10, 0, 0};
+  slow.ioctl(NIRIO_IOC_FIFO_ACQUIRE, &acquire);
+  pass = acquire.timed_out && acquire.available < 100;
+  const auto start = std::chrono::steady_clock::now();
+  acquire = {20, 1000, 0, 0};
+  slow.ioctl(NIRIO_IOC_FIFO_ACQUIRE, &acquire);
+  const auto waited = std::chrono::steady_clock::now() - start;
+  pass = pass && !acquire.timed_out && waited < std::chrono::milliseconds(500);
+  printf("rate: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // aborting stops every FIFO until it's started again
+  write_attribute(backend, "run_vi", "1");
+  write_attribute(backend, "abort_vi", "1");
+  pass = try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_GET_AVAIL, &count) ==
+             EPERM &&
+         try_ioctl(backend, descriptor, NIRIO_IOC_FIFO_START) == 0;
+  printf("abort: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // IRQs wake waiters until they're acknowledged
+  struct ioctl_nirio_irq_wait wait = {1, 0x3, 0, 0, 0};
+  uint32_t irqs = 0x2;
+  board->ioctl(NIRIO_IOC_IRQ_WAIT, &wait);
+  pass = wait.timed_out;
+  device->assertIrqs(0x6);
+  board->ioctl(NIRIO_IOC_IRQ_WAIT, &wait);
+  pass = pass && !wait.timed_out && wait.asserted == 0x2;
+  board->ioctl(NIRIO_IOC_IRQ_ACK, &irqs);
+  board->ioctl(NIRIO_IOC_IRQ_WAIT, &wait);
+  pass = pass && wait.timed_out;
+  printf("irqs: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // the last session to close resets the FPGA, if asked to
+  auto other = std::make_unique<DeviceFile>(DeviceFile::getCdevPath("RIO0"),
+                                            DeviceFile::ReadWrite);
+  pass = SysfsFile("RIO0", "session_count").readU32() == 2 &&
+         try_ioctl(backend, board->getDescriptor(),
+                   NIRIO_IOC_RESET_ON_LAST_REF) == EBUSY;
+  other.reset();
+  pass = pass && device->getSessionCount() == 1 &&
+         try_ioctl(backend, board->getDescriptor(),
+                   NIRIO_IOC_RESET_ON_LAST_REF) == 0;
+  board.reset();
+  pass = pass && device->getSessionCount() == 0 && device->peek(0x100) == 0;
+  printf("reset: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Timing.h"
+#include "TestHelpers.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace nirio;
+using std::chrono::milliseconds;
+
+int main() {
+  bool ok = true;
+
+  // nothing is recorded outside of a call
+  { TimingScope scope(NiFpgaEx_TimingStage_Parse); }
+  bool pass = !TimingRecorder::getCurrent() &&
+              TimingRecorder::getLast().counts[NiFpgaEx_TimingStage_Parse] == 0;
+  printf("idle: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // nested stages only count toward the innermost
+  {
+    TimingRecorder recorder;
+    {
+      TimingScope outer(NiFpgaEx_TimingStage_SysfsRead);
+      std::this_thread::sleep_for(milliseconds(10));
+      {
+        TimingScope inner(NiFpgaEx_TimingStage_DeviceNode);
+        std::this_thread::sleep_for(milliseconds(50));
+      }
+    }
+    { TimingScope again(NiFpgaEx_TimingStage_DeviceNode); }
+    recorder.finish();
+  }
+  const auto& last = TimingRecorder::getLast();
+  const auto sysfs = last.durations[NiFpgaEx_TimingStage_SysfsRead];
+  const auto node = last.durations[NiFpgaEx_TimingStage_DeviceNode];
+  pass = sysfs >= milliseconds(10) && sysfs < milliseconds(50) &&
+         node >= milliseconds(50) &&
+         last.counts[NiFpgaEx_TimingStage_SysfsRead] == 1 &&
+         last.counts[NiFpgaEx_TimingStage_DeviceNode] == 2 &&
+         last.total >= sysfs + node;
+  printf("nested: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // stages recorded on another thread can be merged into this one's
+  Timings background;
+  std::thread([&] {
+    TimingRecorder recorder;
+    { TimingScope scope(NiFpgaEx_TimingStage_Decode); }
+    background = recorder.finish();
+  }).join();
+  {
+    TimingRecorder recorder;
+    TimingRecorder::getCurrent()->merge(background);
+  }
+  pass = TimingRecorder::getLast().counts[NiFpgaEx_TimingStage_Decode] == 1;
+  printf("merged: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a line of JSON is appended for each call
+  char path[] = "/tmp/test_timing.XXXXXX";
+  close(mkstemp(path));
+  setenv("NIFPGA_TIMING_LOG", path, 1);
+  Timings timings;
+  timings.loader = "mock";
+  timings.loaderSteps.push_back({"load", std::chrono::nanoseconds(5)});
+  logTimings("NiFpga_Open", 0, timings);
+  logTimings("NiFpga_Download", -52005, timings);
+  const auto log = read_file(path);
+  pass = log.find("{\"call\":\"NiFpga_Open\",\"status\":0,") == 0 &&
+         log.find("\"parse\":{\"ns\":0,\"count\":0}") != std::string::npos &&
+         log.find("\"loader\":{\"name\":\"mock\",\"steps\":{\"load\":5}}") !=
+             std::string::npos &&
+         log.find("}\n{\"call\":\"NiFpga_Download\",\"status\":-52005,") !=
+             std::string::npos &&
+         log.back() == '\n';
+  printf("logged: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+  unlink(path);
+
+  return ok ? 0 : 1;
+}
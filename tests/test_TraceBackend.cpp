@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/Common.h"
+#include "../src/Loader.h"
+#include "../src/SimulatedBackend.h"
+#include "../src/TraceBackend.h"
+#include "../src/linux/dma-heap.h"
+#include "TestHelpers.h"
+#include <fcntl.h>
+#include <misc/nirio.h>
+#include <sys/mman.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace nirio;
+
+// what the workload saw of the driver
+struct observed {
+  bool exists;
+  std::string signature;
+  uint32_t array[4];
+  uint64_t available;
+  bool timed_out;
+  std::chrono::steady_clock::duration waited;
+};
+
+// does what a session would once firmware is loaded, straight through a
+// backend
+static bool run(DeviceBackend& backend, observed& seen) {
+  const auto attribute = backend.getSysfsRoot() + "/RIO0/signature";
+  struct stat status;
+  seen.exists = backend.stat(attribute, &status) == 0;
+
+  char line[64] = {};
+  int descriptor = backend.open(attribute, O_RDONLY | O_CLOEXEC);
+  if (descriptor == -1 || backend.read(descriptor, line, sizeof(line)) <= 0)
+    return false;
+  backend.close(descriptor);
+  seen.signature = std::string(line, strcspn(line, "\n"));
+
+  // registers, wide ones through ioctls
+  const int board =
+      backend.open(joinPath(backend.getDevRoot(), "RIO0"), O_RDWR);
+  void* const bar =
+      backend.mmap(NULL, 0x80000, PROT_READ | PROT_WRITE, MAP_SHARED, board, 0);
+  if (board == -1 || bar == MAP_FAILED)
+    return false;
+  static_cast<volatile uint32_t*>(bar)[0x40] = 42;
+  alignas(ioctl_nirio_array) uint8_t buffer[sizeof(ioctl_nirio_array) + 16];
+  auto* const array = reinterpret_cast<ioctl_nirio_array*>(buffer);
+  array->offset = 0x200;
+  array->count = 4;
+  for (uint32_t i = 0; i < 4; i++)
+    array->data[i] = i + 1;
+  if (backend.ioctl(board, NIRIO_IOC_WRITE_ARRAY, array))
+    return false;
+  memset(array->data, 0, 16);
+  if (backend.ioctl(board, NIRIO_IOC_READ_ARRAY, array))
+    return false;
+  memcpy(seen.array, array->data, sizeof(seen.array));
+
+  // a FIFO waits on its rate, into a buffer from the DMA heap
+  const int heap =
+      backend.open(joinPath(backend.getDmaHeapRoot(), "system"), O_RDWR);
+  struct dma_heap_allocation_data allocation = {4096, 0, O_RDWR, 0};
+  if (heap == -1 || backend.ioctl(heap, DMA_HEAP_IOCTL_ALLOC, &allocation))
+    return false;
+  backend.close(heap);
+  void* const dma = backend.mmap(NULL, 4096, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED, allocation.fd, 0);
+  const int fifo =
+      backend.open(joinPath(backend.getDevRoot(), "RIO0fifo0"), O_RDONLY);
+  struct ioctl_nirio_fifo_set_buf set_buf = {static_cast<int>(allocation.fd)};
+  if (dma == MAP_FAILED || fifo == -1 ||
+      backend.ioctl(fifo, NIRIO_IOC_FIFO_SET_BUF, &set_buf) ||
+      backend.ioctl(fifo, NIRIO_IOC_FIFO_START, NULL))
+    return false;
+  struct ioctl_nirio_fifo_acquire acquire = {200, 1000, 0, 0};
+  const auto start = std::chrono::steady_clock::now();
+  if (backend.ioctl(fifo, NIRIO_IOC_FIFO_ACQUIRE, &acquire))
+    return false;
+  seen.waited = std::chrono::steady_clock::now() - start;
+  seen.available = acquire.available;
+  seen.timed_out = acquire.timed_out;
+  uint64_t count = 200;
+  if (backend.ioctl(fifo, NIRIO_IOC_FIFO_RELEASE, &count))
+    return false;
+
+  backend.close(fifo);
+  backend.munmap(dma, 4096);
+  backend.close(allocation.fd);
+  backend.munmap(bar, 0x80000);
+  backend.close(board);
+  return true;
+}
+
+int main() {
+  const std::string root = make_temporary_directory("test_tracebackend");
+  if (root.empty())
+    return 1;
+  const std::string trace = root + "/trace";
+
+  bool ok = true;
+
+  // record a simulated device, its FIFO slowed down enough to time
+  observed recorded = {};
+  struct stat status;
+  bool pass;
+  {
+    auto* const simulated =
+        new SimulatedBackend(root + "/sys", root + "/dev", root + "/heap");
+    SimulatedDevice* const device = simulated->getDevice("RIO0");
+    TracingBackend tracing(std::unique_ptr<DeviceBackend>(simulated), trace);
+    const std::string base = root + "/" + simulated_signature;
+    write_file(base + ".bin", "bitstream");
+    write_file(base + ".dts", simulated_overlay);
+    pass = tracing.stat(tracing.getSysfsRoot() + "/RIO0/signature",
+                        &status) == -1;
+    tracing.createLoader()->load({base + ".bin", base + ".dts", ""});
+    device->setFifoRate(0, 10000);
+    pass = pass && run(tracing, recorded) && recorded.exists &&
+           recorded.signature == simulated_signature &&
+           recorded.array[3] == 4 &&
+           !recorded.timed_out &&
+           recorded.waited >= std::chrono::milliseconds(10);
+  }
+  printf("record: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // replaying sees what was recorded, and takes as long
+  ReplayBackend replay(trace);
+  observed replayed = {};
+  pass = replay.getSysfsRoot() == root + "/sys" &&
+         replay.stat(replay.getSysfsRoot() + "/RIO0/signature", &status) ==
+             -1 &&
+         errno == ENOENT && run(replay, replayed) && replay.isFaithful() &&
+         replayed.exists && replayed.signature == simulated_signature &&
+         !memcmp(replayed.array, recorded.array, sizeof(recorded.array)) &&
+         replayed.available == recorded.available &&
+         replayed.timed_out == recorded.timed_out &&
+         replayed.waited >= recorded.waited -
+                                std::chrono::microseconds(200);
+  printf("replay: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // or as fast as it can
+  ReplayBackend untimed(trace, false);
+  untimed.stat(untimed.getSysfsRoot() + "/RIO0/signature", &status);
+  pass = run(untimed, replayed) && untimed.isFaithful() &&
+         replayed.waited < recorded.waited / 2;
+  printf("untimed: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // anything that wasn't recorded fails, and is reported
+  const int board =
+      untimed.open(joinPath(untimed.getDevRoot(), "RIO0"), O_RDWR);
+  pass = board != -1 && untimed.ioctl(board, NIRIO_IOC_IRQ_ACK, NULL) == -1 &&
+         errno == EIO && !untimed.isFaithful() &&
+         untimed.open(root + "/elsewhere", O_RDONLY) == -1 &&
+         errno == EIO;
+  untimed.close(board);
+  printf("diverged: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  ok &= remove_directory(root);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2024 National Instruments
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#include "../src/dtgen.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace dtgen;
+
+static const char* const overlay = "/dts-v1/;\n"
+                                   "/plugin/;\n"
+                                   "\n"
+                                   "/ {\n"
+                                   "\tfragment@0 {\n"
+                                   "\t\ttarget = <&fpga_full>;\n"
+                                   "\t\t__overlay__ {\n"
+                                   "\t\t\t/* a clock for the user */\n"
+                                   "\t\t\tclk: clock {\n"
+                                   "\t\t\t\t#clock-cells = <0>;\n"
+                                   "\t\t\t\tclock-frequency = <100000000>;\n"
+                                   "\t\t\t};\n"
+                                   "\t\t\tuser {\n"
+                                   "\t\t\t\tclocks = <&clk>, <&gic 0x1>;\n"
+                                   "\t\t\t\tnames = \"a\", \"b\";\n"
+                                   "\t\t\t\tmac = [00 11 22]; // bytes\n"
+                                   "\t\t\t};\n"
+                                   "\t\t};\n"
+                                   "\t};\n"
+                                   "};\n";
+
+static std::vector<uint8_t> bytes(const char* value, size_t size) {
+  return std::vector<uint8_t>(value, value + size);
+}
+
+static std::vector<uint8_t> cells(std::initializer_list<uint32_t> values) {
+  std::vector<uint8_t> v;
+  for (uint32_t value : values)
+    for (int shift = 24; shift >= 0; shift -= 8)
+      v.push_back(static_cast<uint8_t>(value >> shift));
+  return v;
+}
+
+static bool has_value(const dt_node& root, const char* path, const char* prop,
+                      const std::vector<uint8_t>& value) {
+  const auto* node = root.find_node(path);
+  const auto* found = node ? node->find_property(prop) : nullptr;
+  return found && found->value == value;
+}
+
+static bool throws(const char* source) {
+  try {
+    dt_tree::parse(source).flatten();
+  } catch (const dt_error&) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+  bool ok = true;
+
+  // properties parse to the bytes they flatten to, keeping their text
+  const auto tree = dt_tree::parse(overlay);
+  const auto* user = tree.root->find_node("fragment@0/__overlay__/user");
+  bool pass = tree.plugin && user &&
+              user->find_property("clocks")->text ==
+                  " = <&clk>, <&gic 0x1>" &&
+              has_value(*tree.root, "fragment@0/__overlay__/clock",
+                        "clock-frequency", cells({100000000})) &&
+              has_value(*tree.root, "fragment@0/__overlay__/user", "names",
+                        bytes("a\0b", 4)) &&
+              has_value(*tree.root, "fragment@0/__overlay__/user", "mac",
+                        bytes("\x00\x11\x22", 3));
+  printf("parse: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // like dtc -@, labels become symbols and references become fixups
+  const auto blob = tree.flatten();
+  const auto flat = dt_tree::unflatten(blob);
+  const char fixup[] = "/fragment@0/__overlay__/user:clocks:4";
+  const char symbol[] = "/fragment@0/__overlay__/clock";
+  pass = has_value(*flat.root, "fragment@0/__overlay__/clock", "phandle",
+                   cells({1})) &&
+         has_value(*flat.root, "fragment@0/__overlay__/user", "clocks",
+                   cells({1, 0xffffffff, 1})) &&
+         has_value(*flat.root, "fragment@0", "target", cells({0xffffffff})) &&
+         has_value(*flat.root, "__symbols__", "clk",
+                   bytes(symbol, sizeof(symbol))) &&
+         has_value(*flat.root, "__fixups__", "fpga_full",
+                   bytes("/fragment@0:target:0", 21)) &&
+         has_value(*flat.root, "__fixups__", "gic",
+                   bytes(fixup, sizeof(fixup))) &&
+         has_value(*flat.root, "__local_fixups__/fragment@0/__overlay__/user",
+                   "clocks", cells({0}));
+  printf("fixups: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // orphans become fragments targeting their label
+  dt_tree orphaned;
+  orphaned.plugin = true;
+  auto node = std::make_unique<dt_node>("");
+  node->add_node(std::make_unique<dt_node>("nirio", 0x1300000000ULL));
+  orphaned.add_orphan("fpga_full", std::move(node));
+  const auto fragments = dt_tree::unflatten(orphaned.flatten());
+  pass = fragments.root->find_node("fragment@0/__overlay__/nirio@1300000000") &&
+         has_value(*fragments.root, "__fixups__", "fpga_full",
+                   bytes("/fragment@0:target:0", 21)) &&
+         orphaned.render().find("&fpga_full {") != std::string::npos;
+  printf("orphans: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // names that end another are stored once, as dtc does
+  dt_tree shared;
+  shared.root->add_property("#size-cells", 2u);
+  shared.root->add_property("size-cells", 2u);
+  const auto strings = shared.flatten();
+  const auto strings_size = static_cast<uint32_t>(strings[32]) << 24 |
+                            strings[33] << 16 | strings[34] << 8 | strings[35];
+  pass = strings_size == sizeof("#size-cells") &&
+         has_value(*dt_tree::unflatten(strings).root, "", "size-cells",
+                   cells({2}));
+  printf("strings: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // a blob read back flattens to the same blob
+  pass = dt_tree::unflatten(blob).flatten() == blob && blob[0] == 0xd0 &&
+         blob[1] == 0x0d && blob[2] == 0xfe && blob[3] == 0xed;
+  printf("round trip: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // what dtc would have to preprocess or evaluate is refused
+  pass = throws("#include <foo.h>\n/ { };") &&
+         throws("/ { a = <(1 + 2)>; };") && throws("/ { a = <FOO>; };") &&
+         throws("/ { a = <&{/path}>; };") &&
+         throws("/ { a = /bits/ 8 <1>; };") &&
+         throws("/delete-node/ &foo;") && throws("/ { a = \"b; };") &&
+         throws("/ { a = <&undefined>; };") && !throws(overlay);
+  printf("unsupported: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  // the builder renders source just as it always has
+  dt_node rio("nirio", 0x1300000000ULL, "rio");
+  rio.add_property("compatible", "ni,rio");
+  rio.add_property("reg", std::vector<uint32_t>{0x13, 0x0});
+  rio.add_property("dma-coherent");
+  rio.add_property_phandle("interrupt-parent", "gic");
+  pass = rio.render(0) == "rio: nirio@1300000000 {\n"
+                          "\tcompatible = \"ni,rio\";\n"
+                          "\treg = <0x13 0x0 >;\n"
+                          "\tdma-coherent;\n"
+                          "\tinterrupt-parent = <&gic>;\n"
+                          "};\n";
+  printf("render: %s\n", pass ? "ok" : "FAIL");
+  ok &= pass;
+
+  return ok ? 0 : 1;
+}